@@ -73,6 +73,8 @@ time_t runningTime;
 struct config_param bhistParams[] = {
 #define LSB_SHAREDIR 0
     {"LSB_SHAREDIR", NULL},
+#define LSB_BHIST_THREADS 1
+    {"LSB_BHIST_THREADS", NULL},
     {NULL, NULL}
 };
 
@@ -1274,6 +1276,26 @@ logfile_check(struct bhistReq *Req)
         return 0;
     }
 
+    /* Several rotated files and no job ID index,
+     * read them in parallel.
+     */
+    if (!(Req->options & OPT_ELOGFILE)
+        && jobIdIndexSPtr == NULL
+        && eLogPtr->curOpenFile > 0
+        && eLogPtr->curOpenFile != eLogPtr->lastOpenFile) {
+        int numThreads = 0;
+
+        if (bhistParams[LSB_BHIST_THREADS].paramValue)
+            numThreads = atoi(bhistParams[LSB_BHIST_THREADS].paramValue);
+
+        fclose(eLogPtr->fp);
+        readEventFiles(workDir,
+                       eLogPtr->curOpenFile,
+                       eLogPtr->lastOpenFile,
+                       numThreads,
+                       Req);
+        return 0;
+    }
 
     while (TRUE) {
 
@@ -2567,6 +2589,13 @@ printChronicleEventLog(struct eventRec *log, struct bhistReq *req)
                         log->eventLog.jobExecuteLog.execUsername);
                 prtLine(prline);
             }
+            if (log->eventLog.jobExecuteLog.cpuBind &&
+                strcmp(log->eventLog.jobExecuteLog.cpuBind, ""))
+            {
+                sprintf(prline, ", CPUs bound <%s>",
+                        log->eventLog.jobExecuteLog.cpuBind);
+                prtLine(prline);
+            }
             prtLine(";\n");
             break;
 
@@ -2997,11 +3026,22 @@ initJobIdIndexS( struct jobIdIndexS *indexS, char *fileName )
         return -1;
     }
 
+    /* An index of an older version has no offsets, mbd
+     * rebuilds it at the next log switch, until then
+     * search the files by time.
+     */
+    if (strcmp(version, LSF_JOBIDINDEX_VERSION)) {
+        fclose(indexS->fp);
+        return -1;
+    }
+
     fseek(indexS->fp, 80, SEEK_SET);
 
     strcpy(indexS->fileName, fileName);
     indexS->version = atof(version);
     indexS->curRow = 0;
+    indexS->seekPos = -1;
+    indexS->endPos = -1;
 
     return 0;
 }
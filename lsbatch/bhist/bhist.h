@@ -199,6 +199,7 @@ extern int  matchJobId(struct bhistReq *, LS_LONG_INT);
 
 extern hEnt *chekMemb(struct hTab *tabPtr, LS_LONG_INT member);
 extern void parse_event(struct eventRec *, struct bhistReq *);
+extern int readEventFiles(char *, int, int, int, struct bhistReq *);
 extern int bhistReqInit(struct bhistReq *);
 
 #endif
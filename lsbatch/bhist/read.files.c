@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include <pthread.h>
+#include "bhist.h"
+
+/* Read the rotated event files in parallel.
+ *
+ * Each worker thread takes the next file, parses it
+ * and keeps the offsets of the records that pass the
+ * job ID, user and time filters. The main thread then
+ * merges the files by event time, reads the kept
+ * records again and gives them to parse_event() which
+ * builds the job history and is not thread safe.
+ *
+ * The workers only read mapped files and keep their
+ * errors with the records, a file that cannot be
+ * mapped is read by the main thread after them.
+ */
+#define MAX_READ_THREADS  32
+
+/* A record kept by a worker, or a read error
+ * to report when the merge gets to it.
+ */
+struct keptRec {
+    long pos;
+    time_t eventTime;
+    int lineNum;
+    int err;
+};
+
+struct eventFile {
+    char name[MAXFILENAMELEN];
+    long start;
+    time_t first;
+    time_t last;
+    int skip;
+    int serial;
+    int numKept;
+    int maxKept;
+    struct keptRec *kept;
+    FILE *fp;
+    struct eventFileMap *map;
+    int cur;
+};
+
+struct readCtx {
+    pthread_mutex_t lock;
+    struct eventFile *files;
+    int numFiles;
+    int next;
+    struct bhistReq *req;
+};
+
+static int fileHeader(const char *, time_t *, time_t *);
+static void *readWorker(void *);
+static void readFile(struct eventFile *, struct bhistReq *, int);
+static int keepRec(struct eventRec *, struct bhistReq *);
+static int addKept(struct eventFile *, long, time_t, int, int);
+static int mergeFiles(struct eventFile *, int, struct bhistReq *);
+
+/* readEventFiles()
+ *
+ * Read lsb.events.first down to lsb.events.last of
+ * eventDir, lsb.events is number 0 and it is read
+ * from the position in its header.
+ */
+int
+readEventFiles(char *eventDir,
+               int first,
+               int last,
+               int numThreads,
+               struct bhistReq *req)
+{
+    struct eventFile *files;
+    struct readCtx ctx;
+    pthread_t tids[MAX_READ_THREADS];
+    time_t lastStamp;
+    time_t stamp;
+    time_t start;
+    int numFiles;
+    int numRead;
+    int i;
+    int n;
+    int cc;
+    char ch;
+    FILE *fp;
+
+    if (last < 0)
+        last = 0;
+    numFiles = first - last + 1;
+    if (numFiles <= 0)
+        return 0;
+
+    files = calloc(numFiles, sizeof(struct eventFile));
+    if (files == NULL) {
+        perror("calloc");
+        return -1;
+    }
+
+    /* Oldest first, the time range of a file goes
+     * from its first event, or the switch time of
+     * the file before it, to its switch time.
+     */
+    lastStamp = 0;
+    sprintf(files[0].name, "%s/lsb.events.%d", eventDir, first + 1);
+    fileHeader(files[0].name, &lastStamp, &start);
+
+    numRead = 0;
+    for (i = 0, n = first; i < numFiles; i++, n--) {
+        struct eventFile *f = &files[i];
+
+        if (n == 0) {
+            sprintf(f->name, "%s/lsb.events", eventDir);
+            f->first = lastStamp;
+            f->last = INFINIT_INT;
+            if ((fp = fopen(f->name, "r")) != NULL) {
+                long pos;
+                if (fscanf(fp, "%c%ld", &ch, &pos) == 2 && ch == '#')
+                    f->start = pos;
+                fclose(fp);
+            }
+        } else {
+            sprintf(f->name, "%s/lsb.events.%d", eventDir, n);
+            cc = fileHeader(f->name, &stamp, &start);
+            if (cc < 0) {
+                f->first = lastStamp;
+                f->last = INFINIT_INT;
+            } else {
+                f->first = (cc == 2) ? start : lastStamp;
+                f->last = stamp;
+                lastStamp = stamp;
+            }
+        }
+
+        if (req->searchTime[1] != -1
+            && (f->last < req->searchTime[0]
+                || f->first > req->searchTime[1])) {
+            f->skip = TRUE;
+            continue;
+        }
+        ++numRead;
+    }
+
+    if (numThreads <= 0)
+        numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads > numRead)
+        numThreads = numRead;
+    if (numThreads > MAX_READ_THREADS)
+        numThreads = MAX_READ_THREADS;
+    if (numThreads < 1)
+        numThreads = 1;
+
+    pthread_mutex_init(&ctx.lock, NULL);
+    ctx.files = files;
+    ctx.numFiles = numFiles;
+    ctx.next = 0;
+    ctx.req = req;
+
+    for (i = 1; i < numThreads; i++) {
+        if (pthread_create(&tids[i], NULL, readWorker, &ctx) != 0) {
+            numThreads = i;
+            break;
+        }
+    }
+    readWorker(&ctx);
+    for (i = 1; i < numThreads; i++)
+        pthread_join(tids[i], NULL);
+
+    pthread_mutex_destroy(&ctx.lock);
+
+    for (i = 0; i < numFiles; i++) {
+        if (files[i].serial)
+            readFile(&files[i], req, TRUE);
+    }
+
+    cc = mergeFiles(files, numFiles, req);
+
+    for (i = 0; i < numFiles; i++)
+        FREEUP(files[i].kept);
+    free(files);
+
+    return cc;
+}
+
+/* fileHeader()
+ *
+ * Get the switch time and, in files written by
+ * this release, the time of the first event from
+ * the header of a rotated event file.
+ */
+static int
+fileHeader(const char *name, time_t *stamp, time_t *first)
+{
+    FILE *fp;
+    long t0;
+    long t1;
+    char ch;
+    int cc;
+
+    if ((fp = fopen(name, "r")) == NULL)
+        return -1;
+
+    cc = fscanf(fp, "%c%ld %ld", &ch, &t0, &t1);
+    fclose(fp);
+
+    if (cc < 2 || ch != '#')
+        return -1;
+
+    *stamp = t0;
+    if (cc == 3)
+        *first = t1;
+
+    return cc - 1;
+}
+
+static void *
+readWorker(void *arg)
+{
+    struct readCtx *ctx;
+    struct eventFile *f;
+
+    ctx = arg;
+    while (1) {
+
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->next < ctx->numFiles
+               && ctx->files[ctx->next].skip)
+            ctx->next++;
+        f = (ctx->next < ctx->numFiles) ? &ctx->files[ctx->next++] : NULL;
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (f == NULL)
+            break;
+
+        readFile(f, ctx->req, FALSE);
+    }
+
+    return NULL;
+}
+
+/* readFile()
+ *
+ * Keep the records of a file. In a worker the file
+ * must be mapped, if it is not it is marked to be
+ * read by the main thread with serial set.
+ */
+static void
+readFile(struct eventFile *f, struct bhistReq *req, int serial)
+{
+    struct eventFileMap *map;
+    struct eventRec *rec;
+    FILE *fp;
+    time_t t;
+    long pos;
+    int lineNum;
+    int err;
+
+    /* Errors are reported at the time of the record
+     * before them.
+     */
+    t = f->first;
+    if ((fp = fopen(f->name, "r")) == NULL) {
+        addKept(f, -1, t, 0, LSBE_SYS_CALL);
+        return;
+    }
+
+    fseek(fp, f->start, SEEK_SET);
+    if ((map = lsb_openeventmap(fp)) == NULL) {
+        addKept(f, -1, t, 0, LSBE_NO_MEM);
+        fclose(fp);
+        return;
+    }
+
+    if (!serial && !lsb_eventmapped(map)) {
+        f->serial = TRUE;
+        lsb_closeeventmap(map);
+        fclose(fp);
+        return;
+    }
+
+    lineNum = 0;
+    while (1) {
+
+        pos = lsb_eventmappos(map);
+        if (serial) {
+            rec = lsb_geteventmaprec(map, &lineNum);
+            err = lsberrno;
+        } else {
+            rec = lsb_geteventmaprec_r(map, &lineNum, &err);
+        }
+        if (rec == NULL) {
+            if (err == LSBE_EOF)
+                break;
+            addKept(f, -1, t, lineNum, err);
+            if (err == LSBE_NO_MEM)
+                break;
+            continue;
+        }
+
+        t = rec->eventTime;
+        if (keepRec(rec, req)
+            && addKept(f, pos, rec->eventTime, lineNum, 0) < 0)
+            break;
+    }
+
+    lsb_closeeventmap(map);
+    fclose(fp);
+}
+
+/* keepRec()
+ *
+ * The records that lsbGetNextJobEvent() would return
+ * and that are in the time range, less the new jobs
+ * of other users parse_event() would drop.
+ */
+static int
+keepRec(struct eventRec *rec, struct bhistReq *req)
+{
+    int jobId;
+    int i;
+
+    if (req->searchTime[1] != -1
+        && (rec->eventTime < req->searchTime[0]
+            || rec->eventTime > req->searchTime[1]))
+        return FALSE;
+
+    if ((jobId = getJobIdFromEventRec(rec)) <= 0)
+        return FALSE;
+
+    if (rec->type == EVENT_JOB_NEW) {
+        if (!(req->options & OPT_ALLUSERS)
+            && strcmp(rec->eventLog.jobNewLog.userName, req->userName) != 0)
+            return FALSE;
+        return TRUE;
+    }
+
+    /* With -J the job IDs are added while the new
+     * jobs are parsed.
+     */
+    if (req->numJobs == 0
+        || (req->options & OPT_JOBNAME))
+        return TRUE;
+
+    for (i = 0; i < req->numJobs; i++) {
+        if (LSB_ARRAY_JOBID(req->jobIds[i]) == jobId)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static int
+addKept(struct eventFile *f, long pos, time_t t, int lineNum, int err)
+{
+    struct keptRec *k;
+    int size;
+
+    if (f->numKept == f->maxKept) {
+        size = f->maxKept ? 2 * f->maxKept : 1024;
+        k = realloc(f->kept, size * sizeof(struct keptRec));
+        if (k == NULL)
+            return -1;
+        f->kept = k;
+        f->maxKept = size;
+    }
+
+    k = &f->kept[f->numKept++];
+    k->pos = pos;
+    k->eventTime = t;
+    k->lineNum = lineNum;
+    k->err = err;
+
+    return 0;
+}
+
+/* mergeFiles()
+ *
+ * Take the kept records in event time order, the
+ * records of a file stay in file order and on equal
+ * times the older file goes first.
+ */
+static int
+mergeFiles(struct eventFile *files, int numFiles, struct bhistReq *req)
+{
+    struct eventFile *f;
+    struct keptRec *k;
+    struct eventRec *rec;
+    int lineNum;
+    int i;
+
+    for (i = 0; i < numFiles; i++) {
+        f = &files[i];
+        if (f->numKept == 0)
+            continue;
+        if ((f->fp = fopen(f->name, "r")) == NULL
+            || (f->map = lsb_openeventmap(f->fp)) == NULL) {
+            perror(f->name);
+            f->numKept = 0;
+        }
+    }
+
+    while (1) {
+
+        k = NULL;
+        f = NULL;
+        for (i = 0; i < numFiles; i++) {
+            if (files[i].cur == files[i].numKept)
+                continue;
+            if (k == NULL
+                || files[i].kept[files[i].cur].eventTime < k->eventTime) {
+                f = &files[i];
+                k = &f->kept[f->cur];
+            }
+        }
+
+        if (k == NULL)
+            break;
+        f->cur++;
+
+        if (k->err) {
+            lsberrno = k->err;
+            ls_syslog(LOG_ERR, I18N(3203,
+                                    "File %s at line %d: %s\n"), /* catgets 3203 */
+                      f->name, k->lineNum, lsb_sysmsg());
+            continue;
+        }
+
+        lineNum = k->lineNum - 1;
+        if (lsb_seekeventmap(f->map, k->pos) < 0
+            || (rec = lsb_geteventmaprec(f->map, &lineNum)) == NULL) {
+            ls_syslog(LOG_ERR, I18N(3203,
+                                    "File %s at line %d: %s\n"), /* catgets 3203 */
+                      f->name, k->lineNum, lsb_sysmsg());
+            continue;
+        }
+
+        parse_event(rec, req);
+    }
+
+    for (i = 0; i < numFiles; i++) {
+        if (files[i].map)
+            lsb_closeeventmap(files[i].map);
+        if (files[i].fp)
+            fclose(files[i].fp);
+    }
+
+    return 0;
+}
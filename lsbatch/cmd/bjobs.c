@@ -143,6 +143,15 @@ main(int argc, char **argv)
     if (format != LONG_FORMAT && !(options & (HOST_NAME | PEND_JOB)))
         options |= NO_PEND_REASONS;
 
+    /* The default output needs only the brief
+     * job info, have mbatchd skip the rest. The
+     * brief reply has no pending or suspending
+     * reasons, -p and -s need the full one.
+     */
+    if (format == 0
+        && !(options & (PEND_JOB | SUSP_JOB)))
+        options |= JOBINFO_BRIEF;
+
     TIMEIT(0, (cc = getUser(lsfUserName, MAXLINELEN)), "getUser");
     if (cc != 0 ) {
         exit(-1);
@@ -171,7 +180,7 @@ main(int argc, char **argv)
         exit(-1);
     }
 
-    options &= ~NO_PEND_REASONS;
+    options &= ~(NO_PEND_REASONS | JOBINFO_BRIEF);
     jobDisplayed = 0;
 
     for (i = 0; i < jInfoH->numJobs; i++) {
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include "cmd.h"
+
+static void printCounters(struct metricsInfoReply *, int);
+static void printHistograms(struct metricsInfoReply *, int);
+static LS_LONG_INT bucketPct(struct mbdMetric *, double);
+
+void
+usage(void)
+{
+    fprintf(stderr, "usage: bmetrics [-h] [-V] [-a] [-l]\n");
+}
+
+/* bmetrics prints the scheduler metrics of mbatchd,
+ * -a prints also the counters that are still zero
+ * and -l the histogram buckets.
+ */
+int
+main(int argc, char **argv)
+{
+    struct metricsInfoReply *r;
+    int all;
+    int longFormat;
+    int cc;
+
+    if (lsb_init(argv[0]) < 0) {
+        lsb_perror("lsb_init");
+        return -1;
+    }
+
+    all = 0;
+    longFormat = 0;
+
+    while ((cc = getopt(argc, argv, "Vhal")) != EOF) {
+        switch (cc) {
+            case 'a':
+                all = 1;
+                break;
+            case 'l':
+                longFormat = 1;
+                break;
+            case 'V':
+                fputs(_LS_VERSION_, stderr);
+                return -1;
+            case 'h':
+            default:
+                usage();
+                return -1;
+        }
+    }
+
+    r = lsb_metricsinfo();
+    if (r == NULL) {
+        lsb_perror("lsb_metricsinfo()");
+        return -1;
+    }
+
+    printf("MBATCHD START TIME: %s\n\n", ls_time(r->startTime));
+
+    printCounters(r, all);
+    printHistograms(r, longFormat);
+
+    return 0;
+}
+
+static void
+printCounters(struct metricsInfoReply *r, int all)
+{
+    struct mbdMetric *m;
+    char buf[MAXLINELEN];
+    int i;
+
+    printf("%-60s %15s\n", "COUNTER", "VALUE");
+    for (i = 0; i < r->numMetrics; i++) {
+        m = &r->metrics[i];
+        if (m->type != METRIC_COUNTER)
+            continue;
+        if (m->value == 0 && !all)
+            continue;
+        if (m->label[0])
+            sprintf(buf, "%s{%s}", m->name, m->label);
+        else
+            sprintf(buf, "%s", m->name);
+        printf("%-60s %15lld\n", buf, (long long)m->value);
+    }
+    printf("\n");
+}
+
+/* printHistograms()
+ *
+ * The percentiles are the upper bounds of the
+ * buckets they fall in.
+ */
+static void
+printHistograms(struct metricsInfoReply *r, int longFormat)
+{
+    struct mbdMetric *m;
+    char buf[MAXLINELEN];
+    int i;
+    int j;
+
+    printf("%-52s %10s %10s %10s %10s %10s\n",
+           "HISTOGRAM", "COUNT", "MEAN", "P50", "P90", "P99");
+    for (i = 0; i < r->numMetrics; i++) {
+        m = &r->metrics[i];
+        if (m->type != METRIC_HISTOGRAM)
+            continue;
+        if (m->label[0])
+            sprintf(buf, "%s{%s}", m->name, m->label);
+        else
+            sprintf(buf, "%s", m->name);
+
+        if (m->count == 0) {
+            printf("%-52s %10d %10s %10s %10s %10s\n",
+                   buf, 0, "-", "-", "-", "-");
+            continue;
+        }
+
+        printf("%-52s %10lld %10lld %10lld %10lld %10lld\n",
+               buf,
+               (long long)m->count,
+               (long long)(m->value / m->count),
+               (long long)bucketPct(m, 0.50),
+               (long long)bucketPct(m, 0.90),
+               (long long)bucketPct(m, 0.99));
+
+        if (!longFormat)
+            continue;
+
+        for (j = 0; j < m->numBuckets; j++) {
+            if (m->buckets[j] == 0)
+                continue;
+            if (j < m->numBuckets - 1)
+                printf("    <= %-20lld %10lld\n",
+                       1LL << j, (long long)m->buckets[j]);
+            else
+                printf("    >  %-20lld %10lld\n",
+                       1LL << (j - 1), (long long)m->buckets[j]);
+        }
+    }
+}
+
+static LS_LONG_INT
+bucketPct(struct mbdMetric *m, double p)
+{
+    LS_LONG_INT n;
+    LS_LONG_INT want;
+    int j;
+
+    want = (LS_LONG_INT)(p * m->count);
+    if (want < 1)
+        want = 1;
+
+    n = 0;
+    for (j = 0; j < m->numBuckets; j++) {
+        n += m->buckets[j];
+        if (n >= want)
+            return 1LL << j;
+    }
+
+    return 1LL << (m->numBuckets - 1);
+}
@@ -332,6 +332,9 @@ prtQueuesLong(int numQueues, struct queueInfoEnt *queueInfo)
         if (qp->qAttrib & Q_ATTRIB_PREEMPTIVE)
             printf("\nPREEMPTION = %s", qp->preemption);
 
+        if (qp->affinity && qp->affinity[0])
+            printf("\nAFFINITY = %s", qp->affinity);
+
         if (strcmp (qp->defaultHostSpec, " ") !=  0)
             printf("\nDEFAULT HOST SPECIFICATION:  %s\n", qp->defaultHostSpec);
 
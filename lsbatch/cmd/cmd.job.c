@@ -496,6 +496,10 @@ prtJobStart(struct jobInfoEnt *job, int prtFlag, int jobPid, int tFormat)
 		    job->execUsername);
             prtLine(prline);
         }
+	if (job->cpuBind && strcmp(job->cpuBind, "")) {
+	    sprintf(prline, ", CPUs bound <%s>", job->cpuBind);
+	    prtLine(prline);
+	}
 	sprintf(prline, ";\n");
 	prtLine(prline);
     }
@@ -67,6 +67,7 @@ typedef enum {
     BATCH_UNUSED_39      = 39,
     BATCH_STATUS_CHUNK   = 40,
     BATCH_JOBMSG_INFO,
+    BATCH_METRICS_INFO,
     BATCH_SET_JOB_ATTR   = 90,
     READY_FOR_OP         = 1023,
     PREPARE_FOR_OP       = 1024
@@ -190,6 +191,7 @@ struct jobInfoReply {
     int       counter[NUM_JGRP_COUNTERS];
     u_short   port;
     int       jobPriority;
+    char      *cpuBind;
 };
 
 struct infoReq {
@@ -279,6 +281,8 @@ typedef enum {
     CMD_SBD_DEBUG   = 7,
     UNUSED_8        = 8,
     MBD_MODIFY_JOB  = 9,
+    MBD_NEW_JOBS    = 10,
+    MBD_JOBS_GO     = 11,
     SBD_JOB_SETUP   = 100,
     SBD_SYSLOG      = 101,
     CMD_SBD_REBOOT   = 300,
@@ -318,6 +322,7 @@ extern int call_server(char *,
                        int (*)(),
                        int *,
                        int);
+extern int serv_connect(char *, ushort, int);
 /* To do: find out why this header file is included
  * in here.
  */
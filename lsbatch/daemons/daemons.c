@@ -85,6 +85,13 @@ struct config_param daemonParams[] = {
     {"LSB_STDOUT_DIRECT", NULL},
     {"MBD_DONT_FORK", NULL},
     {"LIM_NO_MIGRANT_HOSTS", NULL},
+    {"LSB_EVENT_COMMIT_WINDOW", NULL},
+    {"LSB_COMPACT_INTERVAL", NULL},
+    {"LSB_DISPATCH_CHANNEL", NULL},
+    {"LSB_STATUS_BATCH_WINDOW", NULL},
+    {"MBD_QUERY_READERS", NULL},
+    {"MBD_METRICS_SOCKET", NULL},
+    {"MBD_QUERY_MAX_AGE", NULL},
     {NULL, NULL}
 };
 
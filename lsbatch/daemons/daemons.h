@@ -153,6 +153,13 @@
 #define LSB_STDOUT_DIRECT      53
 #define MBD_DONT_FORK          54
 #define LIM_NO_MIGRANT_HOSTS   55
+#define LSB_EVENT_COMMIT_WINDOW 56
+#define LSB_COMPACT_INTERVAL   57
+#define LSB_DISPATCH_CHANNEL   58
+#define LSB_STATUS_BATCH_WINDOW 59
+#define MBD_QUERY_READERS      60
+#define MBD_METRICS_SOCKET     61
+#define MBD_QUERY_MAX_AGE      62
 #define NOT_LOG  INFINIT_INT
 
 #define JOB_SAVE_OUTPUT   0x10000000
@@ -195,7 +202,8 @@ typedef enum {
     ERR_UNREACH_SBD = 23,
     ERR_JOB_RETURN =  24,
     ERR_RESTARTING_FILE = 25,
-    ERR_HANDLE     = 26
+    ERR_HANDLE     = 26,
+    ERR_DISPATCH_DEFER = 27
 } sbdReplyType;
 
 #define LOAD_REASONS   (SUSP_LOAD_REASON | SUSP_QUE_STOP_COND \
@@ -286,6 +294,8 @@ struct jobSpecs {
     char  commandSpool[MAXFILENAMELEN];
     int   userPriority;
     char  execUsername[MAX_LSB_NAME_LEN];
+    char  *affinity;
+    char  *cpuBind;
 };
 
 struct statusReq {
@@ -312,6 +322,7 @@ struct statusReq {
     struct jRusage runRusage;
     int         sigValue;
     int         actStatus;
+    char        *cpuBind;
 };
 
 struct chunkStatusReq {
@@ -361,6 +372,31 @@ struct jobReply {
     int           actStatus;
 };
 
+/* One job in a MBD_NEW_JOBS batch, the job
+ * file travels with the specs so the sbatchd
+ * child does not have to read it from the
+ * channel.
+ */
+struct jobStart {
+    struct jobSpecs jobSpecs;
+    struct lenData  jobFile;
+};
+
+/* Per job answer of sbatchd to MBD_NEW_JOBS.
+ */
+struct jobStartReply {
+    int             reply;
+    struct jobReply jobReply;
+};
+
+/* Per job go-ahead sent by mbatchd in
+ * MBD_JOBS_GO.
+ */
+struct jobGo {
+    LS_LONG_INT jobId;
+    int         go;
+};
+
 
 enum _bufstat {
     MSG_STAT_QUEUED, MSG_STAT_SENT, MSG_STAT_RCVD
@@ -555,6 +591,9 @@ extern int xdr_jobSpecs(XDR *xdrs, struct jobSpecs *jobSpecs, struct LSFHeader *
 extern int xdr_sbdPackage1(XDR *xdrs, struct sbdPackage *, struct LSFHeader *);
 extern int xdr_jobReply(XDR *xdrs, struct jobReply *jobReply, struct LSFHeader *);
 extern int xdr_jobSig(XDR *xdrs, struct jobSig *jobSig, struct LSFHeader *);
+extern int xdr_jobStart(XDR *, struct jobStart *, struct LSFHeader *);
+extern int xdr_jobStartReply(XDR *, struct jobStartReply *, struct LSFHeader *);
+extern int xdr_jobGo(XDR *, struct jobGo *, struct LSFHeader *);
 extern int xdr_chunkStatusReq(XDR *, struct chunkStatusReq *, struct LSFHeader *);
 
 extern float normalizeRq_(float rawql, float cpuFactor, int nprocs);
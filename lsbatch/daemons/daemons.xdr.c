@@ -57,6 +57,8 @@ xdr_jobSpecs (XDR *xdrs, struct jobSpecs *jobSpecs, struct LSFHeader *hdr)
         jobSpecs->loginShell = NULL;
         jobSpecs->schedHostType= NULL;
         jobSpecs->execHosts = NULL;
+        jobSpecs->affinity = NULL;
+        jobSpecs->cpuBind = NULL;
     }
 
     if (xdrs->x_op == XDR_FREE) {
@@ -74,6 +76,8 @@ xdr_jobSpecs (XDR *xdrs, struct jobSpecs *jobSpecs, struct LSFHeader *hdr)
         FREEUP(jobSpecs->loginShell);
         FREEUP(jobSpecs->schedHostType);
         FREEUP(jobSpecs->execHosts);
+        FREEUP(jobSpecs->affinity);
+        FREEUP(jobSpecs->cpuBind);
         if (!xdr_thresholds(xdrs, jobSpecs) ||
             !xdr_lenData(xdrs, &jobSpecs->eexec))
             return false;
@@ -401,6 +405,29 @@ xdr_jobSpecs (XDR *xdrs, struct jobSpecs *jobSpecs, struct LSFHeader *hdr)
 	return false;
     }
 
+    /* The queue affinity policy and the CPUs
+     * the job is bound to since version 32.
+     */
+    if (hdr->version >= 32) {
+
+        if (xdrs->x_op == XDR_ENCODE) {
+            sp[0] = jobSpecs->affinity ? jobSpecs->affinity : "";
+            sp[1] = jobSpecs->cpuBind ? jobSpecs->cpuBind : "";
+        }
+
+        if (!(xdr_var_string(xdrs, &sp[0])
+              && xdr_var_string(xdrs, &sp[1]))) {
+            ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL, fname,
+                      "xdr_var_string", "affinity");
+            return false;
+        }
+
+        if (xdrs->x_op == XDR_DECODE) {
+            jobSpecs->affinity = sp[0];
+            jobSpecs->cpuBind = sp[1];
+        }
+    }
+
     return true;
 
 }
@@ -495,6 +522,58 @@ xdr_jobReply (XDR *xdrs, struct jobReply *jobReply, struct LSFHeader *hdr)
     return true;
 }
 
+/* xdr_jobStart()
+ */
+bool_t
+xdr_jobStart(XDR *xdrs, struct jobStart *js, struct LSFHeader *hdr)
+{
+    if (! xdr_jobSpecs(xdrs, &js->jobSpecs, hdr))
+        return false;
+
+    if (! xdr_lenData(xdrs, &js->jobFile))
+        return false;
+
+    return true;
+}
+
+/* xdr_jobStartReply()
+ */
+bool_t
+xdr_jobStartReply(XDR *xdrs,
+                  struct jobStartReply *jr,
+                  struct LSFHeader *hdr)
+{
+    if (! xdr_int(xdrs, &jr->reply))
+        return false;
+
+    if (! xdr_jobReply(xdrs, &jr->jobReply, hdr))
+        return false;
+
+    return true;
+}
+
+/* xdr_jobGo()
+ */
+bool_t
+xdr_jobGo(XDR *xdrs, struct jobGo *go, struct LSFHeader *hdr)
+{
+    int jobArrId;
+    int jobArrElemId;
+
+    if (xdrs->x_op == XDR_ENCODE)
+        jobId64To32(go->jobId, &jobArrId, &jobArrElemId);
+
+    if (! xdr_int(xdrs, &jobArrId)
+        || ! xdr_int(xdrs, &jobArrElemId)
+        || ! xdr_int(xdrs, &go->go))
+        return false;
+
+    if (xdrs->x_op == XDR_DECODE)
+        jobId32To64(&go->jobId, jobArrId, jobArrElemId);
+
+    return true;
+}
+
 bool_t
 xdr_statusReq (XDR *xdrs, struct statusReq *statusReq, struct LSFHeader *hdr)
 {
@@ -512,6 +591,7 @@ xdr_statusReq (XDR *xdrs, struct statusReq *statusReq, struct LSFHeader *hdr)
         FREEUP (statusReq->queuePreCmd);
         FREEUP (statusReq->queuePostCmd);
         FREEUP (statusReq->execUsername);
+        FREEUP (statusReq->cpuBind);
         if (statusReq->runRusage.npids > 0)
             FREEUP (statusReq->runRusage.pidInfo);
         if (statusReq->runRusage.npgids > 0)
@@ -519,6 +599,9 @@ xdr_statusReq (XDR *xdrs, struct statusReq *statusReq, struct LSFHeader *hdr)
         return true;
     }
 
+    if (xdrs->x_op == XDR_DECODE)
+        statusReq->cpuBind = NULL;
+
     if (xdrs->x_op == XDR_ENCODE) {
 	jobId64To32(statusReq->jobId, &jobArrId, &jobArrElemId);
     }
@@ -581,6 +664,16 @@ xdr_statusReq (XDR *xdrs, struct statusReq *statusReq, struct LSFHeader *hdr)
 	jobId32To64(&statusReq->jobId,jobArrId,jobArrElemId);
     }
 
+    if (hdr->version >= 32) {
+        char *cpuBind;
+
+        cpuBind = statusReq->cpuBind ? statusReq->cpuBind : "";
+        if (!xdr_var_string(xdrs, &cpuBind))
+            return false;
+        if (xdrs->x_op == XDR_DECODE)
+            statusReq->cpuBind = cpuBind;
+    }
+
     return true;
 }
 
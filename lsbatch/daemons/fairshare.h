@@ -28,6 +28,9 @@ struct fair_sched {
     char *name;
     void *handle;
     struct tree_ *tree;
+    struct hash_tab *pend_tab;
+    int session;
+    int indexed;
     int (*fs_init)(struct qData *, struct userConf *);
     int (*fs_update_sacct)(struct qData *,
                            struct jData *,
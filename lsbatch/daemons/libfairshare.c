@@ -18,8 +18,23 @@
  */
 #include "fairshare.h"
 
+/* The ready jobs of one user in the order of the
+ * session jRef list, the elections take them from
+ * the head. The entries are kept from one session
+ * to the next.
+ */
+struct fs_pend {
+    int session;
+    int head;
+    int num;
+    int size;
+    struct jRef **refs;
+};
+
 static struct tree_node_ *get_user_node(struct hash_tab *,
                                         struct jData *);
+static void index_pend_jobs(struct fair_sched *, LIST_T *);
+static struct fs_pend *get_user_pend(struct fair_sched *, int, int);
 
 /* fs_init()
  */
@@ -72,6 +87,12 @@ fs_update_sacct(struct qData *qPtr,
     if (numRUN > 0)
         numRAN = numRUN;
 
+    /* The historical usage decides the
+     * order of the siblings
+     */
+    if (numRAN > 0)
+        sshare_resort_node(n);
+
     while (n) {
         sacct = n->data;
         sacct->numPEND = sacct->numPEND + numPEND;
@@ -97,79 +118,76 @@ fs_init_sched_session(struct qData *qPtr)
      */
     sshare_distribute_slots(t, qPtr->numFairSlots);
 
+    /* The jRef list of this session is
+     * indexed by the first election.
+     */
+    ++qPtr->fsSched->session;
+
     return 0;
 }
 
 /* fs_elect_job()
+ *
+ * Pick the leaf with tokens left in priority
+ * order and take the first ready job of its
+ * user. A leaf whose user has no ready jobs
+ * left in this session is dropped.
  */
 int
 fs_elect_job(struct qData *qPtr,
              LIST_T *jRefList,
              struct jRef **jRef)
 {
+    struct fair_sched *f;
     struct tree_node_ *n;
     struct share_acct *s;
+    struct fs_pend *p;
     link_t *l;
-    struct jRef *jref;
-    struct jData *jPtr;
-    uint32_t sent;
 
-    l = qPtr->fsSched->tree->leafs;
+    f = qPtr->fsSched;
+    l = f->tree->leafs;
     if (LINK_NUM_ENTRIES(l) == 0) {
         *jRef = NULL;
         return -1;
     }
 
+    if (f->indexed != f->session) {
+        index_pend_jobs(f, jRefList);
+        f->indexed = f->session;
+    }
+
     /* pop() so if the num sent drops
      * to zero we remove it and never traverse
      * it again.
      */
-    sent = 0;
     while ((n = pop_link(l))) {
-        s = n->data;
-        if (s->sent > 0) {
-            s->sent--;
-            ++sent;
-            break;
-        }
-    }
 
-    /* No more jobs to sent
-     */
-    if (sent == 0) {
-        *jRef = NULL;
-        return -1;
-    }
+        s = n->data;
+        if (s->sent == 0)
+            continue;
 
-    for (jref = (struct jRef *)jRefList->back;
-         jref != (void *)jRefList;
-         jref = jref->back) {
+        p = get_user_pend(f, s->uid, 0);
+        if (p == NULL
+            || p->head == p->num)
+            continue;
 
-        jPtr = jref->job;
+        s->sent--;
+        *jRef = p->refs[p->head];
+        ++p->head;
 
-        /* end of the reference list or the job
-         * ahead belongs to a different queue
-         */
-        if (jref->back == (void *)jRefList
-            || jPtr->qPtr->queueId != jPtr->back->qPtr->queueId) {
-            *jRef = jref;
-            return 0;
-        }
-        /* fixme: handle user priority here
+        /* More to dispatch from this node
+         * so back to the leaf link
          */
-        if (jPtr->userId == s->uid)
-            break;
+        if (s->sent > 0)
+            push_link(l, n);
+
+        return 0;
     }
 
-    /* More to dispatch from this node
-     * so back to the leaf link
+    /* No more jobs to sent
      */
-    if (s->sent > 0)
-        push_link(l, n);
-
-    *jRef = jref;
-
-    return 0;
+    *jRef = NULL;
+    return -1;
 }
 
 /* fs_fin_sched_session()
@@ -274,6 +292,7 @@ get_user_node(struct hash_tab *node_tab,
     n2->name = strdup(jPtr->userName);
 
     tree_insert_node(n->parent, n2);
+    sshare_resort_node(n->parent);
     sacct2->options |= SACCT_USER;
     sprintf(key, "%s/%s", n2->parent->name, n2->name);
     hash_install(node_tab, key, n2, NULL);
@@ -307,3 +326,67 @@ get_user_node(struct hash_tab *node_tab,
 
     return n->parent->child;
 }
+
+/* index_pend_jobs()
+ *
+ * Queue the session jRefs by user, the list is
+ * walked once per session so each election then
+ * costs O(1).
+ */
+static void
+index_pend_jobs(struct fair_sched *f, LIST_T *jRefList)
+{
+    struct jRef *jref;
+    struct fs_pend *p;
+
+    if (f->pend_tab == NULL)
+        f->pend_tab = hash_make(101);
+
+    for (jref = (struct jRef *)jRefList->back;
+         jref != (void *)jRefList;
+         jref = jref->back) {
+
+        p = get_user_pend(f, jref->job->userId, 1);
+        if (p->num == p->size) {
+            p->size = p->size ? 2 * p->size : 16;
+            p->refs = realloc(p->refs, p->size * sizeof(struct jRef *));
+            assert(p->refs);
+        }
+        p->refs[p->num] = jref;
+        ++p->num;
+    }
+}
+
+/* get_user_pend()
+ *
+ * Return the pending queue of the user for the
+ * current session, create it if asked to.
+ */
+static struct fs_pend *
+get_user_pend(struct fair_sched *f, int uid, int create)
+{
+    struct fs_pend *p;
+    char key[32];
+
+    if (f->pend_tab == NULL)
+        return NULL;
+
+    sprintf(key, "%d", uid);
+    p = hash_lookup(f->pend_tab, key);
+    if (p == NULL) {
+        if (! create)
+            return NULL;
+        p = calloc(1, sizeof(struct fs_pend));
+        assert(p);
+        hash_install(f->pend_tab, key, p, NULL);
+    }
+
+    if (p->session != f->session) {
+        if (! create)
+            return NULL;
+        p->session = f->session;
+        p->head = p->num = 0;
+    }
+
+    return p;
+}
@@ -41,12 +41,41 @@ static sbdReplyType  callSBD(char *,
                              int *);
 
 extern sbdReplyType start_ajob (struct jData *jDataPtr, struct qData *qp, struct jobReply *jobReply);
+static int useDispatchChannel(void);
+static sbdReplyType dispatchJob(struct jData *,
+                                struct jobSpecs *,
+                                struct lenData *,
+                                int);
+static int connectDispatch(struct sbdDispatch *);
 
 struct sbdNode sbdNodeList = {&sbdNodeList, &sbdNodeList, 0, NULL, NULL, 0};
 
+/* Hosts having job starts batched and not
+ * yet sent to their sbatchd.
+ */
+static struct sbdDispatch dispatchList = {&dispatchList, &dispatchList};
+
+/* Max number of jobs a dispatch channel can have
+ * in flight, once reached further job starts are
+ * deferred with ERR_DISPATCH_DEFER until the sbatchd
+ * catches up, the jobs stay pending and the host is
+ * not marked as failed.
+ */
+#define DISPATCH_WINDOW 1024
+
+/* Set by mbdsim to start the jobs on its simulated
+ * hosts instead of sending them to sbatchd.
+ */
+sbdReplyType (*startJobHook)(struct jData *,
+                             struct qData *,
+                             struct jobReply *);
+
 sbdReplyType
 start_job (struct jData *jDataPtr, struct qData *qp, struct jobReply *jobReply)
 {
+    if (startJobHook)
+        return (*startJobHook)(jDataPtr, qp, jobReply);
+
     return(start_ajob(jDataPtr, qp, jobReply));
 }
 
@@ -131,6 +160,13 @@ start_ajob (struct jData *jDataPtr,
         buflen += strlen(jobSpecs.env[i]);
     buflen = (buflen * 4) / 4;
 
+    if (useDispatchChannel()) {
+        reply = dispatchJob(jDataPtr, &jobSpecs, &jf, buflen);
+        freeJobSpecs (&jobSpecs);
+        free(jf.data);
+        goto Reply;
+    }
+
     request_buf = (char *) my_malloc (buflen, fname);
     xdrmem_create(&xdrs, request_buf, buflen, XDR_ENCODE);
     if (! xdr_encodeMsg(&xdrs, (char *)&jobSpecs, &hdr, xdr_jobSpecs, 0,
@@ -158,6 +194,7 @@ start_ajob (struct jData *jDataPtr,
     freeJobSpecs (&jobSpecs);
     free(jf.data);
 
+Reply:
     if (reply == ERR_NULL || reply == ERR_FAIL || reply == ERR_UNREACH_SBD)
         return (reply);
 
@@ -752,6 +789,7 @@ callSBD(char *toHost,
             newSbdNode = my_malloc(sizeof(struct sbdNode),
                                    fname);
             memcpy(newSbdNode, sbdPtr, sizeof(struct sbdNode));
+            newSbdNode->disp = NULL;
             newSbdNode->chanfd = *sockPtr;
             newSbdNode->lastTime = now;
             chanSetMode_(*sockPtr, CHAN_MODE_NONBLOCK);
@@ -829,3 +867,379 @@ callSbdDebug(struct debugReq *pdebug)
                   __func__, reply, pdebug->hostName);
     return reply;
 }
+
+/* useDispatchChannel()
+ *
+ * Job starts go over the persistent dispatch
+ * channel unless the blocking send is configured
+ * or LSB_DISPATCH_CHANNEL=n.
+ */
+static int
+useDispatchChannel(void)
+{
+    if (daemonParams[LSB_MBD_BLOCK_SEND].paramValue)
+        return FALSE;
+
+    if (daemonParams[LSB_DISPATCH_CHANNEL].paramValue
+        && strcasecmp(daemonParams[LSB_DISPATCH_CHANNEL].paramValue,
+                      "n") == 0)
+        return FALSE;
+
+    return TRUE;
+}
+
+/* dispatchJob()
+ *
+ * Append the job start to the batch of its
+ * execution host, the batch is sent by
+ * flushDispatch() before the next select.
+ */
+static sbdReplyType
+dispatchJob(struct jData *jPtr,
+            struct jobSpecs *jobSpecs,
+            struct lenData *jf,
+            int buflen)
+{
+    struct hData *hPtr = jPtr->hPtr[0];
+    struct sbdDispatch *disp;
+    struct jobStart js;
+    struct LSFHeader hdr;
+    XDR xdrs;
+    int size;
+
+    if (hPtr->dispatch == NULL) {
+        disp = my_calloc(1, sizeof(struct sbdDispatch), __func__);
+        disp->hData = hPtr;
+        hPtr->dispatch = disp;
+    }
+    disp = hPtr->dispatch;
+
+    if (disp->numJobs >= DISPATCH_WINDOW) {
+        if (logclass & (LC_SCHED | LC_EXEC))
+            ls_syslog(LOG_DEBUG, "\
+%s: %d jobs in flight to host %s, job %s deferred", __func__,
+                      disp->numJobs, hPtr->host,
+                      lsb_jobid2str(jPtr->jobId));
+        return ERR_DISPATCH_DEFER;
+    }
+
+    size = buflen + jf->len + 2 * NET_INTSIZE_;
+    if (disp->buf == NULL) {
+        disp->size = LSF_HEADER_LEN + NET_INTSIZE_ + size;
+        if (chanAllocBuf_(&disp->buf, disp->size) < 0)
+            mbdDie(MASTER_MEM);
+        disp->buf->len = LSF_HEADER_LEN + NET_INTSIZE_;
+    }
+
+    if (disp->buf->len + size > disp->size) {
+        char *p;
+
+        disp->size = MAX(2 * disp->size, disp->buf->len + size);
+        p = realloc(disp->buf->data, disp->size);
+        if (p == NULL)
+            mbdDie(MASTER_MEM);
+        disp->buf->data = p;
+    }
+
+    initLSFHeader_(&hdr);
+    hdr.opCode = MBD_NEW_JOBS;
+    memcpy(&js.jobSpecs, jobSpecs, sizeof(struct jobSpecs));
+    js.jobFile = *jf;
+
+    xdrmem_create(&xdrs,
+                  disp->buf->data + disp->buf->len,
+                  disp->size - disp->buf->len,
+                  XDR_ENCODE);
+    if (! xdr_jobStart(&xdrs, &js, &hdr)) {
+        ls_syslog(LOG_ERR, "\
+%s: xdr_jobStart() failed for job %s", __func__,
+                  lsb_jobid2str(jPtr->jobId));
+        xdr_destroy(&xdrs);
+        return ERR_FAIL;
+    }
+    disp->buf->len += XDR_GETPOS(&xdrs);
+    xdr_destroy(&xdrs);
+
+    if (disp->numJobs == disp->maxJobs) {
+        disp->maxJobs = disp->maxJobs ? 2 * disp->maxJobs : 16;
+        disp->jobIds = realloc(disp->jobIds,
+                               disp->maxJobs * sizeof(LS_LONG_INT));
+        if (disp->jobIds == NULL)
+            mbdDie(MASTER_MEM);
+    }
+    disp->jobIds[disp->numJobs] = jPtr->jobId;
+    disp->numJobs++;
+
+    disp->numBatch++;
+    if (disp->numBatch == 1)
+        inList((struct listEntry *)&dispatchList,
+               (struct listEntry *)disp);
+
+    return ERR_NO_ERROR;
+}
+
+/* flushDispatch()
+ *
+ * Send the batched job starts, one MBD_NEW_JOBS
+ * request per host, connecting to the sbatchd
+ * if the host has no dispatch channel yet. The
+ * connect completes in the select loop, the
+ * batch of a host still connecting is sent by a
+ * later flush.
+ */
+void
+flushDispatch(void)
+{
+    struct sbdDispatch *disp;
+    struct sbdDispatch *next;
+    struct LSFHeader hdr;
+    XDR xdrs;
+    int len;
+
+    for (disp = dispatchList.forw;
+         disp != &dispatchList;
+         disp = next) {
+        next = disp->forw;
+
+        if (disp->node == NULL
+            && connectDispatch(disp) < 0) {
+            failDispatch(disp);
+            continue;
+        }
+
+        if (disp->connecting) {
+            if (now - disp->node->lastTime >= connTimeout) {
+                ls_syslog(LOG_ERR, "\
+%s: timed out connecting to sbatchd on host %s", __func__,
+                          disp->hData->host);
+                hStatChange(disp->hData, HOST_STAT_UNREACH);
+                failDispatch(disp);
+            }
+            continue;
+        }
+
+        offList((struct listEntry *)disp);
+
+        initLSFHeader_(&hdr);
+        hdr.opCode = MBD_NEW_JOBS;
+        disp->reqId = (disp->reqId + 1) & 0xffff;
+        hdr.refCode = disp->reqId;
+
+        len = disp->buf->len;
+        hdr.length = len - LSF_HEADER_LEN;
+        xdrmem_create(&xdrs, disp->buf->data, len, XDR_ENCODE);
+        if (! xdr_LSFHeader(&xdrs, &hdr)
+            || ! xdr_int(&xdrs, &disp->numBatch)) {
+            ls_syslog(LOG_ERR, "\
+%s: failed encoding header for host %s", __func__,
+                      disp->hData->host);
+            xdr_destroy(&xdrs);
+            disp->numBatch = 0;
+            failDispatch(disp);
+            continue;
+        }
+        xdr_destroy(&xdrs);
+
+        if (chanEnqueue_(disp->node->chanfd, disp->buf) < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: chanEnqueue_() failed for host %s: %M", __func__,
+                      disp->hData->host);
+            disp->numBatch = 0;
+            failDispatch(disp);
+            continue;
+        }
+
+        if (logclass & LC_COMM)
+            ls_syslog(LOG_DEBUG, "\
+%s: request %d with %d jobs sent to host %s, %d in flight",
+                      __func__, disp->reqId, disp->numBatch,
+                      disp->hData->host, disp->numJobs);
+
+        disp->node->lastTime = now;
+        disp->buf = NULL;
+        disp->numBatch = 0;
+    }
+}
+
+/* connectDispatch()
+ *
+ * Start a non blocking connect to the sbatchd,
+ * connectDispatchDone() is called from the select
+ * loop when it completes.
+ */
+static int
+connectDispatch(struct sbdDispatch *disp)
+{
+    struct hData *hPtr = disp->hData;
+    struct sbdNode *node;
+    struct sockaddr_in addr;
+    const struct hostent *hp;
+    int ch;
+
+    if ((hp = Gethostbyname_(hPtr->host)) == NULL) {
+        ls_syslog(LOG_ERR, "\
+%s: cannot resolve host %s", __func__, hPtr->host);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    memcpy(&addr.sin_addr, hp->h_addr, hp->h_length);
+    addr.sin_port = sbd_port;
+
+    ch = chanClientSocket_(AF_INET, SOCK_STREAM, 0);
+    if (ch < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: chanClientSocket_() failed for host %s: %M", __func__,
+                  hPtr->host);
+        return -1;
+    }
+
+    if (chanConnect_(ch, &addr, -1, CHAN_OP_NONBLOCK) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: failed to connect to sbatchd on host %s: %M", __func__,
+                  hPtr->host);
+        chanClose_(ch);
+        hStatChange(hPtr, HOST_STAT_UNREACH);
+        return -1;
+    }
+
+    node = my_calloc(1, sizeof(struct sbdNode), __func__);
+    node->chanfd = ch;
+    node->hData = hPtr;
+    node->reqCode = MBD_NEW_JOBS;
+    node->lastTime = now;
+    node->disp = disp;
+    disp->node = node;
+    disp->connecting = TRUE;
+
+    inList((struct listEntry *)&sbdNodeList,
+           (struct listEntry *)node);
+    nSbdConnections++;
+
+    return 0;
+}
+
+/* connectDispatchDone()
+ *
+ * The socket of a connecting dispatch channel
+ * became writable or failed, see if the connect
+ * went through.
+ */
+void
+connectDispatchDone(struct sbdDispatch *disp, int exception)
+{
+    struct hData *hPtr = disp->hData;
+    socklen_t len;
+    int err;
+
+    err = 0;
+    len = sizeof(err);
+    if (getsockopt(chanSock_(disp->node->chanfd), SOL_SOCKET,
+                   SO_ERROR, &err, &len) < 0)
+        err = errno;
+
+    if (exception || err != 0) {
+        ls_syslog(LOG_ERR, "\
+%s: failed to connect to sbatchd on host %s: %s", __func__,
+                  hPtr->host,
+                  err ? strerror(err) : "exception on channel");
+        hStatChange(hPtr, HOST_STAT_UNREACH);
+        failDispatch(disp);
+        return;
+    }
+
+    disp->connecting = FALSE;
+    disp->node->lastTime = now;
+    hStatChange(hPtr, HOST_STAT_OK);
+}
+
+/* failDispatch()
+ *
+ * The dispatch channel is gone, the jobs in
+ * flight did not start. Put them back to pend,
+ * the channel is reconnected by the next flush.
+ */
+void
+failDispatch(struct sbdDispatch *disp)
+{
+    struct jData *jPtr;
+    int i;
+
+    for (i = 0; i < disp->numJobs; i++) {
+
+        jPtr = getJobData(disp->jobIds[i]);
+        if (jPtr == NULL
+            || jPtr->jobPid != 0
+            || !IS_START(jPtr->jStatus))
+            continue;
+
+        jPtr->newReason = PEND_JOB_START_FAIL;
+        jStatusChange(jPtr, JOB_STAT_PEND, LOG_IT, __func__);
+    }
+    disp->numJobs = 0;
+
+    if (disp->numBatch > 0) {
+        offList((struct listEntry *)disp);
+        disp->numBatch = 0;
+    }
+    chanFreeBuf_(disp->buf);
+    disp->buf = NULL;
+
+    if (disp->node) {
+        chanClose_(disp->node->chanfd);
+        offList((struct listEntry *)disp->node);
+        FREEUP(disp->node);
+        nSbdConnections--;
+    }
+    disp->connecting = FALSE;
+}
+
+/* dispatchJobDone()
+ *
+ * The sbatchd answered for the job, it is
+ * no longer in flight.
+ */
+void
+dispatchJobDone(struct sbdDispatch *disp, LS_LONG_INT jobId)
+{
+    int i;
+
+    for (i = 0; i < disp->numJobs; i++) {
+        if (disp->jobIds[i] == jobId) {
+            memmove(&disp->jobIds[i], &disp->jobIds[i + 1],
+                    (disp->numJobs - i - 1) * sizeof(LS_LONG_INT));
+            disp->numJobs--;
+            return;
+        }
+    }
+}
+
+/* closeDispatch()
+ *
+ * The host is going away, drop its dispatch
+ * channel.
+ */
+void
+closeDispatch(struct hData *hPtr)
+{
+    struct sbdDispatch *disp = hPtr->dispatch;
+
+    if (disp == NULL)
+        return;
+
+    if (disp->numBatch > 0)
+        offList((struct listEntry *)disp);
+    chanFreeBuf_(disp->buf);
+
+    if (disp->node) {
+        chanClose_(disp->node->chanfd);
+        offList((struct listEntry *)disp->node);
+        FREEUP(disp->node);
+        nSbdConnections--;
+    }
+
+    FREEUP(disp->jobIds);
+    FREEUP(disp);
+    hPtr->dispatch = NULL;
+}
@@ -1487,3 +1487,297 @@ evalJobDep(struct dptNode *node, struct jData *jpbw, struct jData *depJob)
 }
 
 
+
+/* Reverse dependency index. Each job or array that
+ * appears in a dependency condition is mapped to the
+ * ids of the jobs whose condition refers to it. Job
+ * names and array counters are resolved to job ids
+ * by parseDepCond() so the id is the only key. When
+ * the referenced job changes state its dependents are
+ * marked dirty and checkJgrpDep() evaluates only the
+ * dirty jobs. A condition with a time window can turn
+ * true with no job event so its jobs are polled.
+ *
+ * An array element is indexed by its array id, the
+ * array is evaluated element by element.
+ */
+#define DEP_SWEEP_INTERVAL 600
+
+struct depRef {
+    int          num;
+    int          size;
+    LS_LONG_INT  *ids;
+};
+
+static struct hTab depRevTab;
+static struct depRef depDirty;
+static struct depRef depPolled;
+static time_t depSweepTime;
+
+static void depRefAdd(struct depRef *, LS_LONG_INT);
+static void depRefPrune(struct depRef *);
+static int depIndexNode(struct dptNode *, LS_LONG_INT);
+static void depIndexRef(LS_LONG_INT, LS_LONG_INT);
+static void depMarkId(LS_LONG_INT);
+static void depSweep(void);
+
+/* depIndexAdd()
+ *
+ * Index the dependency condition of the job and
+ * mark the job dirty so that its readiness is
+ * computed by the next checkJgrpDep().
+ */
+void
+depIndexAdd(struct jData *jp)
+{
+    LS_LONG_INT id;
+
+    id = LSB_ARRAY_JOBID(jp->jobId);
+
+    if (jp->shared->dptRoot
+        && depIndexNode(jp->shared->dptRoot, id)) {
+        if (depPolled.num == 0
+            || depPolled.ids[depPolled.num - 1] != id)
+            depRefAdd(&depPolled, id);
+    }
+
+    depMarkDirty(jp);
+}
+
+/* depJobChanged()
+ *
+ * The job is about to change its status to
+ * newStatus, its dependents must be evaluated
+ * again and so must the job itself if it goes
+ * back to pending.
+ */
+void
+depJobChanged(struct jData *jp, int newStatus)
+{
+    struct depRef *ref;
+    hEnt *ent;
+    int i;
+
+    if (IS_PEND(newStatus))
+        depMarkDirty(jp);
+
+    if (depRevTab.size == 0)
+        return;
+
+    ent = chekMemb(&depRevTab, LSB_ARRAY_JOBID(jp->jobId));
+    if (ent == NULL)
+        return;
+
+    ref = ent->hData;
+    for (i = 0; i < ref->num; i++)
+        depMarkId(ref->ids[i]);
+}
+
+/* depMarkDirty()
+ */
+void
+depMarkDirty(struct jData *jp)
+{
+    if (jp->jFlags & JFLAG_DEP_DIRTY)
+        return;
+
+    jp->jFlags |= JFLAG_DEP_DIRTY;
+    depRefAdd(&depDirty, jp->jobId);
+}
+
+/* depPollJobs()
+ *
+ * Mark dirty the jobs whose condition has a time
+ * window and every now and then drop the index
+ * entries of the jobs that are gone.
+ */
+void
+depPollJobs(void)
+{
+    int i;
+
+    depRefPrune(&depPolled);
+    for (i = 0; i < depPolled.num; i++)
+        depMarkId(depPolled.ids[i]);
+
+    if (now - depSweepTime >= DEP_SWEEP_INTERVAL) {
+        depSweep();
+        depSweepTime = now;
+    }
+}
+
+/* depNextDirty()
+ *
+ * Return the next dirty job or array head,
+ * NULL when there are no more.
+ */
+struct jData *
+depNextDirty(void)
+{
+    struct jData *jp;
+
+    while (depDirty.num > 0) {
+
+        --depDirty.num;
+        jp = getJobData(depDirty.ids[depDirty.num]);
+        if (jp == NULL)
+            continue;
+
+        jp->jFlags &= ~JFLAG_DEP_DIRTY;
+        return jp;
+    }
+
+    return NULL;
+}
+
+/* depIndexNode()
+ *
+ * Add the dependent id to the entries of all jobs
+ * referenced by the condition, return TRUE if the
+ * condition has to be polled.
+ */
+static int
+depIndexNode(struct dptNode *node, LS_LONG_INT id)
+{
+    struct jarray *jarray;
+    int poll;
+
+    switch (node->type) {
+        case DPT_AND:
+        case DPT_OR:
+            poll = depIndexNode(node->dptLeft, id);
+            if (depIndexNode(node->dptRight, id))
+                poll = TRUE;
+            return poll;
+        case DPT_NOT:
+            return depIndexNode(node->dptLeft, id);
+        case DPT_DONE:
+        case DPT_POST_DONE:
+        case DPT_POST_ERR:
+        case DPT_ENDED:
+        case DPT_STARTED:
+        case DPT_EXIT:
+            if (node->dptJobRec)
+                depIndexRef(LSB_ARRAY_JOBID(node->dptJobRec->jobId), id);
+            return FALSE;
+        case DPT_NUMPEND:
+        case DPT_NUMHOLD:
+        case DPT_NUMRUN:
+        case DPT_NUMEXIT:
+        case DPT_NUMDONE:
+        case DPT_NUMSTART:
+        case DPT_NUMENDED:
+            /* parseDepCond() only accepts arrays
+             * as operands of the counters.
+             */
+            jarray = (struct jarray *)node->dptJgrp;
+            if (jarray && jarray->jobArray)
+                depIndexRef(jarray->jobArray->jobId, id);
+            return FALSE;
+        case DPT_WINDOW:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static void
+depIndexRef(LS_LONG_INT refId, LS_LONG_INT id)
+{
+    struct depRef *ref;
+    hEnt *ent;
+
+    if (depRevTab.size == 0)
+        h_initTab_(&depRevTab, 101);
+
+    ent = addMemb(&depRevTab, refId);
+    if (ent) {
+        ent->hData = my_calloc(1, sizeof(struct depRef), __func__);
+    } else {
+        ent = chekMemb(&depRevTab, refId);
+    }
+
+    /* The elements of an array share the
+     * condition and come in a row.
+     */
+    ref = ent->hData;
+    if (ref->num > 0 && ref->ids[ref->num - 1] == id)
+        return;
+
+    depRefAdd(ref, id);
+}
+
+static void
+depMarkId(LS_LONG_INT id)
+{
+    struct jData *jp;
+
+    jp = getJobData(id);
+    if (jp == NULL)
+        return;
+
+    depMarkDirty(jp);
+}
+
+static void
+depRefAdd(struct depRef *ref, LS_LONG_INT id)
+{
+    void *p;
+
+    if (ref->num == ref->size) {
+        ref->size = ref->size ? 2 * ref->size : 16;
+        p = realloc(ref->ids, ref->size * sizeof(LS_LONG_INT));
+        if (p == NULL)
+            mbdDie(MASTER_MEM);
+        ref->ids = p;
+    }
+
+    ref->ids[ref->num] = id;
+    ref->num++;
+}
+
+/* depRefPrune()
+ *
+ * Drop the ids of the jobs that have been
+ * cleaned from memory.
+ */
+static void
+depRefPrune(struct depRef *ref)
+{
+    int i;
+    int n;
+
+    n = 0;
+    for (i = 0; i < ref->num; i++) {
+        if (getJobData(ref->ids[i]) == NULL)
+            continue;
+        ref->ids[n] = ref->ids[i];
+        ++n;
+    }
+    ref->num = n;
+}
+
+static void
+depSweep(void)
+{
+    struct depRef *ref;
+    sTab sTab;
+    hEnt *ent;
+
+    if (depRevTab.size == 0)
+        return;
+
+    for (ent = h_firstEnt_(&depRevTab, &sTab);
+         ent != NULL;
+         ent = h_nextEnt_(&sTab)) {
+
+        ref = ent->hData;
+        depRefPrune(ref);
+        if (ref->num > 0
+            && getJobData(atoll(ent->keyname)) != NULL)
+            continue;
+
+        FREEUP(ref->ids);
+        h_delEnt_(&depRevTab, ent);
+    }
+}
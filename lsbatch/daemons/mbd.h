@@ -25,6 +25,7 @@
 #include "daemons.h"
 #include "../../lsf/intlib/bitset.h"
 #include "../../lsf/intlib/link.h"
+#include "../../lsf/intlib/heap.h"
 #include "jgrp.h"
 #include "../lib/lsb.sig.h"
 
@@ -96,6 +97,7 @@ typedef enum {
 #define JFLAG_URGENT_NOSTOP     0x800000
 #define JFLAG_REQUEUE           0x1000000
 #define JFLAG_HAS_BEEN_REQUEUED 0x2000000
+#define JFLAG_DEP_DIRTY         0x4000000
 #define JFLAG_JOB_PREEMPTED     0x20000000
 #define JFLAG_WILL_BE_PREEMPTED 0x40000000
 #define JFLAG_WAIT_SWITCH       0x80000000
@@ -245,6 +247,47 @@ struct jRef {
     struct jRef *forw;
     struct jRef *back;
     struct jData *job;
+    int    seq;
+    int    group;
+    struct jRef *next;
+};
+
+/* The pending job index used by the job iterator.
+ * Jobs are partitioned in priority groups, runs of
+ * jobs with the same queue priority and job priority
+ * as sorted by inPendJobList(). Inside a group jobs
+ * are chained in buckets, one per round robin user,
+ * one per fcfs queue and one per fairshare queue,
+ * keeping the pending list order so the head of
+ * each bucket is its next candidate.
+ */
+struct pendBucket {
+    int    type;
+#define PEND_BUCKET_FCFS 0
+#define PEND_BUCKET_RR   1
+#define PEND_BUCKET_FS   2
+    int    stamp;
+    int    group;
+    int    hpos;
+    int    numRUN;
+    struct uData *uPtr;
+    struct qData *qPtr;
+    struct jRef  *head;
+    struct jRef  *tail;
+    LIST_T       *jRefList;
+};
+
+/* A priority group has two heaps, the first one
+ * orders fcfs and fairshare buckets by the position
+ * of their head job, the second one orders round
+ * robin users by the number of running jobs and
+ * then by the position of their head job.
+ */
+struct pendGroup {
+    int    qPriority;
+    int    jobPriority;
+    struct heap_ *first;
+    struct heap_ *rr;
 };
 
 struct jData {
@@ -318,6 +361,7 @@ struct jData {
     char    *execCwd;
     char    *execHome;
     char    *execUsername;
+    char    *cpuBind;
     char    *queuePreCmd;
     char    *queuePostCmd;
     int     initFailCount;
@@ -349,6 +393,10 @@ struct jData {
     int numAvailSlotsReserve;
     int numMsg;
     struct lsbMsg **msgs;
+    LS_LONG_INT listSeq;
+    int     listNo;
+    int     numIdxRef;
+    struct jobIndexRef *idxRef;
 };
 
 
@@ -435,6 +483,7 @@ struct uData {
     LS_BITSET_T *parents;
     LS_BITSET_T *ancestors;
     LIST_T *pxySJL;
+    struct pendBucket *pendBucket;
 };
 
 #define USER_GROUP_IS_ALL_USERS(UserGroup) \
@@ -593,6 +642,8 @@ struct qData {
     char *preemption;
     link_t *preemptable;
     struct prm_sched *prmSched;
+    struct pendBucket *pendBucket;
+    char *affinity;
 };
 
 #define HOST_STAT_REMOTE       0x80000000
@@ -645,6 +696,7 @@ struct hData {
     LIST_T    *pxySJL;
     LIST_T    *pxyRsvJL;
     float     leftRusageMem;
+    struct sbdDispatch *dispatch;
 };
 
 
@@ -658,9 +710,32 @@ struct sbdNode {
     time_t lastTime;
     int sigVal;
     int sigFlags;
+    struct sbdDispatch *disp;
 };
 
 extern struct sbdNode sbdNodeList;
+
+/* Persistent dispatch channel to the sbatchd
+ * of one host. Job starts for the host are
+ * batched in buf and flushed as one MBD_NEW_JOBS
+ * request; jobIds holds the jobs batched or
+ * waiting for the sbatchd reply. connecting is
+ * set until the non blocking connect completes.
+ */
+struct sbdDispatch {
+    struct sbdDispatch *forw;
+    struct sbdDispatch *back;
+    struct hData       *hData;
+    struct sbdNode     *node;
+    int                connecting;
+    int                reqId;
+    struct Buffer      *buf;
+    int                size;
+    int                numBatch;
+    LS_LONG_INT        *jobIds;
+    int                numJobs;
+    int                maxJobs;
+};
 extern struct parameterInfo *mbdParams;
 
 struct gData {
@@ -763,6 +838,7 @@ struct clientNode {
     char *fromHost;
     mbdReqType reqType;
     time_t lastTime;
+    long   logSeq;
 };
 
 struct condData {
@@ -787,6 +863,21 @@ struct profileCounters {
     char *cntDescr;
 };
 
+/* The scheduler timers of a session in ms,
+ * the same ones reported by DUMP_TIMERS().
+ */
+struct schedTimers {
+    int getQUsable;
+    int getCandHosts;
+    int getJUsable;
+    int readyToDisp;
+    int cntUQSlots;
+    int fsQelectPendJob;
+    int pickAJob;
+    int scheduleAJob;
+    int collectPendReason;
+};
+
 #undef MBD_PROF_COUNTER
 #define MBD_PROF_COUNTER(Func) PROF_CNT_ ## Func,
 
@@ -803,6 +894,7 @@ typedef enum profCounterType {
 #define RESET_CNT() \
                  { \
                    int i; \
+                   metricsCounters(); \
                    for(i = 0; counters[i].cntDescr != NULL; i++) \
                        counters[i].cntVal = 0; \
                  }
@@ -973,6 +1065,8 @@ extern int                  getHostsByResReq(struct resVal *, int *,
                                              struct hData **,
                                              struct hData ***,
                                              struct hData *,int *);
+extern void                 invalidateSelectCache(void);
+extern void                 invalidateHostSelectCache(struct hData *);
 
 extern struct resVal *      checkResReq(char *, int);
 extern void                 adjLsbLoad(struct jData *, int, bool_t);
@@ -1058,6 +1152,9 @@ extern int                  resigJobs (int *resignal);
 extern void                 removeJob(LS_LONG_INT);
 extern bool_t               runJob(struct runJobRequest *, struct lsfAuth *);
 extern void                 addJobIdHT(struct jData *);
+extern void                 jobListIn(struct jData *, int);
+extern void                 jobIdxUpdate(struct jData *);
+extern void                 jobIdxRemove(struct jData *);
 extern struct jData      *createjDataRef (struct jData *);
 extern void               destroyjDataRef(struct jData *);
 extern void             setJobPendReason(struct jData *, int);
@@ -1099,7 +1196,9 @@ extern void                 offJobList (struct jData *, int);
 extern void                 handleRequeueJob (struct jData *, time_t);
 extern int                  PJLorMJL(struct jData *);
 
+extern int                  schedule;
 extern int                  scheduleAndDispatchJobs(void);
+extern void                 (*schedSessionHook)(struct schedTimers *);
 extern int                  scheduleJobs(int *schedule, int *dispatch,
                                          struct jData *);
 extern int                  dispatchJobs(int *dispatch);
@@ -1188,6 +1287,9 @@ extern int                  do_userInfoReq(XDR *, int , struct sockaddr_in *,
                                            struct LSFHeader *);
 extern int                  do_paramInfoReq(XDR *, int , struct sockaddr_in *,
                                             struct LSFHeader *);
+extern int                  do_metricsInfoReq(XDR *, int,
+                                              struct sockaddr_in *,
+                                              struct LSFHeader *);
 extern int                  do_hostPartInfoReq(XDR *, int ,
                                                struct sockaddr_in *,
                                                struct LSFHeader *);
@@ -1197,6 +1299,7 @@ extern int                  do_modifyReq (XDR *, int, struct sockaddr_in *,
                                           char *, struct LSFHeader *,
                                           struct lsfAuth *);
 extern void                 doNewJobReply(struct sbdNode *, int);
+extern void                 doNewJobsReply(struct sbdNode *, int);
 extern void                 doProbeReply(struct sbdNode *, int);
 extern void                 doSignalJobReply(struct sbdNode *sbdPtr, int);
 extern void                 doSwitchJobReply(struct sbdNode *sbdPtr, int);
@@ -1311,6 +1414,7 @@ extern int                  updAllConfCond(void);
 extern void                 mbdReConf(int);
 
 extern int                  log_newjob(struct jData *);
+extern struct jData         *newJobFromRec(struct eventRec *);
 extern void                 log_switchjob(struct jobSwitchReq *,
                                           int, char *);
 extern void                 log_movejob(struct jobMoveReq *, int , char *);
@@ -1335,7 +1439,13 @@ extern void                 log_jobmsg(struct jData *, struct lsbMsg *);
 extern void                 replay_requeuejob(struct jData *);
 extern int                  init_log(void);
 extern void                 switchELog(void);
+extern void                 checkCompactLog(void);
 extern int                  switch_log(void);
+extern int                  commitEventLog(void);
+extern int                  syncEventLog(void);
+extern long                 eventLogSeq(void);
+extern int                  eventLogCommitted(long);
+extern int                  eventLogCommitDelay(void);
 extern void                 checkAcctLog(void);
 extern int                  switchAcctLog(void);
 extern void                 logJobInfo(struct submitReq *, struct jData *,
@@ -1362,6 +1472,8 @@ extern int                  stripJobStarter(char *, int *, char *);
 
 extern sbdReplyType         start_job(struct jData *, struct qData *,
                                       struct jobReply *);
+extern sbdReplyType         (*startJobHook)(struct jData *, struct qData *,
+                                            struct jobReply *);
 extern sbdReplyType         signal_job(struct jData *jobPtr, struct jobSig *,
                                        struct jobReply *jobReply);
 extern sbdReplyType         switch_job(struct jData *, int options);
@@ -1370,11 +1482,39 @@ extern sbdReplyType         msg_job(struct jData *, struct Buffer *,
 extern sbdReplyType         probe_slave(struct hData *, char sendJobs);
 extern sbdReplyType         rebootSbd(char *host);
 extern sbdReplyType         shutdownSbd(char *host);
+extern void                 flushDispatch(void);
+extern void                 failDispatch(struct sbdDispatch *);
+extern void                 connectDispatchDone(struct sbdDispatch *, int);
+extern void                 closeDispatch(struct hData *);
+extern void                 dispatchJobDone(struct sbdDispatch *,
+                                            LS_LONG_INT);
+extern void                 initQuerySnapshot(void);
+extern int                  querySnapshotReq(mbdReqType);
+extern int                  querySnapshotSend(int, struct sockaddr_in *,
+                                              struct Buffer *);
+extern void                 checkQuerySnapshot(void);
+extern void                 initMetrics(void);
+extern void                 metricsSessionBegin(void);
+extern void                 metricsSessionEnd(struct schedTimers *);
+extern void                 metricsJobStarted(void);
+extern void                 metricsCounters(void);
+extern void                 metricsCommit(struct timeval *);
+extern void                 metricsRequest(mbdReqType, struct timeval *);
+extern int                  initJobInfoStore(const char *);
+extern int                  putJobInfo(const char *, const char *, int);
+extern char                 *getJobInfo(const char *, int *);
+extern int                  rmJobInfo(const char *);
+extern void                 compactJobInfo(void);
 extern struct dptNode       *parseDepCond(char *, struct lsfAuth * ,
                                           int *, char **,int *, int);
 extern int                  evalDepCond (struct dptNode *, struct jData *);
 extern void                 freeDepCond (struct dptNode *);
 extern void                 resetDepCond (struct dptNode *);
+extern void                 depIndexAdd(struct jData *);
+extern void                 depJobChanged(struct jData *, int);
+extern void                 depMarkDirty(struct jData *);
+extern void                 depPollJobs(void);
+extern struct jData *       depNextDirty(void);
 extern bool_t               autoAdjustIsEnabled(void);
 extern int                  getAutoAdjustAtNumPend(void);
 extern float                  getAutoAdjustAtPercent(void);
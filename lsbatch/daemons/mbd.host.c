@@ -40,6 +40,29 @@ static void addMigrantHost(struct hostInfo *);
 static int rmMigrantHost(void);
 static void migrantHostJobs(struct hData *);
 
+/* Pending jobs share few distinct select strings,
+ * the result of evalResReq() on each host is kept
+ * in bitmaps per select string and origin host until
+ * the host load or the shared resources change.
+ * Entries are tagged with the generation they were
+ * filled in, bumping selectGen invalidates them all.
+ */
+struct selectCache {
+    int    gen;
+    int    numHosts;
+    int    *done;
+    int    *ok;
+    int    *overRide;
+};
+#define MAX_SELECT_CACHE 4096
+
+static struct hTab selectTab;
+static int selectGen;
+static int numSelectLive;
+
+static struct selectCache *getSelectCache(const char *, struct hData *);
+static void freeSelectCache(void *);
+
 typedef enum {
     OK_UNREACH,
     UNREACH_OK,
@@ -991,6 +1014,8 @@ getLsbHostLoad(void)
 
     ls_syslog(LOG_DEBUG, "%s: Entering this routine...", __func__);
 
+    invalidateSelectCache();
+
     /* Reset the HOST_UPDATE flag to detect migrant
      * hosts that left the cluster. Only if allow
      * migrants and the hostlist is already built.
@@ -1142,7 +1167,11 @@ getHostsByResReq(struct resVal *resValPtr,
 {
     static char fname[] = "getHostsByResReq";
     struct hData **hData = NULL;
+    struct selectCache *sc;
     int i, numHosts, k = 0;
+    int id;
+    int ok;
+    int overRide;
     struct tclHostData tclHostData;
 
     *overRideFromType = FALSE;
@@ -1156,6 +1185,9 @@ getHostsByResReq(struct resVal *resValPtr,
     if (hData == NULL)
         hData = my_calloc(numofhosts(),
                           sizeof(struct hData *), fname);
+
+    sc = getSelectCache(resValPtr->selectStr, fromHost);
+
     numHosts = 0;
     for (i = 0, k = 0; i < *num; i++) {
 
@@ -1166,16 +1198,40 @@ getHostsByResReq(struct resVal *resValPtr,
             continue;
 
         hData[k++] = hosts[i];
+
+        id = hosts[i]->hostId;
+        if (sc && id >= 0 && id < sc->numHosts) {
+            TEST_BIT(id, sc->done, ok);
+            if (ok) {
+                INC_CNT(PROF_CNT_selectCacheHit);
+                TEST_BIT(id, sc->ok, ok);
+                TEST_BIT(id, sc->overRide, overRide);
+                goto done;
+            }
+            INC_CNT(PROF_CNT_selectCacheMiss);
+        }
+
         getTclHostData (&tclHostData, hosts[i], fromHost);
-        if (evalResReq(resValPtr->selectStr, &tclHostData, DFT_FROMTYPE) != 1) {
-            freeTclHostData (&tclHostData);
-            continue;
+        ok = (evalResReq(resValPtr->selectStr,
+                         &tclHostData, DFT_FROMTYPE) == 1);
+        overRide = (tclHostData.overRideFromType == TRUE);
+        freeTclHostData (&tclHostData);
+
+        if (sc && id >= 0 && id < sc->numHosts) {
+            SET_BIT(id, sc->done);
+            if (ok)
+                SET_BIT(id, sc->ok);
+            if (overRide)
+                SET_BIT(id, sc->overRide);
         }
 
-        if (tclHostData.overRideFromType == TRUE)
+    done:
+        if (!ok)
+            continue;
+
+        if (overRide)
             *overRideFromType = TRUE;
 
-        freeTclHostData (&tclHostData);
         hosts[numHosts++] = hosts[i];
         k--;
     }
@@ -1190,6 +1246,128 @@ getHostsByResReq(struct resVal *resValPtr,
 
 }
 
+/* getSelectCache()
+ *
+ * Get the cached select results for the select
+ * string evaluated with hosts sent from fromHost,
+ * entries from an older generation are cleared.
+ */
+static struct selectCache *
+getSelectCache(const char *selectStr, struct hData *fromHost)
+{
+    static char *key;
+    static int keySize;
+    struct selectCache *sc;
+    hEnt *ent;
+    int new;
+    int n;
+
+    if (selectStr == NULL)
+        return NULL;
+
+    if (selectTab.slotPtr == NULL)
+        h_initTab_(&selectTab, 101);
+
+    n = strlen(selectStr) + MAXHOSTNAMELEN + 2;
+    if (n > keySize) {
+        FREEUP(key);
+        key = my_malloc(n, __func__);
+        keySize = n;
+    }
+    sprintf(key, "%s@%s", fromHost ? fromHost->host : "", selectStr);
+
+    ent = h_getEnt_(&selectTab, key);
+    if (ent == NULL) {
+        if (selectTab.numEnts >= MAX_SELECT_CACHE) {
+            h_freeTab_(&selectTab, freeSelectCache);
+            h_initTab_(&selectTab, 101);
+            numSelectLive = 0;
+        }
+        ent = h_addEnt_(&selectTab, key, &new);
+        ent->hData = my_calloc(1, sizeof(struct selectCache), __func__);
+        sc = ent->hData;
+        sc->gen = selectGen - 1;
+    }
+    sc = ent->hData;
+
+    if (sc->gen == selectGen)
+        return sc;
+
+    /* The host list may have changed since
+     * the entry was made.
+     */
+    n = numofhosts();
+    if (sc->numHosts != n) {
+        FREEUP(sc->done);
+        FREEUP(sc->ok);
+        FREEUP(sc->overRide);
+        sc->done = my_calloc(GET_INTNUM(n), sizeof(int), __func__);
+        sc->ok = my_calloc(GET_INTNUM(n), sizeof(int), __func__);
+        sc->overRide = my_calloc(GET_INTNUM(n), sizeof(int), __func__);
+        sc->numHosts = n;
+    } else {
+        memset(sc->done, 0, GET_INTNUM(n) * sizeof(int));
+        memset(sc->ok, 0, GET_INTNUM(n) * sizeof(int));
+        memset(sc->overRide, 0, GET_INTNUM(n) * sizeof(int));
+    }
+    sc->gen = selectGen;
+    ++numSelectLive;
+
+    return sc;
+}
+
+/* invalidateSelectCache()
+ *
+ * Host load or shared resources have changed,
+ * forget all the select results.
+ */
+void
+invalidateSelectCache(void)
+{
+    ++selectGen;
+    numSelectLive = 0;
+}
+
+/* invalidateHostSelectCache()
+ *
+ * The load of this host only has changed.
+ */
+void
+invalidateHostSelectCache(struct hData *hPtr)
+{
+    struct selectCache *sc;
+    struct sTab stab;
+    hEnt *ent;
+
+    /* Nothing was evaluated since the last
+     * invalidation, typically while getLsbHostLoad()
+     * adjusts the load of all running jobs.
+     */
+    if (numSelectLive == 0)
+        return;
+
+    ent = h_firstEnt_(&selectTab, &stab);
+    while (ent) {
+        sc = ent->hData;
+        if (sc->gen == selectGen
+            && hPtr->hostId >= 0
+            && hPtr->hostId < sc->numHosts)
+            CLEAR_BIT(hPtr->hostId, sc->done);
+        ent = h_nextEnt_(&stab);
+    }
+}
+
+static void
+freeSelectCache(void *e)
+{
+    struct selectCache *sc = e;
+
+    FREEUP(sc->done);
+    FREEUP(sc->ok);
+    FREEUP(sc->overRide);
+    FREEUP(sc);
+}
+
 void
 getTclHostData(struct tclHostData *tclHostData,
                struct hData *hPtr,
@@ -1467,6 +1645,7 @@ adjLsbLoad(struct jData *jpbw, int forResume, bool_t doAdj)
                     && forResume == FALSE)
                     jpbw->hPtr[i]->lsbLoad[ldx] = 1.0;
                 load = jpbw->hPtr[i]->lsbLoad[ldx];
+                invalidateHostSelectCache(jpbw->hPtr[i]);
             } else {
                 originalLoad = atof (instance->value);
                 load = originalLoad + jackValue;
@@ -1475,6 +1654,9 @@ adjLsbLoad(struct jData *jpbw, int forResume, bool_t doAdj)
                 FREEUP (instance->value);
                 sprintf (loadString, "%-10.1f", load);
                 instance->value = safeSave (loadString);
+                /* Instances can be shared by many hosts.
+                 */
+                invalidateSelectCache();
             }
 
             if (logclass & LC_SCHED)
@@ -480,6 +480,7 @@ initHData(struct hData *hData)
     hData->pxySJL = NULL;
     hData->pxyRsvJL = NULL;
     hData->leftRusageMem = INFINIT_LOAD;
+    hData->dispatch = NULL;
 
     return hData;
 }
@@ -910,6 +911,8 @@ freeHData(struct hData *hPtr)
      */
     listRemoveEntry(hostList, (LIST_ENTRY_T *)hPtr);
 
+    closeDispatch(hPtr);
+
     FREEUP(hPtr->host);
     FREEUP(hPtr->hostType);
     FREEUP(hPtr->hostModel);
@@ -1230,6 +1233,7 @@ freeQData(struct qData *qp, int delete)
 
     FREEUP(qp->askedPtr);
     FREEUP(qp->hostList);
+    FREEUP(qp->affinity);
 
     if (delete == TRUE) {
         offList((struct listEntry *)qp);
@@ -2285,6 +2289,9 @@ addQData(struct queueConf *queueConf, int mbdInitFlags )
             qPtr->preemption = strdup(queue->preemption);
             qPtr->qAttrib |= Q_ATTRIB_PREEMPTIVE;
         }
+
+        if (queue->affinity)
+            qPtr->affinity = strdup(queue->affinity);
     }
 
     for (i = 0; i < queueConf->numQueues; i++) {
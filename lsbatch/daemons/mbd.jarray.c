@@ -196,6 +196,10 @@ copyJData(struct jData *jp)
     jData->reqHistory = reqHistory;
     jData->numRef = 0;
     jData->nextJob = NULL;
+    jData->listNo = -1;
+    jData->numIdxRef = 0;
+    jData->idxRef = NULL;
+    jData->jFlags &= ~JFLAG_DEP_DIRTY;
 
     jData->userName = safeSave(jp->userName);
     jData->schedHost = safeSave(jp->schedHost);
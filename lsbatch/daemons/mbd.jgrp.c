@@ -53,6 +53,7 @@ static void       treeObserverEvalDep(TREE_OBSERVER_T *, void *, enum treeEventT
 static TREE_OBSERVER_T * treeObserverCreate(char *, void *, TREE_EVENT_OP_T);
 static void       treeObserverInvoke(void *, enum treeEventType);
 static void       freeGrpNode(struct jgrpData *);
+static void       checkJobDep(struct jData *);
 static int isSelected ( struct jobInfoReq *,
                         struct jData *,
                         struct jgrpInfo *
@@ -756,9 +757,11 @@ putOntoTree(struct jData *jp, int jobType)
     }
 
     jp->jgrpNode = newj;
+    jobIdxUpdate(jp);
 
     for (jPtr = jp->nextJob; jPtr; jPtr = jPtr->nextJob) {
         jPtr->jgrpNode = newj;
+        jobIdxUpdate(jPtr);
 
         updJgrpCountByJStatus(jPtr, JOB_STAT_NULL, jPtr->jStatus);
     }
@@ -777,6 +780,7 @@ putOntoTree(struct jData *jp, int jobType)
          */
         jp->jFlags |= JFLAG_READY2;
     }
+    depIndexAdd(jp);
 
     if (logclass & LC_JGRP)
         printTreeStruct(treeFile);
@@ -805,111 +809,87 @@ destroyJgArrayBaseRef(struct jgArrayBase *jgArrayBase)
     return;
 }
 
+/* checkJgrpDep()
+ *
+ * Compute the readiness of the pending jobs whose
+ * dependencies may have changed since the last call,
+ * see the reverse dependency index in mbd.dep.c.
+ * The first call after startup looks at all jobs.
+ */
 void
 checkJgrpDep(void)
 {
-    static char  fname[] = "checkJgrpDep";
+    static int first = TRUE;
     struct jgTreeNode *nPtr;
-    int    iterNum = 0;
-    time_t   entryTime;
-    int    change = TRUE;
-
-    if (treeObserverDep->entry)
-        nPtr = (struct jgTreeNode *)treeObserverDep->entry;
-    else {
-        nPtr = groupRoot;
-        treeObserverDep->entry = (void *)groupRoot;
+    struct jData *jpbw;
+    int num;
+
+    if (first) {
+        for (nPtr = groupRoot; nPtr; nPtr = treeLexNext(nPtr)) {
+            if (nPtr->nodeType == JGRP_NODE_JOB)
+                depMarkDirty(JOB_DATA(nPtr));
+            else if (nPtr->nodeType == JGRP_NODE_ARRAY)
+                depMarkDirty(ARRAY_DATA(nPtr)->jobArray);
+        }
+        first = FALSE;
     }
 
-    if (logclass & LC_SCHED)
-        ls_syslog(LOG_DEBUG1, "%s: (Re-)entering checkJgrpDep at node <%s%s>;",
-                  fname, jgrpNodeParentPath(nPtr), nPtr->name);
+    depPollJobs();
 
-    entryTime = time(0);
+    num = 0;
+    while ((jpbw = depNextDirty()) != NULL) {
 
+        if (jpbw->jgrpNode
+            && jpbw->jgrpNode->nodeType == JGRP_NODE_ARRAY
+            && ARRAY_DATA(jpbw->jgrpNode)->jobArray == jpbw) {
+            for (jpbw = jpbw->nextJob; jpbw; jpbw = jpbw->nextJob) {
+                checkJobDep(jpbw);
+                ++num;
+            }
+            continue;
+        }
 
-Entry:
-    if (! change)
-        goto Exit;
-    change = FALSE;
-    while(nPtr) {
-        switch (nPtr->nodeType) {
-            case JGRP_NODE_GROUP:
-                nPtr = treeLexNext(nPtr);
-                break;
-            case JGRP_NODE_JOB:
-            case JGRP_NODE_ARRAY: {
-                struct jData * jpbw;
-
-                if (nPtr->nodeType == JGRP_NODE_JOB)
-                    jpbw = JOB_DATA(nPtr);
-                else
-                    jpbw = ARRAY_DATA(nPtr)->jobArray->nextJob;
-
-                for (; jpbw; jpbw = jpbw->nextJob) {
-                    iterNum ++;
-                    if (!JOB_PEND(jpbw)) {
-                        continue;
-                    }
+        checkJobDep(jpbw);
+        ++num;
+    }
 
-                    jpbw->jFlags &= ~(JFLAG_READY1 | JFLAG_READY2);
-                    jpbw->jFlags |= JFLAG_READY1;
+    if (logclass & LC_SCHED)
+        ls_syslog(LOG_DEBUG1, "%s: evaluated %d jobs", __func__, num);
+}
 
+static void
+checkJobDep(struct jData *jpbw)
+{
+    int depCond;
 
-                    if (jpbw->jFlags & JFLAG_WAIT_SWITCH) {
-                        jpbw->newReason = PEND_JOB_SWITCH;
-                        continue;
-                    }
+    if (!JOB_PEND(jpbw))
+        return;
 
-                    if (!jpbw->shared->dptRoot) {
-                        jpbw->jFlags |= JFLAG_READY2;
-                    }
-                    else {
-                        int depCond;
-                        depCond=evalDepCond(jpbw->shared->dptRoot, jpbw);
-                        if (depCond == DP_FALSE) {
-                            jpbw->newReason = PEND_JOB_DEPEND;
-                        }
-                        else if (depCond == DP_INVALID) {
+    jpbw->jFlags &= ~(JFLAG_READY1 | JFLAG_READY2);
+    jpbw->jFlags |= JFLAG_READY1;
 
-                            jpbw->newReason = PEND_JOB_DEP_INVALID;
-                            jpbw->jFlags |= JFLAG_DEPCOND_INVALID;
-                        }
-                        else if (depCond == DP_REJECT) {
-                            jpbw->newReason = PEND_JOB_DEP_REJECT;
-                            jpbw->jFlags |= JFLAG_DEPCOND_REJECT;
-                        }
-                        if (depCond == DP_TRUE) {
-                            jpbw->jFlags |= JFLAG_READY2;
-                            continue;
-                        }
-                    }
-                }
-                nPtr = treeLexNext(nPtr);
-                break;
-            }
-            default:
-                nPtr = treeLexNext(nPtr);
-                break;
-        }
-        iterNum ++;
+    if (jpbw->jFlags & JFLAG_WAIT_SWITCH) {
+        jpbw->newReason = PEND_JOB_SWITCH;
+        return;
+    }
 
-        if (nPtr && (iterNum > 1000) && (time(0) - entryTime > 3))  {
-            if (logclass & LC_SCHED)
-                ls_syslog(LOG_DEBUG1, "%s: Stayed too long; leave at node <%s%s>;", fname, jgrpNodeParentPath(nPtr), nPtr->name);
-            goto Exit;
-        }
+    if (!jpbw->shared->dptRoot) {
+        jpbw->jFlags |= JFLAG_READY2;
+        return;
     }
-    if (!nPtr)
-        nPtr = groupRoot;
-    goto Entry;
 
-    if (logclass & LC_JGRP)
-        printTreeStruct(treeFile);
-Exit: if (nPtr)
-        treeObserverDep->entry = (void *)nPtr;
-    else
-        treeObserverDep->entry = (void *)groupRoot;
+    depCond = evalDepCond(jpbw->shared->dptRoot, jpbw);
+    if (depCond == DP_FALSE) {
+        jpbw->newReason = PEND_JOB_DEPEND;
+    } else if (depCond == DP_INVALID) {
+        jpbw->newReason = PEND_JOB_DEP_INVALID;
+        jpbw->jFlags |= JFLAG_DEPCOND_INVALID;
+    } else if (depCond == DP_REJECT) {
+        jpbw->newReason = PEND_JOB_DEP_REJECT;
+        jpbw->jFlags |= JFLAG_DEPCOND_REJECT;
+    } else if (depCond == DP_TRUE) {
+        jpbw->jFlags |= JFLAG_READY2;
+    }
 }
 
 void
@@ -917,6 +897,8 @@ updJgrpCountByJStatus(struct jData *job, int oldStatus, int newStatus)
 {
     struct jgTreeNode *gPtr = job->jgrpNode;
 
+    depJobChanged(job, newStatus);
+
     while (gPtr) {
         if (gPtr->nodeType == JGRP_NODE_GROUP) {
             if (oldStatus != JOB_STAT_NULL) {
@@ -17,6 +17,7 @@
  *
  */
 
+#include <limits.h>
 #include "mbd.h"
 
 #define UNREACHABLE(s) (((s) & HOST_STAT_UNREACH) || ((s) & HOST_STAT_UNAVAIL))
@@ -366,6 +367,298 @@ addJobIdHT(struct jData *job)
     ent->hData = (int *)job;
 }
 
+/* Secondary indexes of the jobs in the SJL, MJL,
+ * PJL and FJL lists by user, queue, execution host
+ * and job name. selectJobs() takes its candidates
+ * from the smallest one instead of walking all the
+ * lists. Every job also has a listSeq increasing in
+ * the order selectJobs() walks its list so that the
+ * candidates are returned in the same order as the
+ * walk would have.
+ */
+struct jobIndex {
+    int             num;
+    int             size;
+    struct jData    **jobs;
+};
+
+struct jobIndexRef {
+    struct jobIndex   *idx;
+    int             pos;
+};
+
+#define JOB_SEQ_GAP ((LS_LONG_INT)1 << 20)
+
+static hTab userIdxTab;
+static hTab queueIdxTab;
+static hTab hostIdxTab;
+static hTab nameIdxTab;
+
+static struct jobIndex *getJobIdx(hTab *, const char *, int);
+static void jobIdxAdd(struct jData *, struct jobIndex *);
+static void jobListSeq(struct jData *, int);
+static void relabelJobList(struct jData *, int);
+
+/* jobListIn()
+ *
+ * The job was just inserted in the list listno,
+ * give it its sequence and update its indexes.
+ */
+void
+jobListIn(struct jData *jp, int listno)
+{
+    jobListSeq(jp, listno);
+    jobIdxUpdate(jp);
+}
+
+/* jobIdxUpdate()
+ *
+ * Make the indexes of the job match its user,
+ * queue, job name and execution hosts.
+ */
+void
+jobIdxUpdate(struct jData *jp)
+{
+    static struct jobIndex **want;
+    static int wantSize;
+    struct jobIndex *idx;
+    int num;
+    int i;
+    int j;
+
+    if (wantSize < 3 + jp->numHostPtr) {
+        wantSize = 3 + jp->numHostPtr;
+        FREEUP(want);
+        want = my_calloc(wantSize, sizeof(struct jobIndex *), __func__);
+    }
+
+    num = 0;
+    if (jp->userName)
+        want[num++] = getJobIdx(&userIdxTab, jp->userName, TRUE);
+    if (jp->qPtr)
+        want[num++] = getJobIdx(&queueIdxTab, jp->qPtr->queue, TRUE);
+    if (jp->jgrpNode && jp->jgrpNode->name)
+        want[num++] = getJobIdx(&nameIdxTab, jp->jgrpNode->name, TRUE);
+
+    for (i = 0; jp->hPtr && i < jp->numHostPtr; i++) {
+
+        if (jp->hPtr[i] == NULL)
+            continue;
+
+        idx = getJobIdx(&hostIdxTab, jp->hPtr[i]->host, TRUE);
+        for (j = 0; j < num; j++) {
+            if (want[j] == idx)
+                break;
+        }
+        if (j == num)
+            want[num++] = idx;
+    }
+
+    if (num == jp->numIdxRef) {
+        for (i = 0; i < num; i++) {
+            if (jp->idxRef[i].idx != want[i])
+                break;
+        }
+        if (i == num)
+            return;
+    }
+
+    jobIdxRemove(jp);
+    for (i = 0; i < num; i++)
+        jobIdxAdd(jp, want[i]);
+}
+
+/* jobIdxRemove()
+ *
+ * Take the job out of all indexes, the last job
+ * of each index takes its slot.
+ */
+void
+jobIdxRemove(struct jData *jp)
+{
+    struct jobIndex *idx;
+    struct jData *last;
+    int i;
+    int k;
+
+    for (i = 0; i < jp->numIdxRef; i++) {
+
+        idx = jp->idxRef[i].idx;
+        idx->num--;
+        last = idx->jobs[idx->num];
+        idx->jobs[jp->idxRef[i].pos] = last;
+
+        if (last == jp)
+            continue;
+
+        for (k = 0; k < last->numIdxRef; k++) {
+            if (last->idxRef[k].idx == idx) {
+                last->idxRef[k].pos = jp->idxRef[i].pos;
+                break;
+            }
+        }
+    }
+
+    FREEUP(jp->idxRef);
+    jp->numIdxRef = 0;
+}
+
+static struct jobIndex *
+getJobIdx(hTab *tab, const char *key, int create)
+{
+    hEnt *ent;
+    int new;
+
+    if (tab->size == 0) {
+        if (!create)
+            return NULL;
+        h_initTab_(tab, 101);
+    }
+
+    if (!create) {
+        ent = h_getEnt_(tab, key);
+        if (ent == NULL)
+            return NULL;
+        return ent->hData;
+    }
+
+    ent = h_addEnt_(tab, key, &new);
+    if (new)
+        ent->hData = my_calloc(1, sizeof(struct jobIndex), __func__);
+
+    return ent->hData;
+}
+
+static void
+jobIdxAdd(struct jData *jp, struct jobIndex *idx)
+{
+    void *p;
+
+    if (idx->num == idx->size) {
+        idx->size = idx->size ? 2 * idx->size : 16;
+        p = realloc(idx->jobs, idx->size * sizeof(struct jData *));
+        if (p == NULL)
+            mbdDie(MASTER_MEM);
+        idx->jobs = p;
+    }
+
+    p = realloc(jp->idxRef, (jp->numIdxRef + 1) * sizeof(struct jobIndexRef));
+    if (p == NULL)
+        mbdDie(MASTER_MEM);
+    jp->idxRef = p;
+    jp->idxRef[jp->numIdxRef].idx = idx;
+    jp->idxRef[jp->numIdxRef].pos = idx->num;
+    jp->numIdxRef++;
+
+    idx->jobs[idx->num] = jp;
+    idx->num++;
+}
+
+/* jobListSeq()
+ *
+ * The lists are walked from the back so the job
+ * walked before jp is jp->forw and the one after
+ * is jp->back, put jp's sequence in between.
+ */
+static void
+jobListSeq(struct jData *jp, int listno)
+{
+    struct jData *head;
+    struct jData *lo;
+    struct jData *hi;
+
+    head = jDataList[listno];
+    jp->listNo = listno;
+    lo = jp->forw;
+    hi = jp->back;
+
+    if (lo == head && hi == head) {
+        jp->listSeq = 0;
+        return;
+    }
+
+    if (lo == head) {
+        if (hi->listSeq > LLONG_MIN + 2 * JOB_SEQ_GAP) {
+            jp->listSeq = hi->listSeq - JOB_SEQ_GAP;
+            return;
+        }
+    } else if (hi == head) {
+        if (lo->listSeq < LLONG_MAX - 2 * JOB_SEQ_GAP) {
+            jp->listSeq = lo->listSeq + JOB_SEQ_GAP;
+            return;
+        }
+    } else if (hi->listSeq - lo->listSeq >= 2) {
+        jp->listSeq = lo->listSeq + (hi->listSeq - lo->listSeq)/2;
+        return;
+    }
+
+    relabelJobList(jp, listno);
+}
+
+/* relabelJobList()
+ *
+ * No room left for jp, grow a window around it
+ * until its sequences can be spread evenly. The
+ * whole list is renumbered from 0 if need be.
+ */
+static void
+relabelJobList(struct jData *jp, int listno)
+{
+    struct jData *head;
+    struct jData *a;
+    struct jData *b;
+    struct jData *p;
+    LS_LONG_INT lo;
+    LS_LONG_INT gap;
+    int n;
+    int k;
+    int i;
+
+    head = jDataList[listno];
+    a = b = jp;
+    n = 1;
+    for (k = 1;; k *= 2) {
+
+        for (i = 0; i < k && a->forw != head; i++, n++)
+            a = a->forw;
+        for (i = 0; i < k && b->back != head; i++, n++)
+            b = b->back;
+
+        gap = JOB_SEQ_GAP;
+        if (a->forw == head && b->back == head) {
+            lo = -JOB_SEQ_GAP;
+            break;
+        }
+
+        if (a->forw == head) {
+            if (b->back->listSeq < LLONG_MIN/2)
+                continue;
+            lo = b->back->listSeq - (n + 1) * gap;
+            break;
+        }
+
+        if (b->back == head) {
+            if (a->forw->listSeq > LLONG_MAX/2)
+                continue;
+            lo = a->forw->listSeq;
+            break;
+        }
+
+        gap = (b->back->listSeq - a->forw->listSeq)/(n + 1);
+        if (gap >= 1024) {
+            lo = a->forw->listSeq;
+            break;
+        }
+    }
+
+    for (p = a;; p = p->back) {
+        lo += gap;
+        p->listSeq = lo;
+        if (p == b)
+            break;
+    }
+}
+
 void
 handleNewJob(struct jData *jpbw, int job, int eventTime)
 {
@@ -884,189 +1177,389 @@ freeNewJob (struct jData *newjob)
     FREEUP (newjob);
 }
 
+/* Selection criteria of a job info request
+ * shared by the list walk and the index lookup.
+ */
+struct jobSelect {
+    struct jobInfoReq   *req;
+    char                allqueues;
+    char                allusers;
+    char                allhosts;
+    char                searchJobName;
+    struct gData        *uGrp;
+    struct gData        *hGrp;
+    struct uData        *uPtr;
+    struct jData        *recentJob;
+    struct jData        **joblist;
+    int                 numJobs;
+    int                 arraysize;
+};
+
+static int matchJob(struct jobSelect *, struct jData *);
+static int jobSelCands(struct jobSelect *, struct jData ***);
+static int jobListCmp(const void *, const void *);
+
 int
 selectJobs (struct jobInfoReq *jobInfoReq, struct jData ***jobDataList,
             int *listSize)
 {
-    static char fname[] = "selectJobs()";
-    char allqueues = FALSE;
-    char allusers = FALSE;
-    char allhosts = FALSE;
-    char searchJobName = FALSE;
-    struct jData *jpbw, **joblist = NULL, *recentJob = NULL;
-    struct gData *uGrp = NULL;
+    struct jobSelect sel;
+    struct jData **cands;
     int  list = 0;
-    int numJobs = 0;
-    int arraysize = 0;
-    struct  uData *uPtr;
+    int numCands;
+    int needSJL;
+    int num;
+    int cc;
+    int i;
+
+    memset(&sel, 0, sizeof(struct jobSelect));
+    sel.req = jobInfoReq;
 
     if (jobInfoReq->queue[0] == '\0')
-        allqueues = TRUE;
+        sel.allqueues = TRUE;
     if (strcmp(jobInfoReq->userName, ALL_USERS) == 0)
-        allusers = TRUE;
+        sel.allusers = TRUE;
     else
-        uGrp = getUGrpData (jobInfoReq->userName);
+        sel.uGrp = getUGrpData (jobInfoReq->userName);
 
     if (jobInfoReq->host[0] == '\0')
-        allhosts = TRUE;
+        sel.allhosts = TRUE;
+    else
+        sel.hGrp = getHGrpData(jobInfoReq->host);
+
     if (jobInfoReq->jobName[0] != '\0' &&
         jobInfoReq->jobName[strlen(jobInfoReq->jobName) - 1] == '*') {
-        searchJobName = TRUE;
+        sel.searchJobName = TRUE;
         jobInfoReq->jobName[strlen(jobInfoReq->jobName) - 1] = '\0';
     }
 
 
-    uPtr = getUserData(jobInfoReq->userName);
+    sel.uPtr = getUserData(jobInfoReq->userName);
 
+    numCands = jobSelCands(&sel, &cands);
 
-    for (list = 0; list < NJLIST; list++) {
-        struct jData *jp;
-        if (skipJobListByReq (jobInfoReq->options, list)  == TRUE)
-            continue;
+    if (numCands < 0) {
+
+        for (list = 0; list < NJLIST; list++) {
+            struct jData *jp;
+            if (skipJobListByReq (jobInfoReq->options, list)  == TRUE)
+                continue;
 
-        if (list == SJL && jDataList[list]->back != jDataList[list])
-            reorderSJL ();
+            if (list == SJL && jDataList[list]->back != jDataList[list])
+                reorderSJL ();
 
-        for (jp = jDataList[list]->back;
-             (jp!= jDataList[list]); jp = jp->back) {
-            int i;
+            for (jp = jDataList[list]->back;
+                 (jp!= jDataList[list]); jp = jp->back) {
+                if ((cc = matchJob(&sel, jp)) != LSBE_NO_ERROR)
+                    return cc;
+            }
+        }
+    } else {
 
-            jpbw = jp;
+        /* The candidates come from an index, keep the
+         * ones in the lists the request wants and walk
+         * them in the order of the lists.
+         */
+        num = 0;
+        needSJL = FALSE;
+        for (i = 0; i < numCands; i++) {
+            struct jData *jp = cands[i];
 
-            if (jpbw->jobId < 0)
+            if (jp->listNo < 0 || jp->listNo >= NJLIST)
                 continue;
-
-            if (!allqueues
-                && strcmp(jpbw->qPtr->queue, jobInfoReq->queue) != 0)
+            if (skipJobListByReq(jobInfoReq->options, jp->listNo) == TRUE)
                 continue;
+            if (jp->listNo == SJL)
+                needSJL = TRUE;
+            cands[num++] = jp;
+        }
 
+        if (needSJL)
+            reorderSJL();
 
-            if (!allusers && (jpbw->uPtr != uPtr)) {
-                if (uGrp == NULL)
-                    continue;
-                else if (!gMember(jpbw->userName, uGrp))
-                    continue;
-            }
+        if (num > 1)
+            qsort(cands, num, sizeof(struct jData *), jobListCmp);
 
+        for (i = 0; i < num; i++) {
+            if ((cc = matchJob(&sel, cands[i])) != LSBE_NO_ERROR)
+                return cc;
+        }
+    }
+
+    *listSize = sel.numJobs;
 
-            if (jobInfoReq->jobName[0] != '\0') {
-                char  fullName[MAXPATHLEN];
-                fullJobName_r(jpbw, fullName);
-                if ((searchJobName == FALSE &&
-                     strcmp(jobInfoReq->jobName, fullName) != 0) ||
-                    (searchJobName == TRUE &&
-                     strncmp(fullName, jobInfoReq->jobName,
-                             strlen (jobInfoReq->jobName)) != 0))
+    if (sel.numJobs > 0) {
+        if(jobInfoReq->options & LAST_JOB) {
+            sel.numJobs = 1;
+            sel.joblist[0] = sel.recentJob;
+        }
+        *jobDataList = sel.joblist;
+        return LSBE_NO_ERROR;
+    } else if (!sel.allqueues && getQueueData (jobInfoReq->queue) == NULL) {
+        FREEUP(sel.joblist);
+        return LSBE_BAD_QUEUE;
+    }
+    FREEUP(sel.joblist);
+
+    return LSBE_NO_JOB;
+}
+
+/* matchJob()
+ *
+ * Add the job to the selection if it matches the
+ * request, return LSBE_NO_MEM if the selection
+ * cannot grow.
+ */
+static int
+matchJob(struct jobSelect *sel, struct jData *jpbw)
+{
+    struct jobInfoReq *jobInfoReq = sel->req;
+    int i;
+
+    if (jpbw->jobId < 0)
+        return LSBE_NO_ERROR;
+
+    if (!sel->allqueues
+        && strcmp(jpbw->qPtr->queue, jobInfoReq->queue) != 0)
+        return LSBE_NO_ERROR;
+
+
+    if (!sel->allusers && (jpbw->uPtr != sel->uPtr)) {
+        if (sel->uGrp == NULL)
+            return LSBE_NO_ERROR;
+        else if (!gMember(jpbw->userName, sel->uGrp))
+            return LSBE_NO_ERROR;
+    }
+
+
+    if (jobInfoReq->jobName[0] != '\0') {
+        char  fullName[MAXPATHLEN];
+        fullJobName_r(jpbw, fullName);
+        if ((sel->searchJobName == FALSE &&
+             strcmp(jobInfoReq->jobName, fullName) != 0) ||
+            (sel->searchJobName == TRUE &&
+             strncmp(fullName, jobInfoReq->jobName,
+                     strlen (jobInfoReq->jobName)) != 0))
+            return LSBE_NO_ERROR;
+    }
+
+
+
+    if (jobInfoReq->jobId != 0
+        && ((LSB_ARRAY_IDX(jobInfoReq->jobId) != 0
+             && LSB_ARRAY_IDX(jobInfoReq->jobId) != LSB_ARRAY_IDX(jpbw->jobId))
+            ||
+            LSB_ARRAY_JOBID(jobInfoReq->jobId) != LSB_ARRAY_JOBID(jpbw->jobId))) {
+
+        return LSBE_NO_ERROR;
+    }
+
+    {
+        if (jpbw->jStatus & JOB_STAT_PEND) {
+            if (!(jpbw->qPtr->qStatus & QUEUE_STAT_RUN))
+                jpbw->newReason = PEND_QUE_WINDOW;
+            if (!(jpbw->qPtr->qStatus & QUEUE_STAT_ACTIVE))
+                jpbw->newReason = PEND_QUE_INACT;
+        }
+        else if (jpbw->jStatus & JOB_STAT_ZOMBIE)
+            jpbw->newReason |= EXIT_ZOMBIE;
+    }
+
+    if (! matchJobStatus(jobInfoReq->options, jpbw)) {
+        return LSBE_NO_ERROR;
+    }
+
+
+    if (!sel->allhosts) {
+
+        if (IS_PEND (jpbw->jStatus))
+            return LSBE_NO_ERROR;
+
+        if (jpbw->hPtr == NULL) {
+            if (!(jpbw->jStatus & JOB_STAT_EXIT))
+                ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 6510,
+                                                 "%s: Execution host for job <%s> is null"), /* catgets 6510 */
+                          "selectJobs()", lsb_jobid2str(jpbw->jobId));
+            return LSBE_NO_ERROR;
+        }
+
+        if (sel->hGrp != NULL) {
+            for (i = 0; i < jpbw->numHostPtr; i++) {
+                if (jpbw->hPtr[i] == NULL)
                     continue;
+                if (gMember(jpbw->hPtr[i]->host, sel->hGrp))
+                    break;
+            }
+            if (i >= jpbw->numHostPtr)
+                return LSBE_NO_ERROR;
+        } else {
+            for (i = 0; i < jpbw->numHostPtr; i++) {
+                if (jpbw->hPtr[i] == NULL)
+                    continue;
+                if (equalHost_(jobInfoReq->host, jpbw->hPtr[i]->host))
+                    break;
             }
+            if (i >= jpbw->numHostPtr)
+                return LSBE_NO_ERROR;
+        }
+    }
 
 
+    if (findLastJob(jobInfoReq->options, jpbw, &sel->recentJob) == FALSE)
+        return LSBE_NO_ERROR;
 
-            if (jobInfoReq->jobId != 0
-                && ((LSB_ARRAY_IDX(jobInfoReq->jobId) != 0
-                     && LSB_ARRAY_IDX(jobInfoReq->jobId) != LSB_ARRAY_IDX(jpbw->jobId))
-                    ||
-                    LSB_ARRAY_JOBID(jobInfoReq->jobId) != LSB_ARRAY_JOBID(jpbw->jobId))) {
+    if (sel->arraysize == 0) {
+        sel->arraysize = DEFAULT_LISTSIZE;
+        sel->joblist = (struct jData **) calloc (sel->arraysize,
+                                                 sizeof (struct jData *));
+        if (sel->joblist == NULL)
+            return LSBE_NO_MEM;
+    }
+    if (sel->numJobs >= sel->arraysize) {
 
-                continue;
-            }
+        struct jData **biglist;
+        sel->arraysize *= 2;
+        biglist = (struct jData **) realloc((char *)sel->joblist,
+                                            sel->arraysize * sizeof (struct jData *));
+        if (biglist == NULL) {
+            FREEUP(sel->joblist);
+            return LSBE_NO_MEM;
+        }
+        sel->joblist = biglist;
+    }
+    sel->joblist[sel->numJobs] = jpbw;
+    sel->numJobs++;
 
-            {
-                if (jpbw->jStatus & JOB_STAT_PEND) {
-                    if (!(jpbw->qPtr->qStatus & QUEUE_STAT_RUN))
-                        jpbw->newReason = PEND_QUE_WINDOW;
-                    if (!(jpbw->qPtr->qStatus & QUEUE_STAT_ACTIVE))
-                        jpbw->newReason = PEND_QUE_INACT;
-                }
-                else if (jpbw->jStatus & JOB_STAT_ZOMBIE)
-                    jpbw->newReason |= EXIT_ZOMBIE;
-            }
+    return LSBE_NO_ERROR;
+}
 
-            if (! matchJobStatus(jobInfoReq->options, jpbw)) {
-                continue;
-            }
+/* jobSelCands()
+ *
+ * Find the smallest set of jobs that holds all the
+ * jobs the request can match: the job or the array
+ * it names, or the index of its user, queue, job
+ * name or execution host. Return -1 if the request
+ * does not narrow the jobs so the lists are walked.
+ */
+static int
+jobSelCands(struct jobSelect *sel, struct jData ***cands)
+{
+    static struct jData **buf;
+    static int bufSize;
+    struct jobInfoReq *req = sel->req;
+    struct jData **jobs;
+    struct jobIndex *idx;
+    struct hData *hPtr;
+    struct jData *jp;
+    struct jData *p;
+    int num;
+    int n;
 
+    jobs = NULL;
+    num = -1;
 
-            if (!allhosts) {
-                struct gData *gp;
+    if (req->jobId != 0) {
 
-                if (IS_PEND (jpbw->jStatus))
-                    continue;
+        jp = getJobData(req->jobId);
+        n = 0;
+        if (jp && jp->nodeType == JGRP_NODE_ARRAY) {
+            for (p = jp->nextJob; p; p = p->nextJob)
+                ++n;
+        } else if (jp) {
+            n = 1;
+        }
 
-                if (jpbw->hPtr == NULL) {
-                    if (!(jpbw->jStatus & JOB_STAT_EXIT))
-                        ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 6510,
-                                                         "%s: Execution host for job <%s> is null"), /* catgets 6510 */
-                                  fname, lsb_jobid2str(jpbw->jobId));
-                    continue;
-                }
+        if (bufSize < n) {
+            bufSize = n;
+            FREEUP(buf);
+            buf = my_calloc(bufSize, sizeof(struct jData *), __func__);
+        }
 
-                gp = getHGrpData (jobInfoReq->host);
-                if (gp != NULL) {
-                    for (i = 0; i < jpbw->numHostPtr; i++) {
-                        if (jpbw->hPtr[i] == NULL)
-                            continue;
-                        if (gMember(jpbw->hPtr[i]->host, gp))
-                            break;
-                    }
-                    if (i >= jpbw->numHostPtr)
-                        continue;
-                } else {
-                    for (i = 0; i < jpbw->numHostPtr; i++) {
-                        if (jpbw->hPtr[i] == NULL)
-                            continue;
-                        if (equalHost_(jobInfoReq->host, jpbw->hPtr[i]->host))
-                            break;
-                    }
-                    if (i >= jpbw->numHostPtr)
-                        continue;
-                }
-            }
+        if (jp && jp->nodeType == JGRP_NODE_ARRAY) {
+            n = 0;
+            for (p = jp->nextJob; p; p = p->nextJob)
+                buf[n++] = p;
+        } else if (jp) {
+            buf[0] = jp;
+        }
 
+        *cands = buf;
+        return n;
+    }
 
-            if (findLastJob(jobInfoReq->options, jpbw, &recentJob) == FALSE)
-                continue;
+    if (!sel->allusers && sel->uGrp == NULL) {
+        idx = getJobIdx(&userIdxTab, req->userName, FALSE);
+        n = idx ? idx->num : 0;
+        if (num < 0 || n < num) {
+            num = n;
+            jobs = idx ? idx->jobs : NULL;
+        }
+    }
 
-            if (arraysize == 0) {
-                arraysize = DEFAULT_LISTSIZE;
-                joblist = (struct jData **) calloc (arraysize,
-                                                    sizeof (struct jData *));
-                if (joblist == NULL)
-                    return LSBE_NO_MEM;
-            }
-            if (numJobs >= arraysize) {
-
-                struct jData **biglist;
-                arraysize *= 2;
-                biglist = (struct jData **) realloc((char *)joblist,
-                                                    arraysize * sizeof (struct jData *));
-                if (biglist == NULL) {
-                    FREEUP(joblist);
-                    return LSBE_NO_MEM;
-                }
-                joblist = biglist;
-            }
-            joblist[numJobs] = jpbw;
-            numJobs++;
+    if (!sel->allqueues) {
+        idx = getJobIdx(&queueIdxTab, req->queue, FALSE);
+        n = idx ? idx->num : 0;
+        if (num < 0 || n < num) {
+            num = n;
+            jobs = idx ? idx->jobs : NULL;
         }
     }
 
-    *listSize = numJobs;
+    if (req->jobName[0] != '\0' && !sel->searchJobName) {
+        idx = getJobIdx(&nameIdxTab, req->jobName, FALSE);
+        n = idx ? idx->num : 0;
+        if (num < 0 || n < num) {
+            num = n;
+            jobs = idx ? idx->jobs : NULL;
+        }
+    }
 
-    if (numJobs > 0) {
-        if(jobInfoReq->options & LAST_JOB) {
-            numJobs = 1;
-            joblist[0] = recentJob;
+    if (!sel->allhosts
+        && sel->hGrp == NULL
+        && (hPtr = getHostData(req->host)) != NULL) {
+        idx = getJobIdx(&hostIdxTab, hPtr->host, FALSE);
+        n = idx ? idx->num : 0;
+        if (num < 0 || n < num) {
+            num = n;
+            jobs = idx ? idx->jobs : NULL;
         }
-        *jobDataList = joblist;
-        return LSBE_NO_ERROR;
-    } else if (!allqueues && getQueueData (jobInfoReq->queue) == NULL) {
-        FREEUP(joblist);
-        return LSBE_BAD_QUEUE;
     }
-    FREEUP(joblist);
 
-    return LSBE_NO_JOB;
+    if (num < 0)
+        return -1;
+
+    /* The caller filters and sorts the candidates
+     * in place so copy them out of the index.
+     */
+    if (bufSize < num) {
+        bufSize = num;
+        FREEUP(buf);
+        buf = my_calloc(bufSize, sizeof(struct jData *), __func__);
+    }
+    if (num > 0)
+        memcpy(buf, jobs, num * sizeof(struct jData *));
+
+    *cands = buf;
+    return num;
+}
+
+/* jobListCmp()
+ *
+ * Order the candidates as the lists are walked.
+ */
+static int
+jobListCmp(const void *x, const void *y)
+{
+    const struct jData *j1 = *(struct jData * const *)x;
+    const struct jData *j2 = *(struct jData * const *)y;
+
+    if (j1->listNo != j2->listNo)
+        return j1->listNo - j2->listNo;
+    if (j1->listSeq < j2->listSeq)
+        return -1;
+    if (j1->listSeq > j2->listSeq)
+        return 1;
+    return 0;
 }
 
 static int
@@ -1141,6 +1634,7 @@ reorderSJL1 (struct jData *job)
         inList ((struct listEntry *)jDataList[SJL]->forw,
                 (struct listEntry *)job);
     }
+    jobListSeq(job, SJL);
 
 }
 
@@ -2026,6 +2520,8 @@ sbatchdJobs (struct sbdPackage *sbdPackage, struct hData *hData)
                 + strlen (jobSpecs->loginShell)
                 + strlen (jobSpecs->schedHostType)
                 + strlen (jobSpecs->execHosts)
+                + getXdrStrlen(jobSpecs->affinity)
+                + getXdrStrlen(jobSpecs->cpuBind)
                 + 10;
 
             for (i = 0; i < jobSpecs->numToHosts; i++) {
@@ -2422,6 +2918,8 @@ packJobSpecs (struct jData *jDataPtr, struct jobSpecs *jobSpecs)
                   hp->cpuFactor);
 
     jobSpecs->execHosts = safeSave(jDataPtr->execHosts);
+    jobSpecs->affinity = safeSave(qp->affinity);
+    jobSpecs->cpuBind = safeSave(jDataPtr->cpuBind);
 
     if (jDataPtr->jobSpoolDir != NULL ) {
 
@@ -2464,6 +2962,8 @@ freeJobSpecs (struct jobSpecs *jobSpecs)
         free(jobSpecs->eexec.data);
 
     FREEUP(jobSpecs->execHosts);
+    FREEUP(jobSpecs->affinity);
+    FREEUP(jobSpecs->cpuBind);
 
     if (jobSpecs->nxf) {
         FREEUP(jobSpecs->xf);
@@ -2511,6 +3011,7 @@ statusJob(struct statusReq *statusReq, struct hostent *hp, int *schedule)
         if (IS_FINISH(statusReq->newStatus)) {
 
             jpbw->jFlags &= ~JFLAG_WAIT_SWITCH;
+            depMarkDirty(jpbw);
         }
         return (LSBE_NO_ERROR);
     }
@@ -2664,6 +3165,9 @@ statusJob(struct statusReq *statusReq, struct hostent *hp, int *schedule)
             jpbw->execUid = statusReq->execUid;
             jpbw->jobPid = statusReq->jobPid;
             jpbw->jobPGid = statusReq->jobPGid;
+            FREEUP(jpbw->cpuBind);
+            if (statusReq->cpuBind && statusReq->cpuBind[0] != '\0')
+                jpbw->cpuBind = safeSave(statusReq->cpuBind);
             log_executejob (jpbw);
             if (oldStatus == statusReq->newStatus)
                 return (LSBE_NO_ERROR);
@@ -3427,6 +3931,7 @@ handleFinishJob(struct jData *jData, int oldStatus, int eventTime)
     offJobList(jData, listno);
     inList ((struct listEntry *)jDataList[FJL]->forw,
             (struct  listEntry *)jData);
+    jobListIn(jData, FJL);
 
     if( (jData->shared->jobBill.options & SUB_MODIFY_ONCE) &&
         (jData->newSub) ) {
@@ -3638,6 +4143,7 @@ freeExecParams(struct jData *jData)
     jData->numHostPtr = 0;
     jData->nextSeq = 1;
     FREEUP(jData->execHome);
+    FREEUP(jData->cpuBind);
     FREEUP(jData->queuePreCmd);
     FREEUP(jData->queuePostCmd);
 
@@ -3730,6 +4236,8 @@ clean(time_t curTime)
         if (curTime - jPtr->endTime > clean_period)
             removeJob(jPtr->jobId);
     }
+
+    compactJobInfo();
 }
 
 void
@@ -4379,12 +4887,14 @@ insertAndShift (struct jData *froJob, struct jData *toJob,
             listInsertEntryAfter((LIST_T *)jDataList[listno],
                                  (LIST_ENTRY_T *)jobP,
                                  (LIST_ENTRY_T *)tmpJobP);
+            jobListSeq(tmpJobP, listno);
             tmpJobP = jobP;
         }
         offJobList(froJob, listno);
         listInsertEntryBefore((LIST_T *)jDataList[listno],
                               (LIST_ENTRY_T *)oldJobP,
                               (LIST_ENTRY_T *)froJob);
+        jobListSeq(froJob, listno);
     }
     else {
         oldJobP = toJob->back;
@@ -4399,12 +4909,14 @@ insertAndShift (struct jData *froJob, struct jData *toJob,
             listInsertEntryBefore((LIST_T *)jDataList[listno],
                                   (LIST_ENTRY_T *)jobP,
                                   (LIST_ENTRY_T *)tmpJobP);
+            jobListSeq(tmpJobP, listno);
             tmpJobP = jobP;
         }
         offJobList(froJob, listno);
         listInsertEntryAfter((LIST_T *)jDataList[listno],
                              (LIST_ENTRY_T *)oldJobP,
                              (LIST_ENTRY_T *)froJob);
+        jobListSeq(froJob, listno);
     }
     return;
 
@@ -4549,6 +5061,7 @@ inPendJobList2(struct jData *job,
    listInsertEntryBefore((LIST_T *)jDataList[listno],
 			 (LIST_ENTRY_T *)jp,
                          (LIST_ENTRY_T *)job);
+   jobListIn(job, listno);
 }
 
 
@@ -4556,6 +5069,7 @@ void
 offJobList(struct jData *jp, int listno)
 {
     listRemoveEntry((LIST_T *)jDataList[listno], (LIST_ENTRY_T *)jp);
+    jp->listNo = -1;
 
     /* If leaving PJL adjust the queue's last job
      * We have to check for the job status as well
@@ -4593,7 +5107,7 @@ inStartJobList(struct jData *job)
     listInsertEntryBefore((LIST_T *)jDataList[SJL],
                           (LIST_ENTRY_T *)jp,
                           (LIST_ENTRY_T *)job);
-
+    jobListIn(job, SJL);
 }
 void
 jobInQueueEnd(struct jData *job, struct qData *qp)
@@ -4731,6 +5245,7 @@ initJData(struct jShared  *shared)
     job->resumeTime = -1;
     job->exitStatus = 0;
     job->execHome = NULL;
+    job->cpuBind = NULL;
     job->execCwd = NULL;
     job->execUsername = NULL;
     job->queuePreCmd = NULL;
@@ -4766,6 +5281,9 @@ initJData(struct jShared  *shared)
     job->reservedGrp = -1;
     job->groupCands = NULL;
     job->inEligibleGroups = NULL;
+    job->listNo = -1;
+    job->numIdxRef = 0;
+    job->idxRef = NULL;
 
     return (job);
 }
@@ -5137,7 +5655,7 @@ int
 modifyJob (struct modifyReq *req, struct submitMbdReply *reply,
            struct lsfAuth *auth)
 {
-    struct jData *jpbw, *jArray;
+    struct jData *jpbw, *jArray, *jPtr;
     int    numJobIds = 0;
     LS_LONG_INT *jobIdList = NULL;
     int    returnErr, successfulOnce = FALSE;
@@ -5220,6 +5738,8 @@ modifyJob (struct modifyReq *req, struct submitMbdReply *reply,
                             req->submitReq.jobName);
                     FREEUP(jArray->jgrpNode->name);
                     jArray->jgrpNode->name = jobName;
+                    for (jPtr = jArray->nextJob; jPtr; jPtr = jPtr->nextJob)
+                        jobIdxUpdate(jPtr);
                 }
             } else {
                 returnErr = LSBE_MOD_JOB_NAME;
@@ -5717,6 +6237,7 @@ handleJParameters (struct jData *jpbw, struct jData *job, struct submitReq *modR
             jpbw->shared->dptRoot = job->shared->dptRoot;
             job->shared->dptRoot = NULL;
         }
+        depIndexAdd(jpbw);
 
         lsbFreeResVal(&jpbw->shared->resValPtr);
         jpbw->shared->resValPtr = job->shared->resValPtr;
@@ -6386,6 +6907,7 @@ freeJData(struct jData *jPtr)
      * messages to single array elements as well.
      */
     rmMessageFile(jPtr);
+    jobIdxRemove(jPtr);
 
     if (IS_PEND(jPtr->jStatus) && jPtr->candPtr) {
         FREEUP (jPtr->candPtr);
@@ -6411,6 +6933,7 @@ freeJData(struct jData *jPtr)
     FREEUP(jPtr->hPtr);
 
     FREEUP(jPtr->execHome);
+    FREEUP(jPtr->cpuBind);
     FREEUP(jPtr->execCwd);
     FREEUP(jPtr->execUsername);
     FREEUP(jPtr->queuePreCmd);
@@ -6915,6 +7438,7 @@ inZomJobList (struct jData *oldjob, int mail)
     newjob->actPid = oldjob->actPid;
     newjob->execCwd = safeSave (oldjob->execCwd);
     newjob->execHome = safeSave (oldjob->execHome);
+    newjob->cpuBind = safeSave (oldjob->cpuBind);
     newjob->execUsername = safeSave (oldjob->execUsername);
     newjob->queuePreCmd = safeSave (oldjob->queuePreCmd);
     newjob->queuePostCmd = safeSave (oldjob->queuePostCmd);
@@ -7698,6 +8222,7 @@ shouldResumeByRes (struct jData *jp)
         char loadString[MAXLSFNAMELEN];
         for (j = 0; j < allLsInfo->numIndx; j++)
             jp->hPtr[i]->lsbLoad[j] = loads[i][j];
+        invalidateHostSelectCache(jp->hPtr[i]);
         for (j = 0; j < jp->hPtr[i]->numInstances; j++) {
             FREEUP (jp->hPtr[i]->instances[j]->value);
             sprintf (loadString, "%-10.1f", loads[i][allLsInfo->numIndx+j]);
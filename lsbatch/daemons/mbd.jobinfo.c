@@ -0,0 +1,764 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include <dirent.h>
+#include <sys/uio.h>
+#include "mbd.h"
+
+/* The job info store. The job files are appended to
+ * segment files under logdir/jobinfo and addressed by
+ * the hash of their content, so identical scripts are
+ * stored once. The index file is a journal of the job
+ * file names referring to each hash:
+ *
+ *   + <jobFile> <hash>
+ *   - <jobFile>
+ *
+ * At startup the segments are scanned to locate the
+ * contents and the journal is replayed to count their
+ * references. Contents nobody refers to are dead,
+ * a segment mostly dead is compacted by copying its
+ * live contents to the active segment and removing it.
+ */
+#define JINFO_MAGIC    0x4a494e46
+#define JINFO_SEG_MAX  (64 * 1024 * 1024)
+
+struct jinfoHdr {
+    unsigned int magic;
+    unsigned int len;
+    unsigned long long hash;
+};
+
+struct jinfoSeg {
+    int id;
+    int fd;
+    off_t size;
+    off_t dead;
+};
+
+struct jinfoBlob {
+    unsigned long long hash;
+    struct jinfoSeg *seg;
+    off_t off;
+    int len;
+    int refs;
+};
+
+#define BLOB_SIZE(b) ((off_t)sizeof(struct jinfoHdr) + (b)->len)
+
+/* The names made in storeDir, the longest is
+ * a segment.
+ */
+#define JINFO_PATHLEN  (MAXFILENAMELEN + sizeof("/seg.-2147483648"))
+
+static char storeDir[MAXFILENAMELEN];
+static struct jinfoSeg **segs;
+static int numSegs;
+static hTab blobTab;
+static hTab refTab;
+static int idxFd = -1;
+static int idxLines;
+
+static int scanSegment(struct jinfoSeg *);
+static int replayIndex(void);
+static struct jinfoSeg *newSegment(int);
+static int addSegment(struct jinfoSeg *);
+static struct jinfoBlob *getBlob(unsigned long long);
+static struct jinfoBlob *appendBlob(unsigned long long, const char *, int);
+static int sameBlob(struct jinfoBlob *, const char *, int);
+static void addRef(const char *, struct jinfoBlob *);
+static int dropRef(const char *);
+static int journal(const char *, const char *, unsigned long long);
+static int compactSegment(int);
+static int compactIndex(void);
+static unsigned long long jinfoHash(const char *, int);
+static int segCmp(const void *, const void *);
+
+/* initJobInfoStore()
+ *
+ * Open the segments and rebuild the tables.
+ */
+int
+initJobInfoStore(const char *dir)
+{
+    struct jinfoBlob *b;
+    struct dirent *de;
+    DIR *dp;
+    hEnt *e;
+    sTab s;
+    char fn[JINFO_PATHLEN];
+    int id;
+
+    if (strlen(dir) >= sizeof(storeDir)) {
+        ls_syslog(LOG_ERR, "\
+%s: job info directory %s is too long", __func__, dir);
+        return -1;
+    }
+    strcpy(storeDir, dir);
+    if (mkdir(storeDir, 0700) < 0 && errno != EEXIST) {
+        ls_syslog(LOG_ERR, "%s: mkdir() %s failed: %m", __func__, storeDir);
+        return -1;
+    }
+
+    h_initTab_(&blobTab, 1024);
+    h_initTab_(&refTab, 1024);
+
+    if ((dp = opendir(storeDir)) == NULL) {
+        ls_syslog(LOG_ERR, "%s: opendir() %s failed: %m", __func__, storeDir);
+        return -1;
+    }
+
+    while ((de = readdir(dp))) {
+        struct jinfoSeg *seg;
+
+        if (sscanf(de->d_name, "seg.%d", &id) != 1)
+            continue;
+
+        if (snprintf(fn, sizeof(fn), "%s/%s", storeDir, de->d_name)
+            >= (int)sizeof(fn)) {
+            ls_syslog(LOG_ERR, "%s: %s/%s is too long, ignored",
+                      __func__, storeDir, de->d_name);
+            continue;
+        }
+
+        seg = my_calloc(1, sizeof(struct jinfoSeg), __func__);
+        if (seg == NULL) {
+            closedir(dp);
+            return -1;
+        }
+        seg->id = id;
+        if ((seg->fd = open(fn, O_RDWR)) < 0) {
+            ls_syslog(LOG_ERR, "%s: open() %s failed: %m", __func__, fn);
+            free(seg);
+            closedir(dp);
+            return -1;
+        }
+        fcntl(seg->fd, F_SETFD, FD_CLOEXEC);
+
+        if (addSegment(seg) < 0) {
+            close(seg->fd);
+            free(seg);
+            closedir(dp);
+            return -1;
+        }
+    }
+    closedir(dp);
+
+    /* Scan oldest first so the last copy of a
+     * content wins, the others are dead.
+     */
+    qsort(segs, numSegs, sizeof(struct jinfoSeg *), segCmp);
+    for (id = 0; id < numSegs; id++) {
+        if (scanSegment(segs[id]) < 0)
+            return -1;
+    }
+
+    if (numSegs == 0
+        && newSegment(1) == NULL)
+        return -1;
+
+    if (replayIndex() < 0)
+        return -1;
+
+    for (e = h_firstEnt_(&blobTab, &s); e; e = h_nextEnt_(&s)) {
+        b = e->hData;
+        if (b->refs == 0)
+            b->seg->dead += BLOB_SIZE(b);
+    }
+
+    ls_syslog(LOG_INFO, "\
+%s: %d job files in %d contents, %d segments", __func__,
+              refTab.numEnts, blobTab.numEnts, numSegs);
+
+    return 0;
+}
+
+/* putJobInfo()
+ *
+ * Store the job file of jobFile, a job file stored
+ * before under the same name is replaced.
+ */
+int
+putJobInfo(const char *jobFile, const char *data, int len)
+{
+    struct jinfoBlob *b;
+    unsigned long long h;
+
+    h = jinfoHash(data, len);
+
+    /* Different contents on the same hash
+     * take the next free one.
+     */
+    while ((b = getBlob(h))) {
+        if (sameBlob(b, data, len))
+            break;
+        ++h;
+    }
+
+    if (b == NULL) {
+        if ((b = appendBlob(h, data, len)) == NULL)
+            return -1;
+    }
+
+    if (journal("+", jobFile, b->hash) < 0)
+        return -1;
+
+    dropRef(jobFile);
+    addRef(jobFile, b);
+
+    return 0;
+}
+
+/* getJobInfo()
+ *
+ * Read the job file of jobFile in a new buffer, which
+ * is terminated for the string functions.
+ */
+char *
+getJobInfo(const char *jobFile, int *len)
+{
+    struct jinfoBlob *b;
+    hEnt *e;
+    char *buf;
+    int cc;
+
+    if ((e = h_getEnt_(&refTab, jobFile)) == NULL) {
+        errno = ENOENT;
+        return NULL;
+    }
+    b = e->hData;
+
+    buf = malloc(b->len + 1);
+    if (buf == NULL)
+        return NULL;
+
+    cc = pread(b->seg->fd, buf, b->len, b->off + sizeof(struct jinfoHdr));
+    if (cc != b->len) {
+        ls_syslog(LOG_ERR, "\
+%s: pread() segment %d offset %ld for %s failed: %m", __func__,
+                  b->seg->id, (long)b->off, jobFile);
+        free(buf);
+        errno = EIO;
+        return NULL;
+    }
+    buf[b->len] = 0;
+    *len = b->len;
+
+    return buf;
+}
+
+/* rmJobInfo()
+ *
+ * Drop the job file of jobFile, -1 if there is none.
+ */
+int
+rmJobInfo(const char *jobFile)
+{
+    if (h_getEnt_(&refTab, jobFile) == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    journal("-", jobFile, 0);
+    dropRef(jobFile);
+
+    return 0;
+}
+
+/* compactJobInfo()
+ *
+ * Called after the finished jobs are cleaned, get rid
+ * of the segments more than half dead and of the
+ * journal lines of the removed job files.
+ */
+void
+compactJobInfo(void)
+{
+    int i;
+
+    for (i = 0; i < numSegs - 1;) {
+        if (segs[i]->dead * 2 > segs[i]->size
+            && compactSegment(i) == 0)
+            continue;
+        i++;
+    }
+
+    if (idxLines > 2 * refTab.numEnts + 1024)
+        compactIndex();
+}
+
+static int
+scanSegment(struct jinfoSeg *seg)
+{
+    struct jinfoHdr hdr;
+    struct jinfoBlob *b;
+    struct stat st;
+    char key[32];
+    off_t off;
+    hEnt *e;
+    int new;
+
+    fstat(seg->fd, &st);
+
+    off = 0;
+    while (off + (off_t)sizeof(hdr) <= st.st_size) {
+
+        if (pread(seg->fd, &hdr, sizeof(hdr), off) != sizeof(hdr)
+            || hdr.magic != JINFO_MAGIC
+            || off + (off_t)sizeof(hdr) + hdr.len > st.st_size)
+            break;
+
+        sprintf(key, "%016llx", hdr.hash);
+        e = h_addEnt_(&blobTab, key, &new);
+        if (new) {
+            b = my_calloc(1, sizeof(struct jinfoBlob), __func__);
+            if (b == NULL) {
+                h_rmEnt_(&blobTab, e);
+                return -1;
+            }
+            b->hash = hdr.hash;
+            e->hData = b;
+        } else {
+            b = e->hData;
+            b->seg->dead += BLOB_SIZE(b);
+        }
+        b->seg = seg;
+        b->off = off;
+        b->len = hdr.len;
+
+        off += sizeof(hdr) + hdr.len;
+    }
+
+    /* A partial record from a crash.
+     */
+    if (off < st.st_size) {
+        ls_syslog(LOG_WARNING, "\
+%s: segment %d truncated at %ld, size %ld", __func__, seg->id,
+                  (long)off, (long)st.st_size);
+        if (ftruncate(seg->fd, off) < 0) {
+            ls_syslog(LOG_ERR, "%s: ftruncate() segment %d failed: %m",
+                      __func__, seg->id);
+            return -1;
+        }
+    }
+    seg->size = off;
+
+    return 0;
+}
+
+static int
+replayIndex(void)
+{
+    struct jinfoBlob *b;
+    unsigned long long h;
+    char fn[JINFO_PATHLEN];
+    char line[MAXLINELEN];
+    char jobFile[MAXLINELEN];
+    char op;
+    FILE *fp;
+
+    snprintf(fn, sizeof(fn), "%s/index", storeDir);
+
+    if ((fp = fopen(fn, "r"))) {
+        while (fgets(line, sizeof(line), fp)) {
+
+            ++idxLines;
+            if (sscanf(line, "%c %s %llx", &op, jobFile, &h) < 2)
+                continue;
+
+            if (op == '-') {
+                dropRef(jobFile);
+                continue;
+            }
+
+            if ((b = getBlob(h)) == NULL) {
+                ls_syslog(LOG_ERR, "\
+%s: job file %s refers to missing content %016llx", __func__, jobFile, h);
+                continue;
+            }
+            dropRef(jobFile);
+            addRef(jobFile, b);
+        }
+        fclose(fp);
+    }
+
+    if ((idxFd = open(fn, O_WRONLY | O_APPEND | O_CREAT, 0600)) < 0) {
+        ls_syslog(LOG_ERR, "%s: open() %s failed: %m", __func__, fn);
+        return -1;
+    }
+    fcntl(idxFd, F_SETFD, FD_CLOEXEC);
+
+    return 0;
+}
+
+static struct jinfoSeg *
+newSegment(int id)
+{
+    struct jinfoSeg *seg;
+    char fn[JINFO_PATHLEN];
+
+    snprintf(fn, sizeof(fn), "%s/seg.%d", storeDir, id);
+
+    seg = my_calloc(1, sizeof(struct jinfoSeg), __func__);
+    if (seg == NULL)
+        return NULL;
+    seg->id = id;
+    if ((seg->fd = open(fn, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+        ls_syslog(LOG_ERR, "%s: open() %s failed: %m", __func__, fn);
+        free(seg);
+        return NULL;
+    }
+    fcntl(seg->fd, F_SETFD, FD_CLOEXEC);
+
+    if (addSegment(seg) < 0) {
+        close(seg->fd);
+        unlink(fn);
+        free(seg);
+        return NULL;
+    }
+
+    return seg;
+}
+
+/* addSegment()
+ *
+ * Append the segment to segs, which is left as
+ * it was if it cannot grow.
+ */
+static int
+addSegment(struct jinfoSeg *seg)
+{
+    struct jinfoSeg **p;
+
+    p = realloc(segs, (numSegs + 1) * sizeof(struct jinfoSeg *));
+    if (p == NULL) {
+        ls_syslog(LOG_ERR, "%s: realloc() %d segments failed: %m",
+                  __func__, numSegs + 1);
+        return -1;
+    }
+    segs = p;
+    segs[numSegs++] = seg;
+
+    return 0;
+}
+
+static struct jinfoBlob *
+getBlob(unsigned long long h)
+{
+    char key[32];
+    hEnt *e;
+
+    sprintf(key, "%016llx", h);
+    if ((e = h_getEnt_(&blobTab, key)) == NULL)
+        return NULL;
+
+    return e->hData;
+}
+
+/* appendBlob()
+ *
+ * Write the content at the end of the active segment,
+ * start a new one when it is full.
+ */
+static struct jinfoBlob *
+appendBlob(unsigned long long h, const char *data, int len)
+{
+    struct jinfoSeg *seg;
+    struct jinfoBlob *b;
+    struct jinfoHdr hdr;
+    struct iovec iov[2];
+    char key[32];
+    hEnt *e;
+    int new;
+    int cc;
+
+    seg = segs[numSegs - 1];
+    if (seg->size > 0
+        && seg->size + (off_t)sizeof(hdr) + len > JINFO_SEG_MAX) {
+        if ((seg = newSegment(seg->id + 1)) == NULL)
+            return NULL;
+    }
+
+    hdr.magic = JINFO_MAGIC;
+    hdr.len = len;
+    hdr.hash = h;
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = (char *)data;
+    iov[1].iov_len = len;
+
+    cc = pwritev(seg->fd, iov, 2, seg->size);
+    if (cc != (int)sizeof(hdr) + len) {
+        ls_syslog(LOG_ERR, "%s: pwritev() segment %d len %d failed: %m",
+                  __func__, seg->id, len);
+        if (ftruncate(seg->fd, seg->size) < 0)
+            ls_syslog(LOG_ERR, "%s: ftruncate() segment %d failed: %m",
+                      __func__, seg->id);
+        return NULL;
+    }
+
+    sprintf(key, "%016llx", h);
+    e = h_addEnt_(&blobTab, key, &new);
+    if (new) {
+        b = my_calloc(1, sizeof(struct jinfoBlob), __func__);
+        if (b == NULL) {
+            h_rmEnt_(&blobTab, e);
+            return NULL;
+        }
+        b->hash = h;
+        e->hData = b;
+    } else {
+        /* A dead copy in another segment.
+         */
+        b = e->hData;
+    }
+    b->seg = seg;
+    b->off = seg->size;
+    b->len = len;
+    seg->size += sizeof(hdr) + len;
+    if (b->refs == 0)
+        seg->dead += BLOB_SIZE(b);
+
+    return b;
+}
+
+static int
+sameBlob(struct jinfoBlob *b, const char *data, int len)
+{
+    char *buf;
+    int cc;
+
+    if (b->len != len)
+        return FALSE;
+
+    buf = malloc(len);
+    if (buf == NULL)
+        return FALSE;
+
+    cc = pread(b->seg->fd, buf, len, b->off + sizeof(struct jinfoHdr));
+    cc = (cc == len && memcmp(buf, data, len) == 0);
+    free(buf);
+
+    return cc;
+}
+
+static void
+addRef(const char *jobFile, struct jinfoBlob *b)
+{
+    hEnt *e;
+    int new;
+
+    e = h_addEnt_(&refTab, jobFile, &new);
+    e->hData = b;
+
+    /* The dead bytes are counted once the
+     * journal is replayed.
+     */
+    if (b->refs++ == 0 && idxFd >= 0)
+        b->seg->dead -= BLOB_SIZE(b);
+}
+
+static int
+dropRef(const char *jobFile)
+{
+    struct jinfoBlob *b;
+    hEnt *e;
+
+    if ((e = h_getEnt_(&refTab, jobFile)) == NULL)
+        return -1;
+
+    b = e->hData;
+    h_rmEnt_(&refTab, e);
+
+    if (--b->refs == 0 && idxFd >= 0)
+        b->seg->dead += BLOB_SIZE(b);
+
+    return 0;
+}
+
+static int
+journal(const char *op, const char *jobFile, unsigned long long h)
+{
+    char line[MAXLINELEN];
+    int len;
+
+    if (op[0] == '+')
+        len = sprintf(line, "+ %s %016llx\n", jobFile, h);
+    else
+        len = sprintf(line, "- %s\n", jobFile);
+
+    if (write(idxFd, line, len) != len) {
+        ls_syslog(LOG_ERR, "%s: write() %s/index failed: %m",
+                  __func__, storeDir);
+        return -1;
+    }
+    ++idxLines;
+
+    return 0;
+}
+
+/* compactSegment()
+ *
+ * Copy the live contents of segs[i] to the active
+ * segment, the dead ones are forgotten, and remove it.
+ * Until it is removed the copies are duplicates the
+ * scan at startup resolves.
+ */
+static int
+compactSegment(int i)
+{
+    struct jinfoSeg *seg;
+    struct jinfoBlob *b;
+    struct jinfoBlob *nb;
+    hEnt **dead;
+    char fn[JINFO_PATHLEN];
+    char *buf;
+    hEnt *e;
+    sTab s;
+    int numDead;
+    int moved;
+    int cc;
+
+    seg = segs[i];
+    dead = calloc(blobTab.numEnts + 1, sizeof(hEnt *));
+    if (dead == NULL)
+        return -1;
+
+    numDead = moved = 0;
+    for (e = h_firstEnt_(&blobTab, &s); e; e = h_nextEnt_(&s)) {
+
+        b = e->hData;
+        if (b->seg != seg)
+            continue;
+
+        if (b->refs == 0) {
+            dead[numDead++] = e;
+            continue;
+        }
+
+        buf = malloc(b->len);
+        if (buf == NULL) {
+            free(dead);
+            return -1;
+        }
+        cc = pread(seg->fd, buf, b->len, b->off + sizeof(struct jinfoHdr));
+        nb = (cc == b->len) ? appendBlob(b->hash, buf, b->len) : NULL;
+        free(buf);
+        if (nb == NULL) {
+            free(dead);
+            return -1;
+        }
+        ++moved;
+    }
+
+    for (cc = 0; cc < numDead; cc++)
+        h_delEnt_(&blobTab, dead[cc]);
+    free(dead);
+
+    ls_syslog(LOG_DEBUG, "\
+%s: segment %d size %ld dead %ld, %d contents moved, %d dropped",
+              __func__, seg->id, (long)seg->size, (long)seg->dead,
+              moved, numDead);
+
+    snprintf(fn, sizeof(fn), "%s/seg.%d", storeDir, seg->id);
+    close(seg->fd);
+    unlink(fn);
+    free(seg);
+
+    --numSegs;
+    memmove(&segs[i], &segs[i + 1], (numSegs - i) * sizeof(struct jinfoSeg *));
+
+    return 0;
+}
+
+/* compactIndex()
+ *
+ * Rewrite the journal with the live job files only.
+ */
+static int
+compactIndex(void)
+{
+    struct jinfoBlob *b;
+    char fn[JINFO_PATHLEN];
+    char tmp[JINFO_PATHLEN];
+    FILE *fp;
+    hEnt *e;
+    sTab s;
+    int fd;
+
+    snprintf(fn, sizeof(fn), "%s/index", storeDir);
+    snprintf(tmp, sizeof(tmp), "%s/index.tmp", storeDir);
+
+    if ((fp = fopen(tmp, "w")) == NULL) {
+        ls_syslog(LOG_ERR, "%s: fopen() %s failed: %m", __func__, tmp);
+        return -1;
+    }
+
+    for (e = h_firstEnt_(&refTab, &s); e; e = h_nextEnt_(&s)) {
+        b = e->hData;
+        fprintf(fp, "+ %s %016llx\n", e->keyname, b->hash);
+    }
+
+    if (FCLOSEUP(&fp) < 0
+        || rename(tmp, fn) < 0) {
+        ls_syslog(LOG_ERR, "%s: write %s failed: %m", __func__, fn);
+        unlink(tmp);
+        return -1;
+    }
+
+    if ((fd = open(fn, O_WRONLY | O_APPEND)) < 0) {
+        ls_syslog(LOG_ERR, "%s: open() %s failed: %m", __func__, fn);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    close(idxFd);
+    idxFd = fd;
+    idxLines = refTab.numEnts;
+
+    return 0;
+}
+
+/* jinfoHash()
+ *
+ * 64 bit FNV-1a of the content.
+ */
+static unsigned long long
+jinfoHash(const char *buf, int len)
+{
+    unsigned long long h;
+    int i;
+
+    h = 14695981039346656037ULL;
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)buf[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static int
+segCmp(const void *a, const void *b)
+{
+    const struct jinfoSeg *s1 = *(struct jinfoSeg * const *)a;
+    const struct jinfoSeg *s2 = *(struct jinfoSeg * const *)b;
+
+    return s1->id - s2->id;
+}
@@ -74,21 +74,29 @@ static void             logFinishedjob(struct jData *);
 static void             log_loadIndex(void);
 static void             ckSchedHost (void);
 static int              checkJobStarter(char *, char *);
+static char            *loadJobInfo(const char *, LS_LONG_INT, int *, char *);
 
 static FILE            *log_fp;
 static FILE            *joblog_fp;
 static int              openEventFile(const char *);
+static int              openEventLog(void);
+static void             closeEventLog(void);
 static int              openEventFile2(const char *);
 static int              putEventRec(const char *);
 static int              putEventRecTime(const char *, time_t);
 static int              putEventRec1(const char *);
 static int              log_jobdata(struct jData *, char *, int);
-static int              createEvent0File(void);
+static int              createEvent0File(time_t, long *);
 static int              renameElogFiles(void);
 static int              createAcct0File(void);
 
 void                    log_timeExpired(int, time_t);
 static int canSwitch(struct eventRec *, struct jData *);
+static int keepEvent(struct eventRec *, int);
+static int writeCompactLog(struct stat *);
+static FILE *openCompactLog(struct stat *, long *);
+static unsigned int compactCksum(unsigned int, const char *, int);
+static void replayEvents(FILE *, const char *, char *);
 static char *instrJobStarter1(char *, int, char *, char *, char *);
 static int streamEvent(struct eventRec *);
 static int countStream(char *);
@@ -102,6 +110,58 @@ static struct eventRec *logPtr;
 
 static int              logLoadIndex = TRUE;
 
+/* lsb.events is kept open, the records are formatted
+ * in memory by lsb_puteventrec() and written to the file
+ * in batches with a single write() and fdatasync().
+ * A batch is committed when it gets older than
+ * LSB_EVENT_COMMIT_WINDOW milliseconds, when it grows
+ * beyond ELOG_BATCH_MAX or before anybody else reads
+ * or renames the file. The memory stream is not a file
+ * so children of mbd exiting can never write
+ * buffered records twice.
+ */
+#define ELOG_BATCH_MAX (1024 * 1024)
+
+static int              elog_fd = -1;
+static FILE            *elog_fp;
+static char            *elogBuf;
+static size_t           elogLen;
+static int              elogEmpty;
+static struct timeval   elogFirst;
+static long             elogSeq;
+static long             elogCommitSeq;
+static int              elogFailed;
+static int              elogWindow;
+
+/* lsb.compact is lsb.events up to a given offset
+ * compacted to the events of the jobs mbd still knows
+ * and the host and queue control events, preceded
+ * by a binary header. At startup mbd replays it and
+ * lsb.events from the offset instead of the whole
+ * file. It is an event log, not a state checkpoint:
+ * the live jobs are still rebuilt record by record,
+ * only the records of the finished jobs and the
+ * obsolete status records are not replayed.
+ */
+#define COMPACT_MAGIC   "OLCOMP"
+#define COMPACT_VERSION 1
+#define DEF_COMPACT_INTERVAL 600
+
+struct compactHeader {
+    char          magic[8];
+    int           version;
+    int           nextJobId;
+    LS_LONG_INT   ino;
+    LS_LONG_INT   offset;
+    LS_LONG_INT   size;
+    unsigned int  cksum;
+};
+
+static char             compactFname[MAXFILENAMELEN];
+static char             compactTmpFname[MAXFILENAMELEN];
+static time_t           lastCompactTime;
+static long             lastCompactSeq = -1;
+
 
 extern int sigNameToValue_( char *);
 
@@ -153,13 +213,14 @@ init_log(void)
 {
     char first = TRUE;
     int ConfigError = 0;
-    int lineNum;
     int list;
     struct jData *jp;
     char dirbuf[MAXPATHLEN];
     char infoDir[MAXPATHLEN];
     struct stat sbuf;
     struct stat ebuf;
+    FILE *compact_fp;
+    long offset;
 
     mSchedStage = M_STAGE_REPLAY;
 
@@ -169,6 +230,11 @@ init_log(void)
     sprintf(jlogFname, "%s/logdir/lsb.acct",
             daemonParams[LSB_SHAREDIR].paramValue);
 
+    sprintf(compactFname, "%s/logdir/lsb.compact",
+            daemonParams[LSB_SHAREDIR].paramValue);
+    sprintf(compactTmpFname, "%s/logdir/lsb.compact.tmp",
+            daemonParams[LSB_SHAREDIR].paramValue);
+
     sprintf(dirbuf, "%s/logdir", daemonParams[LSB_SHAREDIR].paramValue);
 
     if (stat(dirbuf, &sbuf) < 0) {
@@ -230,51 +296,31 @@ init_log(void)
         mbdDie(MASTER_FATAL);
     }
 
+    /* Open the job info store before the replay
+     * removes the info of the cleaned jobs.
+     */
+    if (snprintf(infoDir, sizeof(infoDir), "%s/logdir/jobinfo",
+                 daemonParams[LSB_SHAREDIR].paramValue)
+        >= (int)sizeof(infoDir)
+        || initJobInfoStore(infoDir) < 0)
+        mbdDie(MASTER_FATAL);
+
     stat(elogFname, &ebuf);
     log_fp = fopen(elogFname, "r");
 
     if (log_fp != NULL) {
 
-        if (lsberrno == LSBE_EOF)
-            lsberrno = LSBE_NO_ERROR;
-
-
-        while (lsberrno != LSBE_EOF) {
-            if ((logPtr = lsb_geteventrec(log_fp, &lineNum)) == NULL) {
-
-                if (lsberrno != LSBE_EOF) {
-                    ls_syslog(LOG_ERR, "\
-%s: Reading event file <%s> at line <%d>: %s",
-                              __func__,
-                              elogFname,
-                              lineNum,
-                              lsb_sysmsg());
-                    first = FALSE;
-                    if (lsberrno == LSBE_NO_MEM) {
-
-                        mbdDie(MASTER_MEM);
-                    }
-
-                } else {
-                    FCLOSEUP(&log_fp);
-                    log_fp = NULL;
-                }
-                continue;
-            }
-
-            eventTime = logPtr->eventTime;
-            if (!replay_event(elogFname, lineNum) && first) {
-                ls_syslog(LOG_ERR, "\
-%s: File %s at line %d: First replay_event() failed; line ignored",
-                          __func__,
-                          elogFname,
-                          lineNum);
-                first = FALSE;
-            }
+        if ((compact_fp = openCompactLog(&ebuf, &offset)) != NULL) {
+            ls_syslog(LOG_INFO, "\
+%s: replaying %s then %s from offset %ld", __func__,
+                      compactFname, elogFname, offset);
+            replayEvents(compact_fp, compactFname, &first);
+            FCLOSEUP(&compact_fp);
+            fseek(log_fp, offset, SEEK_SET);
         }
 
-        if (log_fp)
-            FCLOSEUP(&log_fp);
+        replayEvents(log_fp, elogFname, &first);
+        FCLOSEUP(&log_fp);
 
         for (list = SJL; list <= PJL; list++) {
 
@@ -337,6 +383,61 @@ init_log(void)
     return ConfigError;
 }
 
+/* replayEvents()
+ *
+ * Replay all the events in the stream, the file
+ * is mapped and parsed in place.
+ */
+static void
+replayEvents(FILE *fp, const char *file, char *first)
+{
+    struct eventFileMap *map;
+    int lineNum;
+
+    if ((map = lsb_openeventmap(fp)) == NULL) {
+        ls_syslog(LOG_ERR, "%s: lsb_openeventmap() %s failed: %M",
+                  __func__, file);
+        mbdDie(MASTER_MEM);
+    }
+
+    lineNum = 0;
+    if (lsberrno == LSBE_EOF)
+        lsberrno = LSBE_NO_ERROR;
+
+    while (lsberrno != LSBE_EOF) {
+        if ((logPtr = lsb_geteventmaprec(map, &lineNum)) == NULL) {
+
+            if (lsberrno != LSBE_EOF) {
+                ls_syslog(LOG_ERR, "\
+%s: Reading event file <%s> at line <%d>: %s",
+                          __func__,
+                          file,
+                          lineNum,
+                          lsb_sysmsg());
+                *first = FALSE;
+                if (lsberrno == LSBE_NO_MEM) {
+
+                    mbdDie(MASTER_MEM);
+                }
+            }
+            continue;
+        }
+
+        eventTime = logPtr->eventTime;
+        if (!replay_event((char *)file, lineNum) && *first) {
+            ls_syslog(LOG_ERR, "\
+%s: File %s at line %d: First replay_event() failed; line ignored",
+                      __func__,
+                      file,
+                      lineNum);
+            *first = FALSE;
+        }
+    }
+
+    lsb_closeeventmap(map);
+    logPtr = NULL;
+}
+
 static int
 replay_event(char *filename, int lineNum)
 {
@@ -435,6 +536,46 @@ replay_newjob(char *filename, int lineNum)
     return TRUE;
 }
 
+/* newJobFromRec()
+ *
+ * Submit the job of a JOB_NEW record as if it
+ * came from a client at the time of the record
+ * and log it, mbdsim feeds its workload this way.
+ */
+struct jData *
+newJobFromRec(struct eventRec *rec)
+{
+    struct eventRec *svLogPtr;
+    struct jData *job;
+    struct idxList *idxList;
+    int error;
+    int maxJLimit;
+
+    svLogPtr = logPtr;
+    logPtr = rec;
+    job = replay_jobdata("mbdsim", 0, "newJobFromRec");
+    logPtr = svLogPtr;
+
+    maxJLimit = 0;
+    if ((job->shared->jobBill.options & SUB_RESTART)
+        || (idxList = parseJobArrayIndex(job->shared->jobBill.jobName,
+                                         &error,
+                                         &maxJLimit)) == NULL) {
+        handleNewJob(job, JOB_NEW, LOG_IT);
+    } else {
+        handleNewJobArray(job, idxList, maxJLimit);
+        freeIdxList(idxList);
+    }
+
+    if (job->jobId >= nextJobId) {
+        nextJobId = job->jobId + 1;
+        if (nextJobId >= maxJobId)
+            nextJobId = 1;
+    }
+
+    return job;
+}
+
 static int
 replay_switchjob(char *filename, int lineNum)
 {
@@ -702,6 +843,10 @@ replay_executejob(char *filename, int lineNum)
         FREEUP(jp->execUsername);
     jp->execUsername = safeSave(jobExecuteLog->execUsername);
 
+    FREEUP(jp->cpuBind);
+    if (jobExecuteLog->cpuBind && jobExecuteLog->cpuBind[0] != '\0')
+        jp->cpuBind = safeSave(jobExecuteLog->cpuBind);
+
     return true;
 
 }
@@ -1646,6 +1791,7 @@ log_executejob(struct jData * job)
     jobExecuteLog->execHome = job->execHome;
     jobExecuteLog->execCwd = job->execCwd;
     jobExecuteLog->execUsername = job->execUsername;
+    jobExecuteLog->cpuBind = job->cpuBind;
 
     if (putEventRec(fname) < 0) {
         ls_syslog(LOG_ERR, I18N_JOB_FAIL_S,
@@ -2079,42 +2225,233 @@ log_jobForce(struct jData* job, int uid, char *userName)
 
 /* openEventFile()
  *
- * Open the lsb.events file the path is
- * kept in the elogFname global variable.
+ * Get the lsb.events batch ready for a new record,
+ * the path is kept in the elogFname global variable.
  */
 static int
 openEventFile(const char *fname)
 {
-    long pos;
+    if (openEventLog() < 0)
+        return -1;
+
+    log_fp = elog_fp;
+
+    logPtr = my_calloc(1, sizeof(struct eventRec), __func__);
+
+    /* Use the same version as the main protocol.
+     */
+    sprintf(logPtr->version, "%d", OPENLAVA_XDR_VERSION);
+
+    return 0;
+}
+
+/* openEventLog()
+ *
+ * Open lsb.events if not open yet and start a new
+ * batch in memory if there is none pending.
+ */
+static int
+openEventLog(void)
+{
+    struct stat st;
     sigset_t newmask, oldmask;
 
-    sigemptyset(&newmask);
-    sigaddset(&newmask, SIGCHLD);
-    sigprocmask(SIG_BLOCK, &newmask, &oldmask);
+    if (elog_fd < 0) {
 
-    if ((log_fp = fopen(elogFname, "a+")) == NULL) {
+        sigemptyset(&newmask);
+        sigaddset(&newmask, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &newmask, &oldmask);
+
+        elog_fd = open(elogFname, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (elog_fd < 0) {
+            sigprocmask(SIG_SETMASK, &oldmask, NULL);
+            ls_syslog(LOG_ERR, "\
+%s: open() %s failed: %m", __func__, elogFname);
+            return -1;
+        }
         sigprocmask(SIG_SETMASK, &oldmask, NULL);
-        ls_syslog(LOG_ERR, "%s: fopen() %s failed: %m", __func__, elogFname);
-        return -1;
-    }
-    sigprocmask(SIG_SETMASK, &oldmask, NULL);
 
-    fseek(log_fp, 0L, SEEK_END);
+        fcntl(elog_fd, F_SETFD, FD_CLOEXEC);
+        fchmod(elog_fd, 0644);
 
-    if ((pos = ftell(log_fp)) == 0) {
-        fprintf(log_fp,"#80\n");
+        elogEmpty = FALSE;
+        if (fstat(elog_fd, &st) == 0 && st.st_size == 0)
+            elogEmpty = TRUE;
+
+        if (elogWindow == 0
+            && daemonParams[LSB_EVENT_COMMIT_WINDOW].paramValue
+            && isint_(daemonParams[LSB_EVENT_COMMIT_WINDOW].paramValue))
+            elogWindow = atoi(daemonParams[LSB_EVENT_COMMIT_WINDOW].paramValue);
     }
 
-    chmod(elogFname, 0644);
-    logPtr = my_calloc(1, sizeof(struct eventRec), __func__);
+    if (elog_fp == NULL) {
 
-    /* Use the same version as the main protocol.
-     */
-    sprintf(logPtr->version, "%d", OPENLAVA_XDR_VERSION);
+        elog_fp = open_memstream(&elogBuf, &elogLen);
+        if (elog_fp == NULL) {
+            ls_syslog(LOG_ERR, "%s: open_memstream() failed: %m", __func__);
+            return -1;
+        }
+
+        if (elogEmpty) {
+            fprintf(elog_fp, "#80\n");
+            elogEmpty = FALSE;
+        }
+    }
 
     return 0;
 }
 
+/* commitEventLog()
+ *
+ * Write the pending batch of records to lsb.events
+ * and wait for them to be on disk. The records are
+ * committed only once fdatasync() succeeded, if the
+ * write fails mbatchd dies so that no caller can
+ * acknowledge records that are not on disk.
+ */
+int
+commitEventLog(void)
+{
+    struct timeval t0;
+    size_t n;
+    ssize_t cc;
+    int ret;
+
+    if (elog_fp == NULL)
+        return 0;
+
+    ret = 0;
+    gettimeofday(&t0, NULL);
+
+    fclose(elog_fp);
+    elog_fp = NULL;
+
+    for (n = 0; n < elogLen; n += cc) {
+        cc = write(elog_fd, elogBuf + n, elogLen - n);
+        if (cc < 0) {
+            if (errno == EINTR) {
+                cc = 0;
+                continue;
+            }
+            ls_syslog(LOG_ERR, "\
+%s: write() %d bytes to %s failed: %m", __func__, (int)elogLen, elogFname);
+            ret = -1;
+            break;
+        }
+    }
+
+    if (ret == 0 && fdatasync(elog_fd) < 0) {
+        ls_syslog(LOG_ERR, "%s: fdatasync() %s failed: %m", __func__, elogFname);
+        ret = -1;
+    }
+
+    if (ret == 0 && (logclass & LC_TRACE))
+        ls_syslog(LOG_DEBUG, "\
+%s: committed %d bytes %ld records", __func__, (int)elogLen,
+                  elogSeq - elogCommitSeq);
+
+    free(elogBuf);
+    elogBuf = NULL;
+    elogLen = 0;
+
+    if (ret < 0) {
+        /* mbdDie() commits its own record, do
+         * not go back to it from there.
+         */
+        if (!elogFailed) {
+            elogFailed = TRUE;
+            mbdDie(MASTER_FATAL);
+        }
+        return ret;
+    }
+
+    elogCommitSeq = elogSeq;
+
+    metricsCommit(&t0);
+
+    return ret;
+}
+
+/* syncEventLog()
+ *
+ * Commit the pending records, if any, before
+ * telling sbatchd to go ahead with a job whose
+ * start has just been logged.
+ */
+int
+syncEventLog(void)
+{
+    if (elog_fp == NULL || elogSeq == elogCommitSeq)
+        return 0;
+
+    return commitEventLog();
+}
+
+/* closeEventLog()
+ *
+ * Commit and close lsb.events before the file
+ * is read or renamed by the log switch.
+ */
+static void
+closeEventLog(void)
+{
+    commitEventLog();
+
+    if (elog_fd >= 0) {
+        close(elog_fd);
+        elog_fd = -1;
+    }
+}
+
+/* eventLogSeq()
+ *
+ * Number of records logged in lsb.events since
+ * mbd started.
+ */
+long
+eventLogSeq(void)
+{
+    return elogSeq;
+}
+
+/* eventLogCommitted()
+ *
+ * Tell if the record having the given sequence
+ * number is on disk.
+ */
+int
+eventLogCommitted(long seq)
+{
+    return seq <= elogCommitSeq;
+}
+
+/* eventLogCommitDelay()
+ *
+ * Milliseconds before the pending batch must be
+ * committed, 0 if now, -1 if there is nothing pending.
+ */
+int
+eventLogCommitDelay(void)
+{
+    struct timeval t;
+    long ms;
+
+    if (elog_fp == NULL || elogSeq == elogCommitSeq)
+        return -1;
+
+    if (elogWindow <= 0)
+        return 0;
+
+    gettimeofday(&t, NULL);
+    ms = (t.tv_sec - elogFirst.tv_sec) * 1000
+        + (t.tv_usec - elogFirst.tv_usec) / 1000;
+
+    if (ms >= elogWindow)
+        return 0;
+
+    return elogWindow - ms;
+}
+
 /* openEventFile2()
  *
  * Open the event file having the
@@ -2197,6 +2534,22 @@ putEventRec1(const char *fname)
         streamEvent(logPtr);
 
     free(logPtr);
+
+    if (log_fp == elog_fp) {
+        /* Make elogLen current, no system
+         * call happens here.
+         */
+        fflush(log_fp);
+        log_fp = NULL;
+        if (elogSeq == elogCommitSeq)
+            gettimeofday(&elogFirst, NULL);
+        ++elogSeq;
+        if (elogLen >= ELOG_BATCH_MAX
+            && commitEventLog() < 0)
+            ret = -1;
+        return ret;
+    }
+
     cc = FCLOSEUP(&log_fp);
     if (cc < 0) {
         ls_syslog(LOG_ERR, "%s: fclose() failed: %m", __func__);
@@ -2456,12 +2809,18 @@ switch_log(void)
     static char fname[] = "switch_log";
     char tmpfn[MAXFILENAMELEN];
     int i, lineNum = 0, errnoSv;
-    LS_LONG_INT jobId = 0;
     FILE *efp, *tmpfp;
-    struct jData *jp, *jarray;
+    struct eventFileMap *map;
     long pos;
-    int preserved = FALSE;
     int totalEventFile;
+    struct jobIdIndexRow row;
+    char indexFile[MAXFILENAMELEN];
+    long hdrLen;
+    long epos;
+    long off;
+    int jobId;
+    int rowOk;
+    char ch;
 
     sprintf(tmpfn, "%s/logdir/lsb.events",
             daemonParams[LSB_SHAREDIR].paramValue);
@@ -2469,7 +2828,13 @@ switch_log(void)
     ls_syslog(LOG_INFO, "\
 %s: switching event log file: %s", __FUNCTION__, tmpfn);
 
-    if (createEvent0File() == -1) { ;
+    closeEventLog();
+
+    memset(&row, 0, sizeof(struct jobIdIndexRow));
+    row.timeStamp = time(NULL);
+    rowOk = TRUE;
+
+    if (createEvent0File(row.timeStamp, &hdrLen) == -1) { ;
         ls_syslog(LOG_ERR, I18N_FUNC_FAIL, fname, "createEvent0File");
         goto exiterr;
     }
@@ -2495,6 +2860,27 @@ switch_log(void)
 
     fprintf(tmpfp, "#                                     \n");
 
+    /* The records after the header offset are the
+     * ones createEvent0File() copied to lsb.events.0,
+     * while reading them build the job ID index row
+     * of that file.
+     */
+    if (fscanf(efp, "%c%ld ", &ch, &epos) != 2 || ch != '#') {
+        epos = 0;
+        rewind(efp);
+    } else {
+        lineNum = 1;
+    }
+
+    if ((map = lsb_openeventmap(efp)) == NULL) {
+        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname,
+                  "lsb_openeventmap", elogFname);
+        FCLOSEUP(&efp);
+        FCLOSEUP(&tmpfp);
+        unlink(tmpfn);
+        goto exiterr;
+    }
+
     initHostCtrlTable();
     initQueueCtrlTable();
 
@@ -2503,7 +2889,8 @@ switch_log(void)
 
     while (lsberrno != LSBE_EOF) {
 
-        if ((logPtr = lsb_geteventrec(efp, &lineNum)) == NULL) {
+        off = lsb_eventmappos(map);
+        if ((logPtr = lsb_geteventmaprec(map, &lineNum)) == NULL) {
             if (lsberrno != LSBE_EOF) {
                 ls_syslog(LOG_ERR, "\
 %s: reading line %d in file %s: %s", fname, lineNum,
@@ -2522,130 +2909,29 @@ switch_log(void)
 
         eventTime = logPtr->eventTime;
 
-        switch (logPtr->type) {
-            case EVENT_JOB_NEW:
-            case EVENT_JOB_MODIFY:
-                jobId = LSB_JOBID(logPtr->eventLog.jobNewLog.jobId,
-                                  logPtr->eventLog.jobNewLog.idx);
-                break;
-            case EVENT_JOB_MODIFY2: {
-                struct idxList *idxListP;
-                int tmpJobId;
-                if (getJobIdIndexList(logPtr->eventLog.jobModLog.jobIdStr,
-                                      &tmpJobId, &idxListP) == LSBE_NO_ERROR)
-                    jobId = tmpJobId;
-                freeIdxList(idxListP);
-                break;
-            }
-            case EVENT_PRE_EXEC_START:
-            case EVENT_JOB_START:
-                jobId = LSB_JOBID(logPtr->eventLog.jobStartLog.jobId,
-                                  logPtr->eventLog.jobStartLog.idx);
-                break;
-            case EVENT_JOB_STATUS:
-                jobId = LSB_JOBID(logPtr->eventLog.jobStatusLog.jobId,
-                                  logPtr->eventLog.jobStatusLog.idx);
-                break;
-            case EVENT_JOB_SWITCH:
-                jobId = LSB_JOBID(logPtr->eventLog.jobSwitchLog.jobId,
-                                  logPtr->eventLog.jobSwitchLog.idx);
-                break;
-            case EVENT_JOB_MOVE:
-                jobId = LSB_JOBID(logPtr->eventLog.jobMoveLog.jobId,
-                                  logPtr->eventLog.jobMoveLog.idx);
-                break;
-            case EVENT_MIG:
-                jobId = LSB_JOBID(logPtr->eventLog.migLog.jobId,
-                                  logPtr->eventLog.migLog.idx);
-                break;
-            case EVENT_JOB_ATTR_SET:
-                jobId = LSB_JOBID(logPtr->eventLog.jobAttrSetLog.jobId,
-                                  logPtr->eventLog.jobAttrSetLog.idx);
-                break;
-            case EVENT_CHKPNT:
-                jobId = LSB_JOBID(logPtr->eventLog.chkpntLog.jobId,
-                                  logPtr->eventLog.chkpntLog.idx);
-                break;
-            case EVENT_JOB_SIGACT:
-                jobId = LSB_JOBID(logPtr->eventLog.sigactLog.jobId,
-                                  logPtr->eventLog.sigactLog.idx);
-                break;
-            case EVENT_JOB_SIGNAL:
-                jobId = LSB_JOBID(logPtr->eventLog.signalLog.jobId,
-                                  logPtr->eventLog.signalLog.idx);
-                break;
-            case EVENT_JOB_REQUEUE:
-                jobId = LSB_JOBID(logPtr->eventLog.jobRequeueLog.jobId,
-                                  logPtr->eventLog.jobRequeueLog.idx);
-                break;
-            case EVENT_JOB_CLEAN:
-                jobId = LSB_JOBID(logPtr->eventLog.jobCleanLog.jobId,
-                                  logPtr->eventLog.jobCleanLog.idx);
-                break;
-            case EVENT_MBD_UNFULFILL:
-                jobId = LSB_JOBID(logPtr->eventLog.unfulfillLog.jobId,
-                                  logPtr->eventLog.unfulfillLog.idx);
-                break;
-            case EVENT_LOG_SWITCH:
-            case EVENT_LOAD_INDEX:
-                preserved  = TRUE;
-                break;
-            case EVENT_JOB_EXECUTE:
-                jobId = LSB_JOBID(logPtr->eventLog.jobExecuteLog.jobId,
-                                  logPtr->eventLog.jobExecuteLog.idx);
-                break;
-            case EVENT_JOB_START_ACCEPT:
-                jobId = LSB_JOBID(logPtr->eventLog.jobStartAcceptLog.jobId,
-                                  logPtr->eventLog.jobStartAcceptLog.idx);
-                break;
-            case EVENT_JOB_MSG:
-                jobId = LSB_JOBID(logPtr->eventLog.jobMsgLog.jobId,
-                                  logPtr->eventLog.jobMsgLog.idx);
-                break;
-            case EVENT_JOB_MSG_ACK:
-                jobId = LSB_JOBID(logPtr->eventLog.jobMsgAckLog.jobId,
-                                  logPtr->eventLog.jobMsgAckLog.idx);
-                break;
-            case EVENT_HOST_CTRL:
-                saveHostCtrlEvent(&(logPtr->eventLog.hostCtrlLog),
-                                  eventTime);
-                break;
-            case EVENT_QUEUE_CTRL:
-                saveQueueCtrlEvent(&(logPtr->eventLog.queueCtrlLog),
-                                   eventTime);
-                break;
-            default:
-                break;
+        if (rowOk
+            && off >= epos
+            && (jobId = getJobIdFromEventRec(logPtr)) > 0
+            && addJobIdIndexRow(&row, jobId, off - epos + hdrLen) < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: cannot index job %d, the index will be rebuilt", __func__, jobId);
+            rowOk = FALSE;
         }
 
-        /* The head of the job array
-         */
-        jarray = checkJobInCore(LSB_ARRAY_JOBID(jobId));
-        /* the job element
-         */
-        jp = checkJobInCore(jobId);
-
-        if ((preserved)
-            || (jarray != NULL
-                && ((canSwitch(logPtr, jp) == FALSE)
-                    || (logPtr->type == EVENT_JOB_NEW)
-                    || (logPtr->type == EVENT_JOB_MODIFY)
-                    || (logPtr->type == EVENT_JOB_MODIFY2)
-                    || (logPtr->type == EVENT_JOB_SWITCH)
-                    || (logPtr->type == EVENT_JOB_MOVE)
-                    || (logPtr->type == EVENT_JOB_CLEAN)))) {
+        if (keepEvent(logPtr, TRUE)) {
 
             if (lsb_puteventrec(tmpfp, logPtr) == -1) {
                 ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_MM,
                           fname, "lsb_puteventrec", tmpfn);
+                lsb_closeeventmap(map);
                 FCLOSEUP(&efp);
                 unlink (tmpfn);
                 goto exiterr;
             }
         }
-        jobId = 0;
-        preserved = FALSE;
     }
+    lsb_closeeventmap(map);
+    logPtr = NULL;
     FCLOSEUP(&efp);
 
     pos = ftell(tmpfp);
@@ -2670,6 +2956,11 @@ switch_log(void)
         goto exiterr;
     }
 
+    /* lsb.compact refers to the old file.
+     */
+    unlink(compactFname);
+    lastCompactSeq = -1;
+
     writeHostCtrlEvent();
     destroyHostCtrlTable();
 
@@ -2683,12 +2974,25 @@ switch_log(void)
 
     if ((totalEventFile = renameElogFiles()) > 0)  {
 
-        if (fork() == 0) {
-            char  indexFile[MAXFILENAMELEN];
+        sprintf(indexFile, "%s/logdir/%s",
+                daemonParams[LSB_SHAREDIR].paramValue,
+                LSF_JOBIDINDEX_FILENAME);
+
+        /* Append the row built during the switch, if the
+         * row is incomplete or the index does not match
+         * the files a child rebuilds it reading all of
+         * them. Until then there is no index and readers
+         * search the files by time.
+         */
+        if (rowOk
+            && appendJobIdIndexFile(indexFile, &row, totalEventFile) == 0) {
+            freeJobIdIndexRow(&row);
+            return 0;
+        }
+        freeJobIdIndexRow(&row);
+        unlink(indexFile);
 
-            sprintf(indexFile, "%s/logdir/%s",
-                    daemonParams[LSB_SHAREDIR].paramValue,
-                    LSF_JOBIDINDEX_FILENAME);
+        if (fork() == 0) {
 
             if (updateJobIdIndexFile(indexFile, elogFname, totalEventFile) < 0) {
                 if (lsberrno == LSBE_SYS_CALL)
@@ -2708,11 +3012,431 @@ switch_log(void)
     }
 
 exiterr:
+    freeJobIdIndexRow(&row);
     lsb_merr("\
 Fail to switch lsb.events; see mbatchd error log for details");
     return -1;
 }
 
+/* keepEvent()
+ *
+ * Tell if the event must be kept when lsb.events
+ * is compacted, that is if it belongs to a job still
+ * known to mbd. If saveCtrl is set host and queue
+ * control events are saved in tables to be written
+ * at the end of the switch, otherwise they are kept.
+ */
+static int
+keepEvent(struct eventRec *logPtr, int saveCtrl)
+{
+    LS_LONG_INT jobId = 0;
+    struct jData *jp;
+    struct jData *jarray;
+    int preserved = FALSE;
+
+    switch (logPtr->type) {
+        case EVENT_JOB_NEW:
+        case EVENT_JOB_MODIFY:
+            jobId = LSB_JOBID(logPtr->eventLog.jobNewLog.jobId,
+                              logPtr->eventLog.jobNewLog.idx);
+            break;
+        case EVENT_JOB_MODIFY2: {
+            struct idxList *idxListP;
+            int tmpJobId;
+            if (getJobIdIndexList(logPtr->eventLog.jobModLog.jobIdStr,
+                                  &tmpJobId, &idxListP) == LSBE_NO_ERROR)
+                jobId = tmpJobId;
+            freeIdxList(idxListP);
+            break;
+        }
+        case EVENT_PRE_EXEC_START:
+        case EVENT_JOB_START:
+            jobId = LSB_JOBID(logPtr->eventLog.jobStartLog.jobId,
+                              logPtr->eventLog.jobStartLog.idx);
+            break;
+        case EVENT_JOB_STATUS:
+            jobId = LSB_JOBID(logPtr->eventLog.jobStatusLog.jobId,
+                              logPtr->eventLog.jobStatusLog.idx);
+            break;
+        case EVENT_JOB_SWITCH:
+            jobId = LSB_JOBID(logPtr->eventLog.jobSwitchLog.jobId,
+                              logPtr->eventLog.jobSwitchLog.idx);
+            break;
+        case EVENT_JOB_MOVE:
+            jobId = LSB_JOBID(logPtr->eventLog.jobMoveLog.jobId,
+                              logPtr->eventLog.jobMoveLog.idx);
+            break;
+        case EVENT_MIG:
+            jobId = LSB_JOBID(logPtr->eventLog.migLog.jobId,
+                              logPtr->eventLog.migLog.idx);
+            break;
+        case EVENT_JOB_ATTR_SET:
+            jobId = LSB_JOBID(logPtr->eventLog.jobAttrSetLog.jobId,
+                              logPtr->eventLog.jobAttrSetLog.idx);
+            break;
+        case EVENT_CHKPNT:
+            jobId = LSB_JOBID(logPtr->eventLog.chkpntLog.jobId,
+                              logPtr->eventLog.chkpntLog.idx);
+            break;
+        case EVENT_JOB_SIGACT:
+            jobId = LSB_JOBID(logPtr->eventLog.sigactLog.jobId,
+                              logPtr->eventLog.sigactLog.idx);
+            break;
+        case EVENT_JOB_SIGNAL:
+            jobId = LSB_JOBID(logPtr->eventLog.signalLog.jobId,
+                              logPtr->eventLog.signalLog.idx);
+            break;
+        case EVENT_JOB_REQUEUE:
+            jobId = LSB_JOBID(logPtr->eventLog.jobRequeueLog.jobId,
+                              logPtr->eventLog.jobRequeueLog.idx);
+            break;
+        case EVENT_JOB_CLEAN:
+            jobId = LSB_JOBID(logPtr->eventLog.jobCleanLog.jobId,
+                              logPtr->eventLog.jobCleanLog.idx);
+            break;
+        case EVENT_MBD_UNFULFILL:
+            jobId = LSB_JOBID(logPtr->eventLog.unfulfillLog.jobId,
+                              logPtr->eventLog.unfulfillLog.idx);
+            break;
+        case EVENT_LOG_SWITCH:
+        case EVENT_LOAD_INDEX:
+            preserved  = TRUE;
+            break;
+        case EVENT_JOB_EXECUTE:
+            jobId = LSB_JOBID(logPtr->eventLog.jobExecuteLog.jobId,
+                              logPtr->eventLog.jobExecuteLog.idx);
+            break;
+        case EVENT_JOB_START_ACCEPT:
+            jobId = LSB_JOBID(logPtr->eventLog.jobStartAcceptLog.jobId,
+                              logPtr->eventLog.jobStartAcceptLog.idx);
+            break;
+        case EVENT_JOB_MSG:
+            jobId = LSB_JOBID(logPtr->eventLog.jobMsgLog.jobId,
+                              logPtr->eventLog.jobMsgLog.idx);
+            break;
+        case EVENT_JOB_MSG_ACK:
+            jobId = LSB_JOBID(logPtr->eventLog.jobMsgAckLog.jobId,
+                              logPtr->eventLog.jobMsgAckLog.idx);
+            break;
+        case EVENT_HOST_CTRL:
+            if (!saveCtrl) {
+                preserved = TRUE;
+                break;
+            }
+            saveHostCtrlEvent(&(logPtr->eventLog.hostCtrlLog),
+                              logPtr->eventTime);
+            break;
+        case EVENT_QUEUE_CTRL:
+            if (!saveCtrl) {
+                preserved = TRUE;
+                break;
+            }
+            saveQueueCtrlEvent(&(logPtr->eventLog.queueCtrlLog),
+                               logPtr->eventTime);
+            break;
+        default:
+            break;
+    }
+
+    /* The head of the job array
+     */
+    jarray = checkJobInCore(LSB_ARRAY_JOBID(jobId));
+    /* the job element
+     */
+    jp = checkJobInCore(jobId);
+
+    return ((preserved)
+            || (jarray != NULL
+                && ((canSwitch(logPtr, jp) == FALSE)
+                    || (logPtr->type == EVENT_JOB_NEW)
+                    || (logPtr->type == EVENT_JOB_MODIFY)
+                    || (logPtr->type == EVENT_JOB_MODIFY2)
+                    || (logPtr->type == EVENT_JOB_SWITCH)
+                    || (logPtr->type == EVENT_JOB_MOVE)
+                    || (logPtr->type == EVENT_JOB_CLEAN))));
+}
+
+/* checkCompactLog()
+ *
+ * Write lsb.compact again every LSB_COMPACT_INTERVAL
+ * seconds if events have been logged since the last one.
+ * It is written by a child so mbd does not
+ * stop serving while lsb.events is read.
+ */
+void
+checkCompactLog(void)
+{
+    struct stat st;
+    int interval;
+    pid_t pid;
+
+    interval = DEF_COMPACT_INTERVAL;
+    if (daemonParams[LSB_COMPACT_INTERVAL].paramValue
+        && isint_(daemonParams[LSB_COMPACT_INTERVAL].paramValue))
+        interval = atoi(daemonParams[LSB_COMPACT_INTERVAL].paramValue);
+
+    if (interval <= 0)
+        return;
+
+    if (time(NULL) - lastCompactTime < interval
+        || eventLogSeq() == lastCompactSeq)
+        return;
+
+    /* The child sees the memory as it is now,
+     * lsb.events must be up to date with it.
+     */
+    if (commitEventLog() < 0)
+        return;
+
+    if (stat(elogFname, &st) < 0) {
+        ls_syslog(LOG_ERR, "%s: stat() %s failed: %m", __func__, elogFname);
+        return;
+    }
+
+    lastCompactTime = time(NULL);
+    lastCompactSeq = eventLogSeq();
+
+    pid = fork();
+    if (pid < 0) {
+        ls_syslog(LOG_ERR, "%s: fork() failed: %m", __func__);
+        return;
+    }
+
+    if (pid > 0)
+        return;
+
+    if (writeCompactLog(&st) < 0) {
+        unlink(compactTmpFname);
+        exit(-1);
+    }
+
+    exit(0);
+}
+
+/* writeCompactLog()
+ *
+ * Write the events up to the size of lsb.events
+ * when the compaction was requested that keepEvent()
+ * wants to keep, then a log switch event carrying
+ * the next job id, then the header.
+ */
+static int
+writeCompactLog(struct stat *est)
+{
+    struct compactHeader hdr;
+    struct eventRec rec;
+    struct eventRec *ev;
+    struct eventFileMap *map;
+    struct stat st;
+    char buf[MSGSIZE];
+    FILE *efp;
+    FILE *sfp;
+    int lineNum;
+    int cc;
+
+    efp = fopen(elogFname, "r");
+    if (efp == NULL) {
+        ls_syslog(LOG_ERR, "%s: fopen() %s failed: %m", __func__, elogFname);
+        return -1;
+    }
+
+    /* The log has been switched meanwhile.
+     */
+    if (fstat(fileno(efp), &st) < 0
+        || st.st_ino != est->st_ino) {
+        FCLOSEUP(&efp);
+        return -1;
+    }
+
+    sfp = fopen(compactTmpFname, "w+");
+    if (sfp == NULL) {
+        ls_syslog(LOG_ERR, "%s: fopen() %s failed: %m", __func__, compactTmpFname);
+        FCLOSEUP(&efp);
+        return -1;
+    }
+    fchmod(fileno(sfp), 0644);
+
+    memset(&hdr, 0, sizeof(struct compactHeader));
+    if (fwrite(&hdr, sizeof(struct compactHeader), 1, sfp) != 1)
+        goto fail;
+
+    if ((map = lsb_openeventmap(efp)) == NULL)
+        goto fail;
+
+    lineNum = 0;
+    lsberrno = LSBE_NO_ERROR;
+    while (lsb_eventmappos(map) < est->st_size) {
+
+        if ((ev = lsb_geteventmaprec(map, &lineNum)) == NULL) {
+            if (lsberrno == LSBE_EOF || lsberrno == LSBE_NO_MEM)
+                break;
+            continue;
+        }
+
+        if (!keepEvent(ev, FALSE))
+            continue;
+
+        if (lsb_puteventrec(sfp, ev) < 0) {
+            lsb_closeeventmap(map);
+            goto fail;
+        }
+    }
+    lsb_closeeventmap(map);
+
+    if (lsberrno == LSBE_NO_MEM)
+        goto fail;
+
+    memset(&rec, 0, sizeof(struct eventRec));
+    sprintf(rec.version, "%d", OPENLAVA_XDR_VERSION);
+    rec.type = EVENT_LOG_SWITCH;
+    rec.eventTime = time(NULL);
+    rec.eventLog.logSwitchLog.lastJobId = nextJobId;
+    if (lsb_puteventrec(sfp, &rec) < 0)
+        goto fail;
+
+    if (fflush(sfp) != 0)
+        goto fail;
+
+    hdr.size = ftell(sfp) - sizeof(struct compactHeader);
+    fseek(sfp, sizeof(struct compactHeader), SEEK_SET);
+    while ((cc = fread(buf, 1, sizeof(buf), sfp)) > 0)
+        hdr.cksum = compactCksum(hdr.cksum, buf, cc);
+
+    strcpy(hdr.magic, COMPACT_MAGIC);
+    hdr.version = COMPACT_VERSION;
+    hdr.nextJobId = nextJobId;
+    hdr.ino = est->st_ino;
+    hdr.offset = est->st_size;
+
+    fseek(sfp, 0L, SEEK_SET);
+    if (fwrite(&hdr, sizeof(struct compactHeader), 1, sfp) != 1
+        || fflush(sfp) != 0
+        || fsync(fileno(sfp)) < 0)
+        goto fail;
+
+    FCLOSEUP(&efp);
+    if (FCLOSEUP(&sfp) != 0)
+        return -1;
+
+    if (rename(compactTmpFname, compactFname) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: rename() %s %s failed: %m", __func__, compactTmpFname, compactFname);
+        return -1;
+    }
+
+    ls_syslog(LOG_INFO, "\
+%s: %s up to %ld bytes compacted in %s, %ld bytes",
+              __func__, elogFname, (long)hdr.offset, compactFname,
+              (long)hdr.size);
+
+    return 0;
+
+fail:
+    ls_syslog(LOG_ERR, "%s: failed writing %s: %m", __func__, compactTmpFname);
+    FCLOSEUP(&efp);
+    FCLOSEUP(&sfp);
+    return -1;
+}
+
+/* openCompactLog()
+ *
+ * Open lsb.compact and validate it against
+ * lsb.events, on success the stream is positioned
+ * at the first event and the offset in lsb.events
+ * from which the replay must continue is returned.
+ */
+static FILE *
+openCompactLog(struct stat *ebuf, long *offset)
+{
+    struct compactHeader hdr;
+    struct stat st;
+    char buf[MSGSIZE];
+    unsigned int cksum;
+    FILE *fp;
+    FILE *efp;
+    int cc;
+
+    fp = fopen(compactFname, "r");
+    if (fp == NULL)
+        return NULL;
+
+    if (fread(&hdr, sizeof(struct compactHeader), 1, fp) != 1
+        || strncmp(hdr.magic, COMPACT_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != COMPACT_VERSION) {
+        ls_syslog(LOG_WARNING, "%s: %s bad header", __func__, compactFname);
+        goto fail;
+    }
+
+    if (hdr.ino != ebuf->st_ino
+        || hdr.offset > ebuf->st_size) {
+        ls_syslog(LOG_INFO, "\
+%s: %s does not match %s", __func__, compactFname, elogFname);
+        goto fail;
+    }
+
+    if (fstat(fileno(fp), &st) < 0
+        || st.st_size != hdr.size + sizeof(struct compactHeader)) {
+        ls_syslog(LOG_WARNING, "%s: %s truncated", __func__, compactFname);
+        goto fail;
+    }
+
+    cksum = 0;
+    while ((cc = fread(buf, 1, sizeof(buf), fp)) > 0)
+        cksum = compactCksum(cksum, buf, cc);
+
+    if (cksum != hdr.cksum) {
+        ls_syslog(LOG_WARNING, "%s: %s bad checksum", __func__, compactFname);
+        goto fail;
+    }
+
+    /* The compacted log must end on a record
+     * boundary of lsb.events.
+     */
+    if (hdr.offset > 0) {
+        efp = fopen(elogFname, "r");
+        if (efp == NULL
+            || fseek(efp, hdr.offset - 1, SEEK_SET) != 0
+            || fgetc(efp) != '\n') {
+            ls_syslog(LOG_WARNING, "\
+%s: %s offset %ld is not a record boundary of %s", __func__,
+                      compactFname, (long)hdr.offset, elogFname);
+            if (efp)
+                FCLOSEUP(&efp);
+            goto fail;
+        }
+        FCLOSEUP(&efp);
+    }
+
+    fseek(fp, sizeof(struct compactHeader), SEEK_SET);
+    *offset = hdr.offset;
+
+    return fp;
+
+fail:
+    FCLOSEUP(&fp);
+    return NULL;
+}
+
+/* compactCksum()
+ *
+ * FNV-1a over the compacted log payload.
+ */
+static unsigned int
+compactCksum(unsigned int h, const char *buf, int len)
+{
+    int i;
+
+    if (h == 0)
+        h = 2166136261U;
+
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)buf[i];
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
 static int
 createAcct0File(void)
 {
@@ -2771,7 +3495,7 @@ createAcct0File(void)
 
 
 static int
-createEvent0File (void)
+createEvent0File (time_t stamp, long *hdrLen)
 {
     static char fname[] = "createEvent0File";
     char event0File[MAXFILENAMELEN];
@@ -2780,6 +3504,7 @@ createEvent0File (void)
     struct stat st;
     int nread, cc, size;
     long int pos;
+    long first;
     FILE *eventPtr, *event0Ptr;
 
     sprintf(event0File, "%s/logdir/lsb.events.0",
@@ -2801,12 +3526,22 @@ createEvent0File (void)
     }
     chmod(event0File, 0644);
 
-    fprintf(event0Ptr, "#%ld                       \n", time(0));
-
     if (fscanf(eventPtr, "%c%ld ", &ch, &pos) != 2 || ch != '#') {
         pos = 0;
     }
 
+    /* The header has the time of the switch, the
+     * events in the file are older, followed by the
+     * time of the first event so that readers can
+     * tell the time range of the file.
+     */
+    if (fseek(eventPtr, pos, SEEK_SET) != 0
+        || fscanf(eventPtr, " \"%*[^\"]\" \"%*[^\"]\" %ld", &first) != 1)
+        first = stamp;
+
+    fprintf(event0Ptr, "#%ld %ld                \n", (long)stamp, first);
+    *hdrLen = ftell(event0Ptr);
+
     if (fseek(eventPtr, pos, SEEK_SET) != 0) {
         ls_syslog(LOG_ERR, I18N_FUNC_FAIL, fname, "fseek");
         return -1;
@@ -2885,52 +3620,12 @@ renameElogFiles(void)
 void
 logJobInfo(struct submitReq * req, struct jData *jp, struct lenData * jf)
 {
-    static char fname[] = "logJobInfo";
-    int                     errnoSv;
-    char                    logFn[MAXFILENAMELEN];
-    FILE                   *fp;
-    mode_t                  omask = umask(077);
-    sigset_t                newmask, oldmask;
-
-    sprintf(logFn, "%s/logdir/info/%s",
-            daemonParams[LSB_SHAREDIR].paramValue,
-            jp->shared->jobBill.jobFile);
-
-    sigemptyset(&newmask);
-    sigaddset(&newmask, SIGCHLD);
-    sigprocmask(SIG_BLOCK, &newmask, &oldmask);
-    if ((fp = fopen(logFn, "w")) == NULL) {
-        errnoSv = errno;
-        sigprocmask(SIG_SETMASK, &oldmask, NULL);
-        umask(omask);
-        errno = errnoSv;
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fopen",
-                  logFn);
+    if (putJobInfo(jp->shared->jobBill.jobFile, jf->data, jf->len) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: failed to store job file %s of job %s", __func__,
+                  jp->shared->jobBill.jobFile, lsb_jobid2str(jp->jobId));
         mbdDie(MASTER_FATAL);
     }
-    sigprocmask(SIG_SETMASK, &oldmask, NULL);
-    umask(omask);
-
-    if (fwrite(jf->data, 1, jf->len, fp) != jf->len) {
-        ls_syslog(LOG_ERR, "%s: fwrite(%s, len=%d) failed: %m",
-                  fname,
-                  logFn,
-                  jf->len);
-        FCLOSEUP(&fp);
-        goto error;
-    }
-
-    if (FCLOSEUP(&fp) < 0) {
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fclose",
-                  logFn);
-        goto error;
-    }
-
-    return;
-
-error:
-    unlink(logFn);
-    mbdDie(MASTER_FATAL);
 }
 
 int
@@ -2962,6 +3657,11 @@ rmLogJobInfo(struct jData *jp, int check)
         }
     }
 
+    if (rmJobInfo(req->jobFile) == 0)
+        return 0;
+
+    /* A job file written before the store.
+     */
     sprintf(logFn, "%s/logdir/info/%s",
             daemonParams[LSB_SHAREDIR].paramValue, req->jobFile);
 
@@ -2997,8 +3697,7 @@ readLogJobInfo(struct jobSpecs *jobSpecs, struct jData *jpbw,
 #define ENVEND "$LSB_TRAPSIGS\n"
     static char fname[] = "readLogJobInfo()";
     char logFn[MAXFILENAMELEN];
-    LS_STAT_T st;
-    int fd, i, numEnv,cc;
+    int i, numEnv,cc;
     char *buf, *sp, *edata, *eventAttrs = NULL;
     char *newBuf;
 
@@ -3009,44 +3708,19 @@ readLogJobInfo(struct jobSpecs *jobSpecs, struct jData *jpbw,
     jf->len = 0;
     jf->data = NULL;
 
-    sprintf (logFn, "%s/logdir/info/%s",
-             daemonParams[LSB_SHAREDIR].paramValue,
-             jpbw->shared->jobBill.jobFile);
-
-    fd = open(logFn, O_RDONLY);
-    if (fd < 0) {
-
-        sprintf(logFn, "%s/logdir/info/%d",
-                daemonParams[LSB_SHAREDIR].paramValue,
-                LSB_ARRAY_JOBID(jpbw->jobId));
-        fd = open(logFn, O_RDONLY);
-    }
-
-    if (fd < 0) {
+    buf = loadJobInfo(jpbw->shared->jobBill.jobFile,
+                      jpbw->jobId, &cc, logFn);
+    if (buf == NULL) {
         if (errno != ENOENT) {
             ls_syslog(LOG_ERR, I18N_JOB_FAIL_S_S_M,
                       fname,
                       lsb_jobid2str(jpbw->jobId),
-                      "open",
+                      "read",
                       logFn);
         }
         return -1;
     }
 
-    fstat(fd, &st);
-    buf = my_malloc(st.st_size, fname);
-    if ((cc = read(fd, buf, st.st_size)) != st.st_size) {
-        ls_syslog(LOG_ERR, I18N_JOB_FAIL_S_S_M,
-                  fname,
-                  lsb_jobid2str(jpbw->jobId),
-                  "read",
-                  logFn);
-        close(fd);
-        FREEUP(buf);
-        return -1;
-    }
-    close(fd);
-
     for (sp = buf + strlen(SHELLLINE), numEnv = 0;
          strncmp(sp, ENVEND, sizeof(ENVEND) - 1); numEnv++) {
 
@@ -3204,88 +3878,85 @@ readLogJobInfo(struct jobSpecs *jobSpecs, struct jData *jpbw,
 
 }
 
-char *
-readJobInfoFile (struct jData *jp, int *len)
+/* loadJobInfo()
+ *
+ * Read the job file from the store, or from logdir/info
+ * if it was written before the store by its name or the
+ * ID of its array. logFn names where it was read.
+ */
+static char *
+loadJobInfo(const char *jobFile, LS_LONG_INT jobId, int *len, char *logFn)
 {
-    static char fname[] = "readJobInfoFile";
-    char logFn[MAXFILENAMELEN];
     LS_STAT_T st;
-    int fd;
     char *buf;
+    int fd;
+
+    sprintf(logFn, "%s/logdir/jobinfo/%s",
+            daemonParams[LSB_SHAREDIR].paramValue, jobFile);
+
+    if ((buf = getJobInfo(jobFile, len)) != NULL
+        || errno != ENOENT)
+        return buf;
 
     sprintf(logFn, "%s/logdir/info/%s",
-            daemonParams[LSB_SHAREDIR].paramValue,
-            jp->shared->jobBill.jobFile);
+            daemonParams[LSB_SHAREDIR].paramValue, jobFile);
 
     fd = open(logFn, O_RDONLY);
-    if (fd < 0) {
-
+    if (fd < 0 && jobId != 0) {
         sprintf(logFn, "%s/logdir/info/%d",
                 daemonParams[LSB_SHAREDIR].paramValue,
-                LSB_ARRAY_JOBID(jp->jobId));
+                LSB_ARRAY_JOBID(jobId));
         fd = open(logFn, O_RDONLY);
     }
 
-    if (fd < 0) {
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M,
-                  fname,
-                  "open",
-                  logFn);
+    if (fd < 0)
         return NULL;
-    }
+
     fstat(fd, &st);
+    buf = my_malloc(st.st_size + 1, __func__);
+    if (read(fd, buf, st.st_size) != st.st_size) {
+        close(fd);
+        FREEUP(buf);
+        errno = EIO;
+        return NULL;
+    }
+    close(fd);
 
-    buf = (char *) my_malloc(st.st_size, fname);
+    buf[st.st_size] = 0;
     *len = st.st_size;
-    if (read(fd, buf, st.st_size) != st.st_size) {
+
+    return buf;
+}
+
+char *
+readJobInfoFile (struct jData *jp, int *len)
+{
+    static char fname[] = "readJobInfoFile";
+    char logFn[MAXFILENAMELEN];
+    char *buf;
+
+    buf = loadJobInfo(jp->shared->jobBill.jobFile, jp->jobId, len, logFn);
+    if (buf == NULL) {
         ls_syslog(LOG_ERR, I18N_JOB_FAIL_S_S_M,
                   fname,
                   lsb_jobid2str(jp->jobId),
                   "read",
                   logFn);
-        close(fd);
-        free(buf);
         return NULL;
     }
-    close(fd);
-    return (buf);
+
+    return buf;
 }
 
 void
 writeJobInfoFile(struct jData *jp, char *jf, int len)
 {
-
-    static char             fname[] = "writeJobInfoFile";
-    char                    logFn[MAXFILENAMELEN];
-    int                     fd, errnoSv;
-
-    sprintf(logFn, "%s/logdir/info/%s",
-            daemonParams[LSB_SHAREDIR].paramValue,
-            jp->shared->jobBill.jobFile);
-
-    fd = open(logFn, O_CREAT | O_TRUNC | O_WRONLY, 0600);
-    if (fd < 0) {
-        sprintf(logFn, "%s/logdir/info/%d",
-                daemonParams[LSB_SHAREDIR].paramValue,
-                LSB_ARRAY_JOBID(jp->jobId));
-        fd = open(logFn, O_CREAT | O_TRUNC | O_WRONLY, 0600);
-    }
-    if (fd < 0) {
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "open", logFn);
-        mbdDie(MASTER_FATAL);
-    }
-
-    if (b_write_fix(fd, jf, len) != len) {
-        errnoSv = errno;
-        unlink(logFn);
-        close(fd);
-        errno = errnoSv;
-        ls_syslog(LOG_ERR, I18N_FUNC_S_S_FAIL_M, fname, "fprintf",
-                  logFn, jf);
+    if (putJobInfo(jp->shared->jobBill.jobFile, jf, len) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: failed to store job file %s of job %s", __func__,
+                  jp->shared->jobBill.jobFile, lsb_jobid2str(jp->jobId));
         mbdDie(MASTER_FATAL);
     }
-
-    close(fd);
 }
 
 
@@ -3297,26 +3968,34 @@ replaceJobInfoFile(char *jobFileName,
 {
     static char fname[] = "replaceJobInfoFile";
     char jobFile[MAXFILENAMELEN];
-    char workFile[MAXFILENAMELEN];
     char line[MAXLINELEN];
     char *ptr;
+    char *data;
+    char *out;
+    size_t outLen;
+    int  len;
     int  nbyte;
     FILE *fdi, *fdo;
 
-    sprintf(jobFile, "\
-%s/logdir/info/%s", daemonParams[LSB_SHAREDIR].paramValue, jobFileName);
-    sprintf(workFile, "\
-%s/logdir/info/%s.tmp", daemonParams[LSB_SHAREDIR].paramValue,
-            jobFileName);
+    /* Edit the job file in memory and store
+     * the result under the same name.
+     */
+    if ((data = loadJobInfo(jobFileName, 0, &len, jobFile)) == NULL) {
+        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "read", jobFile);
+        return -1;
+    }
 
-    if ((fdi = fopen(jobFile, "r")) == NULL) {
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fopen", jobFileName);
+    if ((fdi = fmemopen(data, len, "r")) == NULL) {
+        FREEUP(data);
+        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fmemopen", jobFile);
         return -1;
     }
 
-    if ((fdo = fopen(workFile, "w")) == NULL) {
+    if ((fdo = open_memstream(&out, &outLen)) == NULL) {
         FCLOSEUP(&fdi);
-        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fopen", workFile);
+        FREEUP(data);
+        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "open_memstream",
+                  jobFile);
         return -1;
     }
 
@@ -3336,7 +4015,8 @@ replaceJobInfoFile(char *jobFileName,
                 if ((ptr = fgets(line, MAXLINELEN, fdi)) == NULL) {
                     FCLOSEUP(&fdo);
                     FCLOSEUP(&fdi);
-                    remove(workFile);
+                    FREEUP(out);
+                    FREEUP(data);
                     ls_syslog(LOG_ERR, "%s: Unexpected the end of (%s)",
                               fname,
                               jobFileName);
@@ -3358,7 +4038,8 @@ replaceJobInfoFile(char *jobFileName,
                                    outCmdArgs, sizeof(outCmdArgs)) < 0) {
                     FCLOSEUP(&fdo);
                     FCLOSEUP(&fdi);
-                    remove(workFile);
+                    FREEUP(out);
+                    FREEUP(data);
                     ls_syslog(LOG_ERR, "\
 %s: The command line is too long when replacing the command of (%s) by the one of (%s)",
                               fname, oldCmdArgs,
@@ -3383,7 +4064,8 @@ replaceJobInfoFile(char *jobFileName,
     if (ptr == NULL) {
         FCLOSEUP(&fdo);
         FCLOSEUP(&fdi);
-        remove(workFile);
+        FREEUP(out);
+        FREEUP(data);
         ls_syslog(LOG_ERR, "%s: Unexpected the end of (%s)",
                   __func__, jobFileName);
         return -1;
@@ -3404,7 +4086,8 @@ replaceJobInfoFile(char *jobFileName,
     if (ptr == NULL) {
         FCLOSEUP(&fdo);
         FCLOSEUP(&fdi);
-        remove(workFile);
+        FREEUP(out);
+        FREEUP(data);
         ls_syslog(LOG_ERR, "%s: Unexpected the end of (%s)",
                   fname,
                   jobFileName);
@@ -3417,15 +4100,29 @@ replaceJobInfoFile(char *jobFileName,
         if (fwrite(line,1, nbyte, fdo) != nbyte) {
             FCLOSEUP(&fdo);
             FCLOSEUP(&fdi);
-            remove(workFile);
-            ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fwrite", workFile);
+            FREEUP(out);
+            FREEUP(data);
+            ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, fname, "fwrite", jobFile);
             return -1;
         }
 
     FCLOSEUP(&fdo);
     FCLOSEUP(&fdi);
-    remove(jobFile);
-    rename(workFile, jobFile);
+    FREEUP(data);
+
+    if (putJobInfo(jobFileName, out, outLen) < 0) {
+        FREEUP(out);
+        ls_syslog(LOG_ERR, "%s: failed to store job file %s",
+                  fname, jobFileName);
+        return -1;
+    }
+    FREEUP(out);
+
+    /* It is in the store now.
+     */
+    if (strstr(jobFile, "/logdir/info/"))
+        unlink(jobFile);
+
     return 0;
 }
 void
@@ -158,6 +158,9 @@ static int authRequest(struct lsfAuth *, XDR *, struct LSFHeader *,
 static int processClient(struct clientNode *, int *);
 static void clientIO(struct Masks *);
 static int forkOnRequest(mbdReqType);
+static int holdOnRequest(mbdReqType);
+static int keepOnRequest(mbdReqType);
+static void commitEvents(struct timeval *);
 static void shutdownSbdConnections(void);
 static void processSbdNode(struct sbdNode *, int);
 static void setNextSchedTimeWhenJobFinish(void);
@@ -173,7 +176,6 @@ static void preempt(void);
 int
 main(int argc, char **argv)
 {
-    fd_set readmask;
     struct Masks sockmask;
     struct Masks chanmask;
     struct timeval timeout;
@@ -325,6 +327,7 @@ main(int argc, char **argv)
     now = time(NULL);
     if (lsb_CheckMode == TRUE)
         TIMEIT(0, minit(FIRST_START),"minit");
+    initQuerySnapshot();
 
     masterHost = ls_getmastername();
     for (i = 0; i < 3 && !masterHost && lserrno == LSE_TIME_OUT; i++) {
@@ -380,6 +383,8 @@ main(int argc, char **argv)
     /* Go go go...
      */
     TIMEIT(0, minit(FIRST_START),"minit");
+    initQuerySnapshot();
+    initMetrics();
     log_mbdStart();
     ls_syslog(LOG_INFO, "%s: mbatchd (re-)started", __func__);
     pollSbatchds(FIRST_START);
@@ -390,7 +395,6 @@ main(int argc, char **argv)
 
     for (;;) {
 
-        FD_ZERO(&readmask);
         now = time(NULL);
 
         if ( (now - lastSchedTime >= msleeptime)
@@ -416,7 +420,8 @@ main(int argc, char **argv)
             timeout.tv_sec = 0;
         }
 
-        sockmask.rmask = readmask;
+        commitEvents(&timeout);
+        flushDispatch();
 
         nready = chanSelect_(&sockmask, &chanmask, &timeout);
         if (nready < 0) {
@@ -450,10 +455,11 @@ main(int argc, char **argv)
         timeout.tv_sec  = 0;
         timeout.tv_usec = 0;
 
-        if (FD_ISSET(batchSock, &chanmask.rmask)) {
+        if (CHAN_ISSET(batchSock, &chanmask.rmask)) {
             acceptConnection(batchSock);
         }
 
+        checkQuerySnapshot();
         clientIO(&chanmask);
 
     } /* for (;;) */
@@ -524,10 +530,19 @@ clientIO(struct Masks *chanmask)
          sbdPtr = nextSbdPtr) {
         nextSbdPtr = sbdPtr->forw;
 
-        if (FD_ISSET(sbdPtr->chanfd, &chanmask->rmask)
-            || FD_ISSET(sbdPtr->chanfd, &chanmask->emask)) {
+        if (sbdPtr->disp && sbdPtr->disp->connecting) {
+            if (CHAN_ISSET(sbdPtr->chanfd, &chanmask->wmask)
+                || CHAN_ISSET(sbdPtr->chanfd, &chanmask->emask))
+                connectDispatchDone(sbdPtr->disp,
+                                    CHAN_ISSET(sbdPtr->chanfd,
+                                               &chanmask->emask) != 0);
+            continue;
+        }
+
+        if (CHAN_ISSET(sbdPtr->chanfd, &chanmask->rmask)
+            || CHAN_ISSET(sbdPtr->chanfd, &chanmask->emask)) {
 
-            if (FD_ISSET(sbdPtr->chanfd, &chanmask->emask))
+            if (CHAN_ISSET(sbdPtr->chanfd, &chanmask->emask))
                 exception = TRUE;
             else
                 exception = FALSE;
@@ -541,18 +556,18 @@ clientIO(struct Masks *chanmask)
         int needFree;
         nextClient = cliPtr->forw;
 
-        if (FD_ISSET(cliPtr->chanfd, &chanmask->emask)) {
+        if (CHAN_ISSET(cliPtr->chanfd, &chanmask->emask)) {
             shutDownClient(cliPtr);
             continue;
         }
         needFree = FALSE;
-        if (FD_ISSET(cliPtr->chanfd, &chanmask->rmask)) {
+        if (CHAN_ISSET(cliPtr->chanfd, &chanmask->rmask)) {
 
             int saveChfd;
             saveChfd = cliPtr->chanfd;
             if (processClient(cliPtr, &needFree) == 0) {
 
-                FD_CLR(saveChfd, &chanmask->rmask);
+                CHAN_CLR(saveChfd, &chanmask->rmask);
                 if (needFree == TRUE) {
                     offList((struct listEntry *)cliPtr);
                     FREEUP(cliPtr->fromHost);
@@ -581,7 +596,11 @@ processClient(struct clientNode *client, int *needFree)
     XDR                  xdrs;
     int                  statusReqCC = 0;
     int                  hostOkFlag = 0;
+    int                  hold = FALSE;
+    long                 logSeq = 0;
+    struct timeval       reqStart;
 
+    gettimeofday(&reqStart, NULL);
     laddrLen = sizeof(laddr);
     memset(&auth, 0, sizeof(auth));
     s = client->chanfd;
@@ -648,6 +667,11 @@ processClient(struct clientNode *client, int *needFree)
         goto endLoop;
     }
 
+    if (querySnapshotReq(mbdReqtype)
+        && querySnapshotSend(s, &from, buf) == 0) {
+        goto endLoop;
+    }
+
     if (forkOnRequest(mbdReqtype)) {
 
         if ((pid = fork()) < 0) {
@@ -663,6 +687,16 @@ processClient(struct clientNode *client, int *needFree)
             closeExceptFD(chanSock_(s));
     }
 
+    /* Requests changing the state of the cluster
+     * are acknowledged only after the events they
+     * logged have been committed.
+     */
+    if (holdOnRequest(mbdReqtype)
+        && chanHold_(s) == 0) {
+        hold = TRUE;
+        logSeq = eventLogSeq();
+    }
+
     switch (mbdReqtype) {
 
         case PREPARE_FOR_OP:
@@ -780,6 +814,10 @@ processClient(struct clientNode *client, int *needFree)
                    do_jobMsgInfo(&xdrs, s, &from, client->fromHost, &reqHdr, &auth),
                    "do_jobMsgInfo()");
             break;
+        case BATCH_METRICS_INFO:
+            TIMEIT(0, do_metricsInfoReq(&xdrs, s, &from, &reqHdr),
+                   "do_metricsInfoReq()");
+            break;
         default:
             errorBack(s, LSBE_PROTOCOL, &from);
             if (reqHdr.version <= OPENLAVA_XDR_VERSION)
@@ -795,16 +833,30 @@ processClient(struct clientNode *client, int *needFree)
         exit(0);
     }
 endLoop:
+    metricsRequest(mbdReqtype, &reqStart);
     client->reqType = mbdReqtype;
     client->lastTime = now;
     xdr_destroy(&xdrs);
     chanFreeBuf_(buf);
-    if ((reqHdr.opCode != PREPARE_FOR_OP &&
-         reqHdr.opCode != BATCH_STATUS_JOB &&
-         reqHdr.opCode != BATCH_RUSAGE_JOB &&
-         reqHdr.opCode != BATCH_STATUS_MSG_ACK &&
-         reqHdr.opCode != BATCH_STATUS_CHUNK) ||
-        statusReqCC < 0) {
+    if (hold) {
+        if (eventLogSeq() != logSeq)
+            client->logSeq = eventLogSeq();
+        if (client->logSeq != 0
+            && !eventLogCommitted(client->logSeq)) {
+            /* commitEvents() will send the replies
+             * and shut down the client unless it is
+             * a sbatchd keeping the connection.
+             */
+            if (!keepOnRequest(mbdReqtype))
+                return 0;
+        } else {
+            client->logSeq = 0;
+            chanRelease_(s);
+        }
+    }
+    if ((reqHdr.opCode != PREPARE_FOR_OP
+         && !keepOnRequest(reqHdr.opCode))
+        || statusReqCC < 0) {
         shutDownClient(client);
         return -1;
     }
@@ -907,6 +959,7 @@ periodicCheck(void)
     }
 
     switchELog();
+    checkCompactLog();
 
     if (jobPriorityUpdIntvl > 0) {
         if (now - last_jobPriUpdTime >= jobPriorityUpdIntvl * 60 ) {
@@ -1101,6 +1154,104 @@ forkOnRequest(mbdReqType req)
     return 0;
 }
 
+/* holdOnRequest()
+ *
+ * Requests whose reply depends on events logged
+ * while processing them. sbatchd forgets a job
+ * status once mbd has acknowledged it.
+ */
+static int
+holdOnRequest(mbdReqType req)
+{
+    if (keepOnRequest(req))
+        return 1;
+
+    if (req == BATCH_JOB_SUB
+        || req == BATCH_JOB_SIG
+        || req == BATCH_JOB_MSG
+        || req == BATCH_QUE_CTRL
+        || req == BATCH_JOB_MIG
+        || req == BATCH_HOST_CTRL
+        || req == BATCH_JOB_SWITCH
+        || req == BATCH_JOB_MOVE
+        || req == BATCH_SET_JOB_ATTR
+        || req == BATCH_JOB_MODIFY
+        || req == BATCH_JOB_FORCE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/* keepOnRequest()
+ *
+ * Status requests of sbatchd, the connection
+ * is kept open after the reply.
+ */
+static int
+keepOnRequest(mbdReqType req)
+{
+    if (req == BATCH_STATUS_JOB
+        || req == BATCH_RUSAGE_JOB
+        || req == BATCH_STATUS_MSG_ACK
+        || req == BATCH_STATUS_CHUNK)
+        return 1;
+
+    return 0;
+}
+
+/* commitEvents()
+ *
+ * Commit the pending events to lsb.events once
+ * the commit window has passed then send the replies
+ * waiting for them. Otherwise make sure select()
+ * does not sleep beyond the window.
+ */
+static void
+commitEvents(struct timeval *timeout)
+{
+    struct clientNode *cliPtr;
+    struct clientNode *nextClient;
+    int ms;
+
+    ms = eventLogCommitDelay();
+    if (ms < 0)
+        return;
+
+    if (ms > 0) {
+        if (timeout->tv_sec * 1000 + timeout->tv_usec / 1000 > ms) {
+            timeout->tv_sec = ms / 1000;
+            timeout->tv_usec = (ms % 1000) * 1000;
+        }
+        return;
+    }
+
+    if (commitEventLog() < 0) {
+        ls_syslog(LOG_ERR, "%s: failed to commit events: %m", __func__);
+        mbdDie(MASTER_FATAL);
+    }
+
+    for (cliPtr = clientList->forw;
+         cliPtr != clientList;
+         cliPtr = nextClient) {
+        nextClient = cliPtr->forw;
+
+        if (cliPtr->logSeq == 0
+            || !eventLogCommitted(cliPtr->logSeq))
+            continue;
+
+        cliPtr->logSeq = 0;
+        if (keepOnRequest(cliPtr->reqType)) {
+            if (chanRelease_(cliPtr->chanfd) < 0)
+                shutDownClient(cliPtr);
+            continue;
+        }
+
+        chanRelease_(cliPtr->chanfd);
+        shutDownClient(cliPtr);
+    }
+}
+
 static void
 shutdownSbdConnections(void)
 {
@@ -1129,6 +1280,11 @@ shutdownSbdConnections(void)
             || cliPtr->reqType == BATCH_RUSAGE_JOB
             || cliPtr->reqType == BATCH_STATUS_CHUNK) {
 
+            /* Replies waiting for the commit.
+             */
+            if (cliPtr->logSeq != 0)
+                continue;
+
             if (cliPtr->lastTime < oldest) {
                 deleteCliPtr = cliPtr;
                 oldest = cliPtr->lastTime;
@@ -1147,6 +1303,9 @@ shutdownSbdConnections(void)
          sbdPtr = nextSbdPtr) {
         nextSbdPtr = sbdPtr->forw;
 
+        if (sbdPtr->disp && sbdPtr->disp->numJobs > 0)
+            continue;
+
         if (sbdPtr->lastTime < oldest) {
             if (deleteSbdPtr == NULL
                 || sbdPtr->reqCode >= deleteSbdPtr->reqCode) {
@@ -1183,6 +1342,12 @@ processSbdNode(struct sbdNode *sbdPtr, int exception)
             break;
         case MBD_NEW_JOB_KEEP_CHAN:
             break;
+        case MBD_NEW_JOBS:
+            /* The dispatch channel stays open,
+             * doNewJobsReply() closes it on error.
+             */
+            doNewJobsReply(sbdPtr, exception);
+            return;
         default:
             ls_syslog(LOG_ERR, "\
 %s: Unsupported sbdNode request %d", __func__, sbdPtr->reqCode);
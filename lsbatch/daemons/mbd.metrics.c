@@ -0,0 +1,777 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include "mbd.h"
+
+/* The scheduler metrics. The session timers and the
+ * profiling counters are accumulated here since mbatchd
+ * started, together with log2 histograms of the
+ * scheduling sessions, the event log commits and the
+ * service time of the requests.
+ *
+ * The metrics live in a shared anonymous mapping. When
+ * MBD_METRICS_SOCKET is set in lsf.conf a child process
+ * serves them in text format on that unix socket, it
+ * reads the mapping so scraping never enters the main
+ * loop of mbatchd. The writer bumps a sequence number
+ * before and after each update, odd while updating,
+ * so the reader can take a consistent copy.
+ */
+
+enum {
+    HIST_SESSION_US,
+    HIST_SESSION_JOBS,
+    HIST_SESSION_PEND,
+    HIST_COMMIT_US,
+    HIST_LAST
+};
+
+static char *histNames[] = {
+    "mbd_session_duration_us",
+    "mbd_session_dispatched_jobs",
+    "mbd_session_pending_jobs",
+    "mbd_eventlog_commit_us"
+};
+
+static char *timerNames[] = {
+    "getQUsable",
+    "getCandHosts",
+    "getJUsable",
+    "readyToDisp",
+    "cntUQSlots",
+    "fsQelectPendJob",
+    "pickAJob",
+    "scheduleAJob",
+    "collectPendReason"
+};
+#define NUM_TIMERS (sizeof(timerNames)/sizeof(timerNames[0]))
+
+static struct reqName {
+    mbdReqType reqType;
+    char *name;
+} reqNames[] = {
+    {BATCH_JOB_SUB, "job_submit"},
+    {BATCH_JOB_INFO, "job_info"},
+    {BATCH_JOB_PEEK, "job_peek"},
+    {BATCH_JOB_SIG, "job_signal"},
+    {BATCH_HOST_INFO, "host_info"},
+    {BATCH_QUE_INFO, "queue_info"},
+    {BATCH_GRP_INFO, "group_info"},
+    {BATCH_QUE_CTRL, "queue_control"},
+    {BATCH_RECONFIG, "reconfig"},
+    {BATCH_HOST_CTRL, "host_control"},
+    {BATCH_JOB_SWITCH, "job_switch"},
+    {BATCH_JOB_MOVE, "job_move"},
+    {BATCH_JOB_MIG, "job_migrate"},
+    {BATCH_STATUS_JOB, "job_status"},
+    {BATCH_SLAVE_RESTART, "sbd_restart"},
+    {BATCH_USER_INFO, "user_info"},
+    {BATCH_PARAM_INFO, "param_info"},
+    {BATCH_JOB_MODIFY, "job_modify"},
+    {BATCH_JOB_MSG, "job_msg"},
+    {BATCH_STATUS_MSG_ACK, "status_msg_ack"},
+    {BATCH_DEBUG, "debug"},
+    {BATCH_RESOURCE_INFO, "resource_info"},
+    {BATCH_RUSAGE_JOB, "job_rusage"},
+    {BATCH_JOB_FORCE, "job_force"},
+    {BATCH_STATUS_CHUNK, "status_chunk"},
+    {BATCH_JOBMSG_INFO, "jobmsg_info"},
+    {BATCH_METRICS_INFO, "metrics_info"},
+    {BATCH_SET_JOB_ATTR, "set_job_attr"},
+    {PREPARE_FOR_OP, "prepare_for_op"},
+    {0, "other"}
+};
+#define NUM_REQS (sizeof(reqNames)/sizeof(reqNames[0]))
+
+struct metricsHist {
+    LS_LONG_INT count;
+    LS_LONG_INT sum;
+    LS_LONG_INT buckets[METRIC_BUCKETS];
+};
+
+struct metricsShm {
+    volatile unsigned int seq;
+    time_t startTime;
+    LS_LONG_INT sessions;
+    LS_LONG_INT jobsStarted;
+    LS_LONG_INT timers[NUM_TIMERS];
+    LS_LONG_INT counters[PROF_CNT_nullfunc];
+    struct metricsHist hists[HIST_LAST];
+    struct metricsHist reqs[NUM_REQS];
+};
+
+static struct metricsShm *shm;
+static struct timeval sessionStart;
+static int sessionPend;
+static int sessionJobs;
+static int inSession;
+
+static void metricsBegin(void);
+static void metricsEnd(void);
+static void histAdd(struct metricsHist *, LS_LONG_INT);
+static LS_LONG_INT usecSince(struct timeval *);
+static int metricsSnapshot(struct metricsShm *);
+static int metricsCollect(struct metricsShm *, struct mbdMetric **);
+static void freeCollected(struct mbdMetric *, int);
+static int openMetricsSocket(const char *);
+static void metricsExporter(int, int);
+static void metricsServe(int);
+static void metricsText(FILE *, struct metricsShm *);
+
+/* initMetrics()
+ *
+ * Map the metrics and start the exporter if
+ * MBD_METRICS_SOCKET is configured.
+ */
+void
+initMetrics(void)
+{
+    static int exporterPipe = -1;
+    char *path;
+    int p[2];
+    int s;
+    pid_t pid;
+
+    if (shm == NULL) {
+        shm = mmap(NULL,
+                   sizeof(struct metricsShm),
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS,
+                   -1,
+                   0);
+        if (shm == MAP_FAILED) {
+            ls_syslog(LOG_ERR, "%s: mmap() failed: %M", __func__);
+            shm = NULL;
+            return;
+        }
+        memset(shm, 0, sizeof(struct metricsShm));
+        shm->startTime = time(NULL);
+    }
+
+    path = daemonParams[MBD_METRICS_SOCKET].paramValue;
+    if (path == NULL
+        || exporterPipe >= 0)
+        return;
+
+    if (path[0] != '/') {
+        ls_syslog(LOG_ERR, "\
+%s: MBD_METRICS_SOCKET <%s> in lsf.conf is not an absolute path, ignored",
+                  __func__, path);
+        return;
+    }
+
+    if ((s = openMetricsSocket(path)) < 0)
+        return;
+
+    if (pipe(p) < 0) {
+        ls_syslog(LOG_ERR, "%s: pipe() failed: %M", __func__);
+        close(s);
+        return;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        ls_syslog(LOG_ERR, "%s: fork() failed: %M", __func__);
+        close(s);
+        close(p[0]);
+        close(p[1]);
+        return;
+    }
+
+    if (pid == 0) {
+        close(p[1]);
+        metricsExporter(s, p[0]);
+        _exit(0);
+    }
+
+    /* The exporter exits when it sees the end
+     * of the pipe, that is when mbatchd is gone.
+     */
+    close(s);
+    close(p[0]);
+    fcntl(p[1], F_SETFD, FD_CLOEXEC);
+    exporterPipe = p[1];
+
+    ls_syslog(LOG_INFO, "\
+%s: metrics exporter %d serving %s", __func__, pid, path);
+}
+
+/* metricsSessionBegin()
+ */
+void
+metricsSessionBegin(void)
+{
+    gettimeofday(&sessionStart, NULL);
+    sessionPend = LIST_NUM_ENTRIES((LIST_T *)jDataList[PJL])
+        + LIST_NUM_ENTRIES((LIST_T *)jDataList[MJL]);
+    sessionJobs = 0;
+    inSession = TRUE;
+}
+
+/* metricsSessionEnd()
+ *
+ * A session went through the pending jobs, the
+ * duration is the wall time since it started
+ * including the passes it took.
+ */
+void
+metricsSessionEnd(struct schedTimers *t)
+{
+    if (shm == NULL || !inSession)
+        return;
+
+    metricsBegin();
+
+    shm->sessions++;
+    shm->timers[0] += t->getQUsable;
+    shm->timers[1] += t->getCandHosts;
+    shm->timers[2] += t->getJUsable;
+    shm->timers[3] += t->readyToDisp;
+    shm->timers[4] += t->cntUQSlots;
+    shm->timers[5] += t->fsQelectPendJob;
+    shm->timers[6] += t->pickAJob;
+    shm->timers[7] += t->scheduleAJob;
+    shm->timers[8] += t->collectPendReason;
+
+    histAdd(&shm->hists[HIST_SESSION_US], usecSince(&sessionStart));
+    histAdd(&shm->hists[HIST_SESSION_JOBS], sessionJobs);
+    histAdd(&shm->hists[HIST_SESSION_PEND], sessionPend);
+
+    metricsEnd();
+
+    inSession = FALSE;
+}
+
+/* metricsJobStarted()
+ */
+void
+metricsJobStarted(void)
+{
+    if (shm == NULL)
+        return;
+
+    ++sessionJobs;
+
+    metricsBegin();
+    shm->jobsStarted++;
+    metricsEnd();
+}
+
+/* metricsCounters()
+ *
+ * Called by RESET_CNT() to accumulate the profiling
+ * counters before they are zeroed.
+ */
+void
+metricsCounters(void)
+{
+    int i;
+
+    if (shm == NULL)
+        return;
+
+    metricsBegin();
+    for (i = 0; i < PROF_CNT_nullfunc; i++)
+        shm->counters[i] += counters[i].cntVal;
+    metricsEnd();
+}
+
+/* metricsCommit()
+ */
+void
+metricsCommit(struct timeval *start)
+{
+    if (shm == NULL)
+        return;
+
+    metricsBegin();
+    histAdd(&shm->hists[HIST_COMMIT_US], usecSince(start));
+    metricsEnd();
+}
+
+/* metricsRequest()
+ *
+ * The time mbatchd spent serving a request.
+ */
+void
+metricsRequest(mbdReqType reqType, struct timeval *start)
+{
+    int i;
+
+    if (shm == NULL)
+        return;
+
+    for (i = 0; i < NUM_REQS - 1; i++) {
+        if (reqNames[i].reqType == reqType)
+            break;
+    }
+
+    metricsBegin();
+    histAdd(&shm->reqs[i], usecSince(start));
+    metricsEnd();
+}
+
+/* do_metricsInfoReq()
+ */
+int
+do_metricsInfoReq(XDR *xdrs,
+                  int chfd,
+                  struct sockaddr_in *from,
+                  struct LSFHeader *reqHdr)
+{
+    struct metricsShm snap;
+    struct metricsInfoReply reply;
+    struct LSFHeader hdr;
+    XDR xdrs2;
+    char *buf;
+    int len;
+    int cc;
+
+    if (shm == NULL) {
+        errorBack(chfd, LSBE_NO_MEM, from);
+        return -1;
+    }
+
+    /* mbatchd is the only writer so its
+     * copy is always consistent.
+     */
+    memcpy(&snap, shm, sizeof(struct metricsShm));
+
+    reply.startTime = snap.startTime;
+    reply.numMetrics = metricsCollect(&snap, &reply.metrics);
+    if (reply.numMetrics < 0) {
+        errorBack(chfd, LSBE_NO_MEM, from);
+        return -1;
+    }
+
+    len = LSF_HEADER_LEN + 2 * sizeof(int)
+        + reply.numMetrics * (2 * MAXLSFNAMELEN
+                              + (2 * METRIC_BUCKETS + 8) * sizeof(int));
+    buf = my_calloc(len, sizeof(char), __func__);
+
+    xdrmem_create(&xdrs2, buf, len, XDR_ENCODE);
+    initLSFHeader_(&hdr);
+    hdr.opCode = LSBE_NO_ERROR;
+
+    if (! xdr_encodeMsg(&xdrs2,
+                        (char *)&reply,
+                        &hdr,
+                        xdr_metricsInfoReply,
+                        0,
+                        NULL)) {
+        ls_syslog(LOG_ERR, "%s: xdr_encodeMsg() failed", __func__);
+        xdr_destroy(&xdrs2);
+        FREEUP(buf);
+        freeCollected(reply.metrics, reply.numMetrics);
+        errorBack(chfd, LSBE_XDR, from);
+        return -1;
+    }
+
+    cc = 0;
+    if (chanWrite_(chfd, buf, XDR_GETPOS(&xdrs2)) <= 0) {
+        ls_syslog(LOG_ERR, "%s: chanWrite %d bytes failed",
+                  __func__, XDR_GETPOS(&xdrs2));
+        cc = -1;
+    }
+
+    xdr_destroy(&xdrs2);
+    FREEUP(buf);
+    freeCollected(reply.metrics, reply.numMetrics);
+
+    return cc;
+}
+
+static void
+metricsBegin(void)
+{
+    shm->seq++;
+    __sync_synchronize();
+}
+
+static void
+metricsEnd(void)
+{
+    __sync_synchronize();
+    shm->seq++;
+}
+
+static void
+histAdd(struct metricsHist *h, LS_LONG_INT v)
+{
+    LS_LONG_INT b;
+    int i;
+
+    if (v < 0)
+        v = 0;
+
+    b = 1;
+    for (i = 0; i < METRIC_BUCKETS - 1 && v > b; i++)
+        b = b << 1;
+
+    h->buckets[i]++;
+    h->count++;
+    h->sum += v;
+}
+
+static LS_LONG_INT
+usecSince(struct timeval *t0)
+{
+    struct timeval t;
+
+    gettimeofday(&t, NULL);
+
+    return (LS_LONG_INT)(t.tv_sec - t0->tv_sec) * 1000000
+        + (t.tv_usec - t0->tv_usec);
+}
+
+/* metricsSnapshot()
+ *
+ * Copy the metrics from outside mbatchd, retry
+ * while mbatchd is updating them.
+ */
+static int
+metricsSnapshot(struct metricsShm *snap)
+{
+    unsigned int seq;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+
+        seq = shm->seq;
+        __sync_synchronize();
+        if (seq & 1) {
+            millisleep_(1);
+            continue;
+        }
+
+        memcpy(snap, shm, sizeof(struct metricsShm));
+        __sync_synchronize();
+
+        if (seq == shm->seq)
+            return 0;
+    }
+
+    return -1;
+}
+
+/* metricsCollect()
+ *
+ * Flatten a copy of the metrics in the reply
+ * format, return the number of metrics.
+ */
+static int
+metricsCollect(struct metricsShm *snap, struct mbdMetric **metrics)
+{
+    struct mbdMetric *v;
+    struct metricsHist *h;
+    char buf[MAXLINELEN];
+    int num;
+    int i;
+    int n;
+
+    num = 2 + NUM_TIMERS + PROF_CNT_nullfunc + HIST_LAST + NUM_REQS;
+    v = calloc(num, sizeof(struct mbdMetric));
+    if (v == NULL)
+        return -1;
+
+    n = 0;
+
+    v[n].name = strdup("mbd_sessions_total");
+    v[n].label = strdup("");
+    v[n].value = snap->sessions;
+    ++n;
+
+    v[n].name = strdup("mbd_jobs_started_total");
+    v[n].label = strdup("");
+    v[n].value = snap->jobsStarted;
+    ++n;
+
+    for (i = 0; i < NUM_TIMERS; i++) {
+        v[n].name = strdup("mbd_sched_timer_ms_total");
+        sprintf(buf, "timer=\"%s\"", timerNames[i]);
+        v[n].label = strdup(buf);
+        v[n].value = snap->timers[i];
+        ++n;
+    }
+
+    for (i = 0; i < PROF_CNT_nullfunc; i++) {
+        v[n].name = strdup("mbd_prof_counter_total");
+        sprintf(buf, "counter=\"%s\"", counters[i].cntDescr);
+        v[n].label = strdup(buf);
+        v[n].value = snap->counters[i];
+        ++n;
+    }
+
+    for (i = 0; i < HIST_LAST + NUM_REQS; i++) {
+
+        if (i < HIST_LAST) {
+            h = &snap->hists[i];
+            v[n].name = strdup(histNames[i]);
+            v[n].label = strdup("");
+        } else {
+            h = &snap->reqs[i - HIST_LAST];
+            if (h->count == 0)
+                continue;
+            v[n].name = strdup("mbd_request_service_us");
+            sprintf(buf, "request=\"%s\"", reqNames[i - HIST_LAST].name);
+            v[n].label = strdup(buf);
+        }
+
+        v[n].type = METRIC_HISTOGRAM;
+        v[n].value = h->sum;
+        v[n].count = h->count;
+        v[n].numBuckets = METRIC_BUCKETS;
+        v[n].buckets = calloc(METRIC_BUCKETS, sizeof(LS_LONG_INT));
+        if (v[n].buckets)
+            memcpy(v[n].buckets, h->buckets,
+                   METRIC_BUCKETS * sizeof(LS_LONG_INT));
+        ++n;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (v[i].name == NULL
+            || v[i].label == NULL
+            || (v[i].type == METRIC_HISTOGRAM && v[i].buckets == NULL)) {
+            freeCollected(v, n);
+            return -1;
+        }
+    }
+
+    *metrics = v;
+
+    return n;
+}
+
+static void
+freeCollected(struct mbdMetric *v, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        FREEUP(v[i].name);
+        FREEUP(v[i].label);
+        FREEUP(v[i].buckets);
+    }
+    FREEUP(v);
+}
+
+static int
+openMetricsSocket(const char *path)
+{
+    struct sockaddr_un sun;
+    int s;
+
+    if (strlen(path) >= sizeof(sun.sun_path)) {
+        ls_syslog(LOG_ERR, "\
+%s: MBD_METRICS_SOCKET <%s> in lsf.conf is too long, ignored",
+                  __func__, path);
+        return -1;
+    }
+
+    s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0) {
+        ls_syslog(LOG_ERR, "%s: socket() failed: %M", __func__);
+        return -1;
+    }
+
+    memset(&sun, 0, sizeof(struct sockaddr_un));
+    sun.sun_family = AF_UNIX;
+    strcpy(sun.sun_path, path);
+
+    /* The socket left by the previous mbatchd.
+     */
+    unlink(path);
+
+    if (bind(s, (struct sockaddr *)&sun, sizeof(struct sockaddr_un)) < 0
+        || listen(s, 16) < 0) {
+        ls_syslog(LOG_ERR, "%s: bind() %s failed: %M", __func__, path);
+        close(s);
+        return -1;
+    }
+
+    /* Local scrapers need not be root.
+     */
+    chmod(path, 0666);
+
+    return s;
+}
+
+/* metricsExporter()
+ *
+ * Main loop of the exporter, it never writes
+ * to the metrics.
+ */
+static void
+metricsExporter(int s, int p)
+{
+    struct pollfd fds[2];
+    int cc;
+    int i;
+
+    for (i = sysconf(_SC_OPEN_MAX); i >= 3; i--) {
+        if (i != s && i != p)
+            close(i);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGCHLD, SIG_DFL);
+
+    for (;;) {
+
+        fds[0].fd = s;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = p;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        cc = poll(fds, 2, -1);
+        if (cc < 0 && errno == EINTR)
+            continue;
+        if (cc < 0)
+            _exit(-1);
+
+        if (fds[1].revents)
+            _exit(0);
+
+        if (fds[0].revents & POLLIN) {
+            cc = accept(s, NULL, NULL);
+            if (cc >= 0)
+                metricsServe(cc);
+        }
+    }
+}
+
+/* metricsServe()
+ *
+ * The plain text exposition is written as soon as
+ * a client connects, an HTTP GET sent within a short
+ * time gets an HTTP reply so curl --unix-socket
+ * works as well.
+ */
+static void
+metricsServe(int s)
+{
+    struct metricsShm snap;
+    struct pollfd fds;
+    char buf[1024];
+    FILE *fp;
+    int http;
+    int cc;
+
+    http = FALSE;
+    fds.fd = s;
+    fds.events = POLLIN;
+    fds.revents = 0;
+    if (poll(&fds, 1, 100) > 0) {
+        cc = read(s, buf, sizeof(buf) - 1);
+        if (cc >= 4 && strncmp(buf, "GET ", 4) == 0)
+            http = TRUE;
+    }
+
+    if ((fp = fdopen(s, "w")) == NULL) {
+        close(s);
+        return;
+    }
+
+    if (http) {
+        fprintf(fp, "\
+HTTP/1.0 200 OK\r\n\
+Content-Type: text/plain; version=0.0.4\r\n\
+Connection: close\r\n\r\n");
+    }
+
+    if (metricsSnapshot(&snap) == 0)
+        metricsText(fp, &snap);
+
+    fclose(fp);
+}
+
+/* metricsText()
+ *
+ * Prometheus text format, the histogram buckets
+ * are cumulative there.
+ */
+static void
+metricsText(FILE *fp, struct metricsShm *snap)
+{
+    struct mbdMetric *v;
+    LS_LONG_INT n;
+    char *last;
+    char *sep;
+    int num;
+    int i;
+    int j;
+
+    if ((num = metricsCollect(snap, &v)) < 0)
+        return;
+
+    fprintf(fp, "\
+# TYPE mbd_start_time_seconds gauge\n\
+mbd_start_time_seconds %ld\n", (long)snap->startTime);
+
+    last = "";
+    for (i = 0; i < num; i++) {
+
+        if (strcmp(last, v[i].name) != 0) {
+            fprintf(fp, "# TYPE %s %s\n", v[i].name,
+                    v[i].type == METRIC_HISTOGRAM ? "histogram" : "counter");
+            last = v[i].name;
+        }
+
+        if (v[i].type == METRIC_COUNTER) {
+            if (v[i].label[0])
+                fprintf(fp, "%s{%s} %lld\n",
+                        v[i].name, v[i].label, (long long)v[i].value);
+            else
+                fprintf(fp, "%s %lld\n",
+                        v[i].name, (long long)v[i].value);
+            continue;
+        }
+
+        sep = v[i].label[0] ? "," : "";
+        n = 0;
+        for (j = 0; j < v[i].numBuckets; j++) {
+            n += v[i].buckets[j];
+            if (j < v[i].numBuckets - 1)
+                fprintf(fp, "%s_bucket{%s%sle=\"%lld\"} %lld\n",
+                        v[i].name, v[i].label, sep,
+                        1LL << j, (long long)n);
+            else
+                fprintf(fp, "%s_bucket{%s%sle=\"+Inf\"} %lld\n",
+                        v[i].name, v[i].label, sep, (long long)n);
+        }
+
+        if (v[i].label[0]) {
+            fprintf(fp, "%s_sum{%s} %lld\n",
+                    v[i].name, v[i].label, (long long)v[i].value);
+            fprintf(fp, "%s_count{%s} %lld\n",
+                    v[i].name, v[i].label, (long long)v[i].count);
+        } else {
+            fprintf(fp, "%s_sum %lld\n", v[i].name, (long long)v[i].value);
+            fprintf(fp, "%s_count %lld\n", v[i].name, (long long)v[i].count);
+        }
+    }
+
+    freeCollected(v, num);
+}
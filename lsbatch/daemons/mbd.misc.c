@@ -302,6 +302,7 @@ updSwitchJob (struct jData *jp, struct qData *qfp, struct qData *qtp,
         jp->jStatus |= JOB_STAT_RESERVE;
     }
 
+    jobIdxUpdate(jp);
 }
 
 
@@ -1319,6 +1320,7 @@ mbdDie(int sig)
     }
 
     log_mbdDie(sig);
+    commitEventLog();
 
     freeTclLsInfo(tclLsInfo, 0);
     freeTclInterp();
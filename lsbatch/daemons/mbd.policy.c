@@ -320,9 +320,10 @@ static void groupCandHostsInit(struct groupCandHosts *);
 static void inEligibleGroupsInit(int **, int);
 static void groupCands2CandPtr(int, struct groupCandHosts *,
                                int *, struct candHost **);
-static void jiter_init(LIST_T *);
-static struct jData *jiter_next_job(LIST_T *);
-static void jiter_fin(LIST_T *);
+static void jiter_init(void);
+static void jiter_add_job(struct jData *);
+static struct jData *jiter_next_job(void);
+static void jiter_fin(void);
 
 static bool_t lsbPtilePack = FALSE;
 
@@ -356,6 +357,11 @@ static int timePJobLimitOk;
 
 int timeCollectPendReason;
 
+/* Set by mbdsim to collect the timers and the
+ * counters of every completed session.
+ */
+void (*schedSessionHook)(struct schedTimers *);
+
 #define DUMP_TIMERS(fname)                                              \
     {                                                                   \
         if (logclass & LC_PERFM)                                        \
@@ -398,9 +404,34 @@ static bool_t  updateAccountsInQueue;
 
 static void resetSchedulerSession(void);
 
-/* Global as it is shared among few routines.
+/* The pending job index, global as it is shared
+ * among few routines. The storage is kept from one
+ * session to the next so after the first sessions
+ * building the index costs no memory allocation.
  */
-static struct _list *jRefList;
+static struct jRef *jRefs;
+static int numJRefs;
+static int sizeJRefs;
+static struct pendGroup *pendGroups;
+static int numPendGroups;
+static int sizePendGroups;
+static int curPendGroup;
+static struct pendBucket **pendBuckets;
+static int numPendBuckets;
+static int sizePendBuckets;
+static int pendStamp;
+
+static void jiter_reset(void);
+static void jiter_clear_buckets(void);
+static struct pendBucket *jiter_new_bucket(int, struct uData *,
+                                           struct qData *);
+static void jiter_add_bucket(struct pendBucket *, struct jRef *);
+static void jiter_activate_group(struct pendGroup *);
+static struct jData *jiter_fs_job(struct pendGroup *,
+                                  struct pendBucket *);
+static int first_cmp(const void *, const void *);
+static int rr_cmp(const void *, const void *);
+static void bucket_pos(void *, int);
 
 static int
 readyToDisp (struct jData *jpbw, int *numAvailSlots)
@@ -3062,6 +3093,14 @@ dispatch_it (struct jData *jp)
                         return FALSE;
                 }
 
+            case ERR_DISPATCH_DEFER:
+                /* The dispatch window of the host is full,
+                 * the job is tried again at the next session
+                 * and the host keeps its slots.
+                 */
+                jptr->newReason = PEND_SBD_JOB_QUOTA;
+                return FALSE;
+
             default:
                 jobStartError(jptr, reply);
                 return FALSE;
@@ -3202,6 +3241,7 @@ jobStarted(struct jData *jp, struct jobReply *jobReply)
     adjLsbLoad(jp, FALSE, TRUE);
 
     INC_CNT(PROF_CNT_numStartedJobsPerSession);
+    metricsJobStarted();
 
 }
 
@@ -3561,6 +3601,7 @@ getRawLsbLoad(int ncandidates, struct candHost *hosts)
         for (i = 0; i < num; i++) {
             if ((hDataPtr = getHostData (newHostLoad[i].hostName)) != NULL) {
                 hDataPtr->lsbLoad[R15S] = newHostLoad[i].li[R15S];
+                invalidateHostSelectCache(hDataPtr);
             }
         }
     }
@@ -4149,14 +4190,13 @@ scheduleAndDispatchJobs(void)
     int scheduleTime;
     sTab hashSearchPtr;
     hEnt *hashEntryPtr;
-    struct jRef *jR;
     struct jData *jPtr;
 
     now_disp = time(NULL);
     ZERO_OUT_TIMERS();
 
-    if (jRefList == NULL)
-        jRefList = listCreate("job reference list");
+    if (mSchedStage == 0)
+        metricsSessionBegin();
 
     if (mSchedStage == 0) {
 
@@ -4175,6 +4215,8 @@ scheduleAndDispatchJobs(void)
             }
         }
 
+        jiter_reset();
+
         for (i = MJL; i <= PJL; i++) {
 
             for (jPtr = jDataList[i]->back;
@@ -4199,11 +4241,7 @@ scheduleAndDispatchJobs(void)
                 if (! jobIsReady(jPtr))
                     continue;
 
-                jR = calloc(1, sizeof(struct jRef));
-                jR->job = jPtr;
-
-                listInsertEntryAtFront(jRefList,
-                                       (struct _listEntry *)jR);
+                jiter_add_job(jPtr);
             }
         }
 
@@ -4364,7 +4402,7 @@ scheduleAndDispatchJobs(void)
                   __func__, numQUsable, timeGetQUsable);
     }
 
-    if (LIST_NUM_ENTRIES(jRefList) == 0) {
+    if (numJRefs == 0) {
         ls_syslog(LOG_DEBUG, "\
 %s: no pending or migrating to jobs to schedule at the moment.", __func__);
         resetSchedulerSession();
@@ -4385,11 +4423,11 @@ scheduleAndDispatchJobs(void)
     ZERO_OUT_TIMERS();
     /* Initialize the job iterator
      */
-    jiter_init(jRefList);
+    jiter_init();
 
     /* Return the next priority job
      */
-    while ((jPtr = jiter_next_job(jRefList))) {
+    while ((jPtr = jiter_next_job())) {
 
         TIMEVAL(0, scheduleAJob(jPtr, TRUE, TRUE), tmpVal);
 
@@ -4427,7 +4465,7 @@ scheduleAndDispatchJobs(void)
                   __func__, schedSeqNo, scheduleTime);
     }
 
-    jiter_fin(jRefList);
+    jiter_fin();
 
     ++schedSeqNo;
 
@@ -4435,6 +4473,23 @@ scheduleAndDispatchJobs(void)
         schedSeqNo = 0;
     }
 
+    {
+        struct schedTimers t;
+
+        t.getQUsable = timeGetQUsable;
+        t.getCandHosts = timeGetCandHosts;
+        t.getJUsable = timeGetJUsable;
+        t.readyToDisp = timeReadyToDisp;
+        t.cntUQSlots = timeCntUQSlots;
+        t.fsQelectPendJob = timeFSQelectPendJob;
+        t.pickAJob = timePickAJob;
+        t.scheduleAJob = timeScheduleAJob;
+        t.collectPendReason = timeCollectPendReason;
+        metricsSessionEnd(&t);
+        if (schedSessionHook)
+            (*schedSessionHook)(&t);
+    }
+
     DUMP_TIMERS(__func__);
     DUMP_CNT();
     RESET_CNT();
@@ -4442,139 +4497,444 @@ scheduleAndDispatchJobs(void)
     return 0;
 }
 
-/* jiter_init()
+/* jiter_reset()
+ *
+ * Prepare the pending job index for a new session,
+ * there can be at most as many candidates as the
+ * jobs in the pending and migrating lists.
  */
 static void
-jiter_init(LIST_T *jRefList)
+jiter_reset(void)
 {
-    /* The jRefList is initialized at the start of
-     * scheduleAndDispatch() function where we iterate
-     * on PJL already so don't do it twice but keep
-     * this initializer.
+    int num;
+
+    num = LIST_NUM_ENTRIES((LIST_T *)jDataList[MJL])
+        + LIST_NUM_ENTRIES((LIST_T *)jDataList[PJL]);
+
+    if (num > sizeJRefs) {
+        FREEUP(jRefs);
+        sizeJRefs = num + num/2;
+        jRefs = my_calloc(sizeJRefs, sizeof(struct jRef), __func__);
+        if (jRefs == NULL)
+            mbdDie(MASTER_MEM);
+    }
+
+    jiter_clear_buckets();
+    numJRefs = 0;
+    numPendGroups = 0;
+    numPendBuckets = 0;
+    curPendGroup = 0;
+    /* Buckets referenced by users and queues
+     * in previous sessions become stale.
      */
+    ++pendStamp;
 }
 
-/* jiter_fin()
+/* jiter_clear_buckets()
+ *
+ * Empty the fairshare lists of the buckets in use,
+ * their entries point into jRefs which is reused
+ * or freed by the next session.
  */
 static void
-jiter_fin(LIST_T *jRefList)
+jiter_clear_buckets(void)
 {
+    int cc;
+
+    for (cc = 0; cc < numPendBuckets; cc++) {
+        if (pendBuckets[cc]->jRefList == NULL)
+            continue;
+        while (listPop(pendBuckets[cc]->jRefList))
+            ;
+    }
+}
+
+/* jiter_add_job()
+ *
+ * Add a candidate job to the pending job index.
+ * Jobs are added in the order of the pending lists
+ * so a new priority group starts every time the
+ * queue priority or the job priority changes.
+ */
+static void
+jiter_add_job(struct jData *jPtr)
+{
+    struct pendGroup *g;
+    struct pendBucket *b;
+    struct qData *qPtr;
     struct jRef *jR;
-    struct jRef *jR0;
 
-    /* Free the pending reference list.
+    qPtr = jPtr->qPtr;
+    g = NULL;
+    if (numPendGroups > 0)
+        g = &pendGroups[numPendGroups - 1];
+
+    if (g == NULL
+        || g->qPriority != qPtr->priority
+        || g->jobPriority != jPtr->jobPriority) {
+
+        if (numPendGroups == sizePendGroups) {
+            sizePendGroups = sizePendGroups ? 2 * sizePendGroups : 16;
+            pendGroups = realloc(pendGroups,
+                                 sizePendGroups * sizeof(struct pendGroup));
+            if (pendGroups == NULL)
+                mbdDie(MASTER_MEM);
+            memset(&pendGroups[numPendGroups], 0,
+                   (sizePendGroups - numPendGroups)
+                   * sizeof(struct pendGroup));
+        }
+        g = &pendGroups[numPendGroups];
+        ++numPendGroups;
+        g->qPriority = qPtr->priority;
+        g->jobPriority = jPtr->jobPriority;
+        if (g->first == NULL) {
+            g->first = heap_make(16, first_cmp, bucket_pos);
+            g->rr = heap_make(64, rr_cmp, bucket_pos);
+        }
+        heap_clear(g->first);
+        heap_clear(g->rr);
+    }
+
+    jR = &jRefs[numJRefs];
+    jR->forw = jR->back = jR->next = NULL;
+    jR->job = jPtr;
+    jR->seq = numJRefs;
+    jR->group = numPendGroups - 1;
+    ++numJRefs;
+
+    if (qPtr->qAttrib & Q_ATTRIB_FAIRSHARE) {
+        /* One bucket per queue for the whole session
+         * as the fairshare scheduler elects jobs
+         * across priority groups.
+         */
+        b = qPtr->pendBucket;
+        if (b == NULL || b->stamp != pendStamp) {
+            b = jiter_new_bucket(PEND_BUCKET_FS, NULL, qPtr);
+            qPtr->pendBucket = b;
+            heap_insert(g->first, b);
+        }
+        listInsertEntryAtFront(b->jRefList, (LIST_ENTRY_T *)jR);
+        return;
+    }
+
+    if (! (qPtr->qAttrib & Q_ATTRIB_ROUND_ROBIN)) {
+        b = qPtr->pendBucket;
+        if (b == NULL
+            || b->stamp != pendStamp
+            || b->group != jR->group) {
+            b = jiter_new_bucket(PEND_BUCKET_FCFS, NULL, qPtr);
+            qPtr->pendBucket = b;
+            jiter_add_bucket(b, jR);
+            heap_insert(g->first, b);
+            return;
+        }
+        jiter_add_bucket(b, jR);
+        return;
+    }
+
+    b = jPtr->uPtr->pendBucket;
+    if (b == NULL
+        || b->stamp != pendStamp
+        || b->group != jR->group) {
+        b = jiter_new_bucket(PEND_BUCKET_RR, jPtr->uPtr, qPtr);
+        jPtr->uPtr->pendBucket = b;
+        jiter_add_bucket(b, jR);
+        heap_insert(g->rr, b);
+        return;
+    }
+    jiter_add_bucket(b, jR);
+}
+
+/* jiter_new_bucket()
+ */
+static struct pendBucket *
+jiter_new_bucket(int type, struct uData *uPtr, struct qData *qPtr)
+{
+    struct pendBucket *b;
+    int cc;
+
+    if (numPendBuckets == sizePendBuckets) {
+        sizePendBuckets = sizePendBuckets ? 2 * sizePendBuckets : 64;
+        pendBuckets = realloc(pendBuckets,
+                              sizePendBuckets * sizeof(struct pendBucket *));
+        if (pendBuckets == NULL)
+            mbdDie(MASTER_MEM);
+        for (cc = numPendBuckets; cc < sizePendBuckets; cc++) {
+            pendBuckets[cc] = my_calloc(1, sizeof(struct pendBucket),
+                                        __func__);
+            if (pendBuckets[cc] == NULL)
+                mbdDie(MASTER_MEM);
+        }
+    }
+
+    b = pendBuckets[numPendBuckets];
+    ++numPendBuckets;
+
+    b->type = type;
+    b->stamp = pendStamp;
+    b->group = numPendGroups - 1;
+    b->hpos = -1;
+    b->uPtr = uPtr;
+    b->qPtr = qPtr;
+    b->numRUN = uPtr ? uPtr->numRUN : 0;
+    b->head = b->tail = NULL;
+
+    if (type == PEND_BUCKET_FS && b->jRefList == NULL)
+        b->jRefList = listCreate("fairshare job reference list");
+    /* A pooled bucket may come from a session
+     * that did not get to jiter_fin().
      */
-    for (jR = (struct jRef *)jRefList->back;
-         jR != (void *)jRefList; ) {
+    if (b->jRefList) {
+        while (listPop(b->jRefList))
+            ;
+    }
+
+    return b;
+}
+
+/* jiter_add_bucket()
+ */
+static void
+jiter_add_bucket(struct pendBucket *b, struct jRef *jR)
+{
+    if (b->tail)
+        b->tail->next = jR;
+    else
+        b->head = jR;
+    b->tail = jR;
+}
+
+/* jiter_activate_group()
+ *
+ * The number of running jobs of the round robin
+ * users may have changed since the index was built
+ * or since the session was interrupted, refresh
+ * the keys and rebuild the round robin heap.
+ */
+static void
+jiter_activate_group(struct pendGroup *g)
+{
+    struct pendBucket *b;
+    int cc;
 
-        jR0 = jR->back;
-        listRemoveEntry(jRefList, (LIST_ENTRY_T *)jR);
-        free(jR);
-        jR = jR0;
+    for (cc = 0; cc < HEAP_NUM_ENTRIES(g->rr); cc++) {
+        b = g->rr->v[cc];
+        b->numRUN = b->uPtr->numRUN;
     }
+    heap_build(g->rr);
+}
+
+/* jiter_init()
+ */
+static void
+jiter_init(void)
+{
+    /* The index is built at the start of
+     * scheduleAndDispatch() function where we iterate
+     * on PJL already so don't do it twice but keep
+     * this initializer to refresh the current group
+     * when an interrupted session resumes.
+     */
+    if (curPendGroup < numPendGroups)
+        jiter_activate_group(&pendGroups[curPendGroup]);
+}
 
+/* jiter_fin()
+ */
+static void
+jiter_fin(void)
+{
+    jiter_clear_buckets();
+    numJRefs = 0;
+    numPendGroups = 0;
+    numPendBuckets = 0;
+    curPendGroup = 0;
+    ++pendStamp;
 }
 
 /* jiter_next_job()
  *
- * The key property of the reference list is that
+ * The key property of the job iterator is that
  * each job is looked at the scheduler only once
  * no matter if the job is dispatched or not.
+ *
+ * Within a priority group the first fcfs or fairshare
+ * job in pending list order goes first, if there are
+ * none the job of the round robin user with the least
+ * running jobs goes next, the first in pending list
+ * order breaks the tie. Each pick costs O(log n).
  */
 static struct jData *
-jiter_next_job(LIST_T *jRefList)
+jiter_next_job(void)
 {
-    int min;
-    struct jRef *jR;
-    struct jRef *jR0;
-    struct jData *jPtr0;
+    struct pendGroup *g;
+    struct pendBucket *b;
     struct jData *jPtr;
+    struct jRef *jR;
 
-    min = INT32_MAX;
-    jR0 = NULL;
+    while (curPendGroup < numPendGroups) {
 
-    /* Everytime for this loop we return one
-     * job and then everytime we reenter we
-     * restart from the list head, at each call
-     * the list keeps shrinking regardless if
-     * job goes or not.
-     */
-    for (jR = (struct jRef *)jRefList->back;
-         jR != (void *)jRefList;
-         jR = (struct jRef *)jR->back) {
+        g = &pendGroups[curPendGroup];
 
-        /* Get the highest priority job
-         */
-        jPtr = jR->job;
-        assert(jPtr->uPtr->numPEND > 0);
+        if ((b = HEAP_TOP(g->first))) {
 
-        /* Found a fairshare queue let's have the slot
-         * scheduler to pick the job based on its
-         * policy. Remove the reference from jRefList
-         * for the elected job.
-         */
-        if (jPtr->qPtr->qAttrib & Q_ATTRIB_FAIRSHARE) {
-            struct qData *qPtr = jPtr->qPtr;
-            (*qPtr->fsSched->fs_elect_job)(qPtr,
-                                             jRefList,
-                                             &jR0);
-            if (jR0) {
-                listRemoveEntry(jRefList,
-                                (LIST_ENTRY_T *)jR0);
-                jPtr0 = jR0->job;
-                free(jR0);
-                return jPtr0;
+            if (b->type == PEND_BUCKET_FS) {
+                jPtr = jiter_fs_job(g, b);
+                if (jPtr == NULL)
+                    continue;
+                return jPtr;
             }
-            /* No more jobs from this fairshare queue
-             * so finalize the local plugin data for this
-             * session.
-             */
-            (*qPtr->fsSched->fs_fin_sched_session)(qPtr);
-            continue;
-        }
 
-        if (! (jPtr->qPtr->qAttrib & Q_ATTRIB_ROUND_ROBIN)) {
             /* this is a fcfs queue so just dequeue the first
              * job on the priority list and try to run it.
              */
-            listRemoveEntry(jRefList,
-                            (struct _listEntry *)jR);
-            free(jR);
+            jR = b->head;
+            b->head = jR->next;
+            if (b->head == NULL)
+                heap_pop(g->first);
+            else
+                heap_update(g->first, b->hpos);
+
+            jPtr = jR->job;
+            assert(jPtr->uPtr->numPEND > 0);
             return jPtr;
         }
 
-        if (jPtr->uPtr->numRUN < min) {
+        /* Users whose jobs have been dispatched have
+         * more jobs running than their key says, while
+         * the session runs the keys can only grow so
+         * it is enough to refresh the top of the heap.
+         */
+        while ((b = HEAP_TOP(g->rr))
+               && b->numRUN != b->uPtr->numRUN) {
+            b->numRUN = b->uPtr->numRUN;
+            heap_update(g->rr, 0);
+        }
+
+        if (b) {
             /* get the job whose user has
              * the least running jobs.
              */
-            min = jPtr->uPtr->numRUN;
-            jR0 = jR;
-        }
+            jR = b->head;
+            b->head = jR->next;
+            if (b->head == NULL)
+                heap_pop(g->rr);
+            else
+                heap_update(g->rr, b->hpos);
 
-        /* Get the next job and test if the
-         * current queue eneded or not.
-         */
-        jPtr0 = jR->back->job;
-        if (jR->back == (void *)jRefList
-            || jPtr->jobPriority != jPtr0->jobPriority
-            || jPtr->qPtr->priority != jPtr0->qPtr->priority) {
-            /* either at the end of the list, in which case
-             * jPtr0 is bogus, or the job belongs to another
-             * priority group or we just hit another queue
-             * so we have to give to the dispatcher the current
-             * highest priority job.
-             */
-            listRemoveEntry(jRefList, (struct _listEntry *)jR0);
-            jPtr = jR0->job;
-            free(jR0);
+            jPtr = jR->job;
+            assert(jPtr->uPtr->numPEND > 0);
             return jPtr;
         }
 
-    } /* for (jRef = jRefList->back; ...;...) */
+        /* Done with this priority group.
+         */
+        ++curPendGroup;
+        if (curPendGroup < numPendGroups)
+            jiter_activate_group(&pendGroups[curPendGroup]);
+    }
 
     return NULL;
 }
 
+/* jiter_fs_job()
+ *
+ * Found a fairshare queue let's have the slot
+ * scheduler to pick the job based on its
+ * policy. Remove the reference from the queue
+ * list for the elected job.
+ */
+static struct jData *
+jiter_fs_job(struct pendGroup *g, struct pendBucket *b)
+{
+    struct qData *qPtr;
+    struct jRef *jR0;
+    struct jRef *jR;
+
+    qPtr = b->qPtr;
+    jR0 = NULL;
+    (*qPtr->fsSched->fs_elect_job)(qPtr, b->jRefList, &jR0);
+
+    if (jR0 == NULL) {
+        /* No more jobs from this fairshare queue
+         * so finalize the local plugin data for this
+         * session.
+         */
+        heap_rm(g->first, b->hpos);
+        (*qPtr->fsSched->fs_fin_sched_session)(qPtr);
+        while ((jR = (struct jRef *)listPop(b->jRefList)))
+            ;
+        return NULL;
+    }
+
+    listRemoveEntry(b->jRefList, (LIST_ENTRY_T *)jR0);
+
+    heap_rm(g->first, b->hpos);
+    if (LIST_NUM_ENTRIES(b->jRefList) > 0) {
+        /* The queue goes back in the priority
+         * group of its first remaining job.
+         */
+        jR = (struct jRef *)b->jRefList->back;
+        heap_insert(pendGroups[jR->group].first, b);
+    }
+
+    assert(jR0->job->uPtr->numPEND > 0);
+    return jR0->job;
+}
+
+/* first_cmp()
+ *
+ * Order fcfs and fairshare buckets by the position
+ * of their first job in the pending list.
+ */
+static int
+first_cmp(const void *x, const void *y)
+{
+    const struct pendBucket *b1 = x;
+    const struct pendBucket *b2 = y;
+    int s1;
+    int s2;
+
+    if (b1->type == PEND_BUCKET_FS)
+        s1 = ((struct jRef *)b1->jRefList->back)->seq;
+    else
+        s1 = b1->head->seq;
+
+    if (b2->type == PEND_BUCKET_FS)
+        s2 = ((struct jRef *)b2->jRefList->back)->seq;
+    else
+        s2 = b2->head->seq;
+
+    return s1 - s2;
+}
+
+/* rr_cmp()
+ *
+ * Order round robin users by the number of running
+ * jobs, then by the position of their first job.
+ */
+static int
+rr_cmp(const void *x, const void *y)
+{
+    const struct pendBucket *b1 = x;
+    const struct pendBucket *b2 = y;
+
+    if (b1->numRUN != b2->numRUN)
+        return b1->numRUN - b2->numRUN;
+
+    return b1->head->seq - b2->head->seq;
+}
+
+/* bucket_pos()
+ */
+static void
+bucket_pos(void *e, int i)
+{
+    struct pendBucket *b = e;
+
+    b->hpos = i;
+}
+
 static int
 checkIfJobIsReady(struct jData *jp)
 {
@@ -6189,21 +6549,11 @@ totalBackfillSlots(LIST_T *theBackfilleeList)
 static void
 resetSchedulerSession(void)
 {
-    struct jRef *jR;
-    struct jRef *jR0;
-
     copyReason();
     mSchedStage = 0;
     clearJobReason();
 
-    for (jR = (struct jRef *)jRefList->back;
-         jR != (void *)jRefList; ) {
-
-        jR0 = jR->back;
-        listRemoveEntry(jRefList, (LIST_ENTRY_T *)jR);
-        free(jR);
-        jR = jR0;
-    }
+    jiter_fin();
 
     DUMP_TIMERS(__func__);
     DUMP_CNT();
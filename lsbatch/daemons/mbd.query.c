@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mbd.h"
+
+/* Info queries are served by a pool of reader
+ * processes forked from mbatchd. The copy on write
+ * image of each reader is a read only snapshot of
+ * the scheduler state at the time the pool was
+ * published, so the main loop neither forks per
+ * query nor blocks on the clients.
+ *
+ * mbatchd passes the client socket and the request
+ * it has already read to a reader over a unix
+ * socketpair. The readers of a pool are forked one
+ * at a time as the queries arrive, so a pool that
+ * serves one query costs one fork. A pool is retired
+ * when the state changes, at most once every
+ * MBD_QUERY_MAX_AGE seconds, 5 by default, so that
+ * a busy cluster does not fork a reader per query
+ * and a quiet one keeps its readers up to the
+ * scheduling interval. The retired readers drain the
+ * requests they have been given and exit when they
+ * see the end of their socketpair. A new pool is
+ * published by the next query.
+ */
+#define QUERY_MSG_MAX (64 * 1024)
+#define DEF_QUERY_MAX_AGE 5
+
+struct queryReader {
+    int     sock;
+    pid_t   pid;
+};
+
+struct queryMsg {
+    struct sockaddr_in  from;
+};
+
+static struct queryReader *readers;
+static int numReaders;
+static int nextReader;
+static int published;
+static long snapLogSeq;
+static time_t snapTime;
+static int maxAge = DEF_QUERY_MAX_AGE;
+
+static void publishQuerySnapshot(void);
+static void retireQuerySnapshot(void);
+static int forkQueryReader(struct queryReader *);
+static void queryReader(int);
+static void serveQuery(int, XDR *, struct sockaddr_in *, struct LSFHeader *);
+
+/* initQuerySnapshot()
+ *
+ * MBD_QUERY_READERS in lsf.conf is the max number
+ * of reader processes, 0 or unset keeps forking one
+ * mbatchd per query. MBD_QUERY_MAX_AGE is how many
+ * seconds the readers may answer from an image that
+ * misses the latest events, 0 retires them at the
+ * first logged event.
+ */
+void
+initQuerySnapshot(void)
+{
+    int n;
+    int i;
+
+    if (daemonParams[MBD_QUERY_MAX_AGE].paramValue != NULL) {
+        maxAge = atoi(daemonParams[MBD_QUERY_MAX_AGE].paramValue);
+        if (maxAge < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: MBD_QUERY_MAX_AGE <%s> in lsf.conf is invalid, using %d",
+                      __func__, daemonParams[MBD_QUERY_MAX_AGE].paramValue,
+                      DEF_QUERY_MAX_AGE);
+            maxAge = DEF_QUERY_MAX_AGE;
+        }
+    } else {
+        maxAge = DEF_QUERY_MAX_AGE;
+    }
+
+    if (daemonParams[MBD_QUERY_READERS].paramValue == NULL)
+        return;
+
+    n = atoi(daemonParams[MBD_QUERY_READERS].paramValue);
+    if (n < 0 || n > 64) {
+        ls_syslog(LOG_ERR, "\
+%s: MBD_QUERY_READERS <%s> in lsf.conf is invalid, not using readers",
+                  __func__, daemonParams[MBD_QUERY_READERS].paramValue);
+        return;
+    }
+
+    if (n == 0 || numReaders > 0)
+        return;
+
+    readers = my_calloc(n, sizeof(struct queryReader), __func__);
+    for (i = 0; i < n; i++) {
+        readers[i].sock = -1;
+        readers[i].pid = -1;
+    }
+    numReaders = n;
+}
+
+/* querySnapshotReq()
+ *
+ * Can the request be answered by a reader.
+ */
+int
+querySnapshotReq(mbdReqType req)
+{
+    if (numReaders == 0)
+        return 0;
+
+    if (req == BATCH_JOB_INFO
+        || req == BATCH_QUE_INFO
+        || req == BATCH_HOST_INFO
+        || req == BATCH_GRP_INFO
+        || req == BATCH_RESOURCE_INFO
+        || req == BATCH_PARAM_INFO
+        || req == BATCH_USER_INFO) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/* querySnapshotSend()
+ *
+ * Hand the client and its request to a reader,
+ * the caller closes its own copy of the client.
+ * Return -1 if no reader could take it so that
+ * the caller serves the request itself.
+ */
+int
+querySnapshotSend(int chfd, struct sockaddr_in *from, struct Buffer *buf)
+{
+    struct queryMsg qm;
+    struct msghdr msg;
+    struct iovec iov[2];
+    struct cmsghdr *cmsg;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    int s;
+    int n;
+    int cc;
+
+    if (buf->len > QUERY_MSG_MAX)
+        return -1;
+
+    if (!published)
+        publishQuerySnapshot();
+
+    memset(&qm, 0, sizeof(struct queryMsg));
+    memcpy(&qm.from, from, sizeof(struct sockaddr_in));
+
+    iov[0].iov_base = &qm;
+    iov[0].iov_len = sizeof(struct queryMsg);
+    iov[1].iov_base = buf->data;
+    iov[1].iov_len = buf->len;
+
+    s = chanSock_(chfd);
+    for (n = 0; n < numReaders; n++) {
+        struct queryReader *r;
+
+        r = &readers[nextReader];
+        nextReader = (nextReader + 1) % numReaders;
+
+        /* Not forked yet in this pool.
+         */
+        if (r->pid < 0
+            && forkQueryReader(r) < 0)
+            break;
+        if (r->sock < 0)
+            continue;
+
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &s, sizeof(int));
+
+        cc = sendmsg(r->sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (cc >= 0)
+            return 0;
+
+        /* This reader has a backlog, try
+         * the next one.
+         */
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            continue;
+
+        ls_syslog(LOG_ERR, "\
+%s: sendmsg() to reader %d failed: %M", __func__, r->pid);
+        close(r->sock);
+        r->sock = -1;
+    }
+
+    return -1;
+}
+
+/* checkQuerySnapshot()
+ *
+ * Called once per pass of the main loop, retire
+ * the readers if events were logged since they
+ * were published and the pool is older than
+ * MBD_QUERY_MAX_AGE, or if their image is older
+ * than a scheduling interval since the host loads
+ * have been refreshed meanwhile.
+ */
+void
+checkQuerySnapshot(void)
+{
+    if (!published)
+        return;
+
+    if ((eventLogSeq() != snapLogSeq && now - snapTime >= maxAge)
+        || now - snapTime >= msleeptime)
+        retireQuerySnapshot();
+}
+
+/* retireQuerySnapshot()
+ *
+ * Close the socketpairs, the readers answer what
+ * they have been given and exit.
+ */
+static void
+retireQuerySnapshot(void)
+{
+    int i;
+
+    if (!published)
+        return;
+
+    for (i = 0; i < numReaders; i++) {
+        if (readers[i].sock >= 0)
+            close(readers[i].sock);
+        readers[i].sock = -1;
+        readers[i].pid = -1;
+    }
+
+    published = FALSE;
+}
+
+/* publishQuerySnapshot()
+ *
+ * Start a new pool, its readers are forked
+ * by querySnapshotSend() when needed.
+ */
+static void
+publishQuerySnapshot(void)
+{
+    published = TRUE;
+    snapLogSeq = eventLogSeq();
+    snapTime = now;
+
+    if (logclass & LC_COMM)
+        ls_syslog(LOG_DEBUG, "\
+%s: published readers log seq %ld", __func__, snapLogSeq);
+}
+
+/* forkQueryReader()
+ *
+ * Fork a reader of the current pool, its image
+ * is the state of mbatchd now. A reader that
+ * could not be forked is not tried again in
+ * this pool.
+ */
+static int
+forkQueryReader(struct queryReader *r)
+{
+    int sv[2];
+    pid_t pid;
+
+    r->pid = 0;
+    r->sock = -1;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+        ls_syslog(LOG_ERR, "%s: socketpair() failed: %M", __func__);
+        return -1;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        ls_syslog(LOG_ERR, "%s: fork() failed: %M", __func__);
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        closeExceptFD(sv[1]);
+        queryReader(sv[1]);
+        _exit(0);
+    }
+
+    close(sv[1]);
+    io_nonblock_(sv[0]);
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    r->sock = sv[0];
+    r->pid = pid;
+
+    if (logclass & LC_COMM)
+        ls_syslog(LOG_DEBUG, "\
+%s: forked reader %d log seq %ld", __func__, pid, snapLogSeq);
+
+    return 0;
+}
+
+/* queryReader()
+ *
+ * Main loop of a reader, it never writes back
+ * to the state it inherited from mbatchd. Use
+ * _exit() as the inherited stdio buffers belong
+ * to mbatchd.
+ */
+static void
+queryReader(int sock)
+{
+    struct queryMsg qm;
+    struct msghdr msg;
+    struct iovec iov[2];
+    struct cmsghdr *cmsg;
+    struct LSFHeader reqHdr;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    char *data;
+    XDR xdrs;
+    int fd;
+    int cc;
+    int s;
+
+    data = my_malloc(QUERY_MSG_MAX, __func__);
+
+    for (;;) {
+
+        iov[0].iov_base = &qm;
+        iov[0].iov_len = sizeof(struct queryMsg);
+        iov[1].iov_base = data;
+        iov[1].iov_len = QUERY_MSG_MAX;
+
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+
+        cc = recvmsg(sock, &msg, 0);
+        if (cc < 0 && errno == EINTR)
+            continue;
+        if (cc <= 0)
+            _exit(0);
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL
+            || cmsg->cmsg_type != SCM_RIGHTS
+            || cc < (int)sizeof(struct queryMsg))
+            continue;
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+        s = chanOpenSock_(fd, CHAN_OP_RAW);
+        if (s < 0) {
+            close(fd);
+            continue;
+        }
+
+        now = time(NULL);
+        xdrmem_create(&xdrs, data, cc - sizeof(struct queryMsg), XDR_DECODE);
+        if (xdr_LSFHeader(&xdrs, &reqHdr))
+            serveQuery(s, &xdrs, &qm.from, &reqHdr);
+        else
+            ls_syslog(LOG_ERR, "%s: xdr_LSFHeader() failed", __func__);
+
+        xdr_destroy(&xdrs);
+        chanClose_(s);
+    }
+}
+
+static void
+serveQuery(int s,
+           XDR *xdrs,
+           struct sockaddr_in *from,
+           struct LSFHeader *reqHdr)
+{
+    switch (reqHdr->opCode) {
+        case BATCH_USER_INFO:
+            TIMEIT(0, do_userInfoReq(xdrs, s, from, reqHdr),"do_userInfoReq()");
+            break;
+        case BATCH_PARAM_INFO:
+            TIMEIT(0, do_paramInfoReq(xdrs, s, from, reqHdr),"do_paramInfoReq()");
+            break;
+        case BATCH_GRP_INFO:
+            TIMEIT(3, do_groupInfoReq(xdrs, s, from, reqHdr),"do_groupInfoReq()");
+            break;
+        case BATCH_QUE_INFO:
+            TIMEIT(3, do_queueInfoReq(xdrs, s, from, reqHdr),"do_queueInfoReq()");
+            break;
+        case BATCH_JOB_INFO:
+            TIMEIT(3, do_jobInfoReq(xdrs, s, from, reqHdr, schedule),"do_jobInfoReq()");
+            break;
+        case BATCH_HOST_INFO:
+            TIMEIT(3, do_hostInfoReq(xdrs, s, from, reqHdr),"do_hostInfoReq()");
+            break;
+        case BATCH_RESOURCE_INFO:
+            TIMEIT(3, do_resourceInfoReq(xdrs, s, from, reqHdr),"do_resourceInfoReq()");
+            break;
+        default:
+            errorBack(s, LSBE_PROTOCOL, from);
+            break;
+    }
+}
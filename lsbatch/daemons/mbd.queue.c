@@ -443,6 +443,11 @@ checkQueues(struct infoReq *queueInfoReqPtr,
                 qRep->preemption = strdup("");
             }
 
+            if (qp->affinity)
+                qRep->affinity = strdup(qp->affinity);
+            else
+                qRep->affinity = strdup("");
+
             queueInfoReplyPtr->numQueues++;
         }
 
@@ -746,6 +751,7 @@ freeQueueInfoReply(struct queueInfoReply *reply, char *freeAll)
         FREEUP(reply->queues[i].chkpntDir);
         _free_(reply->queues[i].saccts);
         _free_(reply->queues[i].preemption);
+        _free_(reply->queues[i].affinity);
     }
     FREEUP(reply->queues);
 }
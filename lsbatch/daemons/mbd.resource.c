@@ -64,6 +64,7 @@ getLsbResourceInfo (void)
     }
     if (numResources > 0)
         freeSharedResource();
+    invalidateSelectCache();
     initHostInstances (numRes);
     for (i = 0; i < numRes; i++)
         addSharedResource(&resourceInfo[i]);
@@ -414,6 +415,8 @@ resetSharedResource(void)
     int i;
     int j;
 
+    invalidateSelectCache();
+
     for (i = 0; i < numResources; i++) {
 
 	for (j = 0; j < sharedResources[i]->numInstances; j++) {
@@ -466,6 +469,8 @@ updSharedResourceByRUNJob(const struct jData* jp)
     if (resAssign == 0)
         return;
 
+    invalidateSelectCache();
+
     duration = (float) resValPtr->duration;
     decay = resValPtr->decay;
     if (resValPtr->duration != INFINIT_INT && (duration - jp->runTime <= 0)){
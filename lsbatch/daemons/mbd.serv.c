@@ -18,6 +18,8 @@
  *
  */
 
+#include <poll.h>
+#include <sys/uio.h>
 #include "mbd.h"
 #include "fairshare.h"
 
@@ -31,8 +33,31 @@ extern  bool_t xdr_resourceInfoReply(XDR *, struct resourceInfoReply *,
                                      struct LSFHeader *);
 extern bool_t xdr_resourceInfoReq(XDR *, struct resourceInfoReq *,
                                   struct LSFHeader *);
-static int packJgrpInfo(struct jgTreeNode *, int, char **, int, int);
-static int packJobInfo(struct jData *, int, char **, int, int, int);
+
+/* The job info replies are packed back to back in
+ * a buffer that is written with writev() when it
+ * fills up, the jobInfoHead goes out with the first
+ * batch of jobs.
+ */
+#define JOBINFO_STREAM_SIZE (1024 * 1024)
+#define JOBINFO_STREAM_TIMEOUT 60
+
+struct jobStream {
+    int     sock;
+    char    *buf;
+    int     size;
+    int     len;
+    char    *head;
+    int     headLen;
+};
+
+static int packJgrpInfo(struct jgTreeNode *, int, struct jobStream *,
+                        int, int);
+static int packJobInfo(struct jData *, int, struct jobStream *,
+                       int, int, int);
+static int packJobBrief(struct jData *, int, struct jobStream *, int);
+static int streamReserve(struct jobStream *, int);
+static int streamFlush(struct jobStream *);
 static void initSubmit(int *, struct submitReq *, struct submitMbdReply *);
 static int sendBack(int, struct submitReq *, struct submitMbdReply *, int);
 static void addPendSigEvent(struct sbdNode *);
@@ -148,8 +173,8 @@ do_jobInfoReq(XDR *xdrs,
               struct LSFHeader *reqHdr,
               int schedule)
 {
+    static struct jobStream js;
     char *reply_buf;
-    char *buf;
     XDR xdrs2;
     struct jobInfoReq jobInfoReq;
     struct jobInfoHead jobInfoHead;
@@ -245,71 +270,173 @@ do_jobInfoReq(XDR *xdrs,
         return -1;
     }
     len = XDR_GETPOS(&xdrs2);
+    xdr_destroy(&xdrs2);
+    freeJobHead (&jobInfoHead);
 
-    if (chanWrite_(chfd, reply_buf, len) != len) {
-        ls_syslog(LOG_ERR, "%s: chanWrite_() failed: %m", __func__);
-        FREEUP(reply_buf);
-        freeJobHead (&jobInfoHead);
-        FREEUP(jgrplist);
-        xdr_destroy(&xdrs2);
-        return -1;
+    if (js.buf == NULL) {
+        js.size = JOBINFO_STREAM_SIZE;
+        js.buf = my_malloc(js.size, __func__);
     }
+    js.sock = chanSock_(chfd);
+    js.len = 0;
+    js.head = reply_buf;
+    js.headLen = len;
 
-    FREEUP(reply_buf);
-
-    xdr_destroy(&xdrs2);
-    freeJobHead (&jobInfoHead);
     if (reply != LSBE_NO_ERROR ||
         (jobInfoReq.options & (JOBID_ONLY|JOBID_ONLY_ALL))) {
         FREEUP (jgrplist);
+        if (streamFlush(&js) < 0) {
+            FREEUP(reply_buf);
+            return -1;
+        }
+        FREEUP(reply_buf);
         return 0;
     }
 
     for (i = 0; i < listSize; i++) {
-        if (jgrplist[i].isJData &&
-            ((len = packJobInfo((struct jData *)jgrplist[i].info,
-                                listSize - 1 - i,  &buf, schedule,
-                                jobInfoReq.options, reqHdr->version)) < 0)) {
-            ls_syslog(LOG_ERR, "%s: packJobInfo() failed: %m", __func__);
+        int cc;
+
+        if (!jgrplist[i].isJData)
+            cc = packJgrpInfo((struct jgTreeNode *)jgrplist[i].info,
+                              listSize - 1 - i, &js,
+                              schedule, reqHdr->version);
+        else if (jobInfoReq.options & JOBINFO_BRIEF)
+            cc = packJobBrief((struct jData *)jgrplist[i].info,
+                              listSize - 1 - i, &js, reqHdr->version);
+        else
+            cc = packJobInfo((struct jData *)jgrplist[i].info,
+                             listSize - 1 - i, &js, schedule,
+                             jobInfoReq.options, reqHdr->version);
+        if (cc < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: failed to pack job %d of %d", __func__, i, listSize);
+            FREEUP(reply_buf);
             FREEUP(jgrplist);
             return -1;
         }
-        if (!jgrplist[i].isJData &&
-             ((len = packJgrpInfo((struct jgTreeNode *)jgrplist[i].info,
-                                  listSize - 1 - i,
-                                  &buf, schedule, reqHdr->version)) < 0)) {
-            ls_syslog(LOG_ERR, "%s: packJgrpInfo() failed: %m", __func__);
-            FREEUP(jgrplist);
+    }
+
+    FREEUP(jgrplist);
+
+    if (streamFlush(&js) < 0) {
+        FREEUP(reply_buf);
+        return -1;
+    }
+    FREEUP(reply_buf);
+
+    chanClose_(chfd);
+    return 0;
+}
+
+/* streamReserve()
+ *
+ * Make room for len bytes in the stream, write out
+ * what is buffered if need be.
+ */
+static int
+streamReserve(struct jobStream *js, int len)
+{
+    char *p;
+
+    if (js->len + len <= js->size)
+        return 0;
+
+    if (streamFlush(js) < 0)
+        return -1;
+
+    if (len > js->size) {
+        p = realloc(js->buf, len);
+        if (p == NULL) {
+            ls_syslog(LOG_ERR, "%s: realloc(%d) failed: %m", __func__, len);
             return -1;
         }
+        js->buf = p;
+        js->size = len;
+    }
 
-        if (chanWrite_(chfd, buf, len) != len) {
-            ls_syslog(LOG_ERR, "%s: 2 chanWrite_() failed: %m", __func__);
-            FREEUP(buf);
-            FREEUP(jgrplist);
-            return -1;
+    return 0;
+}
+
+/* streamFlush()
+ *
+ * Write the buffered replies, wait for the client
+ * to drain its socket if it is slow but give up
+ * on a client that does not read at all.
+ */
+static int
+streamFlush(struct jobStream *js)
+{
+    struct iovec iov[2];
+    struct iovec *v;
+    struct pollfd pfd;
+    int n;
+    int cc;
+
+    n = 0;
+    if (js->headLen > 0) {
+        iov[n].iov_base = js->head;
+        iov[n].iov_len = js->headLen;
+        ++n;
+    }
+    if (js->len > 0) {
+        iov[n].iov_base = js->buf;
+        iov[n].iov_len = js->len;
+        ++n;
+    }
+
+    v = iov;
+    pfd.fd = js->sock;
+    pfd.events = POLLOUT;
+    while (n > 0) {
+
+        cc = writev(js->sock, v, n);
+        if (cc < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ls_syslog(LOG_ERR, "%s: writev() failed: %m", __func__);
+                return -1;
+            }
+            cc = poll(&pfd, 1, JOBINFO_STREAM_TIMEOUT * 1000);
+            if (cc == 0) {
+                ls_syslog(LOG_ERR, "\
+%s: client did not read for %d seconds", __func__, JOBINFO_STREAM_TIMEOUT);
+                return -1;
+            }
+            if (cc < 0 && errno != EINTR) {
+                ls_syslog(LOG_ERR, "%s: poll() failed: %m", __func__);
+                return -1;
+            }
+            continue;
         }
 
-        FREEUP(buf);
+        while (n > 0 && cc >= (int)v->iov_len) {
+            cc -= v->iov_len;
+            ++v;
+            --n;
+        }
+        if (n > 0) {
+            v->iov_base = (char *)v->iov_base + cc;
+            v->iov_len -= cc;
+        }
     }
 
-    FREEUP(jgrplist);
+    js->headLen = 0;
+    js->len = 0;
 
-    chanClose_(chfd);
     return 0;
 }
 
 static int
 packJgrpInfo(struct jgTreeNode * jgNode,
              int remain,
-             char **replyBuf,
+             struct jobStream *js,
              int schedule,
              int version)
 {
     struct jobInfoReply jobInfoReply;
     struct submitReq jobBill;
     struct LSFHeader hdr;
-    char  *request_buf = NULL;
     XDR xdrs;
     int i, len;
 
@@ -346,8 +473,11 @@ packJgrpInfo(struct jgTreeNode * jgNode,
 
     len = (len * 4) / 4;
 
-    request_buf = (char *) my_malloc(len, "packJgrpInfo");
-    xdrmem_create(&xdrs, request_buf, len, XDR_ENCODE);
+    if (streamReserve(js, len) < 0)
+        return -1;
+
+    xdrmem_create(&xdrs, js->buf + js->len, len, XDR_ENCODE);
+    memset(&hdr, 0, sizeof(struct LSFHeader));
     hdr.reserved = remain;
     hdr.version = version;
 
@@ -356,11 +486,10 @@ packJgrpInfo(struct jgTreeNode * jgNode,
         ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL, __func__,
                   "xdr_encodeMsg", "jobInfoReply");
         xdr_destroy(&xdrs);
-        FREEUP (request_buf);
         return -1;
     }
     i = XDR_GETPOS(&xdrs);
-    *replyBuf = request_buf;
+    js->len += i;
     xdr_destroy(&xdrs);
     return (i);
 
@@ -381,6 +510,7 @@ jobInfoReplyXdrBufLen(struct jobInfoReply *jobInfoReplyPtr)
     len += ALIGNWORD_(strlen(jobInfoReply.execUsername) + 1);
     len += ALIGNWORD_(strlen(jobInfoReply.execHome) + 1);
     len += ALIGNWORD_(strlen(jobInfoReply.execCwd) + 1);
+    len += ALIGNWORD_(strlen(jobInfoReply.cpuBind) + 1);
     len += ALIGNWORD_(strlen(jobInfoReply.parentGroup) + 1);
     len += ALIGNWORD_(strlen(jobInfoReply.jName) + 1);
 
@@ -420,7 +550,7 @@ jobInfoReplyXdrBufLen(struct jobInfoReply *jobInfoReplyPtr)
 static int
 packJobInfo(struct jData *jobData,
             int remain,
-            char **replyBuf,
+            struct jobStream *js,
             int schedule,
             int options, int version)
 {
@@ -428,7 +558,6 @@ packJobInfo(struct jData *jobData,
     struct submitReq jobBill;
     struct LSFHeader hdr;
     struct hData *hPtr;
-    char *request_buf = NULL;
     int *reasonTb = NULL;
     int *jReasonTb;
     XDR xdrs;
@@ -621,6 +750,11 @@ packJobInfo(struct jData *jobData,
     else
         jobInfoReply.execUsername = jobData->execUsername;
 
+    if (!jobData->cpuBind)
+        jobInfoReply.cpuBind = "";
+    else
+        jobInfoReply.cpuBind = jobData->cpuBind;
+
     jobInfoReply.reserveTime = jobData->reserveTime;
     jobInfoReply.jobPid = jobData->jobPid;
     jobInfoReply.port = jobData->port;
@@ -701,9 +835,17 @@ packJobInfo(struct jData *jobData,
     len = jobInfoReplyXdrBufLen(&jobInfoReply);
     len += 1024;
 
-    FREEUP (request_buf);
-    request_buf = my_malloc(len, "packJobInfo");
-    xdrmem_create(&xdrs, request_buf, len, XDR_ENCODE);
+    if (streamReserve(js, len) < 0) {
+        freeJobInfoReply(&jobInfoReply);
+        FREEUP(reasonTb);
+        FREEUP(jReasonTb);
+        FREEUP(loadSched);
+        FREEUP(loadStop);
+        return -1;
+    }
+
+    xdrmem_create(&xdrs, js->buf + js->len, len, XDR_ENCODE);
+    memset(&hdr, 0, sizeof(struct LSFHeader));
     hdr.reserved = remain;
     hdr.version = version;
 
@@ -720,7 +862,6 @@ packJobInfo(struct jData *jobData,
         FREEUP(jReasonTb);
         FREEUP(loadSched);
         FREEUP(loadStop);
-        FREEUP(request_buf);
         return -1;
     }
 
@@ -730,7 +871,125 @@ packJobInfo(struct jData *jobData,
     FREEUP(loadStop);
     freeJobInfoReply(&jobInfoReply);
     i = XDR_GETPOS(&xdrs);
-    *replyBuf = request_buf;
+    js->len += i;
+    xdr_destroy(&xdrs);
+
+    return i;
+}
+
+/* packJobBrief()
+ *
+ * Pack the fields of a JOBINFO_BRIEF reply, the job
+ * bill is not copied as its strings point into the
+ * job.
+ */
+static int
+packJobBrief(struct jData *jobData,
+             int remain,
+             struct jobStream *js,
+             int version)
+{
+    struct jobInfoReply jobInfoReply;
+    struct submitReq jobBill;
+    struct submitReq *sub;
+    struct LSFHeader hdr;
+    char fullName[MAXPATHLEN];
+    XDR xdrs;
+    int len;
+    int i;
+
+    sub = &jobData->shared->jobBill;
+    memset(&jobInfoReply, 0, sizeof(struct jobInfoReply));
+    memset(&jobBill, 0, sizeof(struct submitReq));
+
+    jobInfoReply.jobId = jobData->jobId;
+    if (jobData->jStatus & JOB_STAT_UNKWN)
+        jobInfoReply.status = JOB_STAT_UNKWN;
+    else
+        jobInfoReply.status = jobData->jStatus;
+    jobInfoReply.status &= MASK_INT_JOB_STAT;
+
+    if (IS_SUSP (jobData->jStatus))
+        jobInfoReply.reasons = (~SUSP_MBD_LOCK & jobData->newReason);
+    else
+        jobInfoReply.reasons = jobData->newReason;
+    jobInfoReply.subreasons = jobData->subreasons;
+    jobInfoReply.startTime = jobData->startTime;
+    jobInfoReply.endTime = jobData->endTime;
+    jobInfoReply.userId = jobData->userId;
+    jobInfoReply.userName = jobData->userName;
+
+    jobInfoReply.numToHosts = 0;
+    if (jobData->numHostPtr > 0) {
+        jobInfoReply.toHosts = my_calloc(jobData->numHostPtr,
+                                         sizeof(char *), __func__);
+        for (i = 0; i < jobData->numHostPtr; i++) {
+            if (jobData->hPtr[i] == NULL)
+                continue;
+            jobInfoReply.toHosts[jobInfoReply.numToHosts++]
+                = jobData->hPtr[i]->host;
+        }
+    }
+
+    jobInfoReply.jType = jobData->nodeType;
+    jobInfoReply.jName = jobData->jgrpNode->name;
+    if (jobData->jgrpNode->nodeType == JGRP_NODE_ARRAY) {
+        for (i = 0; i < NUM_JGRP_COUNTERS; i++)
+            jobInfoReply.counter[i] = ARRAY_DATA(jobData->jgrpNode)->counts[i];
+    }
+
+    fullJobName_r(jobData, fullName);
+    jobBill.options = sub->options;
+    jobBill.options2 = sub->options2;
+    jobBill.numProcessors = sub->numProcessors;
+    jobBill.maxNumProcessors = sub->maxNumProcessors;
+    if (sub->options2 & SUB2_USE_DEF_PROCLIMIT) {
+        jobBill.numProcessors = 1;
+        jobBill.maxNumProcessors = 1;
+    }
+    jobBill.submitTime = sub->submitTime;
+    jobBill.fromHost = sub->fromHost;
+    jobBill.queue = jobData->qPtr->queue;
+    jobBill.jobName = fullName;
+    jobBill.projectName = sub->projectName ? sub->projectName : "";
+    jobInfoReply.jobBill = &jobBill;
+
+    len = LSF_HEADER_LEN
+        + (NUM_JGRP_COUNTERS + 32) * NET_INTSIZE_
+        + ALIGNWORD_(strlen(jobInfoReply.jName) + 1)
+        + ALIGNWORD_(strlen(jobInfoReply.userName) + 1)
+        + ALIGNWORD_(strlen(jobBill.fromHost) + 1)
+        + ALIGNWORD_(strlen(jobBill.queue) + 1)
+        + ALIGNWORD_(strlen(jobBill.jobName) + 1)
+        + ALIGNWORD_(strlen(jobBill.projectName) + 1)
+        + jobInfoReply.numToHosts * (NET_INTSIZE_ + ALIGNWORD_(MAXHOSTNAMELEN));
+
+    if (streamReserve(js, len) < 0) {
+        FREEUP(jobInfoReply.toHosts);
+        return -1;
+    }
+
+    xdrmem_create(&xdrs, js->buf + js->len, len, XDR_ENCODE);
+    memset(&hdr, 0, sizeof(struct LSFHeader));
+    hdr.opCode = JOBINFO_BRIEF;
+    hdr.reserved = remain;
+    hdr.version = version;
+
+    if (!xdr_encodeMsg(&xdrs,
+                       (char *)&jobInfoReply,
+                       &hdr,
+                       xdr_jobInfoBrief,
+                       0,
+                       NULL)) {
+        ls_syslog(LOG_ERR, "%s: xdr_encodeMsg() failed", __func__);
+        xdr_destroy(&xdrs);
+        FREEUP(jobInfoReply.toHosts);
+        return -1;
+    }
+
+    FREEUP(jobInfoReply.toHosts);
+    i = XDR_GETPOS(&xdrs);
+    js->len += i;
     xdr_destroy(&xdrs);
 
     return i;
@@ -1138,15 +1397,22 @@ do_statusReq(XDR * xdrs, int chfd, struct sockaddr_in * from, int *schedule,
 
 }
 
+/* do_chunkStatusReq()
+ *
+ * Apply a batch of job status from sbatchd in one
+ * pass and answer with the reply code of each job.
+ */
 int
 do_chunkStatusReq(XDR * xdrs, int chfd, struct sockaddr_in * from,
                   int *schedule, struct LSFHeader * reqHdr)
 {
     static char             fname[] = "do_chunkStatusReq()";
-    char                    reply_buf[MSGSIZE];
+    char                    *reply_buf;
     XDR                     xdrs2;
     struct chunkStatusReq   chunkStatusReq;
     int                     reply;
+    int                     *replies;
+    int                     len;
     struct hData           *hData;
     struct hostent         *hp;
     struct LSFHeader        replyHdr;
@@ -1166,36 +1432,59 @@ do_chunkStatusReq(XDR * xdrs, int chfd, struct sockaddr_in * from,
         return -1;
     }
 
+    replies = NULL;
+    memset(&chunkStatusReq, 0, sizeof(struct chunkStatusReq));
     if (!xdr_chunkStatusReq(xdrs, &chunkStatusReq, reqHdr)) {
         reply = LSBE_XDR;
         ls_syslog(LOG_ERR, I18N_FUNC_FAIL, fname, "xdr_chunkStatusReq");
     } else {
 
+        replies = my_calloc(chunkStatusReq.numStatusReqs + 1,
+                            sizeof(int), __func__);
         for (i=0; i<chunkStatusReq.numStatusReqs; i++) {
 
-            statusJob(chunkStatusReq.statusReqs[i], hp, schedule);
+            replies[i] = statusJob(chunkStatusReq.statusReqs[i], hp, schedule);
         }
 
         reply = LSBE_NO_ERROR;
     }
 
+    len = LSF_HEADER_LEN;
+    if (replies)
+        len += NET_INTSIZE_ + chunkStatusReq.numStatusReqs * NET_INTSIZE_;
+    reply_buf = my_malloc(len, __func__);
+    xdrmem_create(&xdrs2, reply_buf, len, XDR_ENCODE);
+    XDR_SETPOS(&xdrs2, LSF_HEADER_LEN);
+
+    if (replies) {
+        xdr_int(&xdrs2, &chunkStatusReq.numStatusReqs);
+        for (i = 0; i < chunkStatusReq.numStatusReqs; i++)
+            xdr_int(&xdrs2, &replies[i]);
+    }
+
     xdr_lsffree(xdr_chunkStatusReq, (char *) &chunkStatusReq, reqHdr);
+    FREEUP(replies);
 
-    xdrmem_create(&xdrs2, reply_buf, MSGSIZE, XDR_ENCODE);
+    initLSFHeader_(&replyHdr);
     replyHdr.opCode = reply;
-    replyHdr.length = 0;
+    len = XDR_GETPOS(&xdrs2);
+    replyHdr.length = len - LSF_HEADER_LEN;
+    XDR_SETPOS(&xdrs2, 0);
     if (!xdr_LSFHeader(&xdrs2, &replyHdr)) {
         ls_syslog(LOG_ERR, I18N_FUNC_D_FAIL, fname, "xdr_LSFHeader",
                   reply);
         xdr_destroy(&xdrs2);
+        free(reply_buf);
         return -1;
     }
-    if (chanWrite_(chfd, reply_buf, XDR_GETPOS(&xdrs2)) <= 0) {
+    if (chanWrite_(chfd, reply_buf, len) <= 0) {
         ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, fname, "b_write_fix");
         xdr_destroy(&xdrs2);
+        free(reply_buf);
         return -1;
     }
     xdr_destroy(&xdrs2);
+    free(reply_buf);
 
     if ((hData = getHostData(hp->h_name)) != NULL)
         hStatChange(hData, 0);
@@ -1472,7 +1761,8 @@ xdrsize_QueueInfoReply(struct queueInfoReply * qInfoReply)
             + getXdrStrlen(qInfoReply->queues[i].resumeActCmd)
             + getXdrStrlen(qInfoReply->queues[i].terminateActCmd)
             + getXdrStrlen(qInfoReply->queues[i].chkpntDir)
-            + getXdrStrlen(qInfoReply->queues[i].preemption);
+            + getXdrStrlen(qInfoReply->queues[i].preemption)
+            + getXdrStrlen(qInfoReply->queues[i].affinity);
         if (qInfoReply->queues[i].numAccts > 0) {
             len = len
                 + qInfoReply->queues[i].numAccts
@@ -2127,6 +2417,11 @@ doNewJobReply(struct sbdNode *sbdPtr, int exception)
 
         log_startjobaccept(jData);
 
+        if (syncEventLog() < 0) {
+            ls_syslog(LOG_ERR, "%s: failed to commit events: %m", fname);
+            mbdDie(MASTER_FATAL);
+        }
+
         if (daemonParams[LSB_MBD_BLOCK_SEND].paramValue == NULL) {
             struct Buffer *replyBuf;
 
@@ -2169,6 +2464,141 @@ Leave:
 }
 
 
+/* doNewJobsReply()
+ *
+ * Process the sbatchd reply to a batch of job
+ * starts and answer with a go-ahead for each
+ * job that mbatchd still wants to run.
+ */
+void
+doNewJobsReply(struct sbdNode *sbdPtr, int exception)
+{
+    struct sbdDispatch *disp = sbdPtr->disp;
+    struct LSFHeader hdr;
+    struct jobStartReply jr;
+    struct jobGo go;
+    struct jData *jData;
+    struct Buffer *buf;
+    struct Buffer *goBuf;
+    XDR xdrs;
+    XDR xdrs2;
+    int num;
+    int i;
+    int reqId;
+    int svReason;
+    int replayReason;
+
+    if (exception == TRUE
+        || chanRecv_(sbdPtr->chanfd, &buf) < 0) {
+        if (exception == TRUE)
+            ls_syslog(LOG_ERR, "\
+%s: exception bit of %d is set for host %s", __func__,
+                      sbdPtr->chanfd, sbdPtr->hData->host);
+        else
+            ls_syslog(LOG_ERR, "\
+%s: chanRecv_() failed for host %s", __func__, sbdPtr->hData->host);
+        failDispatch(disp);
+        return;
+    }
+
+    sbdPtr->lastTime = now;
+    xdrmem_create(&xdrs, buf->data, buf->len, XDR_DECODE);
+
+    if (! xdr_LSFHeader(&xdrs, &hdr)
+        || hdr.opCode != ERR_NO_ERROR
+        || ! xdr_int(&xdrs, &num)
+        || num < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: bad reply opCode %d from host %s", __func__,
+                  hdr.opCode, sbdPtr->hData->host);
+        xdr_destroy(&xdrs);
+        chanFreeBuf_(buf);
+        failDispatch(disp);
+        return;
+    }
+
+    if (chanAllocBuf_(&goBuf, LSF_HEADER_LEN
+                      + (num + 1) * sizeof(struct jobGo)) < 0)
+        mbdDie(MASTER_MEM);
+    xdrmem_create(&xdrs2, goBuf->data,
+                  LSF_HEADER_LEN + (num + 1) * sizeof(struct jobGo),
+                  XDR_ENCODE);
+    XDR_SETPOS(&xdrs2, LSF_HEADER_LEN);
+    xdr_int(&xdrs2, &num);
+
+    for (i = 0; i < num; i++) {
+
+        if (! xdr_jobStartReply(&xdrs, &jr, &hdr)) {
+            ls_syslog(LOG_ERR, "\
+%s: xdr_jobStartReply() failed for host %s", __func__,
+                      sbdPtr->hData->host);
+            xdr_destroy(&xdrs);
+            xdr_destroy(&xdrs2);
+            chanFreeBuf_(buf);
+            chanFreeBuf_(goBuf);
+            failDispatch(disp);
+            return;
+        }
+
+        dispatchJobDone(disp, jr.jobReply.jobId);
+
+        go.jobId = jr.jobReply.jobId;
+        go.go = FALSE;
+
+        jData = getJobData(jr.jobReply.jobId);
+        if (jData == NULL
+            || jData->jobPid != 0
+            || !IS_START(jData->jStatus)) {
+            xdr_jobGo(&xdrs2, &go, &hdr);
+            continue;
+        }
+
+        if (jr.reply != ERR_NO_ERROR) {
+            replayReason = jobStartError(jData, (sbdReplyType) jr.reply);
+            svReason = jData->newReason;
+            jData->newReason = replayReason;
+            jStatusChange(jData, JOB_STAT_PEND, LOG_IT, __func__);
+            jData->newReason = svReason;
+            xdr_jobGo(&xdrs2, &go, &hdr);
+            continue;
+        }
+
+        jData->jobPid = jr.jobReply.jobPid;
+        jData->jobPGid = jr.jobReply.jobPGid;
+        log_startjobaccept(jData);
+
+        go.go = TRUE;
+        xdr_jobGo(&xdrs2, &go, &hdr);
+    }
+
+    xdr_destroy(&xdrs);
+    chanFreeBuf_(buf);
+
+    reqId = hdr.refCode;
+    initLSFHeader_(&hdr);
+    hdr.opCode = MBD_JOBS_GO;
+    hdr.refCode = reqId;
+    goBuf->len = XDR_GETPOS(&xdrs2);
+    hdr.length = goBuf->len - LSF_HEADER_LEN;
+    XDR_SETPOS(&xdrs2, 0);
+    xdr_LSFHeader(&xdrs2, &hdr);
+    xdr_destroy(&xdrs2);
+
+    if (syncEventLog() < 0) {
+        ls_syslog(LOG_ERR, "%s: failed to commit events: %m", __func__);
+        mbdDie(MASTER_FATAL);
+    }
+
+    if (chanEnqueue_(sbdPtr->chanfd, goBuf) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: chanEnqueue_() failed for host %s: %M", __func__,
+                  sbdPtr->hData->host);
+        chanFreeBuf_(goBuf);
+        failDispatch(disp);
+    }
+}
+
+
 void
 doProbeReply(struct sbdNode *sbdPtr, int exception)
 {
@@ -0,0 +1,1337 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+/* mbdsim runs the mbatchd scheduler offline. The mbatchd
+ * objects are linked as they are, their main() renamed,
+ * and driven by a simulated clock: time() is wrapped by
+ * the linker and the LIM library calls mbatchd makes are
+ * answered here with a set of synthetic hosts. Jobs are
+ * started by the start_job() hook and finish after their
+ * simulated runtime.
+ *
+ * The workload is either generated or replayed from the
+ * JOB_NEW records of an lsb.events file, the runtime of
+ * a replayed job is the time between its start and its
+ * finish in the same file.
+ *
+ * mbdsim builds its configuration and working directories
+ * under $TMPDIR and removes them on exit, with -k the
+ * mbatchd log, lsb.events and lsb.acct of the run are
+ * left there.
+ */
+
+#include "mbd.h"
+#include <sys/stat.h>
+#include <math.h>
+#include <ftw.h>
+
+/* mbd.main.c is compiled with its main() renamed.
+ */
+#undef main
+
+#define SIM_DEF_JOBS      1000
+#define SIM_DEF_USERS     10
+#define SIM_DEF_HOSTS     64
+#define SIM_DEF_SLOTS     8
+#define SIM_DEF_PROCS     1
+#define SIM_DEF_ARRIVAL   1.0
+#define SIM_DEF_RUNTIME   300.0
+#define SIM_DEF_INTERVAL  10
+#define SIM_DEF_TIMING    4
+#define SIM_CLUSTER       "simcluster"
+#define SIM_QUEUE         "normal"
+#define SIM_HOSTTYPE      "linux"
+#define SIM_UGROUP        "simusers"
+
+/* A job of the workload, its JOB_NEW record
+ * and its simulated runtime.
+ */
+struct simJob {
+    struct eventRec rec;
+    int runTime;
+};
+
+/* A running job waiting in the heap
+ * for its finish time.
+ */
+struct simRun {
+    LS_LONG_INT jobId;
+    time_t finishTime;
+    int slots;
+};
+
+/* A scheduling session.
+ */
+struct simSession {
+    time_t simTime;
+    double wallMs;
+    int numPend;
+    int numStarted;
+    int full;
+    struct schedTimers timers;
+};
+
+static char *simDir;
+static pid_t simPid;
+static int keepDir;
+static char simHost[MAXHOSTNAMELEN];
+static int simClock;
+static time_t simNow;
+
+static int numHosts = SIM_DEF_HOSTS;
+static int numSlots = SIM_DEF_SLOTS;
+static char *fairPlugin;
+static int timingLevel = SIM_DEF_TIMING;
+static int verbose;
+static int perSession;
+
+static struct simJob *jobs;
+static int numJobs;
+static int nextArrival;
+static double meanRunTime = SIM_DEF_RUNTIME;
+static struct hTab runTab;
+static char **queues;
+static int numQueues;
+
+static struct heap_ *runHeap;
+static int usedSlots;
+static double slotSeconds;
+static int numStarted;
+static int numDone;
+static double *latency;
+static int sizeLatency;
+
+static struct simSession *sessions;
+static int numSessions;
+static int sizeSessions;
+static int sessionStarted;
+static int sessionFull;
+static struct schedTimers sessionTimers;
+static long *cntSum;
+
+static struct hostInfo *simHosts;
+static struct hostLoad *simLoads;
+static struct clusterInfo simCluster;
+
+static void usage(void);
+static int genWorkload(int, int, double, int, long);
+static int readWorkload(const char *);
+static int addQueue(const char *);
+static void addRunTime(LS_LONG_INT, int);
+static int mkSimDir(void);
+static void rmSimDir(void);
+static int rmSimEnt(const char *, const struct stat *, int, struct FTW *);
+static int writeConf(void);
+static int simPort(void);
+static void simLoop(void);
+static void simAdvance(time_t);
+static void simSchedule(void);
+static void simFinish(struct simRun *);
+static sbdReplyType simStartJob(struct jData *, struct qData *,
+                                struct jobReply *);
+static void simSessionEnd(struct schedTimers *);
+static void simReport(void);
+static int runCmp(const void *, const void *);
+static int jobCmp(const void *, const void *);
+static int dblCmp(const void *, const void *);
+static double pct(double *, int, double);
+
+extern time_t __real_time(time_t *);
+
+int
+main(int argc, char **argv)
+{
+    char *events;
+    char *p;
+    char buf[MAXFILENAMELEN];
+    int nJobs;
+    int nUsers;
+    int maxProcs;
+    double arrival;
+    long seed;
+    int interval;
+    int cc;
+
+    events = NULL;
+    nJobs = SIM_DEF_JOBS;
+    nUsers = SIM_DEF_USERS;
+    maxProcs = SIM_DEF_PROCS;
+    arrival = SIM_DEF_ARRIVAL;
+    interval = SIM_DEF_INTERVAL;
+    seed = 1;
+
+    while ((cc = getopt(argc, argv, "hVvSke:n:u:a:r:p:m:c:s:i:f:t:")) != EOF) {
+        switch (cc) {
+            case 'e':
+                events = optarg;
+                break;
+            case 'n':
+                nJobs = atoi(optarg);
+                break;
+            case 'u':
+                nUsers = atoi(optarg);
+                break;
+            case 'a':
+                arrival = atof(optarg);
+                break;
+            case 'r':
+                meanRunTime = atof(optarg);
+                break;
+            case 'p':
+                maxProcs = atoi(optarg);
+                break;
+            case 'm':
+                numHosts = atoi(optarg);
+                break;
+            case 'c':
+                numSlots = atoi(optarg);
+                break;
+            case 's':
+                seed = atol(optarg);
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                break;
+            case 'f':
+                fairPlugin = optarg;
+                break;
+            case 't':
+                timingLevel = atoi(optarg);
+                break;
+            case 'S':
+                perSession = 1;
+                break;
+            case 'k':
+                keepDir = 1;
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 'V':
+                fputs(_LS_VERSION_, stderr);
+                return 0;
+            case 'h':
+            default:
+                usage();
+                return -1;
+        }
+    }
+
+    if (nJobs <= 0 || nUsers <= 0 || maxProcs <= 0
+        || numHosts <= 0 || numSlots <= 0 || interval <= 0
+        || arrival < 0 || meanRunTime < 1) {
+        usage();
+        return -1;
+    }
+
+    if (fairPlugin && fairPlugin[0] != '/') {
+        if (getcwd(buf, sizeof(buf)) == NULL) {
+            perror("getcwd");
+            return -1;
+        }
+        p = malloc(strlen(buf) + strlen(fairPlugin) + 2);
+        sprintf(p, "%s/%s", buf, fairPlugin);
+        fairPlugin = p;
+    }
+
+    gethostname(simHost, sizeof(simHost));
+    if ((p = strchr(simHost, '.')))
+        *p = 0;
+
+    h_initTab_(&runTab, 1024);
+    runHeap = heap_make(1024, runCmp, NULL);
+
+    if (events) {
+        if (readWorkload(events) < 0)
+            return -1;
+    } else {
+        addQueue(SIM_QUEUE);
+        if (genWorkload(nJobs, nUsers, arrival, maxProcs, seed) < 0)
+            return -1;
+    }
+
+    if (numJobs == 0) {
+        fprintf(stderr, "mbdsim: empty workload\n");
+        return -1;
+    }
+
+    if (mkSimDir() < 0
+        || writeConf() < 0)
+        return -1;
+
+    /* From now on mbatchd lives in simulated time,
+     * starting at the first submission.
+     */
+    simNow = jobs[0].rec.eventLog.jobNewLog.submitTime;
+    simClock = TRUE;
+    now = simNow;
+
+    sprintf(buf, "%s/etc", simDir);
+    setenv("LSF_ENVDIR", buf, 1);
+    env_dir = strdup(buf);
+
+    if (initenv_(daemonParams, env_dir) < 0) {
+        fprintf(stderr, "mbdsim: initenv_() %s failed: %s\n",
+                env_dir, ls_sysmsg());
+        return -1;
+    }
+
+    debug = 1;
+    getLogClass_(daemonParams[LSB_DEBUG_MBD].paramValue,
+                 daemonParams[LSB_TIME_MBD].paramValue);
+    ls_openlog("mbdsim", daemonParams[LSF_LOGDIR].paramValue, FALSE,
+               daemonParams[LSF_LOG_MASK].paramValue);
+    daemon_doinit();
+
+    minit(FIRST_START);
+    log_mbdStart();
+
+    startJobHook = simStartJob;
+    schedSessionHook = simSessionEnd;
+
+    for (cc = 0; counters[cc].cntDescr != NULL; cc++)
+        ;
+    cntSum = calloc(cc + 1, sizeof(long));
+
+    simLoop();
+    commitEventLog();
+    simReport();
+
+    return 0;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "\
+usage: mbdsim [-h] [-V] [-v] [-S] [-k] [-e lsb.events | -n jobs -u users\n\
+              -a mean_interarrival -r mean_runtime -p max_procs -s seed]\n\
+              [-m hosts] [-c slots] [-i interval] [-t timing_level]\n\
+              [-f libfairshare.so]\n");
+}
+
+/* genWorkload()
+ *
+ * Poisson arrivals, exponential runtimes and a uniform
+ * number of processors, the users submit round robin.
+ */
+static int
+genWorkload(int n, int nUsers, double arrival, int maxProcs, long seed)
+{
+    struct jobNewLog *l;
+    double t;
+    int i;
+    int j;
+
+    jobs = calloc(n, sizeof(struct simJob));
+    if (jobs == NULL) {
+        perror("calloc");
+        return -1;
+    }
+
+    srand48(seed);
+    t = (double)__real_time(NULL);
+
+    for (i = 0; i < n; i++) {
+
+        l = &jobs[i].rec.eventLog.jobNewLog;
+        jobs[i].rec.type = EVENT_JOB_NEW;
+
+        t += -arrival * log(1.0 - drand48());
+        jobs[i].runTime = 1 + (int)(-meanRunTime * log(1.0 - drand48()));
+
+        l->jobId = i + 1;
+        l->userId = 10000 + i % nUsers;
+        sprintf(l->userName, "user%03d", i % nUsers);
+        l->numProcessors = 1 + (int)(drand48() * maxProcs);
+        l->maxNumProcessors = l->numProcessors;
+        l->submitTime = (time_t)t;
+        for (j = 0; j < LSF_RLIM_NLIMITS; j++)
+            l->rLimits[j] = DEFAULT_RLIMIT;
+        strcpy(l->queue, SIM_QUEUE);
+        strcpy(l->fromHost, simHost);
+        strcpy(l->cwd, "/tmp");
+        sprintf(l->jobFile, "%d.%d", (int)l->submitTime, l->jobId);
+        sprintf(l->command, "sleep %d", jobs[i].runTime);
+        l->umask = 022;
+        l->userPriority = -1;
+        l->resReq = "";
+        l->dependCond = "";
+        l->preExecCmd = "";
+        l->mailUser = "";
+        l->projectName = "";
+        l->schedHostType = SIM_HOSTTYPE;
+        l->loginShell = "";
+        l->userGroup = "";
+
+        addRunTime(l->jobId, jobs[i].runTime);
+    }
+
+    numJobs = n;
+
+    return 0;
+}
+
+/* readWorkload()
+ *
+ * Take the JOB_NEW records of an event file as the
+ * workload and measure the runtimes from the JOB_START
+ * and the final JOB_STATUS records of the jobs.
+ */
+static int
+readWorkload(const char *file)
+{
+    struct eventRec *rec;
+    struct eventFileMap *map;
+    struct jobNewLog *l;
+    struct hTab startTab;
+    hEnt *e;
+    FILE *fp;
+    LS_LONG_INT jobId;
+    int sizeJobs;
+    int lineNum;
+    int n;
+
+    fp = fopen(file, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "mbdsim: fopen() %s failed: %s\n",
+                file, strerror(errno));
+        return -1;
+    }
+
+    if ((map = lsb_openeventmap(fp)) == NULL) {
+        fprintf(stderr, "mbdsim: lsb_openeventmap() %s failed: %s\n",
+                file, lsb_sysmsg());
+        fclose(fp);
+        return -1;
+    }
+
+    h_initTab_(&startTab, 1024);
+    sizeJobs = 0;
+    lineNum = 0;
+    lsberrno = LSBE_NO_ERROR;
+
+    while (lsberrno != LSBE_EOF) {
+
+        if ((rec = lsb_geteventmaprec(map, &lineNum)) == NULL)
+            continue;
+
+        switch (rec->type) {
+            case EVENT_JOB_NEW:
+
+                if (numJobs == sizeJobs) {
+                    sizeJobs = sizeJobs ? 2 * sizeJobs : 1024;
+                    jobs = realloc(jobs, sizeJobs * sizeof(struct simJob));
+                    if (jobs == NULL) {
+                        perror("realloc");
+                        return -1;
+                    }
+                }
+
+                /* Keep the strings the scheduler looks at,
+                 * the hosts and the files of the original
+                 * cluster do not exist here and the jobs
+                 * run on the type of the simulated hosts.
+                 */
+                jobs[numJobs].rec = *rec;
+                jobs[numJobs].runTime = -1;
+                l = &jobs[numJobs].rec.eventLog.jobNewLog;
+                l->options &= ~(SUB_NOTIFY_BEGIN | SUB_NOTIFY_END
+                                | SUB_HOST | SUB_OTHER_FILES);
+                l->numAskedHosts = 0;
+                l->askedHosts = NULL;
+                l->nxf = 0;
+                l->xf = NULL;
+                l->resReq = strdup(l->resReq ? l->resReq : "");
+                l->dependCond = strdup(l->dependCond ? l->dependCond : "");
+                l->preExecCmd = strdup(l->preExecCmd ? l->preExecCmd : "");
+                l->mailUser = strdup(l->mailUser ? l->mailUser : "");
+                l->projectName = strdup(l->projectName ?
+                                        l->projectName : "");
+                l->schedHostType = strdup(SIM_HOSTTYPE);
+                l->loginShell = strdup(l->loginShell ? l->loginShell : "");
+                l->userGroup = strdup(l->userGroup ? l->userGroup : "");
+                l->options2 &= ~SUB2_HOLD;
+                addQueue(l->queue);
+                ++numJobs;
+                break;
+
+            case EVENT_JOB_START:
+                jobId = LSB_JOBID(rec->eventLog.jobStartLog.jobId,
+                                  rec->eventLog.jobStartLog.idx);
+                e = h_addEnt_(&startTab, lsb_jobid2str(jobId), NULL);
+                if (e->hData == NULL)
+                    e->hData = malloc(sizeof(time_t));
+                *(time_t *)e->hData = rec->eventTime;
+                break;
+
+            case EVENT_JOB_STATUS:
+                if (!IS_FINISH(rec->eventLog.jobStatusLog.jStatus))
+                    break;
+                jobId = LSB_JOBID(rec->eventLog.jobStatusLog.jobId,
+                                  rec->eventLog.jobStatusLog.idx);
+                e = h_getEnt_(&startTab, lsb_jobid2str(jobId));
+                if (e == NULL)
+                    break;
+                n = rec->eventTime - *(time_t *)e->hData;
+                addRunTime(jobId, n > 0 ? n : 1);
+                break;
+        }
+    }
+
+    lsb_closeeventmap(map);
+    fclose(fp);
+    h_freeTab_(&startTab, free);
+
+    if (numJobs > 0)
+        qsort(jobs, numJobs, sizeof(struct simJob), jobCmp);
+
+    return 0;
+}
+
+/* addQueue()
+ */
+static int
+addQueue(const char *name)
+{
+    int i;
+
+    for (i = 0; i < numQueues; i++) {
+        if (strcmp(queues[i], name) == 0)
+            return i;
+    }
+
+    queues = realloc(queues, (numQueues + 1) * sizeof(char *));
+    queues[numQueues] = strdup(name);
+
+    return numQueues++;
+}
+
+/* addRunTime()
+ */
+static void
+addRunTime(LS_LONG_INT jobId, int runTime)
+{
+    hEnt *e;
+
+    e = h_addEnt_(&runTab, lsb_jobid2str(jobId), NULL);
+    if (e->hData == NULL)
+        e->hData = malloc(sizeof(int));
+    *(int *)e->hData = runTime;
+}
+
+/* mkSimDir()
+ */
+static int
+mkSimDir(void)
+{
+    static char *dirs[] = {"etc", "lib", "log", "sbin", "work",
+                           "work/logdir", NULL};
+    char buf[MAXFILENAMELEN];
+    char *tmp;
+    int i;
+
+    tmp = getenv("TMPDIR");
+    if (tmp == NULL)
+        tmp = "/tmp";
+
+    sprintf(buf, "%s/mbdsim.XXXXXX", tmp);
+    if (mkdtemp(buf) == NULL) {
+        fprintf(stderr, "mbdsim: mkdtemp() %s failed: %s\n",
+                buf, strerror(errno));
+        return -1;
+    }
+    simDir = strdup(buf);
+
+    /* Only the mbdsim process removes it, not the
+     * children mbatchd forks.
+     */
+    simPid = getpid();
+    atexit(rmSimDir);
+
+    for (i = 0; dirs[i]; i++) {
+        sprintf(buf, "%s/%s", simDir, dirs[i]);
+        if (mkdir(buf, 0755) < 0) {
+            fprintf(stderr, "mbdsim: mkdir() %s failed: %s\n",
+                    buf, strerror(errno));
+            return -1;
+        }
+    }
+
+    if (fairPlugin) {
+        sprintf(buf, "%s/lib/libfairshare.so", simDir);
+        if (symlink(fairPlugin, buf) < 0) {
+            fprintf(stderr, "mbdsim: symlink() %s failed: %s\n",
+                    buf, strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* rmSimDir()
+ *
+ * Remove the directories of the run unless -k
+ * was given.
+ */
+static void
+rmSimDir(void)
+{
+    if (keepDir || simDir == NULL || getpid() != simPid)
+        return;
+
+    if (nftw(simDir, rmSimEnt, 16, FTW_DEPTH | FTW_PHYS) < 0)
+        fprintf(stderr, "mbdsim: cannot remove %s: %s\n",
+                simDir, strerror(errno));
+}
+
+/* rmSimEnt()
+ */
+static int
+rmSimEnt(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    if (remove(path) < 0) {
+        fprintf(stderr, "mbdsim: remove() %s failed: %s\n",
+                path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* writeConf()
+ *
+ * The lsf.conf, lsf.shared, hosts and lsb files of
+ * the simulated cluster. The local host is the master
+ * and runs no jobs.
+ */
+static int
+writeConf(void)
+{
+    char buf[MAXFILENAMELEN];
+    FILE *fp;
+    int port;
+    int i;
+
+    if ((port = simPort()) < 0)
+        return -1;
+
+    sprintf(buf, "%s/etc/lsf.conf", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "LSF_ENVDIR=%s/etc\n", simDir);
+    fprintf(fp, "LSF_CONFDIR=%s/etc\n", simDir);
+    fprintf(fp, "LSB_CONFDIR=%s/etc\n", simDir);
+    fprintf(fp, "LSF_SERVERDIR=%s/sbin\n", simDir);
+    fprintf(fp, "LSF_LIBDIR=%s/lib\n", simDir);
+    fprintf(fp, "LSB_SHAREDIR=%s/work\n", simDir);
+    fprintf(fp, "LSF_LOGDIR=%s/log\n", simDir);
+    fprintf(fp, "LSF_LOG_MASK=%s\n", verbose ? "LOG_DEBUG" : "LOG_WARNING");
+    if (verbose)
+        fprintf(fp, "LSB_DEBUG_MBD=\"LC_PERFM\"\n");
+    fprintf(fp, "LSB_TIME_MBD=%d\n", timingLevel);
+    fprintf(fp, "LSF_LIM_PORT=%d\n", port);
+    fprintf(fp, "LSF_RES_PORT=%d\n", port);
+    fprintf(fp, "LSB_MBD_PORT=%d\n", port);
+    fprintf(fp, "LSB_SBD_PORT=%d\n", port);
+    fprintf(fp, "LIM_NO_MIGRANT_HOSTS=y\n");
+    fprintf(fp, "LSB_MAILPROG=/bin/true\n");
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/lsf.shared", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "\
+Begin Cluster\n\
+ClusterName\n\
+%s\n\
+End Cluster\n\
+\n\
+Begin HostType\n\
+TYPENAME\n\
+%s\n\
+End HostType\n\
+\n\
+Begin HostModel\n\
+MODELNAME  CPUFACTOR   ARCHITECTURE\n\
+sim        1.0         (x86_64)\n\
+End HostModel\n\
+\n\
+Begin Resource\n\
+RESOURCENAME  TYPE    INTERVAL INCREASING  DESCRIPTION\n\
+cs            Boolean ()       ()          (Compute server)\n\
+End Resource\n", SIM_CLUSTER, SIM_HOSTTYPE);
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/hosts", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "127.0.0.1 %s\n", simHost);
+    for (i = 0; i < numHosts; i++)
+        fprintf(fp, "127.%d.%d.%d sim%05d\n",
+                1 + i / 65536, (i / 256) % 256, i % 256, i);
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/lsb.params", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "\
+Begin Parameters\n\
+DEFAULT_QUEUE = %s\n\
+MBD_SLEEP_TIME = %d\n\
+JOB_ACCEPT_INTERVAL = 0\n\
+End Parameters\n", queues[0], SIM_DEF_INTERVAL);
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/lsb.hosts", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "\
+Begin Host\n\
+HOST_NAME     MXJ\n\
+%s            0\n\
+default       %d\n\
+End Host\n", simHost, numSlots);
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/lsb.users", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    fprintf(fp, "\
+Begin UserGroup\n\
+GROUP_NAME    GROUP_MEMBER    USER_SHARES\n\
+%s      (all)           ([default,1])\n\
+End UserGroup\n", SIM_UGROUP);
+    fclose(fp);
+
+    sprintf(buf, "%s/etc/lsb.queues", simDir);
+    if ((fp = fopen(buf, "w")) == NULL)
+        goto bail;
+    for (i = 0; i < numQueues; i++) {
+        fprintf(fp, "\
+Begin Queue\n\
+QUEUE_NAME = %s\n\
+PRIORITY = 30\n", queues[i]);
+        if (fairPlugin)
+            fprintf(fp, "FAIRSHARE = USER_SHARES[[%s,1]]\n", SIM_UGROUP);
+        fprintf(fp, "End Queue\n\n");
+    }
+    fclose(fp);
+
+    return 0;
+
+bail:
+    fprintf(stderr, "mbdsim: fopen() %s failed: %s\n", buf, strerror(errno));
+    return -1;
+}
+
+/* simPort()
+ *
+ * mbatchd listens on its port even if nobody
+ * talks to it, ask the kernel for a free one.
+ */
+static int
+simPort(void)
+{
+    struct sockaddr_in sin;
+    socklen_t len;
+    int s;
+
+    s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(sin);
+    if (bind(s, (struct sockaddr *)&sin, sizeof(sin)) < 0
+        || getsockname(s, (struct sockaddr *)&sin, &len) < 0) {
+        perror("bind");
+        close(s);
+        return -1;
+    }
+    close(s);
+
+    return ntohs(sin.sin_port);
+}
+
+/* simLoop()
+ *
+ * Advance the clock to the next submission, job
+ * finish or scheduling session whichever comes
+ * first. Sessions run every MBD_SLEEP_TIME while
+ * there are pending jobs, without pending jobs
+ * the clock skips to the session following the
+ * next submission.
+ */
+static void
+simLoop(void)
+{
+    struct simRun *r;
+    time_t nextSched;
+    time_t t;
+    int numPend;
+
+    nextSched = simNow;
+
+    for (;;) {
+
+        t = nextSched;
+        if (nextArrival < numJobs
+            && jobs[nextArrival].rec.eventLog.jobNewLog.submitTime < t)
+            t = jobs[nextArrival].rec.eventLog.jobNewLog.submitTime;
+        r = HEAP_TOP(runHeap);
+        if (r && r->finishTime < t)
+            t = r->finishTime;
+
+        simAdvance(t);
+
+        while (nextArrival < numJobs
+               && jobs[nextArrival].rec.eventLog.jobNewLog.submitTime
+               <= simNow) {
+            newJobFromRec(&jobs[nextArrival].rec);
+            ++nextArrival;
+        }
+
+        while ((r = HEAP_TOP(runHeap))
+               && r->finishTime <= simNow) {
+            heap_pop(runHeap);
+            simFinish(r);
+        }
+
+        if (simNow < nextSched)
+            continue;
+
+        simSchedule();
+
+        numPend = LIST_NUM_ENTRIES((LIST_T *)jDataList[PJL])
+            + LIST_NUM_ENTRIES((LIST_T *)jDataList[MJL]);
+
+        if (nextArrival == numJobs
+            && HEAP_NUM_ENTRIES(runHeap) == 0)
+            break;
+
+        nextSched = simNow + msleeptime;
+        if (numPend == 0 && nextArrival < numJobs) {
+            t = jobs[nextArrival].rec.eventLog.jobNewLog.submitTime;
+            if (t > nextSched)
+                nextSched += ((t - nextSched + msleeptime - 1)
+                              / msleeptime) * msleeptime;
+        }
+    }
+}
+
+/* simAdvance()
+ */
+static void
+simAdvance(time_t t)
+{
+    if (t > simNow)
+        slotSeconds += (double)usedSlots * (t - simNow);
+
+    simNow = t;
+    now = t;
+}
+
+/* simSchedule()
+ *
+ * One scheduling session as mbatchd runs it, the
+ * simulated clock does not move so a session is
+ * never cut short by MAX_SCHED_STAY.
+ */
+static void
+simSchedule(void)
+{
+    struct simSession *s;
+    struct timeval t0;
+    struct timeval t1;
+    int numPend;
+    int cc;
+    int i;
+
+    numPend = LIST_NUM_ENTRIES((LIST_T *)jDataList[PJL])
+        + LIST_NUM_ENTRIES((LIST_T *)jDataList[MJL]);
+    sessionStarted = 0;
+    sessionFull = 0;
+    memset(&sessionTimers, 0, sizeof(struct schedTimers));
+
+    gettimeofday(&t0, NULL);
+
+    checkJgrpDep();
+    for (i = 0; i < 16; i++) {
+        if ((cc = scheduleAndDispatchJobs()) == 0)
+            break;
+    }
+    commitEventLog();
+
+    gettimeofday(&t1, NULL);
+
+    if (numSessions == sizeSessions) {
+        sizeSessions = sizeSessions ? 2 * sizeSessions : 1024;
+        sessions = realloc(sessions, sizeSessions * sizeof(struct simSession));
+        if (sessions == NULL)
+            mbdDie(MASTER_MEM);
+    }
+
+    s = &sessions[numSessions++];
+    s->simTime = simNow;
+    s->wallMs = (t1.tv_sec - t0.tv_sec) * 1000.0
+        + (t1.tv_usec - t0.tv_usec) / 1000.0;
+    s->numPend = numPend;
+    s->numStarted = sessionStarted;
+    s->full = sessionFull;
+    s->timers = sessionTimers;
+}
+
+/* simSessionEnd()
+ *
+ * Called by scheduleAndDispatchJobs() at the end of a
+ * session that went through the pending jobs, collect
+ * the timers and the counters before they are reset.
+ */
+static void
+simSessionEnd(struct schedTimers *t)
+{
+    int i;
+
+    sessionFull = 1;
+    sessionTimers = *t;
+
+    for (i = 0; counters[i].cntDescr != NULL; i++)
+        cntSum[i] += counters[i].cntVal;
+}
+
+/* simStartJob()
+ *
+ * The start_job() hook, the job runs on its hosts
+ * until its simulated runtime expires.
+ */
+static sbdReplyType
+simStartJob(struct jData *jp, struct qData *qp, struct jobReply *jobReply)
+{
+    struct simRun *r;
+    hEnt *e;
+    int runTime;
+
+    e = h_getEnt_(&runTab, lsb_jobid2str(jp->jobId));
+    if (e == NULL)
+        e = h_getEnt_(&runTab,
+                      lsb_jobid2str(LSB_ARRAY_JOBID(jp->jobId)));
+    if (e)
+        runTime = *(int *)e->hData;
+    else
+        runTime = (int)meanRunTime;
+
+    r = my_calloc(1, sizeof(struct simRun), __func__);
+    r->jobId = jp->jobId;
+    r->finishTime = simNow + runTime;
+    r->slots = jp->numHostPtr;
+    heap_insert(runHeap, r);
+
+    usedSlots += r->slots;
+
+    if (numStarted == sizeLatency) {
+        sizeLatency = sizeLatency ? 2 * sizeLatency : 1024;
+        latency = realloc(latency, sizeLatency * sizeof(double));
+        if (latency == NULL)
+            mbdDie(MASTER_MEM);
+    }
+    latency[numStarted] = simNow - jp->shared->jobBill.submitTime;
+    ++numStarted;
+    ++sessionStarted;
+
+    jobReply->jobId = jp->jobId;
+    jobReply->jobPid = 0;
+    jobReply->jobPGid = 0;
+    jobReply->jStatus = JOB_STAT_RUN;
+
+    return ERR_NO_ERROR;
+}
+
+/* simFinish()
+ */
+static void
+simFinish(struct simRun *r)
+{
+    struct jData *jp;
+
+    usedSlots -= r->slots;
+
+    jp = getJobData(r->jobId);
+    if (jp && IS_START(jp->jStatus)) {
+        jp->newReason = EXIT_NORMAL;
+        jp->exitStatus = 0;
+        jStatusChange(jp, JOB_STAT_DONE, LOG_IT, __func__);
+        ++numDone;
+    }
+
+    free(r);
+}
+
+/* simReport()
+ */
+static void
+simReport(void)
+{
+    struct schedTimers sum;
+    struct schedTimers max;
+    struct simSession *s;
+    double *v;
+    double span;
+    int numFull;
+    int i;
+
+#define SUM_TIMER(f)                            \
+    {                                           \
+        sum.f += s->timers.f;                   \
+        if (s->timers.f > max.f)                \
+            max.f = s->timers.f;                \
+    }
+
+    span = simNow - jobs[0].rec.eventLog.jobNewLog.submitTime;
+
+    if (keepDir)
+        printf("mbdsim: directory %s\n", simDir);
+    printf("cluster: %d hosts %d slots per host %d queues%s\n",
+           numHosts, numSlots, numQueues, fairPlugin ? " fairshare" : "");
+    printf("jobs: submitted %d started %d done %d not started %d\n",
+           nextArrival, numStarted, numDone,
+           LIST_NUM_ENTRIES((LIST_T *)jDataList[PJL])
+           + LIST_NUM_ENTRIES((LIST_T *)jDataList[MJL]));
+    printf("simulated time: %.0f s slot utilization %.2f%%\n",
+           span,
+           span > 0 ? 100.0 * slotSeconds / (span * numHosts * numSlots)
+           : 0.0);
+
+    if (numStarted > 0) {
+        qsort(latency, numStarted, sizeof(double), dblCmp);
+        printf("\
+dispatch latency s: p50 %.0f p90 %.0f p99 %.0f max %.0f\n",
+               pct(latency, numStarted, 0.50),
+               pct(latency, numStarted, 0.90),
+               pct(latency, numStarted, 0.99),
+               latency[numStarted - 1]);
+    }
+
+    memset(&sum, 0, sizeof(struct schedTimers));
+    memset(&max, 0, sizeof(struct schedTimers));
+    v = calloc(numSessions + 1, sizeof(double));
+    numFull = 0;
+    for (i = 0; i < numSessions; i++) {
+        s = &sessions[i];
+        v[i] = s->wallMs;
+        if (!s->full)
+            continue;
+        ++numFull;
+        SUM_TIMER(getQUsable);
+        SUM_TIMER(getCandHosts);
+        SUM_TIMER(getJUsable);
+        SUM_TIMER(readyToDisp);
+        SUM_TIMER(cntUQSlots);
+        SUM_TIMER(fsQelectPendJob);
+        SUM_TIMER(pickAJob);
+        SUM_TIMER(scheduleAJob);
+        SUM_TIMER(collectPendReason);
+    }
+
+    if (numSessions > 0) {
+        qsort(v, numSessions, sizeof(double), dblCmp);
+        printf("\
+sessions: %d scheduling %d wall ms p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+               numSessions, numFull,
+               pct(v, numSessions, 0.50),
+               pct(v, numSessions, 0.90),
+               pct(v, numSessions, 0.99),
+               v[numSessions - 1]);
+    }
+    free(v);
+
+    printf("timers ms total/max: getQUsable %d/%d getCandHosts %d/%d \
+getJUsable %d/%d readyToDisp %d/%d cntUQSlots %d/%d fsQelectPendJob %d/%d \
+pickAJob %d/%d scheduleAJob %d/%d collectPendReason %d/%d\n",
+           sum.getQUsable, max.getQUsable,
+           sum.getCandHosts, max.getCandHosts,
+           sum.getJUsable, max.getJUsable,
+           sum.readyToDisp, max.readyToDisp,
+           sum.cntUQSlots, max.cntUQSlots,
+           sum.fsQelectPendJob, max.fsQelectPendJob,
+           sum.pickAJob, max.pickAJob,
+           sum.scheduleAJob, max.scheduleAJob,
+           sum.collectPendReason, max.collectPendReason);
+
+    printf("counters:");
+    for (i = 0; counters[i].cntDescr != NULL; i++) {
+        if (cntSum[i] != 0)
+            printf(" %s %ld", counters[i].cntDescr, cntSum[i]);
+    }
+    printf("\n");
+
+    if (!perSession)
+        return;
+
+    printf("\
+session simtime pend started wall_ms getCandHosts getJUsable \
+readyToDisp cntUQSlots fsQelectPendJob pickAJob scheduleAJob\n");
+    for (i = 0; i < numSessions; i++) {
+        s = &sessions[i];
+        printf("%d %ld %d %d %.3f %d %d %d %d %d %d %d\n",
+               i,
+               (long)(s->simTime - jobs[0].rec.eventLog.jobNewLog.submitTime),
+               s->numPend,
+               s->numStarted,
+               s->wallMs,
+               s->timers.getCandHosts,
+               s->timers.getJUsable,
+               s->timers.readyToDisp,
+               s->timers.cntUQSlots,
+               s->timers.fsQelectPendJob,
+               s->timers.pickAJob,
+               s->timers.scheduleAJob);
+    }
+
+#undef SUM_TIMER
+}
+
+static int
+runCmp(const void *x, const void *y)
+{
+    const struct simRun *r1 = x;
+    const struct simRun *r2 = y;
+
+    if (r1->finishTime < r2->finishTime)
+        return -1;
+    if (r1->finishTime > r2->finishTime)
+        return 1;
+    return 0;
+}
+
+static int
+jobCmp(const void *x, const void *y)
+{
+    const struct simJob *j1 = x;
+    const struct simJob *j2 = y;
+
+    if (j1->rec.eventLog.jobNewLog.submitTime
+        < j2->rec.eventLog.jobNewLog.submitTime)
+        return -1;
+    if (j1->rec.eventLog.jobNewLog.submitTime
+        > j2->rec.eventLog.jobNewLog.submitTime)
+        return 1;
+    return 0;
+}
+
+static int
+dblCmp(const void *x, const void *y)
+{
+    double d1 = *(const double *)x;
+    double d2 = *(const double *)y;
+
+    if (d1 < d2)
+        return -1;
+    if (d1 > d2)
+        return 1;
+    return 0;
+}
+
+/* pct()
+ *
+ * Percentile of a sorted array.
+ */
+static double
+pct(double *v, int n, double p)
+{
+    int i;
+
+    i = (int)ceil(p * n) - 1;
+    if (i < 0)
+        i = 0;
+    if (i >= n)
+        i = n - 1;
+
+    return v[i];
+}
+
+/* The LIM library calls of mbatchd, the linker
+ * routes them here.
+ */
+
+time_t
+__wrap_time(time_t *t)
+{
+    if (!simClock)
+        return __real_time(t);
+
+    if (t)
+        *t = simNow;
+
+    return simNow;
+}
+
+char *
+__wrap_ls_getmastername(void)
+{
+    return ls_getmyhostname();
+}
+
+char *
+__wrap_ls_getclustername(void)
+{
+    return SIM_CLUSTER;
+}
+
+int
+__wrap_ls_isclustername(char *name)
+{
+    return strcmp(name, SIM_CLUSTER) == 0;
+}
+
+struct clusterInfo *
+__wrap_ls_clusterinfo(char *resReq,
+                      int *num,
+                      char **clusterList,
+                      int listsize,
+                      int options)
+{
+    strcpy(simCluster.clusterName, SIM_CLUSTER);
+    strcpy(simCluster.masterName, simHost);
+    simCluster.status = CLUST_STAT_OK;
+    simCluster.numServers = numHosts + 1;
+    *num = 1;
+
+    return &simCluster;
+}
+
+struct lsInfo *
+__wrap_ls_info(void)
+{
+    static struct lsInfo *info;
+    struct sharedConf *conf;
+    char buf[MAXFILENAMELEN];
+
+    if (info)
+        return info;
+
+    sprintf(buf, "%s/etc/lsf.shared", simDir);
+    if ((conf = ls_readshared(buf)) == NULL)
+        return NULL;
+
+    info = conf->lsinfo;
+
+    return info;
+}
+
+struct hostInfo *
+__wrap_ls_gethostinfo(char *resReq,
+                      int *num,
+                      char **hostList,
+                      int listsize,
+                      int options)
+{
+    struct lsInfo *info;
+    struct hostInfo *h;
+    int i;
+    int j;
+
+    *num = numHosts + 1;
+    if (simHosts)
+        return simHosts;
+
+    if ((info = __wrap_ls_info()) == NULL)
+        return NULL;
+
+    simHosts = calloc(numHosts + 1, sizeof(struct hostInfo));
+    for (i = 0; i <= numHosts; i++) {
+        h = &simHosts[i];
+        if (i == 0)
+            strcpy(h->hostName, simHost);
+        else
+            sprintf(h->hostName, "sim%05d", i - 1);
+        h->hostType = info->hostTypes[0];
+        h->hostModel = info->hostModels[0];
+        h->cpuFactor = info->cpuFactor[0];
+        h->maxCpus = numSlots;
+        h->maxMem = 64 * 1024;
+        h->maxSwap = 64 * 1024;
+        h->maxTmp = 64 * 1024;
+        h->windows = "-";
+        h->numIndx = info->numIndx;
+        h->busyThreshold = calloc(info->numIndx, sizeof(float));
+        for (j = 0; j < info->numIndx; j++) {
+            if (info->resTable[j].orderType == INCR)
+                h->busyThreshold[j] = INFINIT_LOAD;
+            else
+                h->busyThreshold[j] = -INFINIT_LOAD;
+        }
+        h->isServer = TRUE;
+    }
+
+    return simHosts;
+}
+
+struct hostLoad *
+__wrap_ls_loadofhosts(char *resReq,
+                      int *num,
+                      int options,
+                      char *fromHost,
+                      char **hostList,
+                      int listsize)
+{
+    struct lsInfo *info;
+    int i;
+    int j;
+
+    *num = numHosts + 1;
+    if (simLoads)
+        return simLoads;
+
+    if ((info = __wrap_ls_info()) == NULL
+        || __wrap_ls_gethostinfo(NULL, num, NULL, 0, 0) == NULL)
+        return NULL;
+
+    /* The hosts are idle, the load of the
+     * running jobs is accounted by mbatchd.
+     */
+    simLoads = calloc(numHosts + 1, sizeof(struct hostLoad));
+    for (i = 0; i <= numHosts; i++) {
+        strcpy(simLoads[i].hostName, simHosts[i].hostName);
+        simLoads[i].status = calloc(1 + GET_INTNUM(info->numIndx),
+                                    sizeof(int));
+        simLoads[i].li = calloc(info->numIndx, sizeof(float));
+        for (j = 0; j < info->numIndx; j++) {
+            if (info->resTable[j].orderType == DECR)
+                simLoads[i].li[j] = 64 * 1024;
+        }
+    }
+
+    return simLoads;
+}
+
+struct lsSharedResourceInfo *
+__wrap_ls_sharedresourceinfo(char **resources,
+                             int *numResources,
+                             char *hostName,
+                             int options)
+{
+    *numResources = 0;
+
+    return NULL;
+}
@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/syscall.h>
+#include "sbd.h"
+
+/* Bind the job slots to CPUs of this host.
+ *
+ * The queue AFFINITY policy comes with the jobSpecs,
+ * sbatchd picks one CPU per slot before starting the
+ * job and counts the jobs bound to each CPU in the
+ * numTasks of array_cpus. PACK takes the CPUs from
+ * the NUMA node with most idle CPUs, SPREAD takes
+ * them round robin across the nodes, MEMBIND binds
+ * the job memory to the nodes of its CPUs as well.
+ * The CPUs go back to mbatchd in the job status and
+ * with the jobSpecs after a sbatchd restart.
+ */
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+#define MAX_NUMA_NODES 1024
+
+struct cpuKey {
+    int cpu;
+    int node;
+    int numTasks;
+    int rank;
+};
+
+struct nodeLoad {
+    int node;
+    int numIdle;
+    int numTasks;
+    int numCPUs;
+    int next;
+};
+
+static int initCPUs(void);
+static int parseCPUList(const char *, int *, int);
+static void makeCPUList(int *, int, char *);
+static int pickCPUs(int, int, int *);
+static int cmpKeys(const void *, const void *);
+static int cmpNodes(const void *, const void *);
+static void countCPUs(int *, int, int);
+
+/* initCPUs()
+ *
+ * Get the CPUs of the host the first time
+ * a job needs them.
+ */
+static int
+initCPUs(void)
+{
+    if (array_cpus != NULL)
+        return numCPUs;
+
+    array_cpus = ls_get_cpu_info(&numCPUs);
+    if (array_cpus == NULL) {
+        numCPUs = 0;
+        ls_syslog(LOG_ERR, "%s: failed to get the host CPUs %M", __func__);
+        return -1;
+    }
+
+    return numCPUs;
+}
+
+/* jobHostSlots()
+ *
+ * The slots the job has on this host.
+ */
+int
+jobHostSlots(struct jobCard *jp)
+{
+    char *myhost;
+    int slots;
+    int i;
+
+    myhost = ls_getmyhostname();
+    slots = 0;
+    for (i = 0; myhost && i < jp->jobSpecs.numToHosts; i++) {
+        if (equalHost_(jp->jobSpecs.toHosts[i], myhost))
+            ++slots;
+    }
+
+    return slots;
+}
+
+/* bindJobCPUs()
+ *
+ * Choose the CPUs of a job of a queue with an
+ * AFFINITY policy and save them in the cpuBind
+ * of its jobSpecs.
+ */
+int
+bindJobCPUs(struct jobCard *jp)
+{
+    char *affinity;
+    char *buf;
+    int *cpus;
+    int slots;
+    int spread;
+
+    affinity = jp->jobSpecs.affinity;
+    if (affinity == NULL
+        || affinity[0] == 0
+        || jp->numBindCPUs > 0)
+        return 0;
+
+    if (initCPUs() <= 0)
+        return -1;
+
+    slots = jobHostSlots(jp);
+    if (slots <= 0)
+        slots = 1;
+    if (slots > numCPUs)
+        slots = numCPUs;
+
+    cpus = calloc(numCPUs, sizeof(int));
+    buf = calloc(numCPUs, 12);
+    if (cpus == NULL || buf == NULL) {
+        FREEUP(cpus);
+        FREEUP(buf);
+        return -1;
+    }
+
+    spread = (strncmp(affinity, "SPREAD", 6) == 0);
+    slots = pickCPUs(slots, spread, cpus);
+    countCPUs(cpus, slots, 1);
+    makeCPUList(cpus, slots, buf);
+
+    FREEUP(jp->jobSpecs.cpuBind);
+    jp->jobSpecs.cpuBind = safeSave(buf);
+    jp->numBindCPUs = slots;
+
+    ls_syslog(LOG_INFO, "%s: job %s affinity %s cpus %s", __func__,
+              lsb_jobid2str(jp->jobSpecs.jobId), affinity, buf);
+
+    free(cpus);
+    free(buf);
+
+    return slots;
+}
+
+/* setJobAffinity()
+ *
+ * Run by the job child before execJob(), the
+ * children of the job inherit the CPU mask and
+ * the memory policy.
+ */
+int
+setJobAffinity(struct jobCard *jp)
+{
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+    cpu_set_t cpuset;
+    int *cpus;
+    int num;
+    int maxNode;
+    int node;
+    int i;
+
+    if (jp->jobSpecs.cpuBind == NULL
+        || jp->jobSpecs.cpuBind[0] == 0
+        || numCPUs <= 0)
+        return 0;
+
+    cpus = calloc(numCPUs, sizeof(int));
+    if (cpus == NULL)
+        return -1;
+
+    num = parseCPUList(jp->jobSpecs.cpuBind, cpus, numCPUs);
+
+    CPU_ZERO(&cpuset);
+    memset(mask, 0, sizeof(mask));
+    maxNode = 0;
+    for (i = 0; i < num; i++) {
+        if (cpus[i] < 0 || cpus[i] >= numCPUs)
+            continue;
+        if (cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &cpuset);
+        node = array_cpus[cpus[i]].numNode;
+        if (node >= 0 && node < MAX_NUMA_NODES) {
+            mask[node / (8 * sizeof(unsigned long))]
+                |= 1UL << (node % (8 * sizeof(unsigned long)));
+            if (node > maxNode)
+                maxNode = node;
+        }
+    }
+    free(cpus);
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: sched_setaffinity() failed for job %s cpus %s %M", __func__,
+                  lsb_jobid2str(jp->jobSpecs.jobId), jp->jobSpecs.cpuBind);
+        return -1;
+    }
+
+    if (jp->jobSpecs.affinity
+        && strstr(jp->jobSpecs.affinity, "MEMBIND")
+        && syscall(SYS_set_mempolicy, MPOL_BIND, mask, maxNode + 2) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: set_mempolicy() failed for job %s cpus %s %M", __func__,
+                  lsb_jobid2str(jp->jobSpecs.jobId), jp->jobSpecs.cpuBind);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* releaseJobCPUs()
+ *
+ * The job is done with its CPUs, it is safe
+ * to call it more than once.
+ */
+void
+releaseJobCPUs(struct jobCard *jp)
+{
+    int *cpus;
+    int num;
+
+    if (jp->numBindCPUs <= 0
+        || numCPUs <= 0)
+        return;
+
+    jp->numBindCPUs = 0;
+
+    cpus = calloc(numCPUs, sizeof(int));
+    if (cpus == NULL)
+        return;
+
+    num = parseCPUList(jp->jobSpecs.cpuBind, cpus, numCPUs);
+    countCPUs(cpus, num, -1);
+    free(cpus);
+}
+
+/* recoverJobCPUs()
+ *
+ * A running job sent again by mbatchd after
+ * sbatchd restarted, count its CPUs.
+ */
+void
+recoverJobCPUs(struct jobCard *jp)
+{
+    int *cpus;
+    int num;
+
+    if (jp->jobSpecs.cpuBind == NULL
+        || jp->jobSpecs.cpuBind[0] == 0
+        || jp->numBindCPUs > 0)
+        return;
+
+    if (initCPUs() <= 0)
+        return;
+
+    cpus = calloc(numCPUs, sizeof(int));
+    if (cpus == NULL)
+        return;
+
+    num = parseCPUList(jp->jobSpecs.cpuBind, cpus, numCPUs);
+    countCPUs(cpus, num, 1);
+    jp->numBindCPUs = num;
+    free(cpus);
+}
+
+/* pickCPUs()
+ *
+ * The nodes are ranked by idle CPUs then by tasks,
+ * inside a node the CPUs with less tasks go first.
+ */
+static int
+pickCPUs(int slots, int spread, int *cpus)
+{
+    struct cpuKey *keys;
+    struct nodeLoad *nodes;
+    int numNodes;
+    int num;
+    int i;
+    int n;
+
+    numNodes = 0;
+    for (i = 0; i < numCPUs; i++) {
+        if (array_cpus[i].numNode >= numNodes)
+            numNodes = array_cpus[i].numNode + 1;
+    }
+
+    keys = calloc(numCPUs, sizeof(struct cpuKey));
+    nodes = calloc(numNodes, sizeof(struct nodeLoad));
+    if (keys == NULL || nodes == NULL) {
+        FREEUP(keys);
+        FREEUP(nodes);
+        for (i = 0; i < slots; i++)
+            cpus[i] = i;
+        return slots;
+    }
+
+    for (i = 0; i < numNodes; i++)
+        nodes[i].node = i;
+
+    for (i = 0; i < numCPUs; i++) {
+        n = array_cpus[i].numNode;
+        nodes[n].numCPUs++;
+        nodes[n].numTasks += array_cpus[i].numTasks;
+        if (array_cpus[i].numTasks == 0)
+            nodes[n].numIdle++;
+    }
+
+    qsort(nodes, numNodes, sizeof(struct nodeLoad), cmpNodes);
+
+    for (i = 0; i < numCPUs; i++) {
+        keys[i].cpu = array_cpus[i].numCPU;
+        keys[i].node = array_cpus[i].numNode;
+        keys[i].numTasks = array_cpus[i].numTasks;
+        for (n = 0; n < numNodes; n++) {
+            if (nodes[n].node == keys[i].node) {
+                keys[i].rank = n;
+                break;
+            }
+        }
+    }
+
+    /* The CPUs of a node follow each other in
+     * rank order.
+     */
+    qsort(keys, numCPUs, sizeof(struct cpuKey), cmpKeys);
+
+    if (! spread) {
+        for (i = 0; i < slots; i++)
+            cpus[i] = keys[i].cpu;
+        free(keys);
+        free(nodes);
+        return slots;
+    }
+
+    n = 0;
+    for (i = 0; i < numNodes; i++) {
+        nodes[i].next = n;
+        n += nodes[i].numCPUs;
+    }
+
+    num = 0;
+    while (num < slots) {
+        for (i = 0; i < numNodes && num < slots; i++) {
+            if (nodes[i].numCPUs == 0)
+                continue;
+            cpus[num++] = keys[nodes[i].next++].cpu;
+            nodes[i].numCPUs--;
+        }
+    }
+
+    free(keys);
+    free(nodes);
+
+    return num;
+}
+
+static int
+cmpNodes(const void *x, const void *y)
+{
+    const struct nodeLoad *n1 = x;
+    const struct nodeLoad *n2 = y;
+
+    if (n1->numIdle != n2->numIdle)
+        return n2->numIdle - n1->numIdle;
+    if (n1->numTasks != n2->numTasks)
+        return n1->numTasks - n2->numTasks;
+    return n1->node - n2->node;
+}
+
+static int
+cmpKeys(const void *x, const void *y)
+{
+    const struct cpuKey *k1 = x;
+    const struct cpuKey *k2 = y;
+
+    if (k1->rank != k2->rank)
+        return k1->rank - k2->rank;
+    if (k1->numTasks != k2->numTasks)
+        return k1->numTasks - k2->numTasks;
+    return k1->cpu - k2->cpu;
+}
+
+static void
+countCPUs(int *cpus, int num, int inc)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        if (cpus[i] < 0 || cpus[i] >= numCPUs)
+            continue;
+        array_cpus[cpus[i]].numTasks += inc;
+        if (array_cpus[cpus[i]].numTasks < 0)
+            array_cpus[cpus[i]].numTasks = 0;
+    }
+}
+
+/* makeCPUList()
+ *
+ * The cpuset list format, like 0-3,8,10.
+ */
+static void
+makeCPUList(int *cpus, int num, char *buf)
+{
+    int *sorted;
+    char *p;
+    int i;
+    int j;
+    int t;
+
+    sorted = cpus;
+    for (i = 1; i < num; i++) {
+        t = sorted[i];
+        for (j = i; j > 0 && sorted[j - 1] > t; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = t;
+    }
+
+    p = buf;
+    *p = 0;
+    for (i = 0; i < num; i = j) {
+        for (j = i + 1; j < num && sorted[j] == sorted[j - 1] + 1; j++)
+            ;
+        if (p != buf)
+            *p++ = ',';
+        if (j - 1 > i)
+            p += sprintf(p, "%d-%d", sorted[i], sorted[j - 1]);
+        else
+            p += sprintf(p, "%d", sorted[i]);
+    }
+}
+
+/* parseCPUList()
+ */
+static int
+parseCPUList(const char *list, int *cpus, int maxCPUs)
+{
+    const char *p;
+    int num;
+    int c0;
+    int c1;
+
+    num = 0;
+    p = list;
+    while (p && sscanf(p, "%d", &c0) == 1) {
+        c1 = c0;
+        while (*p >= '0' && *p <= '9')
+            ++p;
+        if (*p == '-') {
+            ++p;
+            if (sscanf(p, "%d", &c1) != 1)
+                break;
+            while (*p >= '0' && *p <= '9')
+                ++p;
+        }
+        for (; c0 <= c1 && num < maxCPUs; c0++)
+            cpus[num++] = c0;
+        if (*p != ',')
+            break;
+        ++p;
+    }
+
+    return num;
+}
@@ -32,6 +32,26 @@ static int msgSbd(LS_LONG_INT, char *, sbdReqType, int (*)());
 extern int jRusageUpdatePeriod;
 
 #define NL_SETN     11
+static int statusPreCheck(struct jobCard *, int);
+static void makeStatusReq(struct jobCard *, int, sbdReplyType,
+                          struct statusReq *);
+static int statusReqLen(struct statusReq *);
+static int statusJobReply(struct jobCard *, int);
+
+/* Status reports coalesced by statusBatchAdd() and
+ * sent to mbatchd as one BATCH_STATUS_CHUNK request
+ * by statusBatchFlush().
+ */
+#define STATUS_BATCH_MAX 64
+
+static struct {
+    int                 num;
+    struct jobCard      *jobs[STATUS_BATCH_MAX];
+    void                (*done[STATUS_BATCH_MAX])(struct jobCard *, int);
+    struct statusReq    reqs[STATUS_BATCH_MAX];
+    struct statusReq    *reqPtrs[STATUS_BATCH_MAX];
+} statusBatch;
+
 int
 status_job(mbdReqType reqType,
            struct jobCard *jp,
@@ -39,9 +59,7 @@ status_job(mbdReqType reqType,
            sbdReplyType err)
 {
     static char        fname[] = "status_job()";
-    static int         seq = 1;
     static char        lastHost[MAXHOSTNAMELEN];
-    int                reply;
     char               *request_buf;
     char               *reply_buf = NULL;
     XDR                xdrs;
@@ -49,7 +67,6 @@ status_job(mbdReqType reqType,
     int                cc;
     struct statusReq   statusReq;
     int                flags;
-    int                i;
     int                len;
     struct lsfAuth     *auth = NULL;
 
@@ -57,85 +74,11 @@ status_job(mbdReqType reqType,
         ls_syslog(LOG_DEBUG, "%s: Entering ... regType %d jobId %s",
                   fname, reqType, lsb_jobid2str(jp->jobSpecs.jobId));
 
-    if ( newStatus == JOB_STAT_EXIT ) {
-        jp->userJobSucc = FALSE;
-    }
-
-    if ( MASK_STATUS(newStatus) == JOB_STAT_DONE ) {
-        jp->userJobSucc = TRUE;
-    }
-
-    if ( IS_POST_FINISH(newStatus) ) {
-        if ( jp->userJobSucc != TRUE ) {
-            return 0;
-        }
-    }
-
-    if (masterHost == NULL)
-        return -1;
-
-    if (jp->notReported < 0) {
-        jp->notReported = -INFINIT_INT;
-        return 0;
-    }
-
-    statusReq.jobId = jp->jobSpecs.jobId;
-    statusReq.actPid = jp->jobSpecs.actPid;
-    statusReq.jobPid = jp->jobSpecs.jobPid;
-    statusReq.jobPGid = jp->jobSpecs.jobPGid;
-    statusReq.newStatus = newStatus;
-    statusReq.reason = jp->jobSpecs.reasons;
-    statusReq.subreasons = jp->jobSpecs.subreasons;
-    statusReq.sbdReply = err;
-    statusReq.lsfRusage = jp->lsfRusage;
-    statusReq.execUid = jp->jobSpecs.execUid;
-    statusReq.numExecHosts = 0;
-    statusReq.execHosts = NULL;
-    statusReq.exitStatus = jp->w_status;
-    statusReq.execCwd=jp->jobSpecs.execCwd;
-    statusReq.execHome=jp->jobSpecs.execHome;
-    statusReq.execUsername = jp->execUsername;
-    statusReq.queuePostCmd = "";
-    statusReq.queuePreCmd = "";
-    statusReq.msgId = jp->delieveredMsgId;
-
-    if ( IS_FINISH(newStatus) ) {
-        if (jp->maxRusage.mem > jp->runRusage.mem)
-            jp->runRusage.mem = jp->maxRusage.mem;
-        if (jp->maxRusage.swap > jp->runRusage.swap)
-            jp->runRusage.swap = jp->maxRusage.swap;
-        if (jp->maxRusage.stime > jp->runRusage.stime)
-            jp->runRusage.stime = jp->maxRusage.stime;
-        if (jp->maxRusage.utime > jp->runRusage.utime)
-            jp->runRusage.utime = jp->maxRusage.utime;
-    }
-    statusReq.runRusage.mem = jp->runRusage.mem;
-    statusReq.runRusage.swap = jp->runRusage.swap;
-    statusReq.runRusage.utime = jp->runRusage.utime;
-    statusReq.runRusage.stime = jp->runRusage.stime;
-    statusReq.runRusage.npids = jp->runRusage.npids;
-    statusReq.runRusage.pidInfo = jp->runRusage.pidInfo;
-    statusReq.runRusage.npgids = jp->runRusage.npgids;
-    statusReq.runRusage.pgid = jp->runRusage.pgid;
-    statusReq.actStatus = jp->actStatus;
-    statusReq.sigValue  = jp->jobSpecs.actValue;
-    statusReq.seq = seq;
-    seq++;
-    if (seq >= MAX_SEQ_NUM)
-        seq = 1;
-
-    len = 1024 +
-        ALIGNWORD_(sizeof (struct statusReq));
-
-    len += ALIGNWORD_(strlen (statusReq.execHome)) + 4 +
-        ALIGNWORD_(strlen (statusReq.execCwd)) + 4 +
-        ALIGNWORD_(strlen (statusReq.execUsername)) + 4;
+    if ((cc = statusPreCheck(jp, newStatus)) <= 0)
+        return cc;
 
-    for (i = 0; i < statusReq.runRusage.npids; i++)
-        len += ALIGNWORD_(sizeof (struct pidInfo)) + 4;
-
-    for (i = 0; i < statusReq.runRusage.npgids; i++)
-        len += ALIGNWORD_(sizeof (int)) + 4;
+    makeStatusReq(jp, newStatus, err, &statusReq);
+    len = statusReqLen(&statusReq);
 
     if (logclass & (LC_TRACE | LC_COMM))
         ls_syslog(LOG_DEBUG, "%s: The length of the job message is: <%d>", fname, len);
@@ -223,7 +166,205 @@ status_job(mbdReqType reqType,
             ls_syslog(LOG_DEBUG1, "%s: Job <%s> rd_select() failed, assume connection broken", fname, lsb_jobid2str(jp->jobSpecs.jobId));
         return -1;
     }
-    reply = hdr.opCode;
+
+    return statusJobReply(jp, hdr.opCode);
+}
+
+/* statusBatchAdd()
+ *
+ * Queue the status of the job for the next
+ * statusBatchFlush(), done() is called with the
+ * same return code status_job() would have given.
+ * Jobs whose status does not have to be sent are
+ * done right away.
+ */
+void
+statusBatchAdd(struct jobCard *jp,
+               int newStatus,
+               sbdReplyType err,
+               void (*done)(struct jobCard *, int))
+{
+    int cc;
+    int n;
+
+    if ((cc = statusPreCheck(jp, newStatus)) <= 0) {
+        (*done)(jp, cc);
+        return;
+    }
+
+    n = statusBatch.num;
+    makeStatusReq(jp, newStatus, err, &statusBatch.reqs[n]);
+    statusBatch.reqPtrs[n] = &statusBatch.reqs[n];
+    statusBatch.jobs[n] = jp;
+    statusBatch.done[n] = done;
+    statusBatch.num++;
+
+    if (statusBatch.num == STATUS_BATCH_MAX)
+        statusBatchFlush();
+}
+
+/* statusBatchFlush()
+ *
+ * Send all queued status reports in one request,
+ * mbatchd answers with one reply code per job.
+ */
+void
+statusBatchFlush(void)
+{
+    struct chunkStatusReq chunk;
+    int replies[STATUS_BATCH_MAX];
+    int num;
+    int cc;
+    int i;
+
+    if (statusBatch.num == 0)
+        return;
+
+    num = statusBatch.num;
+    statusBatch.num = 0;
+
+    chunk.numStatusReqs = num;
+    chunk.statusReqs = statusBatch.reqPtrs;
+
+    cc = sendUnreportedStatus(&chunk, replies);
+
+    if (logclass & LC_COMM)
+        ls_syslog(LOG_DEBUG, "\
+%s: sent %d job status to mbatchd cc %d", __func__, num, cc);
+
+    for (i = 0; i < num; i++) {
+        struct jobCard *jp = statusBatch.jobs[i];
+
+        if (cc < 0)
+            (*statusBatch.done[i])(jp, -1);
+        else
+            (*statusBatch.done[i])(jp, statusJobReply(jp, replies[i]));
+    }
+}
+
+/* statusPreCheck()
+ *
+ * Return 1 if the status must be sent to mbatchd,
+ * otherwise the return code of status_job().
+ */
+static int
+statusPreCheck(struct jobCard *jp, int newStatus)
+{
+    if ( newStatus == JOB_STAT_EXIT ) {
+        jp->userJobSucc = FALSE;
+    }
+
+    if ( MASK_STATUS(newStatus) == JOB_STAT_DONE ) {
+        jp->userJobSucc = TRUE;
+    }
+
+    if ( IS_POST_FINISH(newStatus) ) {
+        if ( jp->userJobSucc != TRUE ) {
+            return 0;
+        }
+    }
+
+    if (masterHost == NULL)
+        return -1;
+
+    if (jp->notReported < 0) {
+        jp->notReported = -INFINIT_INT;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+makeStatusReq(struct jobCard *jp,
+              int newStatus,
+              sbdReplyType err,
+              struct statusReq *statusReq)
+{
+    static int seq = 1;
+
+    statusReq->jobId = jp->jobSpecs.jobId;
+    statusReq->actPid = jp->jobSpecs.actPid;
+    statusReq->jobPid = jp->jobSpecs.jobPid;
+    statusReq->jobPGid = jp->jobSpecs.jobPGid;
+    statusReq->newStatus = newStatus;
+    statusReq->reason = jp->jobSpecs.reasons;
+    statusReq->subreasons = jp->jobSpecs.subreasons;
+    statusReq->sbdReply = err;
+    statusReq->lsfRusage = jp->lsfRusage;
+    statusReq->execUid = jp->jobSpecs.execUid;
+    statusReq->numExecHosts = 0;
+    statusReq->execHosts = NULL;
+    statusReq->exitStatus = jp->w_status;
+    statusReq->execCwd=jp->jobSpecs.execCwd;
+    statusReq->execHome=jp->jobSpecs.execHome;
+    statusReq->execUsername = jp->execUsername;
+    statusReq->queuePostCmd = "";
+    statusReq->queuePreCmd = "";
+    statusReq->msgId = jp->delieveredMsgId;
+    statusReq->cpuBind = jp->jobSpecs.cpuBind;
+
+    if ( IS_FINISH(newStatus) ) {
+        if (jp->maxRusage.mem > jp->runRusage.mem)
+            jp->runRusage.mem = jp->maxRusage.mem;
+        if (jp->maxRusage.swap > jp->runRusage.swap)
+            jp->runRusage.swap = jp->maxRusage.swap;
+        if (jp->maxRusage.stime > jp->runRusage.stime)
+            jp->runRusage.stime = jp->maxRusage.stime;
+        if (jp->maxRusage.utime > jp->runRusage.utime)
+            jp->runRusage.utime = jp->maxRusage.utime;
+    }
+    statusReq->runRusage.mem = jp->runRusage.mem;
+    statusReq->runRusage.swap = jp->runRusage.swap;
+    statusReq->runRusage.utime = jp->runRusage.utime;
+    statusReq->runRusage.stime = jp->runRusage.stime;
+    statusReq->runRusage.npids = jp->runRusage.npids;
+    statusReq->runRusage.pidInfo = jp->runRusage.pidInfo;
+    statusReq->runRusage.npgids = jp->runRusage.npgids;
+    statusReq->runRusage.pgid = jp->runRusage.pgid;
+    statusReq->actStatus = jp->actStatus;
+    statusReq->sigValue  = jp->jobSpecs.actValue;
+    statusReq->seq = seq;
+    seq++;
+    if (seq >= MAX_SEQ_NUM)
+        seq = 1;
+}
+
+static int
+statusReqLen(struct statusReq *statusReq)
+{
+    int len;
+    int i;
+
+    len = 1024 +
+        ALIGNWORD_(sizeof (struct statusReq));
+
+    len += ALIGNWORD_(strlen (statusReq->execHome)) + 4 +
+        ALIGNWORD_(strlen (statusReq->execCwd)) + 4 +
+        ALIGNWORD_(strlen (statusReq->execUsername)) + 4;
+
+    if (statusReq->cpuBind)
+        len += ALIGNWORD_(strlen (statusReq->cpuBind)) + 4;
+
+    for (i = 0; i < statusReq->runRusage.npids; i++)
+        len += ALIGNWORD_(sizeof (struct pidInfo)) + 4;
+
+    for (i = 0; i < statusReq->runRusage.npgids; i++)
+        len += ALIGNWORD_(sizeof (int)) + 4;
+
+    return len;
+}
+
+/* statusJobReply()
+ *
+ * Act on the reply of mbatchd to the status
+ * of one job.
+ */
+static int
+statusJobReply(struct jobCard *jp, int reply)
+{
+    static char fname[] = "status_job()";
+
     switch (reply) {
         case LSBE_NO_ERROR:
         case LSBE_LOCK_JOB:
@@ -594,8 +735,15 @@ msgSupervisor(struct lsbMsg *lsbMsg, struct clientNode *cliPtr)
     return 0;
 }
 
+/* sendUnreportedStatus()
+ *
+ * Send a chunk of job status to mbatchd, the
+ * per job reply codes are returned in replies.
+ * An mbatchd that only replies with the header
+ * accepted all of them.
+ */
 int
-sendUnreportedStatus (struct chunkStatusReq *chunkStatusReq)
+sendUnreportedStatus(struct chunkStatusReq *chunkStatusReq, int *replies)
 {
     static char        fname[] = "sendUnreportedStatus()";
     static char        lastHost[MAXHOSTNAMELEN];
@@ -627,6 +775,8 @@ sendUnreportedStatus (struct chunkStatusReq *chunkStatusReq)
         len += ALIGNWORD_(strlen (chunkStatusReq->statusReqs[i]->execHome)) + 4 +
             ALIGNWORD_(strlen (chunkStatusReq->statusReqs[i]->execCwd)) + 4 +
             ALIGNWORD_(strlen (chunkStatusReq->statusReqs[i]->execUsername)) + 4;
+        if (chunkStatusReq->statusReqs[i]->cpuBind)
+            len += ALIGNWORD_(strlen (chunkStatusReq->statusReqs[i]->cpuBind)) + 4;
 
         for (j = 0; j < chunkStatusReq->statusReqs[i]->runRusage.npids; j++)
             len += ALIGNWORD_(sizeof (struct pidInfo)) + 4;
@@ -699,10 +849,39 @@ sendUnreportedStatus (struct chunkStatusReq *chunkStatusReq)
     xdr_destroy(&xdrs);
     FREEUP(request_buf);
 
+    reply = hdr.opCode;
+    for (i = 0; i < chunkStatusReq->numStatusReqs; i++)
+        replies[i] = reply;
+
+    if (cc > 0) {
+        int num;
+
+        xdrmem_create(&xdrs, reply_buf, cc, XDR_DECODE);
+        if (!xdr_int(&xdrs, &num)
+            || num != chunkStatusReq->numStatusReqs) {
+            ls_syslog(LOG_ERR, "\
+%s: bad reply for %d jobs from mbatchd on host <%s>", __func__,
+                      chunkStatusReq->numStatusReqs, masterHost);
+            xdr_destroy(&xdrs);
+            free(reply_buf);
+            return -1;
+        }
+        for (i = 0; i < num; i++) {
+            if (!xdr_int(&xdrs, &replies[i])) {
+                ls_syslog(LOG_ERR, "\
+%s: xdr_int() failed for reply %d from mbatchd on host <%s>", __func__,
+                          i, masterHost);
+                xdr_destroy(&xdrs);
+                free(reply_buf);
+                return -1;
+            }
+        }
+        xdr_destroy(&xdrs);
+    }
+
     if (cc)
         free(reply_buf);
 
-    reply = hdr.opCode;
     switch (reply) {
         case LSBE_NO_ERROR:
             return 0;
@@ -105,6 +105,9 @@ struct jobCard {
     char   *spooledExec;
     char   postJobStarted;
     char   userJobSucc;
+    struct lenData *jobFile;
+    int    goFd;
+    int    numBindCPUs;
 };
 
 typedef enum {
@@ -133,6 +136,7 @@ struct clientNode {
     int jobType;
     LS_LONG_INT jobId;
     struct jobCard *jp;
+    int    dispatch;
 };
 
 struct jobSetup {
@@ -161,6 +165,7 @@ struct jobSyslog {
 
 extern bool_t cgroup_cpuset_mounted;
 extern bool_t cgroup_memory_mounted;
+extern bool_t cgroup_v2;
 extern char *cpuset_mount;
 extern char *memory_mount;
 
@@ -228,6 +233,9 @@ extern void start_master(void);
 extern void shutDownClient(struct clientNode *);
 
 extern void do_newjob(XDR *xdrs, int s, struct LSFHeader *);
+extern void do_newjobs(XDR *, int, struct LSFHeader *);
+extern void do_jobsGo(XDR *, int, struct LSFHeader *);
+extern void closeJobsGo(void);
 extern void do_switchjob(XDR *xdrs, int s, struct LSFHeader *);
 extern void do_sigjob(XDR *xdrs, int s, struct LSFHeader *);
 extern void do_probe(XDR *xdrs, int s, struct LSFHeader *);
@@ -245,12 +253,16 @@ extern int status_job(mbdReqType, struct jobCard *, int, sbdReplyType);
 extern void sbdSyslog(int, char *);
 extern void jobSetupStatus(int, int, struct jobCard *);
 extern int msgSupervisor(struct lsbMsg *, struct clientNode *);
-extern int sendUnreportedStatus (struct chunkStatusReq *chunkStatusReq);
+extern int sendUnreportedStatus(struct chunkStatusReq *, int *);
+extern void statusBatchAdd(struct jobCard *, int, sbdReplyType,
+                           void (*)(struct jobCard *, int));
+extern void statusBatchFlush(void);
 extern struct jobCard *addJob(struct jobSpecs *, int);
 extern void refreshJob(struct jobSpecs *);
 extern sbdReplyType job_exec(struct jobCard *jobCardPtr, int);
 extern void status_report(void);
 extern int job_finish (struct jobCard *, int);
+extern void job_finish_batch(struct jobCard *);
 extern void setRunLimit(struct jobCard *, int);
 extern void inJobLink(struct jobCard *);
 extern void deallocJobCard(struct jobCard *);
@@ -267,6 +279,13 @@ extern int runQPost(struct jobCard *);
 extern int postJobSetup(struct jobCard *);
 extern void runUPre(struct jobCard *);
 extern int reniceJob(struct jobCard *);
+extern struct jRusage *cgroupJobRusage(struct jobCard *);
+
+extern int jobHostSlots(struct jobCard *);
+extern int bindJobCPUs(struct jobCard *);
+extern int setJobAffinity(struct jobCard *);
+extern void releaseJobCPUs(struct jobCard *);
+extern void recoverJobCPUs(struct jobCard *);
 extern int updateRUsageFromSuper(struct jobCard *jp, char *mbuf);
 extern void sbdChild(char *, char *);
 extern int initJobCard(struct jobCard *jp, struct jobSpecs *jobSpecs, int *);
@@ -61,6 +61,11 @@ static char **execArgs(struct jobSpecs *jp, char **execArgv);
 static void jobFinishRusage(struct jobCard *jp);
 static void initJRusage(struct jRusage *);
 static int getJobVersion (struct jobSpecs *);
+static int jobFinished(struct jobCard *);
+static void finishReported(struct jobCard *, int);
+static void statusReported(struct jobCard *, int);
+static char mailed = TRUE;
+static int allReported = TRUE;
 extern int sbdlog_newstatus (struct jobCard *jp);
 extern void copyJUsage(struct jRusage *to, struct jRusage *from);
 extern int jRunSuspendAct(struct jobCard *jp, int sigValue, int jState,
@@ -132,6 +137,7 @@ job_exec(struct jobCard *jobCardPtr, int chfd)
 {
     struct jobSpecs *jobSpecsPtr;
     int pid;
+    int goPipe[2];
 
     jobSpecsPtr = &(jobCardPtr->jobSpecs);
     if (logclass & LC_EXEC) {
@@ -143,22 +149,58 @@ job_exec(struct jobCard *jobCardPtr, int chfd)
     jobSpecsPtr->reasons = 0;
     jobSpecsPtr->subreasons = 0;
 
+    /* The job came over the dispatch channel,
+     * the go-ahead is relayed to the child
+     * through a pipe.
+     */
+    if (jobCardPtr->jobFile
+        && pipe(goPipe) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: pipe() failed starting job %s: %m",
+                  __func__, lsb_jobid2str(jobSpecsPtr->jobId));
+        return ERR_FORK_FAIL;
+    }
+
+    if (bindJobCPUs(jobCardPtr) < 0)
+        ls_syslog(LOG_ERR, "\
+%s: failed to bind job %s to CPUs, running it unbound",
+                  __func__, lsb_jobid2str(jobSpecsPtr->jobId));
+
     pid = fork();
 
     if (pid < 0) {
         ls_syslog(LOG_ERR, "\
 %s: ohmygosh fork() failed starting job %s: %m",
                   __func__, lsb_jobid2str(jobSpecsPtr->jobId));
+        releaseJobCPUs(jobCardPtr);
+        if (jobCardPtr->jobFile) {
+            close(goPipe[0]);
+            close(goPipe[1]);
+            jobCardPtr->jobFile = NULL;
+        }
         return ERR_FORK_FAIL;
     }
 
     if (pid == 0) {
         closeBatchSocket();
         sbdChildCloseChan (chfd);
+        if (jobCardPtr->jobFile) {
+            closeJobsGo();
+            close(goPipe[1]);
+            jobCardPtr->goFd = goPipe[0];
+        }
+        setJobAffinity(jobCardPtr);
         execJob(jobCardPtr, chfd);
         exit(-1);
     }
 
+    if (jobCardPtr->jobFile) {
+        close(goPipe[0]);
+        jobCardPtr->goFd = goPipe[1];
+        fcntl(jobCardPtr->goFd, F_SETFD, FD_CLOEXEC);
+        jobCardPtr->jobFile = NULL;
+    }
+
     jobSpecsPtr->jobPid = pid;
 
     if (jobSpecsPtr->options & SUB_RESTART)
@@ -291,15 +333,36 @@ execJob(struct jobCard *jobCardPtr, int chfd)
     jobSpecsPtr->jobPGid = jobSpecsPtr->jobPid;
     jobCardPtr->stdinFile = NULL;
 
-    if (rcvJobFile(chfd, &jf) == -1) {
+    if (jobCardPtr->goFd >= 0) {
+        /* Job file and go-ahead from the
+         * dispatch channel.
+         */
+        jf = *jobCardPtr->jobFile;
+        if (daemonParams[LSB_BSUBI_OLD].paramValue
+            || !PURE_INTERACTIVE(jobSpecsPtr)) {
+            char go;
+
+            if (read(jobCardPtr->goFd, &go, 1) != 1 || go != '1') {
+                ls_syslog(LOG_WARNING, "\
+%s: Fail to get go-ahead from mbatchd; abort job %s",
+                          fname, lsb_jobid2str(jobSpecsPtr->jobId));
+                jobSetupStatus(JOB_STAT_PEND, PEND_JOB_START_FAIL,
+                               jobCardPtr);
+            }
+        }
+        close(jobCardPtr->goFd);
+        jobCardPtr->goFd = -1;
+
+    } else if (rcvJobFile(chfd, &jf) == -1) {
         ls_syslog(LOG_ERR, "\
 %s: failed receiving job file job %s", __func__,
                   lsb_jobid2str(jobSpecsPtr->jobId));
         jobSetupStatus(JOB_STAT_PEND, PEND_JOB_NO_FILE, jobCardPtr);
     }
 
-    if (daemonParams[LSB_BSUBI_OLD].paramValue
-        || !PURE_INTERACTIVE(jobSpecsPtr)) {
+    if (chfd >= 0
+        && (daemonParams[LSB_BSUBI_OLD].paramValue
+            || !PURE_INTERACTIVE(jobSpecsPtr))) {
 
         xdrmem_create(&xdrs, buf, MSGSIZE, XDR_DECODE);
         if (readDecodeHdr_(chfd, buf, chanRead_, &xdrs, &replyHdr) < 0) {
@@ -998,7 +1061,6 @@ int
 job_finish(struct jobCard *jobCard, int report)
 {
     static char fname[] = "job_finish";
-    int pid;
 
     if (logclass & LC_EXEC)
         ls_syslog(LOG_DEBUG,
@@ -1020,6 +1082,51 @@ job_finish(struct jobCard *jobCard, int report)
         return -1;
     }
 
+    return jobFinished(jobCard);
+}
+
+/* job_finish_batch()
+ *
+ * Same as job_finish(jobCard, TRUE) but the status
+ * report is queued with statusBatchAdd(), the job is
+ * cleaned up by finishReported() once mbatchd has
+ * answered. The caller must statusBatchFlush().
+ */
+void
+job_finish_batch(struct jobCard *jobCard)
+{
+    if (jobCard->jobSpecs.actPid)
+        return;
+
+    unlockHosts(jobCard, jobCard->jobSpecs.numToHosts);
+
+    statusBatchAdd(jobCard, jobCard->jobSpecs.jStatus,
+                   (jobCard->jobSpecs.startTime > bootTime) ?
+                   ERR_NO_ERROR : ERR_HOST_BOOT, finishReported);
+}
+
+static void
+finishReported(struct jobCard *jobCard, int cc)
+{
+    if (cc < 0) {
+        jobCard->notReported++;
+        return;
+    }
+
+    jobFinished(jobCard);
+}
+
+/* jobFinished()
+ *
+ * Mbatchd knows the job is finished, run the
+ * post execution and free the job card.
+ */
+static int
+jobFinished(struct jobCard *jobCard)
+{
+    static char fname[] = "job_finish";
+    int pid;
+
     if ((jobCard->jobSpecs.jStatus & JOB_STAT_PEND) &&
         (jobCard->jobSpecs.reasons == PEND_JOB_START_FAIL ||
          jobCard->jobSpecs.reasons == PEND_JOB_NO_FILE)) {
@@ -1027,9 +1134,11 @@ job_finish(struct jobCard *jobCard, int report)
         return 0;
     }
 
-    /* Clean up the cgroup hierarchy of this job.
+    /* Clean up the cgroup hierarchy of this job
+     * and give back its CPUs.
      */
     rm_mem_cgroup(jobCard);
+    releaseJobCPUs(jobCard);
 
     if ( !jobCard->postJobStarted ) {
         pid = fork();
@@ -1164,10 +1273,7 @@ finishJob(struct jobCard *jobCard)
 void
 status_report (void)
 {
-    static char fname[] = "status_report()";
     struct jobCard *jp, *next;
-    static char mailed = TRUE;
-    int rep, allReported = TRUE;
 
     if (logclass & LC_TRACE)
         ls_syslog(LOG_DEBUG2,"status_report: Entering..");
@@ -1181,7 +1287,7 @@ status_report (void)
             && !IS_POST_FINISH(jp->jobSpecs.jStatus) ) {
             ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 5418,
                                              "%s: Illegal job status <%d> of job <%s> found; re-life"), /* catgets 5418 */
-                      fname, jp->jobSpecs.jStatus, lsb_jobid2str(jp->jobSpecs.jobId));
+                      __func__, jp->jobSpecs.jStatus, lsb_jobid2str(jp->jobSpecs.jobId));
             relife();
         }
 
@@ -1204,38 +1310,40 @@ status_report (void)
         /* don't retry other jobs either */
 
         if (IS_START(jp->jobSpecs.jStatus)) {
-            mbdReqType reqType;
 
             if (!jp->notReported && jp->needReportRU)
-                reqType = BATCH_RUSAGE_JOB;
+                status_job(BATCH_RUSAGE_JOB, jp, jp->jobSpecs.jStatus,
+                           ERR_NO_ERROR);
             else
-                reqType = BATCH_STATUS_JOB;
-
-            rep = status_job (reqType, jp, jp->jobSpecs.jStatus,
-                              ERR_NO_ERROR);
-
-            if (reqType == BATCH_STATUS_JOB) {
-                if (rep >= 0) {
-                    if (jp->notReported > 0)
-                        jp->notReported = 0;
-                } else {
-                    allReported = FALSE;
-                    jp->notReported++;
-                    if (jp->notReported == 40 && !mailed) {
-                        mailed = TRUE;
-                        lsb_merr(_i18n_printf(_i18n_msg_get(ls_catd , NL_SETN, 411,
-                                                            "%s: unable to report job %s status to master; retried %d times\n"), /* catgets 411 */
-                                              fname, lsb_jobid2str(jp->jobSpecs.jobId), jp->notReported));
-                    }
-                }
-            }
+                statusBatchAdd(jp, jp->jobSpecs.jStatus,
+                               ERR_NO_ERROR, statusReported);
         }
     }
 
+    statusBatchFlush();
 
     if (allReported == TRUE)
         mailed = FALSE;
+    allReported = TRUE;
+}
+
+static void
+statusReported(struct jobCard *jp, int rep)
+{
+    if (rep >= 0) {
+        if (jp->notReported > 0)
+            jp->notReported = 0;
+        return;
+    }
 
+    allReported = FALSE;
+    jp->notReported++;
+    if (jp->notReported == 40 && !mailed) {
+        mailed = TRUE;
+        lsb_merr(_i18n_printf(_i18n_msg_get(ls_catd , NL_SETN, 411,
+                                            "%s: unable to report job %s status to master; retried %d times\n"), /* catgets 411 */
+                              "status_report()", lsb_jobid2str(jp->jobSpecs.jobId), jp->notReported));
+    }
 }
 
 void
@@ -2150,6 +2258,7 @@ addJob (struct jobSpecs *jobSpecs, int mbdVersion)
             ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 5421,
                                              "%s: lockHosts() failed for job <%s>; Host used by the job will not be locked"), fname, lsb_jobid2str(jp->jobSpecs.jobId)); /* catgets 5421 */
         }
+    recoverJobCPUs(jp);
     renewJobStat (jp);
 
 
@@ -2593,7 +2702,9 @@ deallocJobCard(struct jobCard *jobCard)
 
     offList ((struct listEntry *)jobCard);
     freeWeek (jobCard->week);
+    releaseJobCPUs(jobCard);
     freeToHostsEtc (&jobCard->jobSpecs);
+    FREEUP(jobCard->jobSpecs.cpuBind);
 
 
     if (jobCard->runRusage.npgids > 0) {
@@ -2655,6 +2766,7 @@ freeToHostsEtc (struct jobSpecs *jobSpecs)
     FREEUP (jobSpecs->loginShell);
     FREEUP (jobSpecs->schedHostType);
     FREEUP (jobSpecs->execHosts);
+    FREEUP (jobSpecs->affinity);
 
 }
 
@@ -2705,6 +2817,16 @@ saveSpecs (struct jobSpecs *jobSpecs, struct jobSpecs *specs)
     jobSpecs->schedHostType = safeSave (specs->schedHostType);
     if (specs->execHosts != NULL)
         jobSpecs->execHosts = safeSave (specs->execHosts);
+    if (specs->affinity != NULL)
+        jobSpecs->affinity = safeSave (specs->affinity);
+
+    /* The CPUs are chosen by sbatchd, keep the
+     * ones the job has.
+     */
+    if (jobSpecs->cpuBind == NULL
+        && specs->cpuBind != NULL
+        && specs->cpuBind[0] != '\0')
+        jobSpecs->cpuBind = safeSave (specs->cpuBind);
 
 }
 
@@ -3853,6 +3975,9 @@ initJobCard(struct jobCard *jp, struct jobSpecs *jobSpecs, int *reply)
     jp->actStatus = ACT_NO;
 
     jp->jobSpecs.execHosts = NULL;
+    jp->jobSpecs.affinity = NULL;
+    jp->jobSpecs.cpuBind = NULL;
+    jp->numBindCPUs = 0;
 
 
     ls_syslog(LOG_DEBUG, "options2=%x ", jobSpecs->options2);
@@ -3874,6 +3999,8 @@ initJobCard(struct jobCard *jp, struct jobSpecs *jobSpecs, int *reply)
 
     jp->postJobStarted = 0;
     jp->userJobSucc = FALSE;
+    jp->jobFile = NULL;
+    jp->goFd = -1;
 
     return 0;
 }
@@ -4065,12 +4192,18 @@ setJobArrayEnv(char *jobName, int jobIndex)
 }
 
 /* setup_mem_cgroup()
+ *
+ * With cgroup v2 the job cgroup also gets as
+ * many CPUs worth of time as the job has slots
+ * on this host.
  */
 static void
 setup_mem_cgroup(struct jobCard *jPtr)
 {
     struct rlimit rlimit;
     char job_id[64];
+    char *cpus;
+    int slots;
 
     rlimitDecode_(&jPtr->jobSpecs.lsfLimits[LSF_RLIMIT_RSS],
                   &rlimit,
@@ -4078,6 +4211,28 @@ setup_mem_cgroup(struct jobCard *jPtr)
 
     sprintf(job_id, "%s", lsb_jobid2str(jPtr->jobSpecs.jobId));
 
+    if (cgroup_v2) {
+
+        slots = jobHostSlots(jPtr);
+        cpus = jPtr->jobSpecs.cpuBind;
+        if (cpus && cpus[0] == 0)
+            cpus = NULL;
+
+        if (lsb_constrain_cgroup2(job_id,
+                                  jPtr->jobSpecs.jobPid,
+                                  rlimit.rlim_cur,
+                                  slots,
+                                  cpus) < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: failed to setup the cgroup of job %s: %m", __func__, job_id);
+            return;
+        }
+
+        ls_syslog(LOG_INFO, "%s: job %s cgroup v2 mem %lu cpus %d", __func__,
+                  job_id, rlimit.rlim_cur, slots);
+        return;
+    }
+
     lsb_constrain_mem(job_id, rlimit.rlim_cur, jPtr->jobSpecs.jobPid);
 
     ls_syslog(LOG_INFO, "%s: job %s cur %lu max %lu", __func__,
@@ -4093,7 +4248,58 @@ rm_mem_cgroup(struct jobCard *jPtr)
     char job_id[64];
 
     sprintf(job_id, "%s", lsb_jobid2str(jPtr->jobSpecs.jobId));
+
+    if (cgroup_v2) {
+        if (lsb_rmcgroup2(job_id) < 0)
+            ls_syslog(LOG_ERR, "\
+%s: failed to remove the cgroup of job %s: %m", __func__, job_id);
+        return;
+    }
+
     lsb_rmcgroup_mem(job_id, jPtr->jobSpecs.jobPid);
 
     ls_syslog(LOG_INFO, "%s: cleanup job %s", __func__, job_id);
 }
+
+/* cgroupJobRusage()
+ *
+ * The job usage from its cgroup v2, NULL if
+ * the job has no cgroup. The cgroup lists the
+ * processes but not their groups, they are all
+ * put in the process group of the job.
+ */
+struct jRusage *
+cgroupJobRusage(struct jobCard *jPtr)
+{
+    static int pgid;
+    struct cgroupUsage cu;
+    struct jRusage *jru;
+    char job_id[64];
+    int i;
+
+    if (!cgroup_v2)
+        return NULL;
+
+    sprintf(job_id, "%s", lsb_jobid2str(jPtr->jobSpecs.jobId));
+
+    if ((jru = lsb_cgroup2_rusage(job_id, &cu)) == NULL)
+        return NULL;
+
+    pgid = jPtr->jobSpecs.jobPGid;
+    for (i = 0; i < jru->npids; i++) {
+        jru->pidInfo[i].pgid = pgid;
+        jru->pidInfo[i].jobid = pgid;
+    }
+    jru->pgid = &pgid;
+    jru->npgids = 1;
+
+    if (logclass & (LC_SIGNAL|LC_EXEC))
+        ls_syslog(LOG_DEBUG, "\
+%s: job %s mem %d swap %d utime %d stime %d npids %d npgids %d \
+usage_usec %lld current %lld peak %lld rbytes %lld wbytes %lld",
+                  __func__, job_id, jru->mem, jru->swap, jru->utime,
+                  jru->stime, jru->npids, jru->npgids, cu.usageUsec,
+                  cu.memCurrent, cu.memPeak, cu.rbytes, cu.wbytes);
+
+    return jru;
+}
@@ -29,6 +29,7 @@ static void init_sstate(void);
 static void processMsg(struct clientNode *);
 static void clientIO(struct Masks *);
 static void houseKeeping(void);
+static void init_cgroup(void);
 static int authCmdRequest(struct clientNode *,
                           XDR *,
 			  struct LSFHeader *);
@@ -51,6 +52,11 @@ char masterme = FALSE;
 char master_unknown = TRUE;
 char myStatus = 0;
 char need_checkfinish = FALSE;
+/* Milliseconds to wait after a job finished for
+ * other jobs to finish so that their status is
+ * reported to mbatchd in one request.
+ */
+static int statusBatchWindow = 100;
 int  failcnt = 0;
 ushort sbd_port;
 ushort mbd_port;
@@ -65,6 +71,7 @@ char   *cpuset_mount = NULL;
 char   *memory_mount = NULL;
 bool_t cgroup_memory_mounted = false;
 bool_t cgroup_cpuset_mounted = false;
+bool_t cgroup_v2 = false;
 struct infoCPUs *array_cpus;
 
 int    jobTerminateInterval = DEF_JTERMINATE_INTERVAL;
@@ -125,6 +132,7 @@ main(int argc, char **argv)
     int nready, i;
     sigset_t oldsigmask, newmask;
     struct timeval timeout;
+    struct timeval finishSince;
     struct Masks sockmask, chanmask;
     int aopt;
     char *msg = NULL;
@@ -283,6 +291,16 @@ main(int argc, char **argv)
 	}
     }
 
+    if (daemonParams[LSB_STATUS_BATCH_WINDOW].paramValue != NULL) {
+        statusBatchWindow = atoi(daemonParams[LSB_STATUS_BATCH_WINDOW].paramValue);
+        if (statusBatchWindow < 0 || statusBatchWindow > 1000) {
+            ls_syslog(LOG_ERR, "\
+%s: LSB_STATUS_BATCH_WINDOW <%s> in lsf.conf is invalid, using 100", __func__,
+                      daemonParams[LSB_STATUS_BATCH_WINDOW].paramValue);
+            statusBatchWindow = 100;
+        }
+    }
+
     now = time(NULL);
 
     for (i = 0; i < 8; i++)
@@ -290,6 +308,7 @@ main(int argc, char **argv)
 
     timeout.tv_sec = 0;
     timeout.tv_usec = 0;
+    finishSince.tv_sec = 0;
 
     while ((allLsInfo = ls_info()) == NULL) {
         ls_syslog(LOG_ERR, "%s: ls_info() failed: %M; trying ...", __func__);
@@ -336,12 +355,29 @@ main(int argc, char **argv)
 
 	sigprocmask(SIG_SETMASK, &oldsigmask, NULL);
 
+        /* Give the jobs finishing together a chance
+         * to be reported in the same batch.
+         */
         if (need_checkfinish) {
-            need_checkfinish = FALSE;
-	    TIMEIT(1, checkFinish(), "checkFinish");
+            struct timeval tv;
+            int waited;
+
+            gettimeofday(&tv, NULL);
+            if (finishSince.tv_sec == 0)
+                finishSince = tv;
+            waited = (tv.tv_sec - finishSince.tv_sec) * 1000
+                + (tv.tv_usec - finishSince.tv_usec) / 1000;
+
+            if (waited >= statusBatchWindow) {
+                need_checkfinish = FALSE;
+                finishSince.tv_sec = 0;
+                TIMEIT(1, checkFinish(), "checkFinish");
+            } else {
+                timeout.tv_sec = 0;
+                timeout.tv_usec = (statusBatchWindow - waited) * 1000;
+            }
         }
 
-        FD_ZERO(&sockmask.rmask);
 	houseKeeping();
 
         nready = chanSelect_(&sockmask, &chanmask, &timeout);
@@ -355,6 +391,7 @@ main(int argc, char **argv)
         }
 
         timeout.tv_sec = sbdSleepTime;
+        timeout.tv_usec = 0;
 	sigemptyset(&newmask);
 	sigaddset(&newmask, SIGCHLD);
 	sigprocmask(SIG_BLOCK, &newmask, NULL);
@@ -366,18 +403,18 @@ main(int argc, char **argv)
         }
 
 	if (statusChan >= 0
-            && (FD_ISSET(statusChan, &chanmask.rmask)
-                || FD_ISSET(statusChan, &chanmask.emask))) {
+            && (CHAN_ISSET(statusChan, &chanmask.rmask)
+                || CHAN_ISSET(statusChan, &chanmask.emask))) {
 
 	    if (logclass & LC_COMM)
 		ls_syslog(LOG_DEBUG, "\
-%s: Exception on statusChan <%d>, rmask <%x>", __func__,
-			  statusChan, chanmask.rmask);
+%s: Exception on statusChan <%d>", __func__,
+			  statusChan);
 	    chanClose_(statusChan);
 	    statusChan = -1;
 	}
 
-        if (!FD_ISSET(batchSock, &chanmask.rmask)) {
+        if (!CHAN_ISSET(batchSock, &chanmask.rmask)) {
 	    ls_syslog(LOG_DEBUG,"main: connection already known");
             clientIO(&chanmask);
 	    continue;
@@ -402,6 +439,7 @@ main(int argc, char **argv)
         client->from = from;
 	client->jp = NULL;
 	client->jobId = -1;
+	client->dispatch = FALSE;
 
         inList( (struct listEntry *)clientList, (struct listEntry *) client);
 
@@ -428,13 +466,13 @@ clientIO(struct Masks *chanmask)
     for(cliPtr = clientList->forw; cliPtr != clientList; cliPtr = nextClient) {
         nextClient = cliPtr->forw;
 
-        if (FD_ISSET(cliPtr->chanfd, &chanmask->emask)) {
+        if (CHAN_ISSET(cliPtr->chanfd, &chanmask->emask)) {
 
             shutDownClient(cliPtr);
             continue;
         }
 
-        if (FD_ISSET(cliPtr->chanfd, &chanmask->rmask)) {
+        if (CHAN_ISSET(cliPtr->chanfd, &chanmask->rmask)) {
 	    processMsg(cliPtr);
         }
     }
@@ -476,13 +514,20 @@ processMsg(struct clientNode *client)
     /* -Wenum-compare warning issued by smart gcc 4.9.1
      * compiler when using sbdReqType != PREPARE_FOR_OP
      */
-    if (reqHdr.opCode != PREPARE_FOR_OP)
+    /* The dispatch channel of mbatchd stays
+     * non blocking and open across requests.
+     */
+    if (sbdReqtype == MBD_NEW_JOBS || sbdReqtype == MBD_JOBS_GO)
+        client->dispatch = TRUE;
+
+    if (reqHdr.opCode != PREPARE_FOR_OP && !client->dispatch)
         io_block_(s);
 
     if (sbdReqtype == MBD_NEW_JOB || sbdReqtype == MBD_SIG_JOB
         || sbdReqtype == MBD_SWIT_JOB || sbdReqtype == MBD_PROBE
         || sbdReqtype == MBD_REBOOT || sbdReqtype == MBD_SHUTDOWN
-        || sbdReqtype == MBD_MODIFY_JOB) {
+        || sbdReqtype == MBD_MODIFY_JOB || sbdReqtype == MBD_NEW_JOBS
+        || sbdReqtype == MBD_JOBS_GO) {
 
         if (get_new_master(&client->from) < 0) {
             errorBack(client->chanfd, LSBE_NOLSF_HOST, &client->from);
@@ -521,6 +566,15 @@ processMsg(struct clientNode *client)
             delay_check = TRUE;
             break;
 
+        case MBD_NEW_JOBS:
+            TIMEIT(2, do_newjobs(&xdrs, client->chanfd, &reqHdr), "do_newjobs");
+            delay_check = TRUE;
+            break;
+
+        case MBD_JOBS_GO:
+            TIMEIT(2, do_jobsGo(&xdrs, client->chanfd, &reqHdr), "do_jobsGo");
+            break;
+
         case MBD_SIG_JOB:
             TIMEIT(2, do_sigjob (&xdrs, client->chanfd, &reqHdr), "do_sigjob");
             delay_check = TRUE;
@@ -572,7 +626,7 @@ processMsg(struct clientNode *client)
 
     xdr_destroy(&xdrs);
     chanFreeBuf_(buf);
-    if (reqHdr.opCode != PREPARE_FOR_OP)
+    if (reqHdr.opCode != PREPARE_FOR_OP && !client->dispatch)
         shutDownClient(client);
 
 }
@@ -582,6 +636,9 @@ processMsg(struct clientNode *client)
 void
 shutDownClient(struct clientNode *client)
 {
+    if (client->dispatch)
+        closeJobsGo();
+
     chanClose_(client->chanfd);
     offList((struct listEntry *)client);
 
@@ -835,10 +892,7 @@ init_sstate(void)
     rusageUpdatePercent = sbdPackage.rusageUpdatePercent;
     jobTerminateInterval = sbdPackage.jobTerminateInterval;
 
-    /* Hard code for now
-     */
-    cpuset_mount = strdup("/cgroup/cpuset");
-    memory_mount = strdup("/cgroup/memory");
+    init_cgroup();
 
     for (i = 0; i < sbdPackage.nAdmins; i++)
 	FREEUP(sbdPackage.admins[i]);
@@ -846,6 +900,46 @@ init_sstate(void)
 }
 
 
+/* init_cgroup()
+ *
+ * Find out the cgroup hierarchy under OL_CGROUP_ROOT,
+ * with cgroup v2 jobs get a cgroup in the unified
+ * hierarchy otherwise the memory and cpuset controllers
+ * of v1 are under the root.
+ */
+static void
+init_cgroup(void)
+{
+    char buf[PATH_MAX];
+    char *root;
+
+    FREEUP(cpuset_mount);
+    FREEUP(memory_mount);
+    cgroup_v2 = cgroup_memory_mounted = cgroup_cpuset_mounted = false;
+
+    root = genParams_[OL_CGROUP_ROOT].paramValue;
+    if (root == NULL)
+        return;
+
+    if (ls_cgroup2()) {
+        cgroup_v2 = true;
+        ls_syslog(LOG_INFO, "%s: cgroup v2 hierarchy at %s", __func__, root);
+        return;
+    }
+
+    sprintf(buf, "%s/cpuset", root);
+    cpuset_mount = strdup(buf);
+    cgroup_cpuset_mounted = ls_check_mount(cpuset_mount);
+
+    sprintf(buf, "%s/memory", root);
+    memory_mount = strdup(buf);
+    cgroup_memory_mounted = ls_check_mount(memory_mount);
+
+    ls_syslog(LOG_INFO, "%s: cgroup v1 cpuset %s %d memory %s %d", __func__,
+              cpuset_mount, cgroup_cpuset_mounted,
+              memory_mount, cgroup_memory_mounted);
+}
+
 static void
 houseKeeping(void)
 {
@@ -1257,9 +1257,14 @@ checkFinish (void)
         if (IS_FINISH(jobCard->jobSpecs.jStatus)
 	    || IS_POST_FINISH(jobCard->jobSpecs.jStatus)
 	    || (jobCard->jobSpecs.jStatus & JOB_STAT_PEND)) {
-            job_finish (jobCard, TRUE);
+            job_finish_batch(jobCard);
         }
     }
+
+    /* Report all the jobs found finished in one
+     * request to mbatchd.
+     */
+    statusBatchFlush();
 }
 
 static int
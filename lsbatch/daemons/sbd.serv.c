@@ -29,6 +29,12 @@ extern int sbdlog_newstatus(struct jobCard *jp);
 extern int lsbJobCpuLimit;
 extern int lsbJobMemLimit;
 static int replyHdrWithRC(int rc, int chfd, int jobId);
+static void newJobsError(int, struct LSFHeader *, sbdReplyType);
+static sbdReplyType newJob(struct jobSpecs *,
+                           struct jobReply *,
+                           int,
+                           struct lenData *,
+                           struct jobCard **);
 
 void
 do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
@@ -45,6 +51,7 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
     struct lsfAuth     *auth = NULL;
 
     memset(&jobReply, 0, sizeof(struct jobReply));
+    jp = NULL;
 
     if (!xdr_jobSpecs(xdrs, &jobSpecs, reqHdr)) {
 	reply = ERR_BAD_REQ;
@@ -52,16 +59,71 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
 	goto sendReply;
     }
 
+    reply = newJob(&jobSpecs, &jobReply, chfd, NULL, &jp);
+
+sendReply:
+    xdr_lsffree(xdr_jobSpecs, (char *)&jobSpecs, reqHdr);
+    xdrmem_create(&xdrs2, reply_buf, MSGSIZE, XDR_ENCODE);
+    initLSFHeader_(&replyHdr);
+    replyHdr.opCode = reply;
+    replyStruct = (reply == ERR_NO_ERROR) ? (char *) &jobReply : (char *) NULL;
+    if (!xdr_encodeMsg(&xdrs2, replyStruct, &replyHdr, xdr_jobReply, 0, auth)) {
+	ls_syslog(LOG_ERR, I18N_FUNC_FAIL, fname, "xdr_jobReply");
+	lsb_merr(_i18n_msg_get(ls_catd , NL_SETN, 5804,
+			       "Fatal error: xdr_jobReply() failed; sbatchd relifing")); /* catgets 5804 */
+	relife();
+    }
+
+    if (chanWrite_(chfd, reply_buf, XDR_GETPOS(&xdrs2)) <= 0) {
+	ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 5805,
+					 "%s: Sending jobReply (len=%d) to master failed: %m"), /* catgets 5805 */
+		  fname, XDR_GETPOS(&xdrs2));
+    }
+
+    xdr_destroy(&xdrs2);
+
+
+    if (reply == ERR_NO_ERROR && !daemonParams[LSB_BSUBI_OLD].paramValue &&
+	PURE_INTERACTIVE(&jp->jobSpecs)) {
+  	if (status_job (BATCH_STATUS_JOB, jp, jp->jobSpecs.jStatus,
+		        ERR_NO_ERROR) < 0) {
+            jp->notReported++;
+	}
+    }
+
+}
+
+/* newJob()
+ *
+ * Create the job card and fork the job. When jf
+ * is given the job file came with the request and
+ * the child waits for the go-ahead on a pipe,
+ * otherwise it reads both from the channel chfd.
+ */
+static sbdReplyType
+newJob(struct jobSpecs *jobSpecsPtr,
+       struct jobReply *jobReply,
+       int chfd,
+       struct lenData *jf,
+       struct jobCard **jpp)
+{
+    static char        fname[] = "newJob()";
+    struct jobSpecs    jobSpecs;
+    struct jobCard     *jp;
+    sbdReplyType       reply;
+
+    memcpy(&jobSpecs, jobSpecsPtr, sizeof(struct jobSpecs));
+    *jpp = NULL;
 
     for (jp = jobQueHead->forw; (jp != jobQueHead); jp = jp->forw) {
         if (jp->jobSpecs.jobId == jobSpecs.jobId) {
 
-	    jobReply.jobId = jp->jobSpecs.jobId;
-	    jobReply.jobPid = jp->jobSpecs.jobPid;
-	    jobReply.jobPGid = jp->jobSpecs.jobPGid;
-	    jobReply.jStatus = jp->jobSpecs.jStatus;
-	    reply = ERR_NO_ERROR;
-	    goto sendReply;
+	    jobReply->jobId = jp->jobSpecs.jobId;
+	    jobReply->jobPid = jp->jobSpecs.jobPid;
+	    jobReply->jobPGid = jp->jobSpecs.jobPGid;
+	    jobReply->jStatus = jp->jobSpecs.jStatus;
+	    *jpp = jp;
+	    return ERR_NO_ERROR;
 	}
     }
 
@@ -69,8 +131,7 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
     if (jp == NULL) {
 	ls_syslog(LOG_ERR, I18N_JOB_FAIL_S_M, fname,
                   lsb_jobid2str(jobSpecs.jobId), "calloc");
-	reply = ERR_MEM;
-	goto sendReply;
+	return ERR_MEM;
     }
     memcpy((char *) &jp->jobSpecs, (char *) &jobSpecs,
 	   sizeof(struct jobSpecs));
@@ -86,10 +147,9 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
 	    ls_syslog(LOG_ERR, I18N_JOB_FAIL_S, fname,
                       lsb_jobid2str(jp->jobSpecs.jobId), "lockHosts");
             unlockHosts (jp, jp->jobSpecs.numToHosts);
-	    reply = ERR_LOCK_FAIL;
 	    freeWeek(jp->week);
 	    FREEUP(jp);
-	    goto sendReply;
+	    return ERR_LOCK_FAIL;
         }
     }
     jp->runTime = 0;
@@ -99,7 +159,7 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
 	    unlockHosts (jp, jp->jobSpecs.numToHosts);
 	}
 	FREEUP(jp);
-	goto sendReply;
+	return reply;
     }
 
     jp->execJobFlag = 0;
@@ -132,6 +192,7 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
         else
             SBD_SET_STATE(jp, JOB_STAT_RUN);
 
+    jp->jobFile = jf;
     reply = job_exec(jp, chfd);
 
     if (reply != ERR_NO_ERROR) {
@@ -141,44 +202,206 @@ do_newjob(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
             unlockHosts (jp, jp->jobSpecs.numToHosts);
 	}
 	deallocJobCard(jp);
-    } else {
-	jobReply.jobId = jp->jobSpecs.jobId;
-	jobReply.jobPid = jp->jobSpecs.jobPid;
-	jobReply.jobPGid = jp->jobSpecs.jobPGid;
-	jobReply.jStatus = jp->jobSpecs.jStatus;
+	return reply;
     }
 
+    jobReply->jobId = jp->jobSpecs.jobId;
+    jobReply->jobPid = jp->jobSpecs.jobPid;
+    jobReply->jobPGid = jp->jobSpecs.jobPGid;
+    jobReply->jStatus = jp->jobSpecs.jStatus;
+    *jpp = jp;
+
+    return ERR_NO_ERROR;
+}
+
+/* newJobsError()
+ *
+ * Answer a MBD_NEW_JOBS request that could not be
+ * handled in full. The mbatchd puts the whole batch
+ * back to pend and closes the channel, which closes
+ * the go-ahead pipes of the jobs already forked.
+ */
+static void
+newJobsError(int chfd, struct LSFHeader *reqHdr, sbdReplyType reply)
+{
+    struct LSFHeader replyHdr;
+    struct Buffer *buf;
+    XDR xdrs;
+
+    if (chanAllocBuf_(&buf, LSF_HEADER_LEN) < 0) {
+        ls_syslog(LOG_ERR, "%s: chanAllocBuf_() failed %M", __func__);
+        return;
+    }
 
-sendReply:
-    xdr_lsffree(xdr_jobSpecs, (char *)&jobSpecs, reqHdr);
-    xdrmem_create(&xdrs2, reply_buf, MSGSIZE, XDR_ENCODE);
     initLSFHeader_(&replyHdr);
     replyHdr.opCode = reply;
-    replyStruct = (reply == ERR_NO_ERROR) ? (char *) &jobReply : (char *) NULL;
-    if (!xdr_encodeMsg(&xdrs2, replyStruct, &replyHdr, xdr_jobReply, 0, auth)) {
-	ls_syslog(LOG_ERR, I18N_FUNC_FAIL, fname, "xdr_jobReply");
-	lsb_merr(_i18n_msg_get(ls_catd , NL_SETN, 5804,
-			       "Fatal error: xdr_jobReply() failed; sbatchd relifing")); /* catgets 5804 */
-	relife();
+    replyHdr.refCode = reqHdr->refCode;
+    replyHdr.length = 0;
+    xdrmem_create(&xdrs, buf->data, LSF_HEADER_LEN, XDR_ENCODE);
+    xdr_LSFHeader(&xdrs, &replyHdr);
+    buf->len = XDR_GETPOS(&xdrs);
+    xdr_destroy(&xdrs);
+
+    if (chanEnqueue_(chfd, buf) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: chanEnqueue_() failed for request %d: %M", __func__,
+                  reqHdr->refCode);
+        chanFreeBuf_(buf);
     }
+}
 
-    if (chanWrite_(chfd, reply_buf, XDR_GETPOS(&xdrs2)) <= 0) {
-	ls_syslog(LOG_ERR, _i18n_msg_get(ls_catd , NL_SETN, 5805,
-					 "%s: Sending jobReply (len=%d) to master failed: %m"), /* catgets 5805 */
-		  fname, XDR_GETPOS(&xdrs2));
+/* do_newjobs()
+ *
+ * Start a batch of jobs sent by mbatchd over its
+ * dispatch channel. The channel stays open, the
+ * reply is queued on it and the children wait
+ * for MBD_JOBS_GO.
+ */
+void
+do_newjobs(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
+{
+    struct jobStart js;
+    struct jobStartReply jr;
+    struct jobCard *jp;
+    struct LSFHeader replyHdr;
+    struct Buffer *buf;
+    XDR xdrs2;
+    int num;
+    int i;
+    int len;
+
+    if (! xdr_int(xdrs, &num) || num < 0) {
+        ls_syslog(LOG_ERR, "%s: xdr_int() failed", __func__);
+        newJobsError(chfd, reqHdr, ERR_BAD_REQ);
+        return;
     }
 
+    len = LSF_HEADER_LEN + NET_INTSIZE_
+        + num * 2 * sizeof(struct jobStartReply);
+    if (chanAllocBuf_(&buf, len) < 0) {
+        ls_syslog(LOG_ERR, "%s: chanAllocBuf_() failed %M", __func__);
+        newJobsError(chfd, reqHdr, ERR_MEM);
+        return;
+    }
+    xdrmem_create(&xdrs2, buf->data, len, XDR_ENCODE);
+    XDR_SETPOS(&xdrs2, LSF_HEADER_LEN);
+    xdr_int(&xdrs2, &num);
+
+    for (i = 0; i < num; i++) {
+
+        memset(&jr, 0, sizeof(struct jobStartReply));
+
+        if (! xdr_jobStart(xdrs, &js, reqHdr)) {
+            ls_syslog(LOG_ERR, "\
+%s: xdr_jobStart() failed for job %d of %d", __func__, i, num);
+            xdr_destroy(&xdrs2);
+            chanFreeBuf_(buf);
+            newJobsError(chfd, reqHdr, ERR_BAD_REQ);
+            return;
+        }
+
+        jr.jobReply.jobId = js.jobSpecs.jobId;
+        jr.reply = newJob(&js.jobSpecs, &jr.jobReply, -1, &js.jobFile, &jp);
+        if (jr.reply == ERR_NO_ERROR
+            && !daemonParams[LSB_BSUBI_OLD].paramValue
+            && PURE_INTERACTIVE(&jp->jobSpecs)) {
+            if (status_job(BATCH_STATUS_JOB, jp, jp->jobSpecs.jStatus,
+                           ERR_NO_ERROR) < 0) {
+                jp->notReported++;
+            }
+        }
+
+        xdr_lsffree(xdr_jobSpecs, (char *)&js.jobSpecs, reqHdr);
+        FREEUP(js.jobFile.data);
+
+        if (! xdr_jobStartReply(&xdrs2, &jr, reqHdr)) {
+            ls_syslog(LOG_ERR, "\
+%s: xdr_jobStartReply() failed for job %s", __func__,
+                      lsb_jobid2str(jr.jobReply.jobId));
+            xdr_destroy(&xdrs2);
+            chanFreeBuf_(buf);
+            newJobsError(chfd, reqHdr, ERR_BAD_REQ);
+            return;
+        }
+    }
+
+    initLSFHeader_(&replyHdr);
+    replyHdr.opCode = ERR_NO_ERROR;
+    replyHdr.refCode = reqHdr->refCode;
+    buf->len = XDR_GETPOS(&xdrs2);
+    replyHdr.length = buf->len - LSF_HEADER_LEN;
+    XDR_SETPOS(&xdrs2, 0);
+    xdr_LSFHeader(&xdrs2, &replyHdr);
     xdr_destroy(&xdrs2);
 
+    if (chanEnqueue_(chfd, buf) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: chanEnqueue_() failed for request %d: %M", __func__,
+                  reqHdr->refCode);
+        chanFreeBuf_(buf);
+    }
+}
 
-    if (reply == ERR_NO_ERROR && !daemonParams[LSB_BSUBI_OLD].paramValue &&
-	PURE_INTERACTIVE(&jp->jobSpecs)) {
-  	if (status_job (BATCH_STATUS_JOB, jp, jp->jobSpecs.jStatus,
-		        ERR_NO_ERROR) < 0) {
-            jp->notReported++;
-	}
+/* do_jobsGo()
+ *
+ * Relay the mbatchd go-ahead to the job
+ * children waiting on their pipe.
+ */
+void
+do_jobsGo(XDR *xdrs, int chfd, struct LSFHeader *reqHdr)
+{
+    struct jobGo go;
+    struct jobCard *jp;
+    int num;
+    int i;
+    char c;
+
+    if (! xdr_int(xdrs, &num)) {
+        ls_syslog(LOG_ERR, "%s: xdr_int() failed", __func__);
+        return;
+    }
+
+    for (i = 0; i < num; i++) {
+
+        if (! xdr_jobGo(xdrs, &go, reqHdr)) {
+            ls_syslog(LOG_ERR, "%s: xdr_jobGo() failed", __func__);
+            return;
+        }
+
+        for (jp = jobQueHead->forw; jp != jobQueHead; jp = jp->forw) {
+            if (jp->jobSpecs.jobId == go.jobId)
+                break;
+        }
+
+        if (jp == jobQueHead || jp->goFd < 0)
+            continue;
+
+        c = go.go ? '1' : '0';
+        if (write(jp->goFd, &c, 1) != 1 && errno != EPIPE)
+            ls_syslog(LOG_ERR, "\
+%s: write() go-ahead failed for job %s: %m", __func__,
+                      lsb_jobid2str(go.jobId));
+        close(jp->goFd);
+        jp->goFd = -1;
     }
+}
 
+/* closeJobsGo()
+ *
+ * The dispatch channel is gone, close the pipes
+ * so that the waiting children fail their start.
+ */
+void
+closeJobsGo(void)
+{
+    struct jobCard *jp;
+
+    for (jp = jobQueHead->forw; jp != jobQueHead; jp = jp->forw) {
+        if (jp->goFd >= 0) {
+            close(jp->goFd);
+            jp->goFd = -1;
+        }
+    }
 }
 
 void
@@ -719,10 +719,14 @@ mykillpg(struct jobCard *jp, int sig)
 	npgid = jp->runRusage.npgids;
     }
 
+    /* A job in a cgroup v2 has all its processes
+     * in the cgroup, so pim is not needed.
+     */
     if (jp->regOpFlag & REG_RUSAGE) {
         jru = &(jp->runRusage);
-    }
-    else {
+    } else if ((jru = cgroupJobRusage(jp)) != NULL) {
+        ;
+    } else {
         TIMEIT(0, jru = getJInfo_(npgid, pgid, 0, jp->jobSpecs.jobPGid), "getJInfo_ in mykillpg");
     }
 
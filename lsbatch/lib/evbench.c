@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+/* evbench compares lsb_geteventrec() and lsb_geteventmaprec().
+ * It writes a synthetic event file, or takes the one given
+ * with -f, checks that the two readers return the same
+ * records by writing them back with lsb_puteventrec()
+ * and then times -r passes of each on the file.
+ *
+ * usage: evbench [-n records] [-r repeats] [-f file]
+ */
+#include <sys/time.h>
+#include "lsb.h"
+
+static int writeLog(const char *, int);
+static void fillRec(struct eventRec *, int);
+static int compare(const char *);
+static double timeOld(const char *, int *);
+static double timeMap(const char *, int *);
+static char *recStr(struct eventRec *);
+static double now(void);
+
+static char *hosts[] = {"node001", "node002", "node003", "node004"};
+
+int
+main(int argc, char **argv)
+{
+    char file[MAXFILENAMELEN];
+    char *given;
+    double tOld;
+    double tMap;
+    double t;
+    int numRecs;
+    int repeats;
+    int n;
+    int i;
+    int cc;
+
+    numRecs = 100000;
+    repeats = 5;
+    given = NULL;
+
+    while ((cc = getopt(argc, argv, "n:r:f:")) != EOF) {
+        switch (cc) {
+            case 'n':
+                numRecs = atoi(optarg);
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            case 'f':
+                given = optarg;
+                break;
+            default:
+                fprintf(stderr, "\
+usage: evbench [-n records] [-r repeats] [-f file]\n");
+                return -1;
+        }
+    }
+
+    if (given) {
+        strcpy(file, given);
+    } else {
+        sprintf(file, "%s/evbench.%d",
+                getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp", getpid());
+        if (writeLog(file, numRecs) < 0) {
+            fprintf(stderr, "evbench: cannot write %s: %s\n",
+                    file, strerror(errno));
+            return -1;
+        }
+    }
+
+    if (compare(file) < 0) {
+        if (!given)
+            unlink(file);
+        return -1;
+    }
+
+    n = 0;
+    tOld = tMap = -1;
+    for (i = 0; i < repeats; i++) {
+        t = timeOld(file, &n);
+        if (tOld < 0 || t < tOld)
+            tOld = t;
+        t = timeMap(file, &n);
+        if (tMap < 0 || t < tMap)
+            tMap = t;
+    }
+
+    if (n > 0) {
+        printf("%d records, best of %d passes\n", n, repeats);
+        printf("lsb_geteventrec    %10.3f ms %8.3f us/record\n",
+               tOld * 1000, tOld * 1e6 / n);
+        printf("lsb_geteventmaprec %10.3f ms %8.3f us/record\n",
+               tMap * 1000, tMap * 1e6 / n);
+        if (tMap > 0)
+            printf("speedup            %10.2fx\n", tOld / tMap);
+    }
+
+    if (!given)
+        unlink(file);
+
+    return 0;
+}
+
+/* writeLog()
+ *
+ * A mix of the job events mbatchd writes, plus a
+ * queue control event the mapped reader passes to
+ * the line readers and a comment line.
+ */
+static int
+writeLog(const char *file, int numRecs)
+{
+    struct eventRec rec;
+    FILE *fp;
+    int i;
+
+    fp = fopen(file, "w");
+    if (fp == NULL)
+        return -1;
+
+    fprintf(fp, "#80\n");
+    for (i = 0; i < numRecs; i++) {
+        fillRec(&rec, i);
+        if (lsb_puteventrec(fp, &rec) < 0) {
+            fclose(fp);
+            return -1;
+        }
+        if (i % 1000 == 999)
+            fprintf(fp, "\n# comment\n");
+    }
+
+    if (fclose(fp) != 0)
+        return -1;
+
+    return 0;
+}
+
+static void
+fillRec(struct eventRec *rec, int i)
+{
+    static char *execHosts[2];
+    static char preCmd[] = "echo \"pre\"\tcmd";
+    static char empty[] = "";
+    static char resReq[64];
+    static char dep[] = "done(12) && ended(\"job name\")";
+    static char shell[] = "/bin/sh";
+    static char user[] = "user01";
+    static char sig[] = "SIGTERM";
+    static char home[] = "/home/user01";
+    static char dir[] = "/home/user/some dir";
+    static char project[] = "default";
+    int jobId;
+    int k;
+
+    memset(rec, 0, sizeof(struct eventRec));
+    sprintf(rec->version, "%d", OPENLAVA_XDR_VERSION);
+    rec->eventTime = 1420070400 + i;
+
+    jobId = i / 10 + 1;
+    execHosts[0] = hosts[i % 4];
+    execHosts[1] = hosts[(i + 1) % 4];
+    sprintf(resReq, "select[mem>%d] rusage[mem=%d]", i % 512, i % 64);
+
+    switch (i % 10) {
+        case 0: {
+            struct jobNewLog *l = &rec->eventLog.jobNewLog;
+
+            rec->type = EVENT_JOB_NEW;
+            l->jobId = jobId;
+            l->userId = 500 + i % 7;
+            l->options = SUB_QUEUE | SUB_OUT_FILE | SUB_PROJECT_NAME;
+            l->options2 = (i % 20) ? 0 : SUB2_BSUB_BLOCK;
+            l->numProcessors = l->maxNumProcessors = 1 + i % 4;
+            l->submitTime = rec->eventTime;
+            for (k = 0; k < LSF_RLIM_NLIMITS; k++)
+                l->rLimits[k] = -1;
+            l->rLimits[LSF_RLIMIT_CPU] = 3600;
+            l->hostFactor = 1.0;
+            l->umask = 022;
+            sprintf(l->userName, "user%02d", i % 7);
+            strcpy(l->queue, "normal");
+            strcpy(l->fromHost, hosts[i % 4]);
+            strcpy(l->cwd, dir);
+            strcpy(l->outFile, "out.%J");
+            strcpy(l->subHomeDir, "/home/user");
+            sprintf(l->jobFile, "1420070400.%d", jobId);
+            strcpy(l->jobName, "job \"name\"");
+            strcpy(l->command, "sleep 100; echo \"done\"");
+            l->resReq = resReq;
+            l->dependCond = (i % 30) ? empty : dep;
+            l->preExecCmd = empty;
+            l->mailUser = empty;
+            l->projectName = project;
+            l->schedHostType = empty;
+            l->loginShell = empty;
+            l->userGroup = empty;
+            l->numAskedHosts = (i % 40) ? 0 : 2;
+            l->askedHosts = execHosts;
+            l->niosPort = 40000 + i % 100;
+            break;
+        }
+        case 1:
+        case 5: {
+            struct jobStartLog *l = &rec->eventLog.jobStartLog;
+
+            rec->type = (i % 10 == 1) ? EVENT_JOB_START : EVENT_PRE_EXEC_START;
+            l->jobId = jobId;
+            l->jStatus = JOB_STAT_RUN;
+            l->jobPid = l->jobPGid = 1000 + i;
+            l->hostFactor = 1.0;
+            l->numExHosts = 1 + i % 2;
+            l->execHosts = execHosts;
+            l->queuePreCmd = (i % 3) ? empty : preCmd;
+            l->queuePostCmd = empty;
+            l->userGroup = empty;
+            break;
+        }
+        case 2:
+            rec->type = EVENT_JOB_START_ACCEPT;
+            rec->eventLog.jobStartAcceptLog.jobId = jobId;
+            rec->eventLog.jobStartAcceptLog.jobPid = 1000 + i;
+            rec->eventLog.jobStartAcceptLog.jobPGid = 1000 + i;
+            break;
+        case 3:
+            rec->type = EVENT_JOB_EXECUTE;
+            rec->eventLog.jobExecuteLog.jobId = jobId;
+            rec->eventLog.jobExecuteLog.execUid = 500;
+            rec->eventLog.jobExecuteLog.execCwd = dir;
+            rec->eventLog.jobExecuteLog.execHome = home;
+            rec->eventLog.jobExecuteLog.execUsername = user;
+            rec->eventLog.jobExecuteLog.jobPid = 1000 + i;
+            break;
+        case 4:
+        case 7: {
+            struct jobStatusLog *l = &rec->eventLog.jobStatusLog;
+
+            rec->type = EVENT_JOB_STATUS;
+            l->jobId = jobId;
+            l->jStatus = (i % 10 == 4) ? JOB_STAT_RUN : JOB_STAT_DONE;
+            l->cpuTime = i * 0.25;
+            l->endTime = rec->eventTime;
+            l->ru = (i % 10 == 7);
+            l->lsfRusage.ru_utime = i * 0.5;
+            l->lsfRusage.ru_stime = i * 0.125;
+            l->lsfRusage.ru_maxrss = i;
+            break;
+        }
+        case 6:
+            rec->type = EVENT_SBD_JOB_STATUS;
+            rec->eventLog.sbdJobStatusLog.jobId = jobId;
+            rec->eventLog.sbdJobStatusLog.jStatus = JOB_STAT_RUN;
+            rec->eventLog.sbdJobStatusLog.actPid = -1;
+            rec->eventLog.sbdJobStatusLog.actPeriod = 60;
+            break;
+        case 8:
+            if (i % 20 == 8) {
+                rec->type = EVENT_JOB_SIGNAL;
+                rec->eventLog.signalLog.jobId = jobId;
+                rec->eventLog.signalLog.userId = 500;
+                rec->eventLog.signalLog.signalSymbol = sig;
+                strcpy(rec->eventLog.signalLog.userName, user);
+            } else {
+                rec->type = EVENT_QUEUE_CTRL;
+                rec->eventLog.queueCtrlLog.opCode = QUEUE_OPEN;
+                strcpy(rec->eventLog.queueCtrlLog.queue, "normal");
+                strcpy(rec->eventLog.queueCtrlLog.userName, "root");
+            }
+            break;
+        case 9: {
+            struct jobFinishLog *l = &rec->eventLog.jobFinishLog;
+
+            if (i % 20 == 9) {
+                rec->type = EVENT_JOB_CLEAN;
+                rec->eventLog.jobCleanLog.jobId = jobId;
+                break;
+            }
+            rec->type = EVENT_JOB_FINISH;
+            l->jobId = jobId;
+            l->userId = 500;
+            l->numProcessors = l->maxNumProcessors = 2;
+            l->submitTime = l->startTime = rec->eventTime - 100;
+            strcpy(l->userName, user);
+            strcpy(l->queue, "normal");
+            strcpy(l->fromHost, hosts[0]);
+            strcpy(l->cwd, "/tmp");
+            sprintf(l->jobFile, "1420070400.%d", jobId);
+            strcpy(l->jobName, "job \"name\"");
+            strcpy(l->command, "sleep 100");
+            l->resReq = resReq;
+            l->dependCond = empty;
+            l->preExecCmd = empty;
+            l->mailUser = empty;
+            l->projectName = project;
+            l->loginShell = shell;
+            l->numExHosts = 2;
+            l->execHosts = execHosts;
+            l->jStatus = JOB_STAT_DONE;
+            l->hostFactor = 1.0;
+            l->lsfRusage.ru_utime = 12.5;
+            l->lsfRusage.ru_nvcsw = i;
+            l->maxRMem = 1024 + i;
+            break;
+        }
+    }
+}
+
+/* compare()
+ *
+ * Read the file with both readers side by side.
+ */
+static int
+compare(const char *file)
+{
+    struct eventFileMap *map;
+    struct eventRec *a;
+    struct eventRec *b;
+    FILE *fa;
+    FILE *fb;
+    char *sa;
+    char *sb;
+    int lineA;
+    int lineB;
+    int errA;
+    int errB;
+    int n;
+
+    fa = fopen(file, "r");
+    fb = fopen(file, "r");
+    if (fa == NULL || fb == NULL) {
+        perror(file);
+        return -1;
+    }
+
+    if ((map = lsb_openeventmap(fb)) == NULL) {
+        lsb_perror("lsb_openeventmap");
+        return -1;
+    }
+
+    lineA = lineB = 0;
+    n = 0;
+    for (;;) {
+
+        lsberrno = LSBE_NO_ERROR;
+        a = lsb_geteventrec(fa, &lineA);
+        errA = lsberrno;
+        sa = a ? recStr(a) : NULL;
+
+        lsberrno = LSBE_NO_ERROR;
+        b = lsb_geteventmaprec(map, &lineB);
+        errB = lsberrno;
+        sb = b ? recStr(b) : NULL;
+
+        if (lineA != lineB
+            || (a == NULL) != (b == NULL)
+            || (a == NULL && errA != errB)
+            || (a && strcmp(sa, sb) != 0)) {
+            fprintf(stderr, "\
+evbench: record %d differs\n  old: %s  map: %s",
+                    lineA,
+                    sa ? sa : lsb_sysmsg(), sb ? sb : "NULL\n");
+            return -1;
+        }
+
+        FREEUP(sa);
+        FREEUP(sb);
+
+        if (a == NULL && errA == LSBE_EOF)
+            break;
+        ++n;
+    }
+
+    lsb_closeeventmap(map);
+    fclose(fa);
+    fclose(fb);
+
+    printf("%d records identical\n", n);
+
+    return 0;
+}
+
+static char *
+recStr(struct eventRec *rec)
+{
+    char *buf;
+    size_t size;
+    FILE *fp;
+
+    fp = open_memstream(&buf, &size);
+    if (fp == NULL)
+        return NULL;
+    lsb_puteventrec(fp, rec);
+    fclose(fp);
+
+    return buf;
+}
+
+static double
+timeOld(const char *file, int *n)
+{
+    FILE *fp;
+    double t;
+    int line;
+
+    fp = fopen(file, "r");
+    if (fp == NULL)
+        return 0;
+
+    t = now();
+    line = *n = 0;
+    lsberrno = LSBE_NO_ERROR;
+    while (lsberrno != LSBE_EOF) {
+        if (lsb_geteventrec(fp, &line))
+            ++(*n);
+    }
+    t = now() - t;
+
+    fclose(fp);
+
+    return t;
+}
+
+static double
+timeMap(const char *file, int *n)
+{
+    struct eventFileMap *map;
+    FILE *fp;
+    double t;
+    int line;
+
+    fp = fopen(file, "r");
+    if (fp == NULL)
+        return 0;
+
+    t = now();
+    map = lsb_openeventmap(fp);
+    line = *n = 0;
+    lsberrno = LSBE_NO_ERROR;
+    while (lsberrno != LSBE_EOF) {
+        if (lsb_geteventmaprec(map, &line))
+            ++(*n);
+    }
+    lsb_closeeventmap(map);
+    t = now() - t;
+
+    fclose(fp);
+
+    return t;
+}
+
+static double
+now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
@@ -114,6 +114,7 @@ static void initHostInfo ( struct hostInfoEnt *);
 static void freeHostInfo ( struct hostInfoEnt *);
 static void initQueueInfo ( struct queueInfoEnt *);
 static void freeQueueInfo ( struct queueInfoEnt *);
+static int parseAffinity(const char *, char **);
 
 int checkSpoolDir ( char *spoolDir );
 int checkJobAttaDir ( char * );
@@ -3779,7 +3780,8 @@ do_Queues(struct lsConf *conf,
 #define QKEY_PRE_POST_EXEC_USER info->numIndx+47
 #define QKEY_FAIRSHARE info->numIndx + 48
 #define QKEY_PREEMPTION info->numIndx + 49
-#define KEYMAP_SIZE info->numIndx+51
+#define QKEY_AFFINITY info->numIndx + 50
+#define KEYMAP_SIZE info->numIndx+52
 
     struct queueInfoEnt queue;
     char *linep;
@@ -3849,6 +3851,7 @@ do_Queues(struct lsConf *conf,
     keylist[QKEY_PRE_POST_EXEC_USER].key="PRE_POST_EXEC_USER";
     keylist[QKEY_FAIRSHARE].key = "FAIRSHARE";
     keylist[QKEY_PREEMPTION].key = "PREEMPTION";
+    keylist[QKEY_AFFINITY].key = "AFFINITY";
     keylist[KEYMAP_SIZE - 1].key = NULL;
 
     initQueueInfo(&queue);
@@ -4629,6 +4632,21 @@ do_Queues(struct lsConf *conf,
             }
         }
 
+        if (keylist[QKEY_AFFINITY].val != NULL
+            && strlen(keylist[QKEY_AFFINITY].val) > 0) {
+            if (parseAffinity(keylist[QKEY_AFFINITY].val,
+                              &queue.affinity) < 0) {
+                ls_syslog(LOG_ERR, "\
+%s: File %s in section Queue ending at line %d: unsupported AFFINITY %s, queue %s ignored",
+                          __func__, fname, *lineNum,
+                          keylist[QKEY_AFFINITY].val, keylist[QKEY_NAME].val);
+                lsberrno = LSBE_CONF_WARNING;
+                freekeyval(keylist);
+                freeQueueInfo(&queue);
+                return FALSE;
+            }
+        }
+
         if (info->numIndx
             && (queue.loadSched = calloc(info->numIndx,
                                          sizeof(float *))) == NULL) {
@@ -4727,6 +4745,69 @@ freeQueueInfo(struct queueInfoEnt *qp)
     FREEUP(qp->resumeActCmd);
     FREEUP(qp->terminateActCmd);
     FREEUP(qp->fairshare);
+    FREEUP(qp->affinity);
+}
+
+/* parseAffinity()
+ *
+ * AFFINITY = NONE | PACK | SPREAD [MEMBIND]
+ * NONE leaves the jobs unbound, the other policies
+ * are saved in upper case.
+ */
+static int
+parseAffinity(const char *val, char **affinity)
+{
+    char *p0;
+    char *p;
+    char *word;
+    char buf[32];
+    int memBind;
+
+    p0 = p = strdup(val);
+    if (p == NULL)
+        return -1;
+
+    buf[0] = 0;
+    memBind = 0;
+    while ((word = getNextWord_(&p))) {
+
+        if (buf[0] == 0) {
+            if (strcasecmp(word, "NONE") == 0)
+                strcpy(buf, "NONE");
+            else if (strcasecmp(word, "PACK") == 0)
+                strcpy(buf, "PACK");
+            else if (strcasecmp(word, "SPREAD") == 0)
+                strcpy(buf, "SPREAD");
+            else
+                break;
+            continue;
+        }
+
+        if (strcmp(buf, "NONE") != 0
+            && strcasecmp(word, "MEMBIND") == 0
+            && memBind == 0) {
+            memBind = 1;
+            continue;
+        }
+        break;
+    }
+    _free_(p0);
+
+    if (buf[0] == 0 || word != NULL)
+        return -1;
+
+    *affinity = NULL;
+    if (strcmp(buf, "NONE") == 0)
+        return 0;
+
+    if (memBind)
+        strcat(buf, " MEMBIND");
+
+    *affinity = strdup(buf);
+    if (*affinity == NULL)
+        return -1;
+
+    return 0;
 }
 
 char
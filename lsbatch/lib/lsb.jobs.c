@@ -17,10 +17,28 @@
  *
  */
 
+#include <poll.h>
 #include "lsb.h"
 
 static int mbdSock = -1;
 
+/* mbatchd streams the job info replies back to
+ * back, read them in large chunks and decode them
+ * in place rather than one read and one allocation
+ * per job.
+ */
+#define JOBINFO_READ_SIZE (256 * 1024)
+
+static struct {
+    char    *buf;
+    int     size;
+    int     pos;
+    int     len;
+} jobInfoBuf;
+
+static int readJobInfoPacket(char **, struct LSFHeader *);
+static int fillJobInfoBuf(int);
+
 int
 lsb_openjobinfo(LS_LONG_INT jobId, char *jobName, char *userName,
                 char *queueName, char *hostName, int options)
@@ -130,10 +148,13 @@ lsb_openjobinfo_a (LS_LONG_INT jobId, char *jobName, char *userName,
         }
         strcpy(jobInfoReq.userName, userName);
     }
-    if ((options & ~(JOBID_ONLY | JOBID_ONLY_ALL | HOST_NAME | NO_PEND_REASONS)) == 0)
+    if ((options & ~(JOBID_ONLY | JOBID_ONLY_ALL | HOST_NAME
+                     | NO_PEND_REASONS | JOBINFO_BRIEF)) == 0)
         jobInfoReq.options = CUR_JOB;
     else
         jobInfoReq.options = options;
+    if (options & JOBINFO_BRIEF)
+        jobInfoReq.options |= JOBINFO_BRIEF;
 
     if (jobId < 0) {
         lsberrno = LSBE_BAD_ARG;
@@ -155,6 +176,8 @@ lsb_openjobinfo_a (LS_LONG_INT jobId, char *jobName, char *userName,
 
 
 
+    jobInfoBuf.pos = jobInfoBuf.len = 0;
+
     TIMEIT(0, (cc = callmbd (clusterName, request_buf, XDR_GETPOS(&xdrs),
                              &reply_buf, &hdr, &mbdSock, NULL, NULL)), "callmbd");
     if (cc  == -1) {
@@ -208,11 +231,8 @@ lsb_readjobinfo(int *more)
     static int npgids = 0;
     static int *pgid = NULL;
 
-    TIMEIT(0, (num = readNextPacket(&buffer,
-                                    _lsb_recvtimeout,
-                                    &hdr,
-                                    mbdSock)),
-           "readNextPacket");
+    TIMEIT(0, (num = readJobInfoPacket(&buffer, &hdr)),
+           "readJobInfoPacket");
     if (num < 0) {
         closeSession(mbdSock);
         lsberrno = LSBE_EOF;
@@ -246,7 +266,6 @@ lsb_readjobinfo(int *more)
             FREEUP(jobInfoReply.userName);
             FREEUP(submitReq.cwd);
 
-            free(buffer);
             return NULL;
         }
 
@@ -276,23 +295,25 @@ lsb_readjobinfo(int *more)
     FREEUP(jobInfoReply.execHome);
     FREEUP(jobInfoReply.execCwd);
     FREEUP(jobInfoReply.execUsername);
+    FREEUP(jobInfoReply.cpuBind);
     FREEUP(jobInfoReply.parentGroup);
     FREEUP(jobInfoReply.jName);
 
     xdrmem_create(&xdrs, buffer, XDR_DECODE_SIZE_(hdr.length), XDR_DECODE);
 
-    TIMEIT(1, (cc = xdr_jobInfoReply(&xdrs, &jobInfoReply, &hdr)), "xdr_jobInfoReply");
+    if (hdr.opCode == JOBINFO_BRIEF)
+        cc = xdr_jobInfoBrief(&xdrs, &jobInfoReply, &hdr);
+    else
+        TIMEIT(1, (cc = xdr_jobInfoReply(&xdrs, &jobInfoReply, &hdr)), "xdr_jobInfoReply");
     if (cc == FALSE) {
         lsberrno = LSBE_XDR;
         xdr_destroy(&xdrs);
-        free(buffer);
         jobInfoReply.toHosts = NULL;
         jobInfoReply.numToHosts = 0;
         return NULL;
     }
 
     TIMEIT(1, xdr_destroy(&xdrs), "xdr_destroy");
-    free(buffer);
     jobInfo.jobId = jobInfoReply.jobId;
     jobInfo.status = jobInfoReply.status;
     jobInfo.numReasons = jobInfoReply.numReasons;
@@ -320,6 +341,7 @@ lsb_readjobinfo(int *more)
     jobInfo.execHome = jobInfoReply.execHome;
     jobInfo.execCwd = jobInfoReply.execCwd;
     jobInfo.execUsername = jobInfoReply.execUsername;
+    jobInfo.cpuBind = jobInfoReply.cpuBind;
 
 
     jobInfo.jType    = jobInfoReply.jType;
@@ -404,6 +426,113 @@ lsb_closejobinfo()
     closeSession(mbdSock);
 }
 
+/* readJobInfoPacket()
+ *
+ * Return the next job info reply, its body points
+ * into jobInfoBuf and is valid until the next call.
+ */
+static int
+readJobInfoPacket(char **msgBuf, struct LSFHeader *hdr)
+{
+    XDR xdrs;
+    int cc;
+
+    if (mbdSock < 0) {
+        lsberrno = LSBE_CONN_NONEXIST;
+        return -1;
+    }
+
+    if (fillJobInfoBuf(LSF_HEADER_LEN) < 0)
+        return -1;
+
+    xdrmem_create(&xdrs, jobInfoBuf.buf + jobInfoBuf.pos,
+                  LSF_HEADER_LEN, XDR_DECODE);
+    cc = xdr_LSFHeader(&xdrs, hdr);
+    xdr_destroy(&xdrs);
+    if (!cc) {
+        lsberrno = LSBE_XDR;
+        return -1;
+    }
+
+    if (hdr->length == 0) {
+        lsberrno = LSBE_EOF;
+        return -1;
+    }
+
+    if (fillJobInfoBuf(LSF_HEADER_LEN + hdr->length) < 0)
+        return -1;
+
+    *msgBuf = jobInfoBuf.buf + jobInfoBuf.pos + LSF_HEADER_LEN;
+    jobInfoBuf.pos += LSF_HEADER_LEN + hdr->length;
+
+    return hdr->reserved;
+}
+
+/* fillJobInfoBuf()
+ *
+ * Make sure need bytes past the read position are
+ * buffered, read as much as the socket has.
+ */
+static int
+fillJobInfoBuf(int need)
+{
+    struct pollfd pfd;
+    char *p;
+    int timeout;
+    int size;
+    int cc;
+
+    if (jobInfoBuf.len - jobInfoBuf.pos >= need)
+        return 0;
+
+    if (jobInfoBuf.pos > 0) {
+        memmove(jobInfoBuf.buf, jobInfoBuf.buf + jobInfoBuf.pos,
+                jobInfoBuf.len - jobInfoBuf.pos);
+        jobInfoBuf.len -= jobInfoBuf.pos;
+        jobInfoBuf.pos = 0;
+    }
+
+    if (jobInfoBuf.size < need || jobInfoBuf.buf == NULL) {
+        size = MAX(need, JOBINFO_READ_SIZE);
+        p = realloc(jobInfoBuf.buf, size);
+        if (p == NULL) {
+            lsberrno = LSBE_NO_MEM;
+            return -1;
+        }
+        jobInfoBuf.buf = p;
+        jobInfoBuf.size = size;
+    }
+
+    timeout = -1;
+    if (_lsb_recvtimeout > 0)
+        timeout = _lsb_recvtimeout * 1000;
+
+    pfd.fd = chanSock_(mbdSock);
+    pfd.events = POLLIN;
+    while (jobInfoBuf.len < need) {
+
+        cc = poll(&pfd, 1, timeout);
+        if (cc < 0 && errno == EINTR)
+            continue;
+        if (cc <= 0) {
+            lsberrno = LSBE_LSLIB;
+            return -1;
+        }
+
+        cc = read(pfd.fd, jobInfoBuf.buf + jobInfoBuf.len,
+                  jobInfoBuf.size - jobInfoBuf.len);
+        if (cc < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (cc <= 0) {
+            lsberrno = LSBE_EOF;
+            return -1;
+        }
+        jobInfoBuf.len += cc;
+    }
+
+    return 0;
+}
+
 int
 lsb_runjob(struct runJobRequest* runJobRequest)
 {
@@ -18,14 +18,16 @@
  *
  */
 
+#include <sys/mman.h>
 #include "lsb.h"
 
 bool_t  logMapFileEnable = FALSE;
 
 /* Protocol version of this release.
- * OPENLAVA_XDR_VERSION
+ * OPENLAVA_XDR_VERSION, it is the version of the
+ * record being read so it is per thread.
  */
-static uint32_t version;
+static __thread uint32_t version;
 
 static int readJobNew(char *, struct jobNewLog *);
 static int readJobMod(char *, struct jobModLog *);
@@ -89,11 +91,52 @@ struct eventRec * lsbGetNextJobEvent(struct eventLogHandle *,
 static struct eventRec * lsbGetNextJobRecFromFile(FILE *,
                                                   int *,
                                                   int,
-                                                  LS_LONG_INT *);
+                                                  LS_LONG_INT *,
+                                                  long);
 static int checkJobEventAndJobId(char *, int, int, LS_LONG_INT *);
 static int getEventTypeAndKind(char *, int *);
-static void readEventRecord(char *, struct eventRec *);
+static int eventTypeAndKind(char *, int *);
+static int readEventRecord(char *, struct eventRec *);
 static int lsb_readeventrecord(char *, struct eventRec *);
+static void eventMapReset(struct eventFileMap *);
+static struct eventRec *eventMapRec(struct eventFileMap *, int *);
+static void *eventMapAlloc(struct eventFileMap *, size_t);
+static char *eventMapLine(struct eventFileMap *);
+static int evInt(char **, int *);
+static int evFloat(char **, float *);
+static int evDouble(char **, double *);
+static char *evStr(char **);
+static int evCopy(char **, int, int, char *);
+static int evRusage(char **, struct lsfRusage *);
+static int evHosts(struct eventFileMap *, char **, int, char ***);
+static char *evEmpty(struct eventFileMap *);
+static int mapJobNew(struct eventFileMap *, char *, struct jobNewLog *);
+static int mapJobStart(struct eventFileMap *, char *, struct jobStartLog *);
+static int mapJobStartAccept(char *, struct jobStartAcceptLog *);
+static int mapJobExecute(struct eventFileMap *, char *,
+                         struct jobExecuteLog *);
+static int mapJobStatus(char *, struct jobStatusLog *);
+static int mapSbdJobStatus(char *, struct sbdJobStatusLog *);
+static int mapJobSignal(char *, struct signalLog *);
+static int mapJobClean(char *, struct jobCleanLog *);
+static int mapJobFinish(struct eventFileMap *, char *,
+                        struct jobFinishLog *, time_t);
+
+/* A mapped event file, see lsb_openeventmap().
+ */
+struct eventFileMap {
+    FILE *fp;
+    char *base;
+    size_t size;
+    size_t pos;
+    size_t released;
+    char *tail;
+    struct eventArena *arena;
+    struct eventRec rec;
+    int recLine;
+    int eof;
+    int err;
+};
 
 #define   EVENT_JOB_RELATED     1
 #define   EVENT_NON_JOB_RELATED 0
@@ -376,68 +419,1066 @@ lsb_geteventrec(FILE *log_fp, int *LineNum)
         }
     }
 
-    if (logclass & LC_TRACE)
-        ls_syslog(LOG_DEBUG2, "%s: line=%s", __func__, line);
+    if (logclass & LC_TRACE)
+        ls_syslog(LOG_DEBUG2, "%s: line=%s", __func__, line);
+
+    namebuf = calloc(1, strlen(line)+1);
+    if (namebuf == NULL) {
+        lsberrno = LSBE_NO_MEM;
+        return NULL;
+    }
+
+
+    if ((ccount = stripQStr(line, namebuf)) < 0
+        || strlen(line) == ccount
+        || strlen(namebuf) >= MAX_LSB_NAME_LEN) {
+        lsberrno = LSBE_EVENT_FORMAT;
+        free(namebuf);
+        return NULL;
+    }
+
+    strcpy(etype, namebuf);
+    line += ccount + 1;
+
+    if ((ccount = stripQStr(line, namebuf)) < 0
+        || strlen(line) == ccount
+        || strlen(namebuf) >= MAX_VERSION_LEN) {
+        lsberrno = LSBE_EVENT_FORMAT;
+        free(namebuf);
+        return NULL;
+    }
+
+    /* The log record keeps the version as char[]
+     * while the global is uint32_t
+     */
+    strcpy(logRec->version, namebuf);
+    if ((version = atoi(logRec->version)) <= 0) {
+        lsberrno = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+    line += ccount + 1;
+
+    free(namebuf);
+
+    cc = sscanf(line, "%d%n", &tempTimeStamp, &ccount);
+    logRec->eventTime = tempTimeStamp;
+
+    if (cc != 1) {
+        lsberrno = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+    line += ccount + 1;
+
+    if ((logRec->type = getEventTypeAndKind(etype, &eventKind)) == -1)
+        return NULL;
+    if (logclass & LC_TRACE)
+        ls_syslog(LOG_DEBUG2, "%s: log.type=%x", __func__, logRec->type);
+
+    lsberrno = readEventRecord(line, logRec);
+
+    if (lsberrno == LSBE_NO_ERROR)
+        return logRec;
+
+    return NULL;
+
+}
+
+/* Mapped event files.
+ *
+ * lsb_geteventmaprec() returns the same records as
+ * lsb_geteventrec() but parses the file mapped in
+ * memory. The lines are not copied, the quoted
+ * strings are unquoted in place in the private mapping
+ * and the char * fields of the records point to them,
+ * the integers are converted by hand and the arrays
+ * come from an arena reset at every record. The events
+ * that are frequent in lsb.events and lsb.acct have
+ * their readers here, the other ones are passed to the
+ * line readers as lsb_geteventrec() does.
+ */
+#define EVMAP_ARENA    (64 * 1024)
+#define EVMAP_RELEASE  (4 * 1024 * 1024)
+
+struct eventArena {
+    struct eventArena *next;
+    size_t size;
+    size_t used;
+    char data[1];
+};
+
+/* lsb_openeventmap()
+ *
+ * Map the event file open on fp, the records are
+ * read from the current position of fp. If the file
+ * cannot be mapped the records are read from fp.
+ */
+struct eventFileMap *
+lsb_openeventmap(FILE *fp)
+{
+    struct eventFileMap *m;
+    struct stat st;
+    long pos;
+
+    m = calloc(1, sizeof(struct eventFileMap));
+    if (m == NULL) {
+        lsberrno = LSBE_NO_MEM;
+        return NULL;
+    }
+    m->fp = fp;
+
+    pos = ftell(fp);
+    if (pos < 0
+        || fstat(fileno(fp), &st) < 0
+        || !S_ISREG(st.st_mode))
+        return m;
+
+    /* Nothing to map, do not go to the stream
+     * either, it is not safe in threads.
+     */
+    if (st.st_size <= pos) {
+        m->eof = TRUE;
+        return m;
+    }
+
+    m->base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE, fileno(fp), 0);
+    if (m->base == MAP_FAILED) {
+        m->base = NULL;
+        return m;
+    }
+    madvise(m->base, st.st_size, MADV_SEQUENTIAL);
+
+    m->size = st.st_size;
+    m->pos = pos;
+
+    return m;
+}
+
+/* lsb_eventmappos()
+ *
+ * Offset in the file of the next line.
+ */
+long
+lsb_eventmappos(struct eventFileMap *m)
+{
+    if (m->base == NULL)
+        return ftell(m->fp);
+
+    return m->pos;
+}
+
+/* lsb_seekeventmap()
+ *
+ * Move to the line at offset pos.
+ */
+int
+lsb_seekeventmap(struct eventFileMap *m, long pos)
+{
+    if (m->base == NULL)
+        return fseek(m->fp, pos, SEEK_SET);
+
+    if (pos < 0 || pos > (long)m->size)
+        return -1;
+
+    eventMapReset(m);
+    m->pos = pos;
+    if (m->released > pos)
+        m->released = pos & ~((size_t)getpagesize() - 1);
+
+    return 0;
+}
+
+/* lsb_closeeventmap()
+ *
+ * Unmap the file and leave fp at the position
+ * of the next line.
+ */
+void
+lsb_closeeventmap(struct eventFileMap *m)
+{
+    struct eventArena *a;
+
+    if (m == NULL)
+        return;
+
+    eventMapReset(m);
+
+    while ((a = m->arena)) {
+        m->arena = a->next;
+        free(a);
+    }
+
+    if (m->base) {
+        munmap(m->base, m->size);
+        fseek(m->fp, m->pos, SEEK_SET);
+    }
+
+    FREEUP(m->tail);
+    free(m);
+}
+
+/* lsb_geteventmaprec()
+ *
+ * Get the next record of a mapped event file. The
+ * record is valid until the next call.
+ */
+struct eventRec *
+lsb_geteventmaprec(struct eventFileMap *m, int *lineNum)
+{
+    struct eventRec *logRec;
+
+    if (m->base == NULL && !m->eof)
+        return lsb_geteventrec(m->fp, lineNum);
+
+    logRec = eventMapRec(m, lineNum);
+    lsberrno = m->err;
+
+    return logRec;
+}
+
+/* lsb_eventmapped()
+ *
+ * Is the file mapped. The records of a file that
+ * is not are read from its stream by lsb_geteventrec()
+ * which is not thread safe.
+ */
+int
+lsb_eventmapped(struct eventFileMap *m)
+{
+    return m->base != NULL || m->eof;
+}
+
+/* lsb_geteventmaprec_r()
+ *
+ * lsb_geteventmaprec() for threads, the error is
+ * returned in err and lsberrno is not used. The
+ * file must be mapped, see lsb_eventmapped().
+ */
+struct eventRec *
+lsb_geteventmaprec_r(struct eventFileMap *m, int *lineNum, int *err)
+{
+    struct eventRec *logRec;
+
+    if (!lsb_eventmapped(m)) {
+        *err = LSBE_SYS_CALL;
+        return NULL;
+    }
+
+    logRec = eventMapRec(m, lineNum);
+    *err = m->err;
+
+    return logRec;
+}
+
+/* eventMapRec()
+ *
+ * Parse the next record of the mapped file, the
+ * error is left in the map.
+ */
+static struct eventRec *
+eventMapRec(struct eventFileMap *m, int *lineNum)
+{
+    struct eventRec *logRec;
+    char *line;
+    char *etype;
+    char *ver;
+    int eventTime;
+    int eventKind;
+
+    m->err = LSBE_NO_ERROR;
+
+    if (m->eof) {
+        (*lineNum)++;
+        m->err = LSBE_EOF;
+        return NULL;
+    }
+
+    eventMapReset(m);
+    logRec = &m->rec;
+
+    (*lineNum)++;
+
+    do {
+        if ((line = eventMapLine(m)) == NULL) {
+            if (m->err == LSBE_NO_ERROR)
+                m->err = LSBE_EOF;
+            return NULL;
+        }
+    } while (*line == '#');
+
+    if (logclass & LC_TRACE)
+        ls_syslog(LOG_DEBUG2, "%s: line=%s", __func__, line);
+
+    etype = evStr(&line);
+    if (etype == NULL
+        || *line == '\0'
+        || strlen(etype) >= MAX_LSB_NAME_LEN) {
+        m->err = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+
+    ver = evStr(&line);
+    if (ver == NULL
+        || *line == '\0'
+        || strlen(ver) >= MAX_VERSION_LEN) {
+        m->err = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+
+    strcpy(logRec->version, ver);
+    if ((version = atoi(logRec->version)) <= 0) {
+        m->err = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+
+    if (evInt(&line, &eventTime) < 0) {
+        m->err = LSBE_EVENT_FORMAT;
+        return NULL;
+    }
+    logRec->eventTime = eventTime;
+
+    if ((logRec->type = eventTypeAndKind(etype, &eventKind)) == -1) {
+        m->err = LSBE_UNKNOWN_EVENT;
+        return NULL;
+    }
+
+    switch (logRec->type) {
+        case EVENT_JOB_NEW:
+        case EVENT_JOB_MODIFY:
+            m->err = mapJobNew(m, line, &logRec->eventLog.jobNewLog);
+            break;
+        case EVENT_PRE_EXEC_START:
+        case EVENT_JOB_START:
+            m->err = mapJobStart(m, line, &logRec->eventLog.jobStartLog);
+            break;
+        case EVENT_JOB_START_ACCEPT:
+            m->err = mapJobStartAccept(line,
+                                       &logRec->eventLog.jobStartAcceptLog);
+            break;
+        case EVENT_JOB_EXECUTE:
+            m->err = mapJobExecute(m, line,
+                                   &logRec->eventLog.jobExecuteLog);
+            break;
+        case EVENT_JOB_STATUS:
+            m->err = mapJobStatus(line, &logRec->eventLog.jobStatusLog);
+            break;
+        case EVENT_SBD_JOB_STATUS:
+            m->err = mapSbdJobStatus(line,
+                                     &logRec->eventLog.sbdJobStatusLog);
+            break;
+        case EVENT_JOB_SIGNAL:
+            m->err = mapJobSignal(line, &logRec->eventLog.signalLog);
+            break;
+        case EVENT_JOB_CLEAN:
+            m->err = mapJobClean(line, &logRec->eventLog.jobCleanLog);
+            break;
+        case EVENT_JOB_FINISH:
+            m->err = mapJobFinish(m, line, &logRec->eventLog.jobFinishLog,
+                                  logRec->eventTime);
+            break;
+        default:
+            m->recLine = TRUE;
+            m->err = readEventRecord(line, logRec);
+            break;
+    }
+
+    if (m->err == LSBE_NO_ERROR)
+        return logRec;
+
+    return NULL;
+}
+
+/* eventMapReset()
+ *
+ * Release the previous record, the pages already
+ * parsed and the arena.
+ */
+static void
+eventMapReset(struct eventFileMap *m)
+{
+    struct eventArena *a;
+    size_t size;
+    size_t off;
+
+    if (m->recLine)
+        freeLogRec(&m->rec);
+    m->recLine = FALSE;
+    memset(&m->rec, 0, sizeof(struct eventRec));
+
+    /* The unquoted strings dirty the private pages,
+     * give them back once they have been parsed.
+     */
+    if (m->base && m->pos - m->released >= EVMAP_RELEASE) {
+        off = (m->pos & ~((size_t)getpagesize() - 1));
+        madvise(m->base + m->released, off - m->released, MADV_DONTNEED);
+        m->released = off;
+    }
+
+    if (m->arena == NULL)
+        return;
+
+    if (m->arena->next == NULL) {
+        m->arena->used = 0;
+        return;
+    }
+
+    /* The record did not fit, replace the chunks
+     * with one as large as all of them.
+     */
+    size = 0;
+    while ((a = m->arena)) {
+        size += a->size;
+        m->arena = a->next;
+        free(a);
+    }
+
+    m->arena = malloc(sizeof(struct eventArena) + size);
+    if (m->arena) {
+        m->arena->next = NULL;
+        m->arena->size = size;
+        m->arena->used = 0;
+    }
+}
+
+static void *
+eventMapAlloc(struct eventFileMap *m, size_t n)
+{
+    struct eventArena *a;
+    size_t size;
+    void *p;
+
+    n = (n + 7) & ~(size_t)7;
+
+    a = m->arena;
+    if (a == NULL || a->used + n > a->size) {
+        size = n > EVMAP_ARENA ? n : EVMAP_ARENA;
+        a = malloc(sizeof(struct eventArena) + size);
+        if (a == NULL)
+            return NULL;
+        a->next = m->arena;
+        a->size = size;
+        a->used = 0;
+        m->arena = a;
+    }
+
+    p = a->data + a->used;
+    a->used += n;
+    memset(p, 0, n);
+
+    return p;
+}
+
+/* eventMapLine()
+ *
+ * Get the next line that is not blank, as
+ * getNextLine_() does the space characters become
+ * blanks and the trailing ones are removed.
+ */
+static char *
+eventMapLine(struct eventFileMap *m)
+{
+    char *line;
+    char *end;
+    char *p;
+    size_t len;
+
+    while (m->pos < m->size) {
+
+        line = m->base + m->pos;
+        end = memchr(line, '\n', m->size - m->pos);
+        if (end == NULL) {
+            /* The last line has no newline, there may be
+             * no room for the terminator in the mapping.
+             */
+            len = m->size - m->pos;
+            FREEUP(m->tail);
+            m->tail = malloc(len + 1);
+            if (m->tail == NULL) {
+                m->err = LSBE_NO_MEM;
+                return NULL;
+            }
+            memcpy(m->tail, line, len);
+            line = m->tail;
+            end = line + len;
+            m->pos = m->size;
+        } else {
+            m->pos = end - m->base + 1;
+        }
+        *end = '\0';
+
+        for (p = line; p < end; p++)
+            if (isspace((unsigned char)*p))
+                *p = ' ';
+
+        while (end > line && end[-1] == ' ')
+            *--end = '\0';
+
+        if (end > line)
+            return line;
+    }
+
+    return NULL;
+}
+
+/* evInt()
+ *
+ * Convert the next integer like sscanf("%d") does.
+ */
+static int
+evInt(char **line, int *val)
+{
+    char *p;
+    unsigned int v;
+    int neg;
+
+    p = *line;
+    while (*p == ' ')
+        p++;
+
+    neg = 0;
+    if (*p == '-') {
+        neg = 1;
+        p++;
+    } else if (*p == '+') {
+        p++;
+    }
+
+    if (*p < '0' || *p > '9')
+        return -1;
+
+    v = 0;
+    while (*p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+
+    *val = neg ? -(int)v : (int)v;
+    *line = p;
+
+    return 0;
+}
+
+static int
+evFloat(char **line, float *val)
+{
+    char *end;
+
+    *val = strtof(*line, &end);
+    if (end == *line)
+        return -1;
+    *line = end;
+
+    return 0;
+}
+
+static int
+evDouble(char **line, double *val)
+{
+    char *end;
+
+    *val = strtod(*line, &end);
+    if (end == *line)
+        return -1;
+    *line = end;
+
+    return 0;
+}
+
+/* evStr()
+ *
+ * Unquote the next string in place, the doubled
+ * quotes become one as in stripQStr().
+ */
+static char *
+evStr(char **line)
+{
+    char *q;
+    char *s;
+    char *d;
+
+    for (q = *line; *q != '"' && *q != '\0'; q++)
+        ;
+    if (*q == '\0')
+        return NULL;
+
+    s = d = ++q;
+    for (; *q != '\0'; q++, d++) {
+        if (*q == '"') {
+            if (*(q + 1) != '"')
+                break;
+            q++;
+        }
+        *d = *q;
+    }
+
+    if (*q == '\0')
+        return NULL;
+
+    *d = '\0';
+    *line = q + 1;
+
+    return s;
+}
+
+/* evCopy()
+ *
+ * The copyQStr() of the mapped readers.
+ */
+static int
+evCopy(char **line, int maxLen, int nonNil, char *dest)
+{
+    char *s;
+    size_t len;
+
+    if ((s = evStr(line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    len = strlen(s);
+    if (len >= (size_t)maxLen
+        || (nonNil && len == 0))
+        return LSBE_EVENT_FORMAT;
+
+    memcpy(dest, s, len + 1);
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+evRusage(char **line, struct lsfRusage *ru)
+{
+    if (evDouble(line, &ru->ru_utime) < 0
+        || evDouble(line, &ru->ru_stime) < 0
+        || evDouble(line, &ru->ru_maxrss) < 0
+        || evDouble(line, &ru->ru_ixrss) < 0
+        || evDouble(line, &ru->ru_ismrss) < 0
+        || evDouble(line, &ru->ru_idrss) < 0
+        || evDouble(line, &ru->ru_isrss) < 0
+        || evDouble(line, &ru->ru_minflt) < 0
+        || evDouble(line, &ru->ru_majflt) < 0
+        || evDouble(line, &ru->ru_nswap) < 0
+        || evDouble(line, &ru->ru_inblock) < 0
+        || evDouble(line, &ru->ru_oublock) < 0
+        || evDouble(line, &ru->ru_ioch) < 0
+        || evDouble(line, &ru->ru_msgsnd) < 0
+        || evDouble(line, &ru->ru_msgrcv) < 0
+        || evDouble(line, &ru->ru_nsignals) < 0
+        || evDouble(line, &ru->ru_nvcsw) < 0
+        || evDouble(line, &ru->ru_nivcsw) < 0
+        || evDouble(line, &ru->ru_exutime) < 0)
+        return -1;
+
+    return 0;
+}
+
+/* evHosts()
+ *
+ * Read num host names in an array of the arena.
+ */
+static int
+evHosts(struct eventFileMap *m, char **line, int num, char ***hosts)
+{
+    int i;
+
+    if (num <= 0)
+        return LSBE_NO_ERROR;
+
+    *hosts = eventMapAlloc(m, num * sizeof(char *));
+    if (*hosts == NULL)
+        return LSBE_NO_MEM;
+
+    for (i = 0; i < num; i++) {
+        if (((*hosts)[i] = evStr(line)) == NULL)
+            return LSBE_EVENT_FORMAT;
+    }
+
+    return LSBE_NO_ERROR;
+}
+
+static char *
+evEmpty(struct eventFileMap *m)
+{
+    return eventMapAlloc(m, 1);
+}
+
+/* The mapped readers follow readJobNew() and the
+ * others field by field, including the checks.
+ */
+static int
+mapJobNew(struct eventFileMap *m, char *line, struct jobNewLog *l)
+{
+    int submitTime;
+    int beginTime;
+    int termTime;
+    int i;
+    int cc;
+
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->userId) < 0
+        || evInt(&line, &l->options) < 0
+        || evInt(&line, &l->numProcessors) < 0
+        || evInt(&line, &submitTime) < 0
+        || evInt(&line, &beginTime) < 0
+        || evInt(&line, &termTime) < 0
+        || evInt(&line, &l->sigValue) < 0
+        || evInt(&line, &l->chkpntPeriod) < 0
+        || evInt(&line, &l->restartPid) < 0)
+        return LSBE_EVENT_FORMAT;
+    l->submitTime = submitTime;
+    l->beginTime = beginTime;
+    l->termTime = termTime;
+
+    if ((cc = evCopy(&line, MAX_LSB_NAME_LEN, 1, l->userName)))
+        return cc;
+
+    for (i = 0; i < LSF_RLIM_NLIMITS; i++) {
+        if (evInt(&line, &l->rLimits[i]) < 0)
+            return LSBE_EVENT_FORMAT;
+    }
+
+    if ((cc = evCopy(&line, MAXHOSTNAMELEN, 0, l->hostSpec)))
+        return cc;
+
+    if (evFloat(&line, &l->hostFactor) < 0
+        || evInt(&line, &l->umask) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if ((cc = evCopy(&line, MAX_LSB_NAME_LEN, 1, l->queue)))
+        return cc;
+    if ((l->resReq = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+    if ((cc = evCopy(&line, MAXHOSTNAMELEN, 1, l->fromHost))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->cwd))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->chkpntDir))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->inFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->outFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->errFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->subHomeDir))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 1, l->jobFile)))
+        return cc;
+
+    if (evInt(&line, &l->numAskedHosts) < 0)
+        return LSBE_EVENT_FORMAT;
+    if ((cc = evHosts(m, &line, l->numAskedHosts, &l->askedHosts)))
+        return cc;
+
+    if ((l->dependCond = evStr(&line)) == NULL
+        || (l->preExecCmd = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    if ((cc = evCopy(&line, MAX_CMD_DESC_LEN, 0, l->jobName))
+        || (cc = evCopy(&line, MAX_CMD_DESC_LEN, 0, l->command)))
+        return cc;
+
+    if (evInt(&line, &l->nxf) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (l->nxf > 0) {
+        l->xf = eventMapAlloc(m, l->nxf * sizeof(struct xFile));
+        if (l->xf == NULL)
+            return LSBE_NO_MEM;
+    }
+
+    for (i = 0; i < l->nxf; i++) {
+        if ((cc = evCopy(&line, MAXFILENAMELEN, 0, l->xf[i].subFn))
+            || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->xf[i].execFn)))
+            return cc;
+        if (evInt(&line, &l->xf[i].options) < 0)
+            return LSBE_EVENT_FORMAT;
+    }
+
+    if ((l->mailUser = evStr(&line)) == NULL
+        || (l->projectName = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    l->niosPort = 0;
+    if ((l->options & SUB_INTERACTIVE)
+        && evInt(&line, &l->niosPort) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->maxNumProcessors) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if ((l->schedHostType = evStr(&line)) == NULL
+        || (l->loginShell = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->options2) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if ((l->options2 & SUB2_BSUB_BLOCK)
+        && *line != '\0') {
+        char *p = line;
+        if (evInt(&p, &l->niosPort) < 0)
+            return LSBE_EVENT_FORMAT;
+    }
+
+    if (!(l->options & SUB_RLIMIT_UNIT_IS_KB)) {
+        convertRLimit(l->rLimits, 1);
+    }
+
+    if ((cc = evCopy(&line, MAXFILENAMELEN, 0, l->inFileSpool))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->commandSpool))
+        || (cc = evCopy(&line, MAXPATHLEN, 0, l->jobSpoolDir)))
+        return cc;
+
+    if (evInt(&line, &l->userPriority) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (version >= 31) {
+        if ((l->userGroup = evStr(&line)) == NULL)
+            return LSBE_EVENT_FORMAT;
+    } else if ((l->userGroup = evEmpty(m)) == NULL) {
+        return LSBE_NO_MEM;
+    }
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobStart(struct eventFileMap *m, char *line, struct jobStartLog *l)
+{
+    int cc;
+
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->jStatus) < 0
+        || evInt(&line, &l->jobPid) < 0
+        || evInt(&line, &l->jobPGid) < 0
+        || evFloat(&line, &l->hostFactor) < 0
+        || evInt(&line, &l->numExHosts) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (l->numExHosts == 0) {
+        ls_syslog(LOG_ERR, "\
+%s: The number of execution hosts is zero for job <%d>",
+                  __func__, l->jobId);
+        return LSBE_EVENT_FORMAT;
+    }
+
+    if ((cc = evHosts(m, &line, l->numExHosts, &l->execHosts)))
+        return cc;
+
+    if ((l->queuePreCmd = evStr(&line)) == NULL
+        || (l->queuePostCmd = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->jFlags) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (version >= 31) {
+        if ((l->userGroup = evStr(&line)) == NULL)
+            return LSBE_EVENT_FORMAT;
+    } else if ((l->userGroup = evEmpty(m)) == NULL) {
+        return LSBE_NO_MEM;
+    }
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobStartAccept(char *line, struct jobStartAcceptLog *l)
+{
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->jobPid) < 0
+        || evInt(&line, &l->jobPGid) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobExecute(struct eventFileMap *m, char *line, struct jobExecuteLog *l)
+{
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->execUid) < 0
+        || evInt(&line, &l->jobPGid) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if ((l->execCwd = evStr(&line)) == NULL
+        || (l->execHome = evStr(&line)) == NULL
+        || (l->execUsername = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->jobPid) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (version >= 32) {
+        if ((l->cpuBind = evStr(&line)) == NULL)
+            return LSBE_EVENT_FORMAT;
+    } else if ((l->cpuBind = evEmpty(m)) == NULL) {
+        return LSBE_NO_MEM;
+    }
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobStatus(char *line, struct jobStatusLog *l)
+{
+    int endTime;
+
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->jStatus) < 0
+        || evInt(&line, &l->reason) < 0
+        || evInt(&line, &l->subreasons) < 0
+        || evFloat(&line, &l->cpuTime) < 0
+        || evInt(&line, &endTime) < 0
+        || evInt(&line, &l->ru) < 0)
+        return LSBE_EVENT_FORMAT;
+    l->endTime = endTime;
+
+    if (l->ru && evRusage(&line, &l->lsfRusage) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->exitStatus) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapSbdJobStatus(char *line, struct sbdJobStatusLog *l)
+{
+    int actPeriod;
+
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->jStatus) < 0
+        || evInt(&line, &l->reasons) < 0
+        || evInt(&line, &l->subreasons) < 0
+        || evInt(&line, &l->actPid) < 0
+        || evInt(&line, &l->actValue) < 0
+        || evInt(&line, &actPeriod) < 0
+        || evInt(&line, &l->actFlags) < 0
+        || evInt(&line, &l->actStatus) < 0
+        || evInt(&line, &l->actReasons) < 0
+        || evInt(&line, &l->actSubReasons) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+    l->actPeriod = actPeriod;
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobSignal(char *line, struct signalLog *l)
+{
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->userId) < 0
+        || evInt(&line, &l->runCount) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    if ((l->signalSymbol = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
+
+    if (evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    return evCopy(&line, MAX_LSB_NAME_LEN, 1, l->userName);
+}
+
+static int
+mapJobClean(char *line, struct jobCleanLog *l)
+{
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->idx) < 0)
+        return LSBE_EVENT_FORMAT;
+
+    return LSBE_NO_ERROR;
+}
+
+static int
+mapJobFinish(struct eventFileMap *m,
+             char *line,
+             struct jobFinishLog *l,
+             time_t eventTime)
+{
+    int submitTime;
+    int beginTime;
+    int termTime;
+    int startTime;
+    int cc;
 
-    namebuf = calloc(1, strlen(line)+1);
-    if (namebuf == NULL) {
-        lsberrno = LSBE_NO_MEM;
-        return NULL;
-    }
+    if (evInt(&line, &l->jobId) < 0
+        || evInt(&line, &l->userId) < 0
+        || evInt(&line, &l->options) < 0
+        || evInt(&line, &l->numProcessors) < 0
+        || evInt(&line, &submitTime) < 0
+        || evInt(&line, &beginTime) < 0
+        || evInt(&line, &termTime) < 0
+        || evInt(&line, &startTime) < 0)
+        return LSBE_EVENT_FORMAT;
+    l->submitTime = submitTime;
+    l->beginTime = beginTime;
+    l->termTime = termTime;
+    l->startTime = startTime;
+
+    if ((cc = evCopy(&line, MAX_LSB_NAME_LEN, 1, l->userName))
+        || (cc = evCopy(&line, MAX_LSB_NAME_LEN, 1, l->queue)))
+        return cc;
+
+    if ((l->resReq = evStr(&line)) == NULL
+        || (l->dependCond = evStr(&line)) == NULL
+        || (l->preExecCmd = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
 
+    if ((cc = evCopy(&line, MAXHOSTNAMELEN, 1, l->fromHost))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->cwd))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->inFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->outFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->errFile))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 1, l->jobFile)))
+        return cc;
 
-    if ((ccount = stripQStr(line, namebuf)) < 0
-        || strlen(line) == ccount
-        || strlen(namebuf) >= MAX_LSB_NAME_LEN) {
-        lsberrno = LSBE_EVENT_FORMAT;
-        free(namebuf);
-        return NULL;
-    }
+    if (evInt(&line, &l->numAskedHosts) < 0)
+        return LSBE_EVENT_FORMAT;
+    if ((cc = evHosts(m, &line, l->numAskedHosts, &l->askedHosts)))
+        return cc;
 
-    strcpy(etype, namebuf);
-    line += ccount + 1;
+    if (evInt(&line, &l->numExHosts) < 0)
+        return LSBE_EVENT_FORMAT;
+    if ((cc = evHosts(m, &line, l->numExHosts, &l->execHosts)))
+        return cc;
 
-    if ((ccount = stripQStr(line, namebuf)) < 0
-        || strlen(line) == ccount
-        || strlen(namebuf) >= MAX_VERSION_LEN) {
-        lsberrno = LSBE_EVENT_FORMAT;
-        free(namebuf);
-        return NULL;
-    }
+    if (evInt(&line, &l->jStatus) < 0
+        || evFloat(&line, &l->hostFactor) < 0)
+        return LSBE_EVENT_FORMAT;
 
-    /* The log record keeps the version as char[]
-     * while the global is uint32_t
-     */
-    strcpy(logRec->version, namebuf);
-    if ((version = atoi(logRec->version)) <= 0) {
-        lsberrno = LSBE_EVENT_FORMAT;
-        return NULL;
-    }
-    line += ccount + 1;
+    l->endTime = eventTime;
 
-    free(namebuf);
+    if ((cc = evCopy(&line, MAX_CMD_DESC_LEN, 0, l->jobName))
+        || (cc = evCopy(&line, MAX_CMD_DESC_LEN, 0, l->command)))
+        return cc;
 
-    cc = sscanf(line, "%d%n", &tempTimeStamp, &ccount);
-    logRec->eventTime = tempTimeStamp;
+    if (evRusage(&line, &l->lsfRusage) < 0)
+        return LSBE_EVENT_FORMAT;
 
-    if (cc != 1) {
-        lsberrno = LSBE_EVENT_FORMAT;
-        return NULL;
-    }
-    line += ccount + 1;
+    l->cpuTime = (float)(l->lsfRusage.ru_utime + l->lsfRusage.ru_stime);
+    if (l->cpuTime < 0)
+        l->cpuTime = 0.0;
 
-    if ((logRec->type = getEventTypeAndKind(etype, &eventKind)) == -1)
-        return NULL;
-    if (logclass & LC_TRACE)
-        ls_syslog(LOG_DEBUG2, "%s: log.type=%x", __func__, logRec->type);
+    if ((l->mailUser = evStr(&line)) == NULL
+        || (l->projectName = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
 
-    readEventRecord(line, logRec);
+    if (evInt(&line, &l->exitStatus) < 0
+        || evInt(&line, &l->maxNumProcessors) < 0)
+        return LSBE_EVENT_FORMAT;
 
-    if (lsberrno == LSBE_NO_ERROR)
-        return logRec;
+    if ((l->loginShell = evStr(&line)) == NULL)
+        return LSBE_EVENT_FORMAT;
 
-    return NULL;
+    if (evInt(&line, &l->idx) < 0
+        || evInt(&line, &l->maxRMem) < 0
+        || evInt(&line, &l->maxRSwap) < 0)
+        return LSBE_EVENT_FORMAT;
 
+    if ((cc = evCopy(&line, MAXFILENAMELEN, 0, l->inFileSpool))
+        || (cc = evCopy(&line, MAXFILENAMELEN, 0, l->commandSpool)))
+        return cc;
+
+    return LSBE_NO_ERROR;
 }
 
 static void
@@ -574,6 +1615,7 @@ freeLogRec(struct eventRec *logRec)
             free(logRec->eventLog.jobExecuteLog.execCwd);
             free(logRec->eventLog.jobExecuteLog.execHome);
             free(logRec->eventLog.jobExecuteLog.execUsername);
+            _free_(logRec->eventLog.jobExecuteLog.cpuBind);
             return;
         case EVENT_JOB_MSG:
             _free_(logRec->eventLog.jobMsgLog.msg);
@@ -753,7 +1795,7 @@ readJobNew(char *line, struct jobNewLog *jobNewLog)
     if (cc != 1)
         return LSBE_EVENT_FORMAT;
 
-    if (version >= OPENLAVA_XDR_VERSION) {
+    if (version >= 31) {
         saveQStr(line, jobNewLog->userGroup);
     } else {
         jobNewLog->userGroup = strdup("");
@@ -975,7 +2017,7 @@ readJobStart(char *line, struct jobStartLog *jobStartLog)
     if (cc != 1)
         return LSBE_EVENT_FORMAT;
 
-    if (version >= OPENLAVA_XDR_VERSION) {
+    if (version >= 31) {
         saveQStr(line, jobStartLog->userGroup);
     } else {
         jobStartLog->userGroup = strdup("");
@@ -1032,6 +2074,14 @@ readJobExecute(char *line, struct jobExecuteLog *jobExecuteLog)
     cc = sscanf(line, "%d%n", &(jobExecuteLog->idx),  &ccount);
     if (cc != 1)
         return LSBE_EVENT_FORMAT;
+    line += ccount + 1;
+
+    if (version >= 32) {
+        saveQStr(line, jobExecuteLog->cpuBind);
+    } else {
+        jobExecuteLog->cpuBind = strdup("");
+    }
+
     return LSBE_NO_ERROR;
 
 }
@@ -2136,6 +3186,10 @@ writeJobExecute(FILE *log_fp, struct jobExecuteLog *jobExecuteLog)
     if (fprintf(log_fp, " %d", jobExecuteLog->idx) < 0)
         return LSBE_SYS_CALL;
 
+    if (addQStr(log_fp,
+                jobExecuteLog->cpuBind ? jobExecuteLog->cpuBind : "") < 0)
+        return LSBE_SYS_CALL;
+
     if (fprintf(log_fp, "\n") < 0)
         return LSBE_SYS_CALL;
 
@@ -2184,7 +3238,7 @@ writeSbdJobStatus(FILE *log_fp, struct sbdJobStatusLog *jobStatusLog)
                 jobStatusLog->actSubReasons) < 0)
         return LSBE_SYS_CALL;
 
-    if (fprintf(log_fp, " %d", jobStatusLog->idx) < 0)
+    if (fprintf(log_fp, " %d\n", jobStatusLog->idx) < 0)
         return LSBE_SYS_CALL;
 
     return LSBE_NO_ERROR;
@@ -2794,7 +3848,10 @@ lsbGetNextJobEvent (struct eventLogHandle *ePtr, int *lineNum,
     while(TRUE) {
         if (ePtr->fp != NULL)
             logRec = lsbGetNextJobRecFromFile(ePtr->fp, lineNum,
-                                              numJobIds, jobIds);
+                                              numJobIds, jobIds,
+                                              (indexS != NULL
+                                               && ePtr->curOpenFile > 0) ?
+                                              indexS->endPos : -1);
         else
             lsberrno = LSBE_EOF;
 
@@ -2821,6 +3878,10 @@ lsbGetNextJobEvent (struct eventLogHandle *ePtr, int *lineNum,
                 }
 
                 if ((indexS == NULL) || (nextFileNumber == -1)) {
+                    if (indexS != NULL) {
+                        indexS->seekPos = -1;
+                        indexS->endPos = -1;
+                    }
                     sprintf  (eventFile, "%s/lsb.events.%d",
                               ePtr->openEventFile,
                               --(ePtr->curOpenFile));
@@ -2863,6 +3924,14 @@ lsbGetNextJobEvent (struct eventLogHandle *ePtr, int *lineNum,
                 }
                 if (fseek (newfp, pos, SEEK_SET) != 0)
                     ls_syslog(LOG_ERR, I18N_FUNC_D_FAIL_M,  __func__, "fseek", pos);
+            } else if (indexS != NULL && indexS->seekPos > 0) {
+                /* Go straight to the first record of the
+                 * jobs, line numbers are then counted from
+                 * there.
+                 */
+                if (fseek(newfp, indexS->seekPos, SEEK_SET) != 0)
+                    ls_syslog(LOG_ERR, "%s: fseek(%s, %ld) failed: %m",
+                              __func__, eventFile, indexS->seekPos);
             }
             ePtr->fp = newfp;
             continue;
@@ -2871,9 +3940,15 @@ lsbGetNextJobEvent (struct eventLogHandle *ePtr, int *lineNum,
     }
 }
 
+/* lsbGetNextJobRecFromFile()
+ *
+ * Get the next record of the given jobs, records
+ * starting beyond endPos are not read unless endPos
+ * is negative.
+ */
 struct eventRec *
 lsbGetNextJobRecFromFile(FILE *logFp, int *lineNum,
-                         int numJobIds, LS_LONG_INT *jobIds)
+                         int numJobIds, LS_LONG_INT *jobIds, long endPos)
 {
     int cc;
     int ccount;
@@ -2897,6 +3972,11 @@ lsbGetNextJobRecFromFile(FILE *logFp, int *lineNum,
     while(TRUE) {
         (*lineNum)++;
 
+        if (endPos >= 0 && ftell(logFp) > endPos) {
+            lsberrno = LSBE_EOF;
+            break;
+        }
+
         if ((line = getNextLine_(logFp, FALSE)) == NULL) {
             if (lserrno == LSE_NO_MEM) {
                 lsberrno = LSBE_NO_MEM;
@@ -2955,7 +4035,7 @@ lsbGetNextJobRecFromFile(FILE *logFp, int *lineNum,
         if (logclass & LC_TRACE)
             ls_syslog(LOG_DEBUG2, "%s: log.type=%x", __func__, logRec->type);
 
-        readEventRecord (line, logRec);
+        lsberrno = readEventRecord(line, logRec);
 
         break;
 
@@ -3042,6 +4122,23 @@ getEventTypeAndKind(char *typeStr, int *eventKind)
 {
     int eventType;
 
+    if ((eventType = eventTypeAndKind(typeStr, eventKind)) == -1)
+        lsberrno = LSBE_UNKNOWN_EVENT;
+
+    return eventType;
+}
+
+/* eventTypeAndKind()
+ *
+ * Same as getEventTypeAndKind() but leaves lsberrno
+ * alone so that the threads reading mapped files
+ * can use it.
+ */
+static int
+eventTypeAndKind(char *typeStr, int *eventKind)
+{
+    int eventType;
+
     if (strcmp(typeStr, "JOB_NEW") == 0)
         eventType = EVENT_JOB_NEW;
     else if (strcmp(typeStr, "JOB_START") == 0)
@@ -3101,7 +4198,6 @@ getEventTypeAndKind(char *typeStr, int *eventKind)
     else if (strcmp(typeStr, "LOG_SWITCH") == 0)
         eventType = EVENT_LOG_SWITCH;
     else {
-        lsberrno = LSBE_UNKNOWN_EVENT;
         *eventKind = EVENT_NON_JOB_RELATED;
         return -1;
     }
@@ -3194,8 +4290,7 @@ lsb_readeventrecord(char *line, struct eventRec *logRec)
     }
 
 
-    lsberrno = LSBE_NO_ERROR;
-    readEventRecord(line, logRec);
+    lsberrno = readEventRecord(line, logRec);
     if (lsberrno != LSBE_NO_ERROR) {
         ls_syslog(LOG_DEBUG2, "%s: readEventRecord fail", __func__);
         return -1;
@@ -3204,101 +4299,110 @@ lsb_readeventrecord(char *line, struct eventRec *logRec)
 
 }
 
-void
+static int
 readEventRecord(char *line, struct eventRec *logRec)
 {
+    int cc;
+
+    cc = LSBE_NO_ERROR;
 
     switch (logRec->type) {
         case EVENT_JOB_NEW:
         case EVENT_JOB_MODIFY:
-            lsberrno = readJobNew(line, &(logRec->eventLog.jobNewLog));
+            cc = readJobNew(line, &(logRec->eventLog.jobNewLog));
             break;
         case EVENT_JOB_MODIFY2:
-            lsberrno = readJobMod(line, &(logRec->eventLog.jobModLog));
+            cc = readJobMod(line, &(logRec->eventLog.jobModLog));
             break;
         case EVENT_PRE_EXEC_START:
         case EVENT_JOB_START:
-            lsberrno = readJobStart(line, &(logRec->eventLog.jobStartLog));
+            cc = readJobStart(line, &(logRec->eventLog.jobStartLog));
             break;
         case EVENT_JOB_START_ACCEPT:
-            lsberrno = readJobStartAccept(line,
-                                          &(logRec->eventLog.jobStartAcceptLog));
+            cc = readJobStartAccept(line,
+                                    &(logRec->eventLog.jobStartAcceptLog));
             break;
         case EVENT_JOB_STATUS:
-            lsberrno = readJobStatus(line, &(logRec->eventLog.jobStatusLog));
+            cc = readJobStatus(line, &(logRec->eventLog.jobStatusLog));
             break;
         case EVENT_SBD_JOB_STATUS:
-            lsberrno = readSbdJobStatus(line, &(logRec->eventLog.sbdJobStatusLog));
+            cc = readSbdJobStatus(line, &(logRec->eventLog.sbdJobStatusLog));
             break;
         case EVENT_JOB_SWITCH:
-            lsberrno = readJobSwitch(line, &(logRec->eventLog.jobSwitchLog));
+            cc = readJobSwitch(line, &(logRec->eventLog.jobSwitchLog));
             break;
         case EVENT_JOB_MOVE:
-            lsberrno = readJobMove(line, &(logRec->eventLog.jobMoveLog));
+            cc = readJobMove(line, &(logRec->eventLog.jobMoveLog));
             break;
         case EVENT_QUEUE_CTRL:
-            lsberrno = readQueueCtrl(line, &(logRec->eventLog.queueCtrlLog));
+            cc = readQueueCtrl(line, &(logRec->eventLog.queueCtrlLog));
             break;
         case EVENT_HOST_CTRL:
-            lsberrno = readHostCtrl(line, &(logRec->eventLog.hostCtrlLog));
+            cc = readHostCtrl(line, &(logRec->eventLog.hostCtrlLog));
             break;
         case EVENT_MBD_START:
-            lsberrno = readMbdStart(line, &(logRec->eventLog.mbdStartLog));
+            cc = readMbdStart(line, &(logRec->eventLog.mbdStartLog));
             break;
         case EVENT_MBD_DIE:
-            lsberrno = readMbdDie (line, &(logRec->eventLog.mbdDieLog));
+            cc = readMbdDie (line, &(logRec->eventLog.mbdDieLog));
             break;
         case EVENT_MBD_UNFULFILL:
-            lsberrno = readUnfulfill (line, &(logRec->eventLog.unfulfillLog));
+            cc = readUnfulfill (line, &(logRec->eventLog.unfulfillLog));
             break;
         case EVENT_LOAD_INDEX:
-            lsberrno = readLoadIndex (line, &(logRec->eventLog.loadIndexLog));
+            cc = readLoadIndex (line, &(logRec->eventLog.loadIndexLog));
             break;
         case EVENT_JOB_FINISH:
-            lsberrno = readJobFinish(line, &(logRec->eventLog.jobFinishLog),
-                                     logRec->eventTime);
+            cc = readJobFinish(line, &(logRec->eventLog.jobFinishLog),
+                               logRec->eventTime);
             break;
         case EVENT_CHKPNT:
-            lsberrno = readChkpnt(line, &(logRec->eventLog.chkpntLog));
+            cc = readChkpnt(line, &(logRec->eventLog.chkpntLog));
             break;
         case EVENT_MIG:
-            lsberrno = readMig(line, &(logRec->eventLog.migLog));
+            cc = readMig(line, &(logRec->eventLog.migLog));
             break;
         case EVENT_JOB_ATTR_SET:
-            lsberrno = readJobAttrSet(line, &(logRec->eventLog.jobAttrSetLog));
+            cc = readJobAttrSet(line, &(logRec->eventLog.jobAttrSetLog));
             break;
         case EVENT_JOB_SIGNAL:
-            lsberrno = readJobSignal(line, &(logRec->eventLog.signalLog));
+            cc = readJobSignal(line, &(logRec->eventLog.signalLog));
             break;
         case EVENT_JOB_EXECUTE:
-            lsberrno = readJobExecute(line, &(logRec->eventLog.jobExecuteLog));
+            cc = readJobExecute(line, &(logRec->eventLog.jobExecuteLog));
             break;
         case EVENT_JOB_MSG:
-            lsberrno = readJobMsg(line, &(logRec->eventLog.jobMsgLog));
+            cc = readJobMsg(line, &(logRec->eventLog.jobMsgLog));
             break;
         case EVENT_JOB_SIGACT:
-            lsberrno = readJobSigAct(line, &(logRec->eventLog.sigactLog));
+            cc = readJobSigAct(line, &(logRec->eventLog.sigactLog));
             break;
         case EVENT_JOB_REQUEUE:
-            lsberrno = readJobRequeue(line, &(logRec->eventLog.jobRequeueLog));
+            cc = readJobRequeue(line, &(logRec->eventLog.jobRequeueLog));
             break;
         case EVENT_JOB_CLEAN:
-            lsberrno = readJobClean(line, &(logRec->eventLog.jobCleanLog));
+            cc = readJobClean(line, &(logRec->eventLog.jobCleanLog));
             break;
         case EVENT_JOB_FORCE:
-            lsberrno = readJobForce(line, &(logRec->eventLog.jobForceRequestLog));
+            cc = readJobForce(line, &(logRec->eventLog.jobForceRequestLog));
             break;
         case EVENT_LOG_SWITCH:
-            lsberrno = readLogSwitch(line, &(logRec->eventLog.logSwitchLog));
+            cc = readLogSwitch(line, &(logRec->eventLog.logSwitchLog));
             break;
     }
 
-    return;
+    return cc;
 }
 
+/* getJobIdIndexFromEventFile()
+ *
+ * Build the index row of an event file parsing only
+ * the beginning of each record, this is how the index
+ * is rebuilt when mbd could not append the row itself
+ * at the time of the log switch.
+ */
 int
-getJobIdIndexFromEventFile (char *eventFile, struct sortIntList *header,
-                            time_t *timeStamp)
+getJobIdIndexFromEventFile(char *eventFile, struct jobIdIndexRow *row)
 {
     FILE *eventFp;
     char ch;
@@ -3310,6 +4414,7 @@ getJobIdIndexFromEventFile (char *eventFile, struct sortIntList *header,
     int eventType;
     int tempTimeStamp;
     int cc;
+    long pos;
 
     if ((eventFp = fopen(eventFile, "r")) == NULL) {
         lsberrno = LSBE_SYS_CALL;
@@ -3322,12 +4427,13 @@ getJobIdIndexFromEventFile (char *eventFile, struct sortIntList *header,
 %s: fscanf(%s) failed: old event file format", __func__, eventFile);
         if (fseek (eventFp, 0, SEEK_SET) != 0)
             ls_syslog(LOG_ERR, I18N_FUNC_D_FAIL_M,  __func__, "fseek", 0);
-        *timeStamp = 0;
+        tempTimeStamp = 0;
     }
-    *timeStamp = tempTimeStamp;
+    row->timeStamp = tempTimeStamp;
 
     while(TRUE) {
 
+        pos = ftell(eventFp);
         if ((line = getNextLine_(eventFp, FALSE)) == NULL) {
             if (lserrno == LSE_NO_MEM) {
                 lsberrno = LSBE_NO_MEM;
@@ -3367,11 +4473,10 @@ getJobIdIndexFromEventFile (char *eventFile, struct sortIntList *header,
         if ((jobId = getJobIdFromEvent(line, eventType)) == 0)
             continue;
 
-        if (insertSortIntList(header, jobId)<0) {
-            lsberrno = LSBE_NO_MEM;
-            break;
+        if (addJobIdIndexRow(row, jobId, pos) < 0) {
+            fclose(eventFp);
+            return -1;
         }
-
     }
 
     fclose(eventFp);
@@ -3436,70 +4541,181 @@ getJobIdFromEvent(char *line, int eventType)
 
 }
 
+/* getJobIdFromEventRec()
+ *
+ * Same as getJobIdFromEvent() for a record already
+ * parsed, 0 if the event does not belong to a job.
+ */
 int
-writeJobIdIndexToIndexFile (FILE *indexFp, struct sortIntList *header,
-                            time_t timeStamp)
+getJobIdFromEventRec(struct eventRec *logPtr)
 {
-    int                     minJobId;
-    int                     maxJobId;
-    int                     totalJobIds;
-    struct sortIntList      *list;
-    int                     col;
-    int                     jobId;
-
+    switch (logPtr->type) {
+        case EVENT_JOB_NEW:
+        case EVENT_JOB_MODIFY:
+            return logPtr->eventLog.jobNewLog.jobId;
+        case EVENT_JOB_MODIFY2:
+            return atoi(logPtr->eventLog.jobModLog.jobIdStr);
+        case EVENT_PRE_EXEC_START:
+        case EVENT_JOB_START:
+            return logPtr->eventLog.jobStartLog.jobId;
+        case EVENT_JOB_START_ACCEPT:
+            return logPtr->eventLog.jobStartAcceptLog.jobId;
+        case EVENT_JOB_STATUS:
+            return logPtr->eventLog.jobStatusLog.jobId;
+        case EVENT_SBD_JOB_STATUS:
+            return logPtr->eventLog.sbdJobStatusLog.jobId;
+        case EVENT_JOB_FINISH:
+            return logPtr->eventLog.jobFinishLog.jobId;
+        case EVENT_CHKPNT:
+            return logPtr->eventLog.chkpntLog.jobId;
+        case EVENT_MIG:
+            return logPtr->eventLog.migLog.jobId;
+        case EVENT_JOB_ATTR_SET:
+            return logPtr->eventLog.jobAttrSetLog.jobId;
+        case EVENT_JOB_SIGNAL:
+            return logPtr->eventLog.signalLog.jobId;
+        case EVENT_JOB_EXECUTE:
+            return logPtr->eventLog.jobExecuteLog.jobId;
+        case EVENT_JOB_MSG:
+            return logPtr->eventLog.jobMsgLog.jobId;
+        case EVENT_JOB_MSG_ACK:
+            return logPtr->eventLog.jobMsgAckLog.jobId;
+        case EVENT_JOB_SIGACT:
+            return logPtr->eventLog.sigactLog.jobId;
+        case EVENT_JOB_REQUEUE:
+            return logPtr->eventLog.jobRequeueLog.jobId;
+        case EVENT_JOB_CLEAN:
+            return logPtr->eventLog.jobCleanLog.jobId;
+        case EVENT_JOB_FORCE:
+            return logPtr->eventLog.jobForceRequestLog.jobId;
+        case EVENT_JOB_SWITCH:
+            return logPtr->eventLog.jobSwitchLog.jobId;
+        case EVENT_JOB_MOVE:
+            return logPtr->eventLog.jobMoveLog.jobId;
+        default:
+            return 0;
+    }
+}
 
-    if (getMinSortIntList(header, &minJobId) == -1)
-        minJobId = 0;
+/* addJobIdIndexRow()
+ *
+ * Record that the event of jobId starts at pos.
+ * Consecutive records of the same job share the
+ * entry, the rest is merged when the row is written.
+ * A row that misses a job must not be written, the
+ * readers would skip the file for that job.
+ */
+int
+addJobIdIndexRow(struct jobIdIndexRow *row, int jobId, long pos)
+{
+    struct jobIdIndexEnt *e;
 
-    if (getMaxSortIntList(header, &maxJobId) == -1)
-        maxJobId = 0;
+    if (row->numEnts > 0
+        && row->ents[row->numEnts - 1].jobId == jobId) {
+        row->ents[row->numEnts - 1].last = pos;
+        return 0;
+    }
 
-    totalJobIds = getTotalSortIntList(header);
+    if (row->numEnts == row->maxEnts) {
+        int n;
 
-    if (fprintf(indexFp, "#%d %d %s %s\n",
-                (int) timeStamp,
-                totalJobIds,
-                lsb_jobidinstr(minJobId),
-                lsb_jobidinstr(maxJobId)) < 0) {
-        lsberrno = LSBE_SYS_CALL;
-        return -1;
+        n = row->maxEnts ? 2 * row->maxEnts : 1024;
+        e = realloc(row->ents, n * sizeof(struct jobIdIndexEnt));
+        if (e == NULL) {
+            lsberrno = LSBE_NO_MEM;
+            return -1;
+        }
+        row->ents = e;
+        row->maxEnts = n;
     }
 
-    list = header;
-    col = 0;
+    e = &row->ents[row->numEnts];
+    e->jobId = jobId;
+    e->first = pos;
+    e->last = pos;
+    row->numEnts++;
 
-    while((list = getNextSortIntList(header, list, &jobId)) != NULL) {
-        if (col == 0) {
-            if (fprintf(indexFp, "%d", jobId) < 0) {
-                lsberrno = LSBE_SYS_CALL;
-                return -1;
-            }
-        } else {
-            if (fprintf(indexFp, " %d", jobId) < 0) {
-                lsberrno = LSBE_SYS_CALL;
-                return -1;
-            }
-        }
+    return 0;
+}
 
-        col++;
-        if (col == 10) {
-            if (fprintf(indexFp, "\n") < 0) {
-                lsberrno = LSBE_SYS_CALL;
-                return -1;
-            }
-            col = 0;
+static int
+cmpJobIdIndexEnt(const void *x, const void *y)
+{
+    const struct jobIdIndexEnt *e1 = x;
+    const struct jobIdIndexEnt *e2 = y;
+
+    if (e1->jobId != e2->jobId)
+        return e1->jobId > e2->jobId ? -1 : 1;
+    if (e1->first != e2->first)
+        return e1->first < e2->first ? -1 : 1;
+    return 0;
+}
+
+/* writeJobIdIndexRow()
+ *
+ * Write the row sorted by decreasing job ID, one
+ * job per line with the offsets of its first and
+ * last record. The header carries the length of the
+ * lines so readers can skip rows not having the jobs
+ * they look for.
+ */
+int
+writeJobIdIndexRow(FILE *indexFp, struct jobIdIndexRow *row)
+{
+    struct jobIdIndexEnt *e;
+    long len;
+    int i;
+    int n;
+
+    if (row->numEnts > 0)
+        qsort(row->ents, row->numEnts,
+              sizeof(struct jobIdIndexEnt), cmpJobIdIndexEnt);
+
+    n = 0;
+    for (i = 0; i < row->numEnts; i++) {
+        e = &row->ents[i];
+        if (n > 0 && row->ents[n - 1].jobId == e->jobId) {
+            if (e->last > row->ents[n - 1].last)
+                row->ents[n - 1].last = e->last;
+            continue;
         }
+        row->ents[n++] = *e;
+    }
+    row->numEnts = n;
+
+    len = 0;
+    for (i = 0; i < row->numEnts; i++) {
+        e = &row->ents[i];
+        len += snprintf(NULL, 0, "%d %ld %ld\n", e->jobId, e->first, e->last);
+    }
 
+    if (fprintf(indexFp, "#%ld %d %d %d %ld\n",
+                (long)row->timeStamp,
+                row->numEnts,
+                row->numEnts ? row->ents[row->numEnts - 1].jobId : 0,
+                row->numEnts ? row->ents[0].jobId : 0,
+                len) < 0) {
+        lsberrno = LSBE_SYS_CALL;
+        return -1;
     }
 
-    if (col)
-        if (fprintf(indexFp, "\n") < 0) {
+    for (i = 0; i < row->numEnts; i++) {
+        e = &row->ents[i];
+        if (fprintf(indexFp, "%d %ld %ld\n", e->jobId, e->first, e->last) < 0) {
             lsberrno = LSBE_SYS_CALL;
             return -1;
         }
+    }
 
     return 0;
+}
 
+void
+freeJobIdIndexRow(struct jobIdIndexRow *row)
+{
+    FREEUP(row->ents);
+    row->numEnts = 0;
+    row->maxEnts = 0;
 }
 
 int
@@ -3511,12 +4727,12 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
     char indexVersion[16];
     int rows;
     int lastUpdate;
-    struct sortIntList *listHeader;
-    time_t timeStamp;
+    struct jobIdIndexRow row;
     int addedEventFile;
     int i;
 
     lsberrno = LSBE_NO_ERROR;
+    indexFp = NULL;
 
     if (stat(indexFile, &st) == 0) {
 
@@ -3525,7 +4741,7 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
             return -1;
         }
 
-        if (fscanf(indexFp, "%s %s %d %d\n",
+        if (fscanf(indexFp, "%s %15s %d %d\n",
                    nameBuf, indexVersion, &rows, &lastUpdate) != 4 ||
             strcmp(nameBuf, LSF_JOBIDINDEX_FILETAG)) {
             ls_syslog(LOG_ERR, I18N(5506,
@@ -3537,8 +4753,11 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
             return -1;
         }
 
-
-        if (totalEventFile == rows + 1) {
+        /* Indexes of older versions have no offsets
+         * so they are rebuilt.
+         */
+        if (totalEventFile == rows + 1
+            && strcmp(indexVersion, LSF_JOBIDINDEX_VERSION) == 0) {
             addedEventFile = 1;
 
 
@@ -3554,8 +4773,7 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
 
     }
 
-    if ((stat(indexFile, &st) != 0) ||
-        (indexFp == NULL)) {
+    if (indexFp == NULL) {
 
         if ((indexFp = fopen(indexFile, "w+")) == NULL) {
             lsberrno = LSBE_SYS_CALL;
@@ -3568,7 +4786,7 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
         }
 
         addedEventFile = totalEventFile;
-        sprintf(indexVersion, "%d", OPENLAVA_XDR_VERSION);
+        strcpy(indexVersion, LSF_JOBIDINDEX_VERSION);
         rows = 0;
 
         fprintf(indexFp, "%80s", "\n");
@@ -3579,19 +4797,19 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
 
         sprintf(nameBuf, "%s.%d", eventFile, i);
 
-        if ((listHeader = initSortIntList(0)) == NULL) {
-            lsberrno = LSBE_NO_MEM;
-            break;
-        }
-        if (getJobIdIndexFromEventFile (nameBuf, listHeader, &timeStamp)) {
-            freeSortIntList(listHeader);
-            break;
-        }
-        if (writeJobIdIndexToIndexFile (indexFp, listHeader, timeStamp)) {
-            freeSortIntList(listHeader);
-            break;
+        /* The rows map to the files by their count,
+         * an index missing a row or part of one is
+         * removed so that readers search the files.
+         */
+        memset(&row, 0, sizeof(struct jobIdIndexRow));
+        if (getJobIdIndexFromEventFile (nameBuf, &row)
+            || writeJobIdIndexRow (indexFp, &row)) {
+            freeJobIdIndexRow(&row);
+            fclose(indexFp);
+            unlink(indexFile);
+            return -1;
         }
-        freeSortIntList(listHeader);
+        freeJobIdIndexRow(&row);
         rows++;
     }
 
@@ -3617,98 +4835,154 @@ updateJobIdIndexFile (char *indexFile, char *eventFile, int totalEventFile)
     return 0;
 }
 
+/* appendJobIdIndexFile()
+ *
+ * Append the row of the file just rotated to
+ * lsb.events.1, the row is built by mbd while it
+ * compacts lsb.events during the switch. Fails if the
+ * index is missing or does not match the existing
+ * files, the caller must then rebuild it.
+ */
+int
+appendJobIdIndexFile(char *indexFile,
+                     struct jobIdIndexRow *row,
+                     int totalEventFile)
+{
+    FILE *indexFp;
+    char nameBuf[MAXLINELEN];
+    char indexVersion[16];
+    int rows;
+    int lastUpdate;
+
+    if ((indexFp = fopen(indexFile, "r+")) == NULL) {
+        lsberrno = LSBE_SYS_CALL;
+        return -1;
+    }
+
+    if (fscanf(indexFp, "%s %15s %d %d",
+               nameBuf, indexVersion, &rows, &lastUpdate) != 4
+        || strcmp(nameBuf, LSF_JOBIDINDEX_FILETAG)
+        || strcmp(indexVersion, LSF_JOBIDINDEX_VERSION)
+        || totalEventFile != rows + 1) {
+        lsberrno = LSBE_INDEX_FORMAT;
+        fclose(indexFp);
+        return -1;
+    }
+
+    if (fseek(indexFp, 0, SEEK_END) != 0
+        || writeJobIdIndexRow(indexFp, row) < 0) {
+        lsberrno = LSBE_SYS_CALL;
+        fclose(indexFp);
+        return -1;
+    }
+
+    rewind(indexFp);
+    if (fprintf(indexFp, "%s %s %d %d",
+                LSF_JOBIDINDEX_FILETAG, indexVersion,
+                rows + 1, (int)time(NULL)) < 0) {
+        lsberrno = LSBE_SYS_CALL;
+        fclose(indexFp);
+        return -1;
+    }
+
+    if (fclose(indexFp) != 0) {
+        lsberrno = LSBE_SYS_CALL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* getNextFileNumFromIndexS()
+ *
+ * Return the number of the next event file having
+ * records of the given jobs, 0 for lsb.events. The
+ * rows are in the order of the files from the oldest
+ * to lsb.events.1. The offsets of the first and last
+ * record of the jobs in the file are returned in
+ * seekPos and endPos.
+ */
 int
 getNextFileNumFromIndexS(struct jobIdIndexS *indexS, int numJobIds,
                           LS_LONG_INT *jobIds)
 {
-    int                     position;
-    int                     i,j;
-    int                     size;
+    long len;
+    long rowPos;
+    long first;
+    long last;
+    int found;
+    int jobId;
+    int minWanted;
+    int i;
+    int j;
 
     while(TRUE) {
 
         indexS->curRow++;
-        if (indexS->curRow == indexS->totalRows) {
-            free(indexS->jobIds);
-            indexS->jobIds = NULL;
+        if (indexS->curRow > indexS->totalRows) {
             fclose(indexS->fp);
+            indexS->fp = NULL;
+            indexS->seekPos = -1;
+            indexS->endPos = -1;
             return 0;
         }
 
-        if (indexS->jobIds != NULL) {
-            free(indexS->jobIds);
-            indexS->jobIds = NULL;
-        }
-
-        if (fscanf(indexS->fp, "#%ld %d %lld %lld\n",
+        if (fscanf(indexS->fp, "#%ld %d %lld %lld %ld\n",
                    &(indexS->timeStamp),
                    &(indexS->totalJobIds),
                    &(indexS->minJobId),
-                   &(indexS->maxJobId)) != 4) {
-            lsberrno = LSBE_SYS_CALL;
+                   &(indexS->maxJobId),
+                   &len) != 5) {
+            lsberrno = LSBE_INDEX_FORMAT;
             return -1;
         }
+        rowPos = ftell(indexS->fp);
 
-        size = indexS->totalJobIds*sizeof(int);
-        if ((indexS->jobIds = (int *)malloc(size)) == NULL) {
-            lsberrno = LSBE_NO_MEM;
-            return -1;
+        minWanted = INFINIT_INT;
+        for (i = 0; i < numJobIds; i++) {
+            jobId = LSB_ARRAY_JOBID(jobIds[i]);
+            if (jobId > indexS->maxJobId
+                || jobId < indexS->minJobId)
+                continue;
+            if (jobId < minWanted)
+                minWanted = jobId;
         }
 
-        if (indexS->totalJobIds == 0)
-            continue;
-
+        found = FALSE;
+        for (j = 0;
+             minWanted != INFINIT_INT && j < indexS->totalJobIds;
+             j++) {
 
-        position = 0;
-        while (indexS->totalJobIds - position >= 10) {
-            if (fscanf(indexS->fp, "%d %d %d %d %d %d %d %d %d %d\n",
-                       &(indexS->jobIds[position]),
-                       &(indexS->jobIds[position+1]),
-                       &(indexS->jobIds[position+2]),
-                       &(indexS->jobIds[position+3]),
-                       &(indexS->jobIds[position+4]),
-                       &(indexS->jobIds[position+5]),
-                       &(indexS->jobIds[position+6]),
-                       &(indexS->jobIds[position+7]),
-                       &(indexS->jobIds[position+8]),
-                       &(indexS->jobIds[position+9])) != 10) {
-                lsberrno = LSBE_SYS_CALL;
+            if (fscanf(indexS->fp, "%d %ld %ld\n",
+                       &jobId, &first, &last) != 3) {
+                lsberrno = LSBE_INDEX_FORMAT;
                 return -1;
             }
-            position+=10;
-        }
 
-        for(i=position; i<indexS->totalJobIds; i++) {
-            if (fscanf(indexS->fp, "%d", &(indexS->jobIds[i])) != 1) {
-                lsberrno = LSBE_SYS_CALL;
-                return -1;
+            /* Sorted by decreasing job ID.
+             */
+            if (jobId < minWanted)
+                break;
+
+            for (i = 0; i < numJobIds; i++) {
+                if (jobId != LSB_ARRAY_JOBID(jobIds[i]))
+                    continue;
+                if (!found || first < indexS->seekPos)
+                    indexS->seekPos = first;
+                if (!found || last > indexS->endPos)
+                    indexS->endPos = last;
+                found = TRUE;
+                break;
             }
-            if (i == indexS->totalJobIds - 1)
-                if (fscanf(indexS->fp, "\n") < 0) {
-                    lsberrno = LSBE_SYS_CALL;
-                    return -1;
-                }
         }
 
-        for (i = 0; i < numJobIds; i++) {
-            int jobId;
-
-            jobId = LSB_ARRAY_JOBID(jobIds[i]);
-
-            if ((jobId > indexS->maxJobId) ||
-                (jobId < indexS->minJobId))
-                continue;
-
-            for (j = 0; j < indexS->totalJobIds; j++) {
-                if (jobId == indexS->jobIds[j]) {
-                    return(indexS->totalRows-indexS->curRow+1);
-                }
-
-                if (jobId > indexS->jobIds[j])
-                    break;
-            }
+        if (fseek(indexS->fp, rowPos + len, SEEK_SET) != 0) {
+            lsberrno = LSBE_SYS_CALL;
+            return -1;
         }
 
+        if (found)
+            return indexS->totalRows - indexS->curRow + 1;
     }
 
     return 0;
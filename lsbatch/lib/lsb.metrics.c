@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include "lsb.h"
+
+static void freeMetrics(struct metricsInfoReply *);
+
+/* lsb_metricsinfo()
+ *
+ * Get the scheduler counters and histograms from
+ * mbatchd. The reply is owned by the library and
+ * is valid until the next call.
+ */
+struct metricsInfoReply *
+lsb_metricsinfo(void)
+{
+    static struct metricsInfoReply reply;
+    XDR xdrs;
+    struct LSFHeader hdr;
+    char request_buf[MSGSIZE/8];
+    char *reply_buf;
+    int cc;
+
+    freeMetrics(&reply);
+
+    initLSFHeader_(&hdr);
+    hdr.opCode = BATCH_METRICS_INFO;
+
+    xdrmem_create(&xdrs, request_buf, sizeof(request_buf), XDR_ENCODE);
+
+    if (! xdr_encodeMsg(&xdrs,
+                        NULL,
+                        &hdr,
+                        NULL,
+                        0,
+                        NULL)) {
+        xdr_destroy(&xdrs);
+        lsberrno = LSBE_XDR;
+        return NULL;
+    }
+
+    cc = callmbd(NULL,
+                 request_buf,
+                 XDR_GETPOS(&xdrs),
+                 &reply_buf,
+                 &hdr,
+                 NULL,
+                 NULL,
+                 NULL);
+    if (cc < 0) {
+        xdr_destroy(&xdrs);
+        return NULL;
+    }
+    xdr_destroy(&xdrs);
+
+    lsberrno = hdr.opCode;
+    if (lsberrno != LSBE_NO_ERROR) {
+        if (cc)
+            free(reply_buf);
+        return NULL;
+    }
+
+    xdrmem_create(&xdrs, reply_buf, XDR_DECODE_SIZE_(cc), XDR_DECODE);
+
+    if (! xdr_metricsInfoReply(&xdrs, &reply, &hdr)) {
+        xdr_destroy(&xdrs);
+        if (cc)
+            free(reply_buf);
+        freeMetrics(&reply);
+        lsberrno = LSBE_XDR;
+        return NULL;
+    }
+
+    xdr_destroy(&xdrs);
+    if (cc)
+        free(reply_buf);
+
+    return &reply;
+}
+
+static void
+freeMetrics(struct metricsInfoReply *r)
+{
+    int i;
+
+    if (r->metrics == NULL)
+        return;
+
+    for (i = 0; i < r->numMetrics; i++) {
+        FREEUP(r->metrics[i].name);
+        FREEUP(r->metrics[i].label);
+        FREEUP(r->metrics[i].buckets);
+    }
+
+    FREEUP(r->metrics);
+    r->numMetrics = 0;
+}
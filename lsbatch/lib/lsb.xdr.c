@@ -771,6 +771,151 @@ xdr_jobInfoReply(XDR *xdrs,
 
     if (xdrs->x_op == XDR_DECODE) {
         jobId32To64(&jobInfoReply->jobId,jobArrId, jobArrElemId);
+        jobInfoReply->cpuBind = NULL;
+    }
+
+    /* The CPUs the job is bound to since
+     * version 32.
+     */
+    if (hdr->version >= 32) {
+        sp = jobInfoReply->cpuBind ? jobInfoReply->cpuBind : "";
+        if (!xdr_var_string(xdrs, &sp))
+            return false;
+        if (xdrs->x_op == XDR_DECODE)
+            jobInfoReply->cpuBind = sp;
+    }
+
+    return true;
+}
+
+/* xdr_jobInfoBrief()
+ *
+ * The job info reply for JOBINFO_BRIEF requests,
+ * the job bill is reduced to the fields bjobs shows
+ * by default. On decode the fields that are not
+ * sent are zero or NULL.
+ */
+bool_t
+xdr_jobInfoBrief(XDR *xdrs,
+                 struct jobInfoReply *jobInfoReply,
+                 struct LSFHeader *hdr)
+{
+    struct submitReq *jobBill;
+    char *sp;
+    int i;
+    int j;
+    int jobArrId, jobArrElemId;
+
+    jobBill = jobInfoReply->jobBill;
+
+    if (xdrs->x_op == XDR_DECODE) {
+
+        jobInfoReply->userName[0] = '\0';
+        jobInfoReply->cpuTime = 0;
+        jobInfoReply->nIdx = 0;
+        jobInfoReply->numReasons = 0;
+        jobInfoReply->exitStatus = 0;
+        jobInfoReply->execUid = -1;
+        jobInfoReply->reserveTime = 0;
+        jobInfoReply->jobPid = 0;
+        jobInfoReply->port = 0;
+        jobInfoReply->jobPriority = -1;
+        jobInfoReply->predictedStartTime = 0;
+        jobInfoReply->jRusageUpdateTime = 0;
+        memset(&jobInfoReply->runRusage, 0, sizeof(struct jRusage));
+
+        jobBill->fromHost[0] = '\0';
+        jobBill->jobFile[0] = '\0';
+        jobBill->inFile[0] = '\0';
+        jobBill->outFile[0] = '\0';
+        jobBill->errFile[0] = '\0';
+        jobBill->inFileSpool[0] = '\0';
+        jobBill->commandSpool[0] = '\0';
+        jobBill->chkpntDir[0] = '\0';
+        jobBill->hostSpec[0] = '\0';
+        jobBill->cwd[0] = '\0';
+        jobBill->subHomeDir[0] = '\0';
+
+        FREEUP(jobBill->queue);
+        FREEUP(jobBill->command);
+        FREEUP(jobBill->jobName);
+        FREEUP(jobBill->preExecCmd);
+        FREEUP(jobBill->dependCond);
+        FREEUP(jobBill->resReq);
+        FREEUP(jobBill->mailUser);
+        FREEUP(jobBill->projectName);
+        FREEUP(jobBill->loginShell);
+        FREEUP(jobBill->schedHostType);
+        FREEUP(jobBill->userGroup);
+        jobBill->numAskedHosts = 0;
+        jobBill->askedHosts = NULL;
+        jobBill->nxf = 0;
+        jobBill->xf = NULL;
+    }
+
+    if (xdrs->x_op == XDR_ENCODE) {
+        jobId64To32(jobInfoReply->jobId, &jobArrId, &jobArrElemId);
+    }
+
+    if (!(xdr_int(xdrs, (int *) &jobInfoReply->jType)
+          && xdr_var_string(xdrs, &jobInfoReply->jName)))
+        return false;
+
+    for (i = 0; i < NUM_JGRP_COUNTERS; i++ ) {
+        if (!xdr_int(xdrs, (int *) &jobInfoReply->counter[i]))
+            return false;
+    }
+
+    sp = jobInfoReply->userName;
+    if (!(xdr_int(xdrs, &jobArrId) &&
+          xdr_int(xdrs, (int *)&(jobInfoReply->status)) &&
+          xdr_int(xdrs, &(jobInfoReply->reasons)) &&
+          xdr_int(xdrs, &(jobInfoReply->subreasons)) &&
+          xdr_time_t(xdrs, &(jobInfoReply->startTime)) &&
+          xdr_time_t(xdrs, &(jobInfoReply->endTime)) &&
+          xdr_int(xdrs, &(jobInfoReply->numToHosts)) &&
+          xdr_int(xdrs, &jobInfoReply->userId) &&
+          xdr_string(xdrs, &sp, MAXLSFNAMELEN))) {
+        return false;
+    }
+
+    if (xdrs->x_op == XDR_DECODE && jobInfoReply->numToHosts > 0) {
+        jobInfoReply->toHosts = calloc(jobInfoReply->numToHosts,
+                                       sizeof(char *));
+        if (jobInfoReply->toHosts == NULL) {
+            jobInfoReply->numToHosts = 0;
+            return false;
+        }
+    }
+
+    for (i = 0; i < jobInfoReply->numToHosts; i++) {
+        if (!xdr_var_string(xdrs, &jobInfoReply->toHosts[i])) {
+            if (xdrs->x_op == XDR_DECODE) {
+                for (j = 0; j < i; j++)
+                    free(jobInfoReply->toHosts[j]);
+                FREEUP(jobInfoReply->toHosts);
+                jobInfoReply->numToHosts = 0;
+            }
+            return false;
+        }
+    }
+
+    sp = jobBill->fromHost;
+    if (!(xdr_u_int(xdrs, (unsigned int *)&jobBill->options) &&
+          xdr_int(xdrs, &jobBill->options2) &&
+          xdr_int(xdrs, &jobBill->numProcessors) &&
+          xdr_int(xdrs, &jobBill->maxNumProcessors) &&
+          xdr_time_t(xdrs, &jobBill->submitTime) &&
+          xdr_string(xdrs, &sp, MAXHOSTNAMELEN) &&
+          xdr_var_string(xdrs, &jobBill->queue) &&
+          xdr_var_string(xdrs, &jobBill->jobName) &&
+          xdr_var_string(xdrs, &jobBill->projectName) &&
+          xdr_int(xdrs, &jobArrElemId))) {
+        return false;
+    }
+
+    if (xdrs->x_op == XDR_DECODE) {
+        jobId32To64(&jobInfoReply->jobId, jobArrId, jobArrElemId);
     }
 
     return true;
@@ -839,6 +984,7 @@ xdr_queueInfoReply(XDR *xdrs,
             FREEUP(qInfo[i].resumeActCmd);
             FREEUP(qInfo[i].terminateActCmd);
             FREEUP(qInfo[i].preemption);
+            FREEUP(qInfo[i].affinity);
         }
 
         qInfoReply->queues = qInfo;
@@ -1008,6 +1154,11 @@ xdr_queueInfoEnt(XDR *xdrs,
         xdr_var_string(xdrs, &qInfo->preemption);
     }
 
+    if (hdr->version >= 32) {
+        if (! xdr_var_string(xdrs, &qInfo->affinity))
+            return false;
+    }
+
     return true;
 }
 
@@ -1940,3 +2091,99 @@ xdr_lsbMsg(XDR *xdrs,
 
     return true;
 }
+
+/* xdr_metricValue()
+ *
+ * 64 bit values travel as two ints like the job ids.
+ */
+static bool_t
+xdr_metricValue(XDR *xdrs, LS_LONG_INT *v)
+{
+    unsigned int hi;
+    unsigned int lo;
+
+    if (xdrs->x_op == XDR_ENCODE) {
+        hi = (unsigned int)((unsigned long long)*v >> 32);
+        lo = (unsigned int)((unsigned long long)*v & 0xffffffff);
+    }
+
+    if (! xdr_u_int(xdrs, &hi)
+        || ! xdr_u_int(xdrs, &lo))
+        return false;
+
+    if (xdrs->x_op == XDR_DECODE)
+        *v = (LS_LONG_INT)(((unsigned long long)hi << 32) | lo);
+
+    return true;
+}
+
+/* xdr_mbdMetric()
+ */
+bool_t
+xdr_mbdMetric(XDR *xdrs,
+              struct mbdMetric *m,
+              struct LSFHeader *hdr)
+{
+    int i;
+
+    if (! xdr_wrapstring(xdrs, &m->name)
+        || ! xdr_wrapstring(xdrs, &m->label)
+        || ! xdr_int(xdrs, &m->type)
+        || ! xdr_metricValue(xdrs, &m->value)
+        || ! xdr_metricValue(xdrs, &m->count)
+        || ! xdr_int(xdrs, &m->numBuckets))
+        return false;
+
+    if (m->numBuckets < 0
+        || m->numBuckets > METRIC_BUCKETS)
+        return false;
+
+    if (xdrs->x_op == XDR_DECODE) {
+        m->buckets = NULL;
+        if (m->numBuckets > 0) {
+            m->buckets = calloc(m->numBuckets, sizeof(LS_LONG_INT));
+            if (m->buckets == NULL)
+                return false;
+        }
+    }
+
+    for (i = 0; i < m->numBuckets; i++) {
+        if (! xdr_metricValue(xdrs, &m->buckets[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/* xdr_metricsInfoReply()
+ */
+bool_t
+xdr_metricsInfoReply(XDR *xdrs,
+                     struct metricsInfoReply *r,
+                     struct LSFHeader *hdr)
+{
+    int i;
+
+    if (! xdr_time_t(xdrs, &r->startTime)
+        || ! xdr_int(xdrs, &r->numMetrics))
+        return false;
+
+    if (r->numMetrics < 0)
+        return false;
+
+    if (xdrs->x_op == XDR_DECODE) {
+        r->metrics = NULL;
+        if (r->numMetrics > 0) {
+            r->metrics = calloc(r->numMetrics, sizeof(struct mbdMetric));
+            if (r->metrics == NULL)
+                return false;
+        }
+    }
+
+    for (i = 0; i < r->numMetrics; i++) {
+        if (! xdr_mbdMetric(xdrs, &r->metrics[i], hdr))
+            return false;
+    }
+
+    return true;
+}
@@ -90,6 +90,10 @@ extern bool_t xdr_jobInfoReply(XDR *,
 			       struct jobInfoReply *,
 			       struct LSFHeader *);
 
+extern bool_t xdr_jobInfoBrief(XDR *,
+			       struct jobInfoReply *,
+			       struct LSFHeader *);
+
 extern bool_t xdr_jobInfoEnt(XDR *,
 			     struct jobInfoEnt *,
 			     struct LSFHeader *);
@@ -159,3 +163,9 @@ extern bool_t xdr_shareAcct(XDR *,
 extern bool_t xdr_jobID(XDR *,
                         LS_LONG_INT *,
                         struct LSFHeader *);
+extern bool_t xdr_mbdMetric(XDR *,
+                            struct mbdMetric *,
+                            struct LSFHeader *);
+extern bool_t xdr_metricsInfoReply(XDR *,
+                                   struct metricsInfoReply *,
+                                   struct LSFHeader *);
@@ -587,6 +587,9 @@ struct submig {
 #define JGRP_ARRAY_INFO 0x1000
 #define JOBID_ONLY_ALL  0x02000
 #define ZOMBIE_JOB      0x04000
+/* Reply with the fields bjobs shows by default only.
+ */
+#define JOBINFO_BRIEF   0x08000
 
 #define    JGRP_NODE_JOB        1
 #define    JGRP_NODE_GROUP      2
@@ -678,6 +681,7 @@ struct jobInfoEnt {
     u_short port;
     int     jobPriority;
     char *userGroup;
+    char *cpuBind;
 };
 
 struct userInfoEnt {
@@ -758,6 +762,7 @@ struct queueInfoEnt {
     uint32_t numFairSlots;
     struct share_acct **saccts;
     char *preemption;
+    char *affinity;
 };
 
 #define ACT_NO              0
@@ -1036,6 +1041,7 @@ struct jobExecuteLog {
     char   *execUsername;
     int    jobPid;
     int    idx;
+    char   *cpuBind;
 };
 
 
@@ -1315,6 +1321,7 @@ struct eventLogHandle {
 
 #define LSF_JOBIDINDEX_FILENAME "lsb.events.index"
 #define LSF_JOBIDINDEX_FILETAG "#LSF_JOBID_INDEX_FILE"
+#define LSF_JOBIDINDEX_VERSION "2.0"
 
 struct jobIdIndexS {
     char fileName[MAXFILENAMELEN];
@@ -1329,7 +1336,25 @@ struct jobIdIndexS {
     LS_LONG_INT minJobId;
     LS_LONG_INT maxJobId;
     int totalJobIds;
-    int *jobIds;
+    long seekPos;
+    long endPos;
+};
+
+/* One row of the job ID index, the offsets of the
+ * first and last record of each job in a rotated
+ * lsb.events.N file.
+ */
+struct jobIdIndexEnt {
+    int jobId;
+    long first;
+    long last;
+};
+
+struct jobIdIndexRow {
+    time_t timeStamp;
+    int numEnts;
+    int maxEnts;
+    struct jobIdIndexEnt *ents;
 };
 
 struct sortIntList {
@@ -1353,6 +1378,33 @@ struct lsbMsgReply {
     struct lsbMsg *msg; /* array of messages */
 };
 
+/* lsb_metricsinfo()
+ */
+#define METRIC_COUNTER    0
+#define METRIC_HISTOGRAM  1
+
+/* Histogram bucket i counts the observations
+ * less or equal than 2^i, the last bucket counts
+ * all the observations above the previous one.
+ */
+#define METRIC_BUCKETS    28
+
+struct mbdMetric {
+    char *name;          /* metric name */
+    char *label;         /* key="value" or empty */
+    int type;            /* METRIC_COUNTER or METRIC_HISTOGRAM */
+    LS_LONG_INT value;   /* counter value or sum of the observations */
+    LS_LONG_INT count;   /* number of observations */
+    int numBuckets;
+    LS_LONG_INT *buckets;
+};
+
+struct metricsInfoReply {
+    time_t startTime;    /* mbatchd start time */
+    int numMetrics;
+    struct mbdMetric *metrics;
+};
+
 #define CONF_NO_CHECK           0x00
 #define CONF_CHECK              0x01
 #define CONF_EXPAND             0X02
@@ -1464,6 +1516,7 @@ extern int  lsb_reconfig(int);
 extern int  lsb_signaljob(LS_LONG_INT, int);
 extern int  lsb_postjobmsg(LS_LONG_INT, char *);
 extern struct lsbMsg *lsb_readjobmsg(LS_LONG_INT, int *);
+extern struct metricsInfoReply *lsb_metricsinfo(void);
 extern int  lsb_chkpntjob(LS_LONG_INT, time_t, int);
 extern int  lsb_deletejob(LS_LONG_INT, int, int);
 extern int  lsb_forcekilljob(LS_LONG_INT);
@@ -1491,10 +1544,22 @@ extern char *lsb_pendreason(int, int *, struct jobInfoHead *,
                             struct loadIndexLog *);
 extern int lsb_puteventrec(FILE *, struct eventRec *);
 extern struct eventRec *lsb_geteventrec(FILE *, int *);
-extern int getJobIdIndexFromEventFile(char *, struct sortIntList *, time_t *);
+extern struct eventFileMap *lsb_openeventmap(FILE *);
+extern struct eventRec *lsb_geteventmaprec(struct eventFileMap *, int *);
+extern struct eventRec *lsb_geteventmaprec_r(struct eventFileMap *, int *,
+                                             int *);
+extern int lsb_eventmapped(struct eventFileMap *);
+extern long lsb_eventmappos(struct eventFileMap *);
+extern int lsb_seekeventmap(struct eventFileMap *, long);
+extern void lsb_closeeventmap(struct eventFileMap *);
+extern int getJobIdIndexFromEventFile(char *, struct jobIdIndexRow *);
 extern int getJobIdFromEvent(char *, int);
-extern int writeJobIdIndexToIndexFile(FILE *, struct sortIntList *, time_t);
+extern int getJobIdFromEventRec(struct eventRec *);
+extern int addJobIdIndexRow(struct jobIdIndexRow *, int, long);
+extern int writeJobIdIndexRow(FILE *, struct jobIdIndexRow *);
+extern void freeJobIdIndexRow(struct jobIdIndexRow *);
 extern int updateJobIdIndexFile(char *, char *, int);
+extern int appendJobIdIndexFile(char *, struct jobIdIndexRow *, int);
 extern int getNextFileNumFromIndexS(struct jobIdIndexS *, int, LS_LONG_INT *);
 
 
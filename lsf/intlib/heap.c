@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "heap.h"
+
+static void sift_up(struct heap_ *, int);
+static void sift_down(struct heap_ *, int);
+
+/* heap_make()
+ */
+struct heap_ *
+heap_make(int size,
+          int (*cmp)(const void *, const void *),
+          void (*pos)(void *, int))
+{
+    struct heap_ *h;
+
+    if (size <= 0)
+        size = 16;
+
+    h = calloc(1, sizeof(struct heap_));
+    if (h == NULL)
+        return NULL;
+
+    h->v = calloc(size, sizeof(void *));
+    if (h->v == NULL) {
+        free(h);
+        return NULL;
+    }
+
+    h->size = size;
+    h->cmp = cmp;
+    h->pos = pos;
+
+    return h;
+}
+
+/* heap_free()
+ *
+ * Free the heap, the elements are owned
+ * by the caller.
+ */
+void
+heap_free(struct heap_ *h)
+{
+    if (h == NULL)
+        return;
+
+    free(h->v);
+    free(h);
+}
+
+/* heap_clear()
+ *
+ * Forget all elements but keep the
+ * array for the next round.
+ */
+void
+heap_clear(struct heap_ *h)
+{
+    h->num = 0;
+}
+
+/* heap_insert()
+ */
+int
+heap_insert(struct heap_ *h, void *e)
+{
+    void **v;
+
+    if (h->num == h->size) {
+        v = realloc(h->v, 2 * h->size * sizeof(void *));
+        if (v == NULL)
+            return -1;
+        h->v = v;
+        h->size = 2 * h->size;
+    }
+
+    h->v[h->num] = e;
+    if (h->pos)
+        (*h->pos)(e, h->num);
+    h->num++;
+    sift_up(h, h->num - 1);
+
+    return 0;
+}
+
+/* heap_pop()
+ *
+ * Remove and return the top of the heap.
+ */
+void *
+heap_pop(struct heap_ *h)
+{
+    if (h->num == 0)
+        return NULL;
+
+    return heap_rm(h, 0);
+}
+
+/* heap_rm()
+ *
+ * Remove the element at index i, the last
+ * element takes its place and is moved
+ * up or down as needed.
+ */
+void *
+heap_rm(struct heap_ *h, int i)
+{
+    void *e;
+
+    if (i < 0 || i >= h->num)
+        return NULL;
+
+    e = h->v[i];
+    h->num--;
+    if (h->pos)
+        (*h->pos)(e, -1);
+
+    if (i == h->num)
+        return e;
+
+    h->v[i] = h->v[h->num];
+    if (h->pos)
+        (*h->pos)(h->v[i], i);
+
+    heap_update(h, i);
+
+    return e;
+}
+
+/* heap_update()
+ *
+ * The key of the element at index i
+ * has changed, restore the heap order.
+ */
+void
+heap_update(struct heap_ *h, int i)
+{
+    if (i < 0 || i >= h->num)
+        return;
+
+    if (i > 0
+        && (*h->cmp)(h->v[i], h->v[(i - 1)/2]) < 0) {
+        sift_up(h, i);
+        return;
+    }
+
+    sift_down(h, i);
+}
+
+/* heap_build()
+ *
+ * Restore the heap order of all elements,
+ * use after the keys of many elements changed
+ * at once. Floyd's method, it costs O(n).
+ */
+void
+heap_build(struct heap_ *h)
+{
+    int i;
+
+    for (i = h->num/2 - 1; i >= 0; i--)
+        sift_down(h, i);
+}
+
+static void
+sift_up(struct heap_ *h, int i)
+{
+    void *e;
+    int p;
+
+    e = h->v[i];
+    while (i > 0) {
+        p = (i - 1)/2;
+        if ((*h->cmp)(e, h->v[p]) >= 0)
+            break;
+        h->v[i] = h->v[p];
+        if (h->pos)
+            (*h->pos)(h->v[i], i);
+        i = p;
+    }
+
+    h->v[i] = e;
+    if (h->pos)
+        (*h->pos)(e, i);
+}
+
+static void
+sift_down(struct heap_ *h, int i)
+{
+    void *e;
+    int c;
+
+    e = h->v[i];
+    while ((c = 2 * i + 1) < h->num) {
+
+        if (c + 1 < h->num
+            && (*h->cmp)(h->v[c + 1], h->v[c]) < 0)
+            ++c;
+
+        if ((*h->cmp)(h->v[c], e) >= 0)
+            break;
+
+        h->v[i] = h->v[c];
+        if (h->pos)
+            (*h->pos)(h->v[i], i);
+        i = c;
+    }
+
+    h->v[i] = e;
+    if (h->pos)
+        (*h->pos)(e, i);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+/*
+ * Elementary binary heap in C.
+ * D. Knuth Art of Computer Programming Volume 3. 5.2.3
+ */
+#ifndef __HEAP__
+#define __HEAP__
+
+/* The heap is an array of opaque pointers ordered
+ * by the user supplied cmp() function, the element
+ * for which cmp() returns the smallest value is at
+ * the top. The optional pos() function is called
+ * every time an element moves so that the caller
+ * can keep track of its index and use heap_update()
+ * or heap_rm() on it.
+ */
+struct heap_ {
+    int     num;
+    int     size;
+    void    **v;
+    int     (*cmp)(const void *, const void *);
+    void    (*pos)(void *, int);
+};
+
+#define HEAP_NUM_ENTRIES(H) ((H)->num)
+#define HEAP_TOP(H) ((H)->num > 0 ? (H)->v[0] : NULL)
+
+extern struct heap_ *heap_make(int,
+                               int (*)(const void *, const void *),
+                               void (*)(void *, int));
+extern void heap_free(struct heap_ *);
+extern void heap_clear(struct heap_ *);
+extern int heap_insert(struct heap_ *, void *);
+extern void *heap_pop(struct heap_ *);
+extern void *heap_rm(struct heap_ *, int);
+extern void heap_update(struct heap_ *, int);
+extern void heap_build(struct heap_ *);
+
+#endif /* __HEAP__ */
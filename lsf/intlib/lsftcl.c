@@ -49,12 +49,98 @@ static int   *ar;
 static int   *ar2;
 static int   *ar4;
 
+/* A value computed by the native expression
+ * evaluator, it follows the tcl int and double
+ * arithmetic.
+ */
+struct exprVal {
+    int     isDouble;
+    long    i;
+    double  d;
+};
+
+/* Operations of the compiled select expressions.
+ * The program is postfix code for a stack machine,
+ * the logical operators jump to honor the short
+ * circuit evaluation done by tcl.
+ */
+enum exprOp {
+    EXPR_INT,
+    EXPR_DOUBLE,
+    EXPR_NUMERIC,
+    EXPR_BOOLEAN,
+    EXPR_CMD,
+    EXPR_NEG,
+    EXPR_PLUS,
+    EXPR_NOT,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_LT,
+    EXPR_GT,
+    EXPR_LE,
+    EXPR_GE,
+    EXPR_EQ,
+    EXPR_NE,
+    EXPR_AND,
+    EXPR_OR,
+    EXPR_BOOL
+};
+
+struct exprCode {
+    int     op;
+    int     arg;
+    long    i;
+    double  d;
+};
+
+/* A tcl command substitution like [type "eq" "LINUX"]
+ * or [defined "res"], tcl substitutes all of them
+ * before evaluating the expression.
+ */
+struct exprCmd {
+    int     indx;
+    char    *op;
+    char    *val;
+};
+
+struct exprProg {
+    int     useTcl;
+    int     numCode;
+    int     sizeCode;
+    struct exprCode *code;
+    int     numCmds;
+    int     sizeCmds;
+    struct exprCmd *cmds;
+    int     depth;
+};
+
+/* Table of compiled select strings, the same
+ * string is evaluated over and over for every
+ * host.
+ */
+static hTab   exprTab;
+static hTab   funcTab;
+static hTab   cmdTab;
+#define MAX_EXPR_CACHE 4096
+
 int numericValue (ClientData, Tcl_Interp *, Tcl_Value *, Tcl_Value *);
 int booleanValue (ClientData, Tcl_Interp *, Tcl_Value *, Tcl_Value *);
 int stringValue (ClientData, Tcl_Interp *, int, const char **);
 static int copyTclLsInfo (struct tclLsInfo *);
 static char *getResValue (int);
 static int definedCmd(ClientData, Tcl_Interp *, int, const char **);
+static int numValue(int, struct exprVal *);
+static int boolValue(int, long *);
+static int strValue(int, const char *, const char *, int *);
+static int definedValue(const char *, int *);
+static void addSymbol(hTab *, const char *, int, int);
+static struct exprProg *getExprProg(char *);
+static struct exprProg *compileExpr(char *);
+static void freeExprProg(void *);
+static void freeExprTab(void);
+static int evalExprProg(struct exprProg *, struct exprVal *);
 
 /* numericValue()
  * Evaluate host or shared resource numerica value.
@@ -65,27 +151,52 @@ numericValue(ClientData clientData,
              Tcl_Value *args,
              Tcl_Value *resultPtr)
 {
+    struct exprVal v;
     int     *indx;
-    float   cpuf;
-    char    *value;
 
     indx = clientData;
 
+    if (numValue(*indx, &v) != TCL_OK)
+        return TCL_ERROR;
+
+    if (v.isDouble) {
+        resultPtr->type = TCL_DOUBLE;
+        resultPtr->doubleValue = v.d;
+    } else {
+        resultPtr->type = TCL_INT;
+        resultPtr->intValue = v.i;
+    }
+
+    return TCL_OK;
+}
+
+/* numValue()
+ * Compute the value of a numeric symbol for the
+ * current host, used by the tcl math functions
+ * and by the compiled expressions.
+ */
+static int
+numValue(int indx, struct exprVal *v)
+{
+    float   cpuf;
+    char    *value;
+
     if (logclass & LC_TRACE)
-        ls_syslog(LOG_DEBUG3, "numericValue: *indx = %d", *indx);
+        ls_syslog(LOG_DEBUG3, "numericValue: *indx = %d", indx);
 
     cpuf = hPtr->cpuFactor;
-    resultPtr->type        = TCL_INT;
+    v->isDouble = FALSE;
+    v->i = 0;
     runTimeDataQueried     = TRUE;
 
-    if (*indx < numIndx) {
+    if (indx < numIndx) {
 
-        resultPtr->type = TCL_DOUBLE;
-        if (*indx <= R15M) {
-            resultPtr->doubleValue = hPtr->loadIndex[*indx] * cpuf - 1;
+        v->isDouble = TRUE;
+        if (indx <= R15M) {
+            v->d = hPtr->loadIndex[indx] * cpuf - 1;
         } else {
-            resultPtr->doubleValue = hPtr->loadIndex[*indx];
-            if (hPtr->loadIndex[*indx] >= (INFINIT_LOAD - 10.0)
+            v->d = hPtr->loadIndex[indx];
+            if (hPtr->loadIndex[indx] >= (INFINIT_LOAD - 10.0)
                 && hPtr->flag !=  TCL_CHECK_SYNTAX) {
 
                 return (TCL_ERROR);
@@ -96,54 +207,54 @@ numericValue(ClientData clientData,
 
     }
 
-    if (*indx == CPUFACTOR) {
+    if (indx == CPUFACTOR) {
         runTimeDataQueried = FALSE;
-        resultPtr->type = TCL_DOUBLE;
-        resultPtr->doubleValue = cpuf;
-    } else if (*indx == NDISK) {
+        v->isDouble = TRUE;
+        v->d = cpuf;
+    } else if (indx == NDISK) {
 
         runTimeDataQueried = FALSE;
-        resultPtr->intValue    = hPtr->nDisks;
+        v->i    = hPtr->nDisks;
 
-    } else if (*indx == REXPRI) {
+    } else if (indx == REXPRI) {
 
         runTimeDataQueried = FALSE;
-        resultPtr->intValue    = hPtr->rexPriority;
+        v->i    = hPtr->rexPriority;
 
-    } else if (*indx == MAXCPUS_) {
-        resultPtr->intValue = hPtr->maxCpus;
+    } else if (indx == MAXCPUS_) {
+        v->i = hPtr->maxCpus;
 
-    } else if (*indx == MAXMEM) {
+    } else if (indx == MAXMEM) {
 
-        resultPtr->intValue = hPtr->maxMem;
+        v->i = hPtr->maxMem;
 
-    } else if (*indx == MAXSWAP) {
+    } else if (indx == MAXSWAP) {
 
-     resultPtr->intValue = hPtr->maxSwap;
+        v->i = hPtr->maxSwap;
 
-    } else if (*indx == MAXTMP) {
+    } else if (indx == MAXTMP) {
 
-        resultPtr->intValue = hPtr->maxTmp;
+        v->i = hPtr->maxTmp;
 
-    } else if (*indx == SERVER) {
+    } else if (indx == SERVER) {
 
         runTimeDataQueried = FALSE;
-        resultPtr->intValue = (hPtr->hostInactivityCount == -1) ? 0 : 1;
+        v->i = (hPtr->hostInactivityCount == -1) ? 0 : 1;
 
     } else {
 
-        value = getResValue(*indx - myTclLsInfo->numIndx);
+        value = getResValue(indx - myTclLsInfo->numIndx);
         if (value == NULL || !strcmp(value,"-")) {
-            resultPtr->intValue = 0;
+            v->i = 0;
             return(TCL_OK);
         }
 
-        resultPtr->doubleValue = atof (value) ;
-        resultPtr->type = TCL_DOUBLE;
+        v->d = atof (value) ;
+        v->isDouble = TRUE;
 
         if (logclass & LC_TRACE)
             ls_syslog(LOG_DEBUG3, "\
-numericValue():value = %s, clientData =%d", value, *indx);
+numericValue():value = %s, clientData =%d", value, indx);
     }
 
     return TCL_OK;
@@ -159,40 +270,55 @@ booleanValue(ClientData clientData,
              Tcl_Value *resultPtr)
 {
     int    *idx;
-    int    isSet;
-    char   *value;
+    long   val;
 
     idx = (int *)clientData;
 
+    if (boolValue(*idx, &val) != TCL_OK)
+        return TCL_ERROR;
+
+    resultPtr->type = TCL_INT;
+    resultPtr->intValue = val;
+
+    return TCL_OK;
+}
+
+/* boolValue()
+ */
+static int
+boolValue(int idx, long *val)
+{
+    int    isSet;
+    char   *value;
+
     if (logclass & LC_TRACE)
-        ls_syslog(LOG_DEBUG3, "booleanValue: *idx = %d", *idx);
-    if (*idx < 0)
+        ls_syslog(LOG_DEBUG3, "booleanValue: *idx = %d", idx);
+    if (idx < 0)
         return(TCL_ERROR);
 
     overRideFromType = TRUE;
 
-    resultPtr->type = TCL_INT;
     if (hPtr->resBitMaps == NULL) {
-        resultPtr->intValue = 0;
+        *val = 0;
         return (TCL_OK);
     }
 
     /* Is a host based resource.
      */
-    TEST_BIT(*idx, hPtr->resBitMaps, isSet);
+    TEST_BIT(idx, hPtr->resBitMaps, isSet);
     if (isSet == 1) {
-        resultPtr->intValue = isSet;
+        *val = isSet;
         return TCL_OK;
     }
 
-    value = getResValue (*idx);
+    value = getResValue (idx);
     if (value == NULL || value[0] == '-') {
         if (hPtr->flag == TCL_CHECK_SYNTAX)
-            resultPtr->intValue = 1;
+            *val = 1;
         else
-            resultPtr->intValue = 0;
+            *val = 0;
     } else {
-        resultPtr->intValue = atoi(value);
+        *val = atoi(value);
     }
 
     return TCL_OK;
@@ -208,11 +334,7 @@ stringValue(ClientData clientData,
             const char *argv[])
 {
     int *indx;
-    char *sp;
-    char *sp2;
-    char *value;
-    char status[MAXLSFNAMELEN];
-    struct hostent *hp;
+    int result;
 
     if (argc != 3) {
         Tcl_SetResult(interp, "wrong # args", NULL);
@@ -227,37 +349,62 @@ stringValue: arg0 %s arg1 %s arg2 %s indx %d hostname %s",
                   argv[0], argv[1], argv[2],
                   *indx, hPtr->hostName);
 
-    switch (*indx) {
+    if (strValue(*indx, argv[1], argv[2], &result) != TCL_OK)
+        return TCL_ERROR;
+
+    if (result)
+        Tcl_SetResult(interp, "1", NULL);
+    else
+        Tcl_SetResult(interp, "0", NULL);
+
+    return TCL_OK;
+}
+
+/* strValue()
+ * Compare a host string attribute or a string resource
+ * using the operator op, set result to 1 or 0.
+ */
+static int
+strValue(int indx, const char *op, const char *arg, int *result)
+{
+    char *sp;
+    char *sp2;
+    char *value;
+    char status[MAXLSFNAMELEN];
+    struct hostent *hp;
+    int cc;
+
+    switch (indx) {
 
         case HOSTNAME:
             overRideFromType = TRUE;
             sp = hPtr->hostName;
-            hp = Gethostbyname_((char *)argv[2]);
+            hp = Gethostbyname_((char *)arg);
             if (hp)
                 sp2 = hp->h_name;
             else
-                sp2 = (char *) argv[2];
+                sp2 = (char *)arg;
             break;
 
         case HOSTTYPE:
             sp = hPtr->hostType;
-            if (strcmp(argv[2], LOCAL_STR) == 0) {
+            if (strcmp(arg, LOCAL_STR) == 0) {
                 sp2 = hPtr->fromHostType;
-                if (strcmp (argv[1], "eq") != 0)
+                if (strcmp (op, "eq") != 0)
                     overRideFromType = TRUE;
             } else {
                 overRideFromType = TRUE;
-                sp2 = (char *) argv[2];
+                sp2 = (char *)arg;
             }
             break;
 
         case HOSTMODEL:
             overRideFromType = TRUE;
             sp = hPtr->hostModel;
-            if (strcmp(argv[2], LOCAL_STR) == 0)
+            if (strcmp(arg, LOCAL_STR) == 0)
                 sp2 = hPtr->fromHostModel;
             else
-                sp2 = (char *) argv[2];
+                sp2 = (char *)arg;
             break;
 
         case HOSTSTATUS:
@@ -282,14 +429,14 @@ stringValue: arg0 %s arg1 %s arg2 %s indx %d hostname %s",
                 strcpy(status,"ok");
             }
             sp = status;
-            sp2 = (char *) argv[2];
+            sp2 = (char *)arg;
             break;
         default:
 
-            value = getResValue (*indx - LAST_STRING);
+            value = getResValue (indx - LAST_STRING);
             if (value == NULL || value[0] == '-') {
                 if (hPtr->flag == TCL_CHECK_SYNTAX) {
-                    Tcl_SetResult(interp, "1", NULL);
+                    *result = 1;
                     return(TCL_OK);
                 } else {
                     return (TCL_ERROR);
@@ -297,7 +444,7 @@ stringValue: arg0 %s arg1 %s arg2 %s indx %d hostname %s",
             }
             overRideFromType = TRUE;
             sp = value;
-            sp2 = (char *)argv[2];
+            sp2 = (char *)arg;
             break;
     }
 
@@ -307,40 +454,23 @@ stringValue: sp = %s, sp2 = %s", sp, sp2);
     }
 
     if (strcmp(sp2, WILDCARD_STR) == 0 ) {
-        Tcl_SetResult(interp, "1", NULL);
+        *result = 1;
         return TCL_OK;
     }
 
-    if (strcmp(argv[1],"eq") == 0) {
-        if (strcmp(sp2, sp) == 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
-    } else if (strcmp(argv[1],"ne") == 0) {
-        if (strcmp(sp2, sp) != 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
-    } else if (strcmp(argv[1],"ge") == 0) {
-        if (strcmp(sp2, sp) <= 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
-    } else if (strcmp(argv[1],"le") == 0) {
-        if (strcmp(sp2,sp) >= 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
-    } else if (strcmp(argv[1],"gt") == 0) {
-        if (strcmp(sp2, sp) < 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
-    } else if (strcmp(argv[1],"lt") == 0) {
-        if (strcmp(sp2, sp) > 0)
-            Tcl_SetResult(interp, "1", NULL);
-        else
-            Tcl_SetResult(interp, "0", NULL);
+    cc = strcmp(sp2, sp);
+    if (strcmp(op, "eq") == 0) {
+        *result = (cc == 0);
+    } else if (strcmp(op, "ne") == 0) {
+        *result = (cc != 0);
+    } else if (strcmp(op, "ge") == 0) {
+        *result = (cc <= 0);
+    } else if (strcmp(op, "le") == 0) {
+        *result = (cc >= 0);
+    } else if (strcmp(op, "gt") == 0) {
+        *result = (cc < 0);
+    } else if (strcmp(op, "lt") == 0) {
+        *result = (cc > 0);
     } else {
         return TCL_ERROR;
     }
@@ -354,11 +484,8 @@ definedCmd(ClientData clientData,
            int argc,
            const  char *argv[])
 {
-    int    resNo;
-    int    hasRes = FALSE;
-    int    isSet;
     int    *indx;
-    char   *value;
+    int    result;
 
     if (argc != 2) {
         Tcl_SetResult(interp, "wrong # args", NULL);
@@ -372,9 +499,31 @@ definedCmd(ClientData clientData,
 definedCmd: argv0 %s argv1 %s indx %d",
                   argv[0], argv[1], *indx);
 
+    if (definedValue(argv[1], &result) != TCL_OK)
+        return TCL_ERROR;
+
+    if (result)
+        Tcl_SetResult(interp, "1", NULL);
+    else
+        Tcl_SetResult(interp, "0", NULL);
+
+    return TCL_OK;
+
+}
+
+/* definedValue()
+ */
+static int
+definedValue(const char *name, int *result)
+{
+    int    resNo;
+    int    hasRes = FALSE;
+    int    isSet;
+    char   *value;
+
     overRideFromType = TRUE;
     for (resNo = 0; resNo < myTclLsInfo->nRes; resNo++) {
-        if (strcmp (myTclLsInfo->resName[resNo], argv[1]) == 0) {
+        if (strcmp (myTclLsInfo->resName[resNo], name) == 0) {
             hasRes = TRUE;
             break;
         }
@@ -383,25 +532,24 @@ definedCmd: argv0 %s argv1 %s indx %d",
         return(TCL_ERROR);
 
     if (hPtr->resBitMaps == NULL) {
-        Tcl_SetResult(interp, "0", NULL);
+        *result = 0;
         return TCL_OK;
     }
     TEST_BIT(resNo, hPtr->resBitMaps, isSet);
     if (isSet == 1)
-        Tcl_SetResult(interp, "1", NULL);
+        *result = 1;
     else {
         value = getResValue (resNo);
         if (value == NULL) {
             if (hPtr->flag == TCL_CHECK_SYNTAX)
-                Tcl_SetResult(interp, "1", NULL);
+                *result = 1;
             else
-                Tcl_SetResult(interp, "0", NULL);
+                *result = 0;
         } else
-            Tcl_SetResult(interp, "1", NULL);
+            *result = 1;
     }
 
     return TCL_OK;
-
 }
 
 /* initTcl()
@@ -442,6 +590,14 @@ initTcl(struct tclLsInfo *tclLsInfo)
     if (copyTclLsInfo (tclLsInfo) < 0)
         return -1;
 
+    /* The symbols may have changed so the compiled
+     * expressions are gone.
+     */
+    freeExprTab();
+    h_initTab_(&exprTab, 101);
+    h_initTab_(&funcTab, 101);
+    h_initTab_(&cmdTab, 23);
+
     numIndx = tclLsInfo->numIndx;
     nRes = tclLsInfo->nRes;
 
@@ -477,6 +633,7 @@ initTcl:indexNames=%s, i =%d", tclLsInfo->indexNames[i], i);
                            NULL,
                            numericValue,
                            (ClientData)&ar[i]);
+        addSymbol(&funcTab, tclLsInfo->indexNames[i], EXPR_NUMERIC, ar[i]);
     }
 
     for (resNo = 0; resNo < tclLsInfo->nRes; resNo++) {
@@ -496,6 +653,7 @@ initTcl:Name=%s, i =%d", tclLsInfo->resName[resNo], i);
                            NULL,
                            numericValue,
                            (ClientData)&ar[i]);
+        addSymbol(&funcTab, tclLsInfo->resName[resNo], EXPR_NUMERIC, ar[i]);
         i++;
     }
 
@@ -511,6 +669,7 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
                            NULL,
                            numericValue,
                            (ClientData)&funcPtr->clientData);
+        addSymbol(&funcTab, funcPtr->name, EXPR_NUMERIC, funcPtr->clientData);
     }
 
     i = 0;
@@ -532,6 +691,7 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
                            NULL,
                            booleanValue,
                            (ClientData)&ar2[i]);
+        addSymbol(&funcTab, tclLsInfo->resName[resNo], EXPR_BOOLEAN, ar2[i]);
         ++i;
     }
 
@@ -541,24 +701,28 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
                       stringValue,
                       (ClientData)&ar3[0],
                       NULL);
+    addSymbol(&cmdTab, "type", EXPR_CMD, ar3[0]);
     ar3[1] = HOSTMODEL;
     Tcl_CreateCommand(globinterp,
                       "model",
                       stringValue,
                       (ClientData)&ar3[1],
                       NULL);
+    addSymbol(&cmdTab, "model", EXPR_CMD, ar3[1]);
     ar3[2] = HOSTSTATUS;
     Tcl_CreateCommand(globinterp,
                       "status",
                       stringValue,
                       (ClientData)&ar3[2],
                       NULL);
+    addSymbol(&cmdTab, "status", EXPR_CMD, ar3[2]);
     ar3[3] = HOSTNAME;
     Tcl_CreateCommand(globinterp,
                       "hname",
                       stringValue,
                       (ClientData)&ar3[3],
                       NULL);
+    addSymbol(&cmdTab, "hname", EXPR_CMD, ar3[3]);
 
     ar3[4] = DEFINEDFUNCTION;
     Tcl_CreateCommand(globinterp,
@@ -566,6 +730,7 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
                       definedCmd,
                       (ClientData)&ar3[4],
                       NULL);
+    addSymbol(&cmdTab, "defined", EXPR_CMD, ar3[4]);
 
     i = 0;
     ar4 = calloc(tclLsInfo->nRes, sizeof(int));
@@ -582,6 +747,7 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
                           stringValue,
                           (ClientData)&ar4[i],
                           NULL);
+        addSymbol(&cmdTab, tclLsInfo->resName[resNo], EXPR_CMD, ar4[i]);
         ++i;
     }
 
@@ -589,15 +755,23 @@ initTcl:indexNames=%s, i =%d", funcPtr->name, funcPtr->clientData);
 }
 
 /* evalResReq()
+ *
+ * Evaluate the select expression against a host.
+ * The expression is compiled once into a program
+ * for the native evaluator, only expressions the
+ * compiler does not understand go to tcl.
  */
 int
 evalResReq(char *resReq,
            struct tclHostData *hPtr2,
            char useFromType)
 {
+    struct exprProg *prog;
+    struct exprVal v;
     int code;
     int i;
     int resBits;
+    int isZero;
 
     hPtr = hPtr2;
 
@@ -610,9 +784,26 @@ evalResReq(char *resReq,
         ls_syslog(LOG_DEBUG3, "\
 evalResReq: resReq=%s, host = %s", resReq, hPtr->hostName);
 
-    code = Tcl_Eval(globinterp, resReq);
-    if (code != TCL_OK) {
-        return -1;
+    prog = getExprProg(resReq);
+    code = -2;
+    if (prog && !prog->useTcl) {
+        code = evalExprProg(prog, &v);
+        if (code == -1)
+            return -1;
+        /* tcl prints doubles with a decimal point
+         * so only the integer zero is "0".
+         */
+        isZero = (!v.isDouble && v.i == 0);
+    }
+
+    if (code == -2) {
+        overRideFromType = FALSE;
+        runTimeDataQueried = FALSE;
+        code = Tcl_Eval(globinterp, resReq);
+        if (code != TCL_OK) {
+            return -1;
+        }
+        isZero = (strcmp(Tcl_GetStringResult(globinterp), "0") == 0);
     }
 
     hPtr->overRideFromType = overRideFromType;
@@ -639,12 +830,959 @@ evalResReq: resReq=%s, host = %s", resReq, hPtr->hostName);
     if (runTimeDataQueried && LS_ISUNAVAIL(hPtr->status))
         return 0;
 
-    if (strcmp(Tcl_GetStringResult(globinterp), "0") == 0)
+    if (isZero)
         return 0;
 
     return 1;
 }
 
+/* Symbols known to the compiler, they mirror
+ * the math functions and commands registered
+ * in the interpreter.
+ */
+struct exprSym {
+    int   type;
+    int   indx;
+};
+
+/* addSymbol()
+ *
+ * Like tcl the last definition of a name wins.
+ */
+static void
+addSymbol(hTab *tab, const char *name, int type, int indx)
+{
+    struct exprSym *sym;
+    hEnt *ent;
+    int new;
+
+    ent = h_addEnt_(tab, name, &new);
+    if (new)
+        ent->hData = calloc(1, sizeof(struct exprSym));
+    sym = ent->hData;
+    if (sym == NULL)
+        return;
+
+    sym->type = type;
+    sym->indx = indx;
+}
+
+/* getExprProg()
+ */
+static struct exprProg *
+getExprProg(char *resReq)
+{
+    struct exprProg *prog;
+    hEnt *ent;
+    int new;
+
+    if (exprTab.slotPtr == NULL)
+        return NULL;
+
+    ent = h_getEnt_(&exprTab, resReq);
+    if (ent)
+        return ent->hData;
+
+    /* The cache is bounded, when full start
+     * over, the hot expressions come back
+     * quickly.
+     */
+    if (exprTab.numEnts >= MAX_EXPR_CACHE) {
+        h_freeTab_(&exprTab, freeExprProg);
+        h_initTab_(&exprTab, 101);
+    }
+
+    prog = compileExpr(resReq);
+    if (prog == NULL)
+        return NULL;
+
+    ent = h_addEnt_(&exprTab, resReq, &new);
+    ent->hData = prog;
+
+    if (logclass & LC_TRACE)
+        ls_syslog(LOG_DEBUG3, "\
+%s: %s compiled code %d commands %d tcl %d", __func__, resReq,
+                  prog->numCode, prog->numCmds, prog->useTcl);
+
+    return prog;
+}
+
+/* freeExprProg()
+ */
+static void
+freeExprProg(void *e)
+{
+    struct exprProg *prog = e;
+    int i;
+
+    if (prog == NULL)
+        return;
+
+    for (i = 0; i < prog->numCmds; i++) {
+        FREEUP(prog->cmds[i].op);
+        FREEUP(prog->cmds[i].val);
+    }
+    FREEUP(prog->cmds);
+    FREEUP(prog->code);
+    free(prog);
+}
+
+/* freeExprTab()
+ */
+static void
+freeExprTab(void)
+{
+    if (exprTab.slotPtr)
+        h_freeTab_(&exprTab, freeExprProg);
+    if (funcTab.slotPtr)
+        h_freeTab_(&funcTab, NULL);
+    if (cmdTab.slotPtr)
+        h_freeTab_(&cmdTab, NULL);
+}
+
+/* The compiler is a recursive descent parser of the
+ * tcl expression produced by parseResReq(), the
+ * grammar is the subset of tcl expr made of numbers,
+ * math functions without arguments, command substitutions
+ * and the operators allowed by resToClassNew():
+ *
+ * or    : and { || and }
+ * and   : eq { && eq }
+ * eq    : rel { == | != rel }
+ * rel   : add { < | > | <= | >= add }
+ * add   : mul { + | - mul }
+ * mul   : unary { * | / unary }
+ * unary : - unary | + unary | ! unary | primary
+ * primary : number | name() | [cmd "arg" ...] | ( or )
+ *
+ * Whatever falls outside of this is left to tcl.
+ */
+enum exprTok {
+    TOK_END,
+    TOK_INT,
+    TOK_DOUBLE,
+    TOK_FUNC,
+    TOK_CMD,
+    TOK_LP,
+    TOK_RP,
+    TOK_OP,
+    TOK_BAD
+};
+
+struct exprLex {
+    char    *p;
+    int     tok;
+    int     op;
+    int     arg;
+    long    i;
+    double  d;
+    struct exprProg *prog;
+};
+
+static void exprNext(struct exprLex *);
+static int exprCmd(struct exprLex *);
+static int exprEmit(struct exprProg *, int, int);
+static int exprOr(struct exprLex *);
+static int exprAnd(struct exprLex *);
+static int exprEq(struct exprLex *);
+static int exprRel(struct exprLex *);
+static int exprAdd(struct exprLex *);
+static int exprMul(struct exprLex *);
+static int exprUnary(struct exprLex *);
+static int exprPrimary(struct exprLex *);
+
+#define EXPR_NAME_CHAR(c) \
+    (isalnum((int)(c)) || (c) == '_')
+
+/* compileExpr()
+ */
+static struct exprProg *
+compileExpr(char *resReq)
+{
+    struct exprProg *prog;
+    struct exprLex lex;
+
+    prog = calloc(1, sizeof(struct exprProg));
+    if (prog == NULL)
+        return NULL;
+
+    if (strncmp(resReq, "expr", 4) != 0
+        || !isspace((int)resReq[4])) {
+        prog->useTcl = TRUE;
+        return prog;
+    }
+
+    lex.p = resReq + 4;
+    lex.prog = prog;
+    exprNext(&lex);
+
+    if (lex.tok == TOK_END
+        || exprOr(&lex) < 0
+        || lex.tok != TOK_END) {
+        freeExprProg(prog);
+        prog = calloc(1, sizeof(struct exprProg));
+        if (prog)
+            prog->useTcl = TRUE;
+        return prog;
+    }
+
+    return prog;
+}
+
+/* exprNext()
+ *
+ * Get the next token.
+ */
+static void
+exprNext(struct exprLex *lex)
+{
+    struct exprSym *sym;
+    hEnt *ent;
+    char name[MAXLINELEN];
+    char *p;
+    char *q;
+    int n;
+
+    while (isspace((int)*lex->p))
+        lex->p++;
+
+    p = lex->p;
+    lex->tok = TOK_BAD;
+
+    switch (*p) {
+        case '\0':
+            lex->tok = TOK_END;
+            return;
+        case '(':
+            lex->tok = TOK_LP;
+            lex->p++;
+            return;
+        case ')':
+            lex->tok = TOK_RP;
+            lex->p++;
+            return;
+        case '[':
+            if (exprCmd(lex) == 0)
+                lex->tok = TOK_CMD;
+            return;
+        case '|':
+            if (p[1] == '|') {
+                lex->tok = TOK_OP;
+                lex->op = EXPR_OR;
+                lex->p += 2;
+            }
+            return;
+        case '&':
+            if (p[1] == '&') {
+                lex->tok = TOK_OP;
+                lex->op = EXPR_AND;
+                lex->p += 2;
+            }
+            return;
+        case '=':
+            if (p[1] == '=') {
+                lex->tok = TOK_OP;
+                lex->op = EXPR_EQ;
+                lex->p += 2;
+            }
+            return;
+        case '!':
+            lex->tok = TOK_OP;
+            if (p[1] == '=') {
+                lex->op = EXPR_NE;
+                lex->p += 2;
+            } else {
+                lex->op = EXPR_NOT;
+                lex->p++;
+            }
+            return;
+        case '<':
+        case '>':
+            lex->tok = TOK_OP;
+            if (p[1] == '=') {
+                lex->op = (*p == '<') ? EXPR_LE : EXPR_GE;
+                lex->p += 2;
+            } else if (p[1] == *p) {
+                /* shift operators
+                 */
+                lex->tok = TOK_BAD;
+            } else {
+                lex->op = (*p == '<') ? EXPR_LT : EXPR_GT;
+                lex->p++;
+            }
+            return;
+        case '+':
+            lex->tok = TOK_OP;
+            lex->op = EXPR_ADD;
+            lex->p++;
+            return;
+        case '-':
+            lex->tok = TOK_OP;
+            lex->op = EXPR_SUB;
+            lex->p++;
+            return;
+        case '*':
+            /* No exponentiation.
+             */
+            if (p[1] != '*') {
+                lex->tok = TOK_OP;
+                lex->op = EXPR_MUL;
+                lex->p++;
+            }
+            return;
+        case '/':
+            lex->tok = TOK_OP;
+            lex->op = EXPR_DIV;
+            lex->p++;
+            return;
+    }
+
+    if (isdigit((int)*p) || (*p == '.' && isdigit((int)p[1]))) {
+
+        q = p;
+        n = 0;
+        while (isdigit((int)*q)) {
+            ++q;
+            ++n;
+        }
+        if (*q == '.') {
+            ++q;
+            while (isdigit((int)*q))
+                ++q;
+            lex->tok = TOK_DOUBLE;
+            lex->d = strtod(p, NULL);
+        } else {
+            /* Leading zeros mean octal to tcl and
+             * big numbers are bignums.
+             */
+            if ((n > 1 && *p == '0') || n > 15)
+                return;
+            lex->tok = TOK_INT;
+            lex->i = strtol(p, NULL, 10);
+        }
+        /* Exponents, hex or words glued to the number.
+         */
+        if (EXPR_NAME_CHAR(*q) || *q == '.' || *q == '[') {
+            lex->tok = TOK_BAD;
+            return;
+        }
+        lex->p = q;
+        return;
+    }
+
+    if (isalpha((int)*p)) {
+
+        n = 0;
+        while (EXPR_NAME_CHAR(*p) && n < MAXLINELEN - 1)
+            name[n++] = *p++;
+        name[n] = 0;
+
+        if (p[0] != '(' || p[1] != ')')
+            return;
+        p += 2;
+        if (EXPR_NAME_CHAR(*p) || *p == '.' || *p == '[')
+            return;
+
+        ent = h_getEnt_(&funcTab, name);
+        if (ent == NULL)
+            return;
+        sym = ent->hData;
+
+        lex->tok = TOK_FUNC;
+        lex->op = sym->type;
+        lex->arg = sym->indx;
+        lex->p = p;
+        return;
+    }
+}
+
+/* exprCmd()
+ *
+ * Parse a command substitution like
+ * [type "eq" "LINUX"] or [defined "res"]
+ */
+static int
+exprCmd(struct exprLex *lex)
+{
+    struct exprProg *prog;
+    struct exprSym *sym;
+    struct exprCmd *cmd;
+    hEnt *ent;
+    char name[MAXLINELEN];
+    char *args[2];
+    char *p;
+    char *q;
+    int numArgs;
+    int n;
+
+    prog = lex->prog;
+    p = lex->p + 1;
+
+    while (isspace((int)*p))
+        ++p;
+
+    n = 0;
+    while (*p && !isspace((int)*p) && *p != ']' && n < MAXLINELEN - 1) {
+        if (strchr("$[{}\\\";", *p))
+            return -1;
+        name[n++] = *p++;
+    }
+    name[n] = 0;
+
+    ent = h_getEnt_(&cmdTab, name);
+    if (ent == NULL)
+        return -1;
+    sym = ent->hData;
+
+    numArgs = 0;
+    while (1) {
+        while (isspace((int)*p))
+            ++p;
+        if (*p == ']')
+            break;
+        if (*p != '"' || numArgs == 2)
+            return -1;
+        q = ++p;
+        while (*p && *p != '"') {
+            if (strchr("$[]{}\\", *p))
+                return -1;
+            ++p;
+        }
+        if (*p != '"')
+            return -1;
+        ++p;
+        if (!isspace((int)*p) && *p != ']') {
+            while (numArgs > 0)
+                FREEUP(args[--numArgs]);
+            return -1;
+        }
+        n = p - q - 1;
+        args[numArgs] = malloc(n + 1);
+        if (args[numArgs] == NULL) {
+            while (numArgs > 0)
+                FREEUP(args[--numArgs]);
+            return -1;
+        }
+        memcpy(args[numArgs], q, n);
+        args[numArgs][n] = 0;
+        ++numArgs;
+    }
+    ++p;
+
+    /* The substituted result glued to
+     * something else.
+     */
+    if (EXPR_NAME_CHAR(*p) || *p == '.' || *p == '[' || *p == '"'
+        || (sym->indx == DEFINEDFUNCTION && numArgs != 1)
+        || (sym->indx != DEFINEDFUNCTION && numArgs != 2)) {
+        while (numArgs > 0)
+            FREEUP(args[--numArgs]);
+        return -1;
+    }
+
+    if (prog->numCmds == prog->sizeCmds) {
+        prog->sizeCmds = prog->sizeCmds ? 2 * prog->sizeCmds : 4;
+        cmd = realloc(prog->cmds, prog->sizeCmds * sizeof(struct exprCmd));
+        if (cmd == NULL) {
+            while (numArgs > 0)
+                FREEUP(args[--numArgs]);
+            return -1;
+        }
+        prog->cmds = cmd;
+    }
+
+    cmd = &prog->cmds[prog->numCmds];
+    cmd->indx = sym->indx;
+    if (numArgs == 1) {
+        cmd->op = NULL;
+        cmd->val = args[0];
+    } else {
+        cmd->op = args[0];
+        cmd->val = args[1];
+    }
+
+    lex->arg = prog->numCmds;
+    ++prog->numCmds;
+    lex->p = p;
+
+    return 0;
+}
+
+/* exprEmit()
+ *
+ * Append an instruction to the program and
+ * return its address.
+ */
+static int
+exprEmit(struct exprProg *prog, int op, int arg)
+{
+    struct exprCode *code;
+
+    if (prog->numCode == prog->sizeCode) {
+        prog->sizeCode = prog->sizeCode ? 2 * prog->sizeCode : 16;
+        code = realloc(prog->code, prog->sizeCode * sizeof(struct exprCode));
+        if (code == NULL)
+            return -1;
+        prog->code = code;
+    }
+
+    code = &prog->code[prog->numCode];
+    code->op = op;
+    code->arg = arg;
+    code->i = 0;
+    code->d = 0.0;
+
+    return prog->numCode++;
+}
+
+/* exprOr()
+ *
+ * The logical operators jump over their right
+ * operand if the left one decides the result,
+ * otherwise the result is the right operand
+ * converted to 0 or 1.
+ */
+static int
+exprOr(struct exprLex *lex)
+{
+    int pc;
+
+    if (exprAnd(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP && lex->op == EXPR_OR) {
+        exprNext(lex);
+        if ((pc = exprEmit(lex->prog, EXPR_OR, -1)) < 0)
+            return -1;
+        if (exprAnd(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, EXPR_BOOL, 0) < 0)
+            return -1;
+        lex->prog->code[pc].arg = lex->prog->numCode;
+    }
+
+    return 0;
+}
+
+static int
+exprAnd(struct exprLex *lex)
+{
+    int pc;
+
+    if (exprEq(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP && lex->op == EXPR_AND) {
+        exprNext(lex);
+        if ((pc = exprEmit(lex->prog, EXPR_AND, -1)) < 0)
+            return -1;
+        if (exprEq(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, EXPR_BOOL, 0) < 0)
+            return -1;
+        lex->prog->code[pc].arg = lex->prog->numCode;
+    }
+
+    return 0;
+}
+
+static int
+exprEq(struct exprLex *lex)
+{
+    int op;
+
+    if (exprRel(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP
+           && (lex->op == EXPR_EQ || lex->op == EXPR_NE)) {
+        op = lex->op;
+        exprNext(lex);
+        if (exprRel(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, op, 0) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+exprRel(struct exprLex *lex)
+{
+    int op;
+
+    if (exprAdd(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP
+           && (lex->op == EXPR_LT || lex->op == EXPR_GT
+               || lex->op == EXPR_LE || lex->op == EXPR_GE)) {
+        op = lex->op;
+        exprNext(lex);
+        if (exprAdd(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, op, 0) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+exprAdd(struct exprLex *lex)
+{
+    int op;
+
+    if (exprMul(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP
+           && (lex->op == EXPR_ADD || lex->op == EXPR_SUB)) {
+        op = lex->op;
+        exprNext(lex);
+        if (exprMul(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, op, 0) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+exprMul(struct exprLex *lex)
+{
+    int op;
+
+    if (exprUnary(lex) < 0)
+        return -1;
+
+    while (lex->tok == TOK_OP
+           && (lex->op == EXPR_MUL || lex->op == EXPR_DIV)) {
+        op = lex->op;
+        exprNext(lex);
+        if (exprUnary(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, op, 0) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+exprUnary(struct exprLex *lex)
+{
+    int op;
+
+    if (lex->tok == TOK_OP
+        && (lex->op == EXPR_SUB
+            || lex->op == EXPR_ADD
+            || lex->op == EXPR_NOT)) {
+
+        if (lex->op == EXPR_SUB)
+            op = EXPR_NEG;
+        else if (lex->op == EXPR_ADD)
+            op = EXPR_PLUS;
+        else
+            op = EXPR_NOT;
+
+        exprNext(lex);
+        if (exprUnary(lex) < 0)
+            return -1;
+        if (exprEmit(lex->prog, op, 0) < 0)
+            return -1;
+        return 0;
+    }
+
+    return exprPrimary(lex);
+}
+
+static int
+exprPrimary(struct exprLex *lex)
+{
+    int pc;
+
+    switch (lex->tok) {
+        case TOK_INT:
+            if ((pc = exprEmit(lex->prog, EXPR_INT, 0)) < 0)
+                return -1;
+            lex->prog->code[pc].i = lex->i;
+            break;
+        case TOK_DOUBLE:
+            if ((pc = exprEmit(lex->prog, EXPR_DOUBLE, 0)) < 0)
+                return -1;
+            lex->prog->code[pc].d = lex->d;
+            break;
+        case TOK_FUNC:
+            if (exprEmit(lex->prog, lex->op, lex->arg) < 0)
+                return -1;
+            break;
+        case TOK_CMD:
+            if (exprEmit(lex->prog, EXPR_CMD, lex->arg) < 0)
+                return -1;
+            break;
+        case TOK_LP:
+            exprNext(lex);
+            if (exprOr(lex) < 0)
+                return -1;
+            if (lex->tok != TOK_RP)
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+
+    exprNext(lex);
+    return 0;
+}
+
+#define EXPR_TRUE(V) ((V)->isDouble ? (V)->d != 0.0 : (V)->i != 0)
+
+/* evalExprProg()
+ *
+ * Run a compiled expression on the current host.
+ * Like tcl does all command substitutions are done
+ * first, then the expression is evaluated. Return
+ * -2 if an integer operation overflows a long, tcl
+ * promotes the result to a bignum so the caller has
+ * to let tcl evaluate the expression.
+ */
+static int
+evalExprProg(struct exprProg *prog, struct exprVal *result)
+{
+    static struct exprVal *stack;
+    static int sizeStack;
+    static int *cmdVal;
+    static int sizeCmdVal;
+    struct exprCode *c;
+    struct exprCmd *cmd;
+    struct exprVal *x;
+    struct exprVal *y;
+    double d1;
+    double d2;
+    int pc;
+    int sp;
+    int cc;
+    int i;
+
+    if (prog->numCode + 1 > sizeStack) {
+        FREEUP(stack);
+        sizeStack = prog->numCode + 16;
+        stack = calloc(sizeStack, sizeof(struct exprVal));
+        if (stack == NULL) {
+            sizeStack = 0;
+            return -1;
+        }
+    }
+
+    if (prog->numCmds > sizeCmdVal) {
+        FREEUP(cmdVal);
+        sizeCmdVal = prog->numCmds + 4;
+        cmdVal = calloc(sizeCmdVal, sizeof(int));
+        if (cmdVal == NULL) {
+            sizeCmdVal = 0;
+            return -1;
+        }
+    }
+
+    for (i = 0; i < prog->numCmds; i++) {
+        cmd = &prog->cmds[i];
+        if (cmd->indx == DEFINEDFUNCTION)
+            cc = definedValue(cmd->val, &cmdVal[i]);
+        else
+            cc = strValue(cmd->indx, cmd->op, cmd->val, &cmdVal[i]);
+        if (cc != TCL_OK)
+            return -1;
+    }
+
+    sp = 0;
+    pc = 0;
+    while (pc < prog->numCode) {
+
+        c = &prog->code[pc];
+        ++pc;
+
+        switch (c->op) {
+            case EXPR_INT:
+                stack[sp].isDouble = FALSE;
+                stack[sp].i = c->i;
+                ++sp;
+                continue;
+            case EXPR_DOUBLE:
+                stack[sp].isDouble = TRUE;
+                stack[sp].d = c->d;
+                ++sp;
+                continue;
+            case EXPR_NUMERIC:
+                if (numValue(c->arg, &stack[sp]) != TCL_OK)
+                    return -1;
+                ++sp;
+                continue;
+            case EXPR_BOOLEAN:
+                stack[sp].isDouble = FALSE;
+                if (boolValue(c->arg, &stack[sp].i) != TCL_OK)
+                    return -1;
+                ++sp;
+                continue;
+            case EXPR_CMD:
+                stack[sp].isDouble = FALSE;
+                stack[sp].i = cmdVal[c->arg];
+                ++sp;
+                continue;
+            case EXPR_NEG:
+                x = &stack[sp - 1];
+                if (x->isDouble)
+                    x->d = -x->d;
+                else if (__builtin_sub_overflow(0, x->i, &x->i))
+                    return -2;
+                continue;
+            case EXPR_PLUS:
+                continue;
+            case EXPR_NOT:
+                x = &stack[sp - 1];
+                x->i = !EXPR_TRUE(x);
+                x->isDouble = FALSE;
+                continue;
+            case EXPR_BOOL:
+                x = &stack[sp - 1];
+                x->i = EXPR_TRUE(x);
+                x->isDouble = FALSE;
+                continue;
+            case EXPR_AND:
+                --sp;
+                if (!EXPR_TRUE(&stack[sp])) {
+                    stack[sp].isDouble = FALSE;
+                    stack[sp].i = 0;
+                    ++sp;
+                    pc = c->arg;
+                }
+                continue;
+            case EXPR_OR:
+                --sp;
+                if (EXPR_TRUE(&stack[sp])) {
+                    stack[sp].isDouble = FALSE;
+                    stack[sp].i = 1;
+                    ++sp;
+                    pc = c->arg;
+                }
+                continue;
+        }
+
+        /* Binary operators.
+         */
+        --sp;
+        y = &stack[sp];
+        x = &stack[sp - 1];
+
+        if (!x->isDouble && !y->isDouble) {
+            switch (c->op) {
+                case EXPR_MUL:
+                    if (__builtin_mul_overflow(x->i, y->i, &x->i))
+                        return -2;
+                    break;
+                case EXPR_DIV:
+                    if (y->i == 0)
+                        return -1;
+                    if (y->i == -1 && x->i == LONG_MIN)
+                        return -2;
+                    /* tcl rounds toward minus infinity
+                     */
+                    if (x->i % y->i != 0 && ((x->i < 0) != (y->i < 0)))
+                        x->i = x->i / y->i - 1;
+                    else
+                        x->i = x->i / y->i;
+                    break;
+                case EXPR_ADD:
+                    if (__builtin_add_overflow(x->i, y->i, &x->i))
+                        return -2;
+                    break;
+                case EXPR_SUB:
+                    if (__builtin_sub_overflow(x->i, y->i, &x->i))
+                        return -2;
+                    break;
+                case EXPR_LT:
+                    x->i = x->i < y->i;
+                    break;
+                case EXPR_GT:
+                    x->i = x->i > y->i;
+                    break;
+                case EXPR_LE:
+                    x->i = x->i <= y->i;
+                    break;
+                case EXPR_GE:
+                    x->i = x->i >= y->i;
+                    break;
+                case EXPR_EQ:
+                    x->i = x->i == y->i;
+                    break;
+                case EXPR_NE:
+                    x->i = x->i != y->i;
+                    break;
+                default:
+                    return -1;
+            }
+            continue;
+        }
+
+        d1 = x->isDouble ? x->d : (double)x->i;
+        d2 = y->isDouble ? y->d : (double)y->i;
+
+        x->isDouble = FALSE;
+        switch (c->op) {
+            case EXPR_MUL:
+                x->isDouble = TRUE;
+                x->d = d1 * d2;
+                break;
+            case EXPR_DIV:
+                x->isDouble = TRUE;
+                x->d = d1 / d2;
+                break;
+            case EXPR_ADD:
+                x->isDouble = TRUE;
+                x->d = d1 + d2;
+                break;
+            case EXPR_SUB:
+                x->isDouble = TRUE;
+                x->d = d1 - d2;
+                break;
+            case EXPR_LT:
+                x->i = d1 < d2;
+                break;
+            case EXPR_GT:
+                x->i = d1 > d2;
+                break;
+            case EXPR_LE:
+                x->i = d1 <= d2;
+                break;
+            case EXPR_GE:
+                x->i = d1 >= d2;
+                break;
+            case EXPR_EQ:
+                x->i = d1 == d2;
+                break;
+            case EXPR_NE:
+                x->i = d1 != d2;
+                break;
+            default:
+                return -1;
+        }
+
+        /* tcl raises a domain error
+         */
+        if (x->isDouble && isnan(x->d))
+            return -1;
+    }
+
+    if (sp != 1)
+        return -1;
+
+    *result = stack[0];
+
+    return 0;
+}
+
 /* getResValue()
  */
 static char *
@@ -301,6 +301,7 @@ make_sacct(const char *name, uint32_t shares)
     s = calloc(1, sizeof(struct share_acct));
     s->name = strdup(name);
     s->shares = shares;
+    s->resort = 1;
 
     return s;
 }
@@ -334,8 +335,31 @@ compute_slots(struct tree_node_ *n, uint32_t total, uint32_t avail)
     return s->sent;
 }
 
+/* sshare_resort_node()
+ *
+ * The usage or the shares of the children of
+ * the node have changed, mark the node and its
+ * ancestors so that the next session sorts the
+ * children again.
+ */
+void
+sshare_resort_node(struct tree_node_ *n)
+{
+    struct share_acct *s;
+
+    while (n) {
+        s = n->data;
+        s->resort = 1;
+        n = n->parent;
+    }
+}
+
 /* sort_tree_by_deviate()
  *
+ * Sort again only the siblings whose parent
+ * has been marked by sshare_resort_node(),
+ * the order of the others has not changed
+ * since the last session.
  */
 static void
 sort_tree_by_deviate(struct tree_ *t)
@@ -348,8 +372,13 @@ sort_tree_by_deviate(struct tree_ *t)
     uint64_t sum;
     uint64_t avail;
 
-    stack = make_link();
     root = t->root;
+    s = root->data;
+    if (s->resort == 0)
+        return;
+    s->resort = 0;
+
+    stack = make_link();
     n = root->child;
 
 znovu:
@@ -357,10 +386,12 @@ znovu:
     sum = 0;
     while (n) {
 
-        if (n->child)
+        s = n->data;
+        if (n->child && s->resort) {
             enqueue_link(stack, n);
+            s->resort = 0;
+        }
 
-        s = n->data;
         s->dsrv2 = 0;
         /* sum up the historical.
          */
@@ -387,7 +418,6 @@ znovu:
     }
 
     fin_link(stack);
-    make_leafs(t);
 }
 
 
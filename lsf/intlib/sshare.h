@@ -23,6 +23,7 @@ struct share_acct {
     int numRAN;
     int32_t dsrv2;
     uint32_t options;
+    int resort;
 };
 
 /* Support data structure equivalent of groupInfoEnt
@@ -53,5 +54,6 @@ extern struct share_acct *make_sacct(const char *, uint32_t);
 extern void free_sacct(struct share_acct *);
 extern int sshare_distribute_slots(struct tree_ *,
                                    uint32_t);
+extern void sshare_resort_node(struct tree_node_ *);
 
 #endif /* _SSHARE_HEADER_ */
@@ -23,6 +23,14 @@
 #include "lib.h"
 #include "lproto.h"
 
+/* On Linux the channels are multiplexed by epoll,
+ * define CHAN_NO_EPOLL to build the select() version.
+ */
+#if defined(__linux__) && !defined(CHAN_NO_EPOLL)
+#define CHAN_EPOLL
+#include <sys/epoll.h>
+#endif
+
 
 #define MAXLOOP 3000
 
@@ -42,12 +50,42 @@ static int chanMaxSize;
 
 extern int CreateSock_(int);
 
-static void doread(int , struct Masks *);
-static void dowrite(int, struct Masks *);
+static int doread(int , struct Masks *);
+static int dowrite(int, struct Masks *);
 static struct Buffer *newBuf(void);
 static void enqueueTail_(struct Buffer *, struct Buffer *);
 static void dequeue_(struct Buffer *);
 static int findAFreeChannel(void);
+static int chanSelectFds(struct Masks *, struct timeval *);
+
+#ifdef CHAN_EPOLL
+/* Number of events harvested by one epoll_wait(),
+ * the others are picked up by the next call.
+ */
+#define MAX_EPOLL_EVENTS 1024
+
+static int epfd = -1;
+static pid_t epPid;
+static int epFailed;
+static struct epoll_event *epEvents;
+static int *pendList;
+static int numPend;
+
+static int epollOpen(void);
+static int epollSelect(struct Masks *, struct timeval *);
+static int epollPoll(struct Masks *, int);
+static int chanEvents(int);
+static void chanWatch(int);
+static void chanUnwatch(int);
+static void addPending(int);
+static ssize_t readNoWait(int, void *, size_t);
+static ssize_t writeNoWait(int, const void *, size_t);
+#else
+#define chanWatch(c)
+#define chanUnwatch(c)
+#define readNoWait(s, b, l)  read((s), (b), (l))
+#define writeNoWait(s, b, l) write((s), (b), (l))
+#endif
 
 int
 chanInit_(void)
@@ -60,11 +98,19 @@ chanInit_(void)
     first = FALSE;
 
     chanMaxSize = sysconf(_SC_OPEN_MAX);
+    if (chanMaxSize > CHAN_SETSIZE)
+        chanMaxSize = CHAN_SETSIZE;
 
     channels = calloc(chanMaxSize, sizeof(struct chanData));
     if (channels == NULL)
         return -1;
 
+#ifdef CHAN_EPOLL
+    pendList = calloc(chanMaxSize, sizeof(int));
+    if (pendList == NULL)
+        return -1;
+#endif
+
     chanIndex = 0;
 
     return 0;
@@ -120,6 +166,8 @@ chanServSocket_(int type, u_short port, int backlog, int options)
         channels[ch].type  = CH_TYPE_UDP;
     else
         channels[ch].type  = CH_TYPE_PASSIVE;
+    chanWatch(ch);
+
     return(ch);
 }
 
@@ -203,23 +251,25 @@ chanAccept_(int chfd, struct sockaddr_in *from)
 void
 chanInactivate_(int chfd)
 {
-    if (chfd < 0 || chfd > chanMaxSize)
+    if (chfd < 0 || chfd >= chanMaxSize)
         return;
 
     if (channels[chfd].state != CH_INACTIVE) {
         channels[chfd].prestate = channels[chfd].state;
         channels[chfd].state = CH_INACTIVE;
+        chanWatch(chfd);
     }
 }
 
 void
 chanActivate_(int chfd)
 {
-    if (chfd < 0 || chfd > chanMaxSize)
+    if (chfd < 0 || chfd >= chanMaxSize)
         return;
 
     if (channels[chfd].state == CH_INACTIVE) {
         channels[chfd].state = channels[chfd].prestate;
+        chanWatch(chfd);
     }
 }
 
@@ -247,6 +297,25 @@ chanConnect_(int chfd, struct sockaddr_in *peer, int timeout, int options)
         return 0;
     }
 
+    /* Let chanSelect_() tell when the connection is
+     * done, the socket then shows up in the wmask.
+     */
+    if (options & CHAN_OP_NONBLOCK) {
+        if (io_nonblock_(channels[chfd].handle) < 0) {
+            lserrno = LSE_SOCK_SYS;
+            return -1;
+        }
+        cc = connect(channels[chfd].handle, (struct sockaddr *) peer,
+                     sizeof(struct sockaddr_in));
+        if (SOCK_CALL_FAIL(cc) && errno != EINPROGRESS) {
+            lserrno = LSE_CONN_SYS;
+            return -1;
+        }
+        channels[chfd].state = CH_PRECONN;
+        chanWatch(chfd);
+        return 0;
+    }
+
     if (timeout >= 0) {
         if (b_connect_(channels[chfd].handle, (struct sockaddr *) peer,
                        sizeof(struct sockaddr_in), timeout/1000) < 0) {
@@ -257,9 +326,11 @@ chanConnect_(int chfd, struct sockaddr_in *peer, int timeout, int options)
             return -1;
         }
         channels[chfd].state = CH_CONN;
+        chanWatch(chfd);
         return 0;
     }
     channels[chfd].state = CH_CONN;
+    chanWatch(chfd);
     return 0;
 
 }
@@ -432,6 +503,7 @@ chanOpen: connect() failed, laddr=%s, addr=%s"),/*catgets 5003*/
             return -1;
         }
         channels[i].state = CH_PRECONN;
+        chanWatch(i);
         return(i);
     }
 
@@ -446,6 +518,7 @@ chanOpen: connect() failed, laddr=%s, addr=%s"),/*catgets 5003*/
         lserrno = LSE_MALLOC;
         return -1;
     }
+    chanWatch(i);
 
     return(i);
 
@@ -483,6 +556,8 @@ chanOpenSock_(int s, int options)
         lserrno = LSE_MALLOC;
         return -1;
     }
+    chanWatch(i);
+
     return(i);
 }
 
@@ -504,6 +579,7 @@ chanClose_(int chfd)
         cherrno = CHANE_BADCHFD;
         return -1;
     }
+    chanUnwatch(chfd);
     close(channels[chfd].handle);
 
     if (channels[chfd].send
@@ -524,6 +600,10 @@ chanClose_(int chfd)
             FREEUP(buf);
         }
     }
+    if (channels[chfd].hold) {
+        FREEUP(channels[chfd].hold->data);
+        FREEUP(channels[chfd].hold);
+    }
     FREEUP(channels[chfd].recv);
     FREEUP(channels[chfd].send);
     channels[chfd].state = CH_FREE;
@@ -555,17 +635,53 @@ chanCloseAllBut_(int chfd)
             chanClose_(i);
 }
 
+/* chanSelect_()
+ *
+ * Wait for activity on the channels and report it in
+ * chanmask indexed by channel number. The sockmask is
+ * only scratch space kept for the callers that still
+ * pass it.
+ */
 int
 chanSelect_(struct Masks *sockmask,
             struct Masks *chanmask,
             struct timeval *timeout)
 {
+#ifdef CHAN_EPOLL
+    if (epfd < 0 || epPid != getpid()) {
+        if (!epFailed && epollOpen() < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: epoll_create1() failed, falling back to select() %m", __func__);
+            epFailed = TRUE;
+        }
+    }
+
+    if (epfd >= 0)
+        return epollSelect(chanmask, timeout);
+#endif
+
+    return chanSelectFds(chanmask, timeout);
+}
+
+/* chanSelectFds()
+ *
+ * The select() based multiplexer, it has to rebuild
+ * the fd_sets from all channels at every call and
+ * cannot look at sockets above FD_SETSIZE.
+ */
+static int
+chanSelectFds(struct Masks *chanmask, struct timeval *timeout)
+{
+    static fd_set rfds;
+    static fd_set wfds;
+    static fd_set efds;
     int i;
     int nReady;
     int maxfds;
 
-    FD_ZERO(&sockmask->wmask);
-    FD_ZERO(&sockmask->emask);
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    FD_ZERO(&efds);
 
     for(i = 0; i < chanIndex; i++) {
         if (channels[i].state == CH_INACTIVE)
@@ -580,6 +696,13 @@ chanSelect_(struct Masks *sockmask,
             continue;
         }
 
+        if (channels[i].handle >= FD_SETSIZE) {
+            ls_syslog(LOG_ERR, "\
+%s: channel %d socket %d is above FD_SETSIZE %d", __func__,
+                      i, channels[i].handle, FD_SETSIZE);
+            continue;
+        }
+
         if (channels[i].type == CH_TYPE_UDP &&
             channels[i].state != CH_WAIT)
             continue;
@@ -597,7 +720,7 @@ chanSelect_(struct Masks *sockmask,
             continue;
 
         if (channels[i].state == CH_PRECONN) {
-            FD_SET(channels[i].handle , &(sockmask->wmask));
+            FD_SET(channels[i].handle, &wfds);
             continue;
         }
 
@@ -605,81 +728,74 @@ chanSelect_(struct Masks *sockmask,
             ls_syslog(LOG_DEBUG3, "\
 %s: Adding channel %d handle %d ", __func__, i,
                       channels[i].handle);
-        FD_SET(channels[i].handle, &(sockmask->rmask));
+        FD_SET(channels[i].handle, &rfds);
 
         if (channels[i].type != CH_TYPE_UDP)
-            FD_SET(channels[i].handle, &(sockmask->emask));
+            FD_SET(channels[i].handle, &efds);
 
         if (channels[i].send
             && channels[i].send->forw != channels[i].send)
-            FD_SET(channels[i].handle, &(sockmask->wmask));
+            FD_SET(channels[i].handle, &wfds);
     }
 
     maxfds = FD_SETSIZE;
 
-    nReady = select(maxfds,
-                    &(sockmask->rmask),
-                    &(sockmask->wmask),
-                    &(sockmask->emask),
-                    timeout);
+    nReady = select(maxfds, &rfds, &wfds, &efds, timeout);
     if (nReady <= 0) {
         return nReady;
     }
 
-    FD_ZERO(&(chanmask->rmask));
-    FD_ZERO(&(chanmask->wmask));
-    FD_ZERO(&(chanmask->emask));
+    CHAN_ZERO(&chanmask->rmask);
+    CHAN_ZERO(&chanmask->wmask);
+    CHAN_ZERO(&chanmask->emask);
 
     for(i = 0; i < chanIndex; i++) {
 
-        if (channels[i].handle == INVALID_HANDLE)
+        if (channels[i].handle == INVALID_HANDLE
+            || channels[i].handle >= FD_SETSIZE)
             continue;
 
-        if (FD_ISSET(channels[i].handle, &(sockmask->emask))) {
+        if (FD_ISSET(channels[i].handle, &efds)) {
             ls_syslog(LOG_DEBUG, "\
 %s: setting error mask for channel %d", __func__, channels[i].handle);
-            FD_SET(i, &(chanmask->emask));
+            CHAN_SET(i, &chanmask->emask);
             continue;
         }
 
         if ((!channels[i].send || !channels[i].recv)
             && (channels[i].state != CH_PRECONN) ) {
-            if (FD_ISSET(channels[i].handle, &(sockmask->rmask)))
-                FD_SET(i, &(chanmask->rmask));
-            if (FD_ISSET(channels[i].handle, &(sockmask->wmask)))
-                FD_SET(i, &(chanmask->wmask));
+            if (FD_ISSET(channels[i].handle, &rfds))
+                CHAN_SET(i, &chanmask->rmask);
+            if (FD_ISSET(channels[i].handle, &wfds))
+                CHAN_SET(i, &chanmask->wmask);
             continue;
         }
 
 
         if (channels[i].state == CH_PRECONN) {
 
-            if (FD_ISSET(channels[i].handle, &(sockmask->wmask))) {
+            if (FD_ISSET(channels[i].handle, &wfds)) {
                 channels[i].state = CH_CONN;
                 channels[i].send  = newBuf();
                 channels[i].recv  = newBuf();
-                FD_SET(i, &(chanmask->wmask));
+                CHAN_SET(i, &chanmask->wmask);
             }
 
         } else {
 
-            if (FD_ISSET(channels[i].handle, &(sockmask->rmask))) {
+            if (FD_ISSET(channels[i].handle, &rfds)) {
                 doread(i, chanmask);
-                if (!FD_ISSET(i, &(chanmask->rmask))
-                    && !FD_ISSET(i, &(chanmask->emask)) )
+                if (!CHAN_ISSET(i, &chanmask->rmask)
+                    && !CHAN_ISSET(i, &chanmask->emask))
                     nReady--;
             }
 
             if ((channels[i].send->forw != channels[i].send)
-                && FD_ISSET(channels[i].handle, &(sockmask->wmask))) {
+                && FD_ISSET(channels[i].handle, &wfds)) {
                 dowrite(i, chanmask);
             }
-            FD_SET(i, &(chanmask->wmask));
+            CHAN_SET(i, &chanmask->wmask);
         }
-
-        FD_CLR(channels[i].handle, &(sockmask->rmask));
-        FD_CLR(channels[i].handle, &(sockmask->wmask));
-        FD_CLR(channels[i].handle, &(sockmask->emask));
     }
 
     return nReady;
@@ -705,6 +821,17 @@ chanEnqueue_(int chfd, struct Buffer *msg)
     }
 
     enqueueTail_(msg, channels[chfd].send);
+#ifdef CHAN_EPOLL
+    /* The socket is known to be writable and
+     * there will be no new edge to tell us.
+     */
+    if (channels[chfd].ready & CHAN_WREADY)
+        addPending(chfd);
+    if (channels[chfd].events
+        && !(channels[chfd].events & EPOLLET))
+        chanWatch(chfd);
+#endif
+
     return 0;
 }
 
@@ -730,6 +857,11 @@ chanDequeue_(int chfd, struct Buffer **buf)
     }
     *buf = channels[chfd].recv->forw;
     dequeue_(channels[chfd].recv->forw);
+#ifdef CHAN_EPOLL
+    if (channels[chfd].ready & CHAN_RREADY)
+        addPending(chfd);
+#endif
+
     return 0;
 }
 
@@ -757,9 +889,85 @@ chanRead_(int chfd, char *buf, int len)
 int
 chanWrite_(int chfd, char *buf, int len)
 {
+    struct Buffer *hold;
+    char *data;
+
+    if (channels[chfd].hold == NULL)
+        return (b_write_fix(channels[chfd].handle, buf, len));
+
+    /* The buffer pos is the size of the
+     * allocated data.
+     */
+    hold = channels[chfd].hold;
+    if (hold->len + len > hold->pos) {
+        data = realloc(hold->data, 2 * (hold->len + len));
+        if (data == NULL) {
+            lserrno = LSE_MALLOC;
+            return -1;
+        }
+        hold->data = data;
+        hold->pos = 2 * (hold->len + len);
+    }
+    memcpy(hold->data + hold->len, buf, len);
+    hold->len += len;
+
+    return len;
+}
+
+/* chanHold_()
+ *
+ * Keep in memory what is written to the channel
+ * with chanWrite_() until chanRelease_() is called.
+ */
+int
+chanHold_(int chfd)
+{
+    if (chfd < 0 || chfd >= chanMaxSize) {
+        cherrno = CHANE_BADCHFD;
+        return -1;
+    }
+
+    if (channels[chfd].hold)
+        return 0;
 
-    return (b_write_fix(channels[chfd].handle, buf, len));
+    channels[chfd].hold = calloc(1, sizeof(struct Buffer));
+    if (channels[chfd].hold == NULL) {
+        cherrno = CHANE_MALLOC;
+        return -1;
+    }
 
+    return 0;
+}
+
+/* chanRelease_()
+ *
+ * Write what has been held so far and go back
+ * to write directly on the channel.
+ */
+int
+chanRelease_(int chfd)
+{
+    struct Buffer *hold;
+    int cc;
+
+    if (chfd < 0 || chfd >= chanMaxSize) {
+        cherrno = CHANE_BADCHFD;
+        return -1;
+    }
+
+    hold = channels[chfd].hold;
+    if (hold == NULL)
+        return 0;
+    channels[chfd].hold = NULL;
+
+    cc = 0;
+    if (hold->len > 0)
+        cc = b_write_fix(channels[chfd].handle, hold->data, hold->len);
+
+    FREEUP(hold->data);
+    FREEUP(hold);
+
+    return cc;
 }
 
 int
@@ -897,6 +1105,7 @@ chanSetMode_(int chfd, int mode)
             lserrno = LSE_MALLOC;
             return -1;
         }
+        chanWatch(chfd);
 
         return 0;
     }
@@ -905,11 +1114,17 @@ chanSetMode_(int chfd, int mode)
         lserrno = LSE_SOCK_SYS;
         return -1;
     }
+    chanWatch(chfd);
 
     return 0;
 }
 
-static void
+/* doread()
+ *
+ * Read what is available of the current message,
+ * return the number of bytes read.
+ */
+static int
 doread(int chfd, struct Masks *chanmask)
 {
     struct Buffer *rcvbuf;
@@ -918,9 +1133,9 @@ doread(int chfd, struct Masks *chanmask)
     if (channels[chfd].recv->forw == channels[chfd].recv) {
         rcvbuf = newBuf();
         if (!rcvbuf) {
-            FD_SET(chfd, &(chanmask->emask));
+            CHAN_SET(chfd, &chanmask->emask);
             channels[chfd].chanerr = LSE_MALLOC;
-            return;
+            return -1;
         }
         enqueueTail_(rcvbuf, channels[chfd].recv);
     } else
@@ -929,36 +1144,38 @@ doread(int chfd, struct Masks *chanmask)
     if (!rcvbuf->len) {
         rcvbuf->data =  malloc(LSF_HEADER_LEN);
         if (!rcvbuf->data) {
-            FD_SET(chfd, &(chanmask->emask));
+            CHAN_SET(chfd, &chanmask->emask);
             channels[chfd].chanerr = LSE_MALLOC;
-            return;
+            return -1;
         }
         rcvbuf->len = LSF_HEADER_LEN;
         rcvbuf->pos = 0;
     }
 
     if (rcvbuf->pos == rcvbuf->len) {
-        FD_SET(chfd, &(chanmask->rmask));
-        return;
+        CHAN_SET(chfd, &chanmask->rmask);
+        return 0;
     }
 
     errno = 0;
 
-    cc = read(channels[chfd].handle, rcvbuf->data + rcvbuf->pos,
-              rcvbuf->len - rcvbuf->pos);
+    cc = readNoWait(channels[chfd].handle, rcvbuf->data + rcvbuf->pos,
+                    rcvbuf->len - rcvbuf->pos);
     if (cc == 0 && errno == EINTR) {
         ls_syslog(LOG_ERR, "\
 %s: looks like read() has returned EOF when interrupted by a signal",
                   __func__);
-        return;
+        return 0;
     }
 
     if (cc <= 0) {
         if (cc == 0 || BAD_IO_ERR(errno)) {
-            FD_SET(chfd, &(chanmask->emask));
+            CHAN_SET(chfd, &chanmask->emask);
             channels[chfd].chanerr = CHANE_CONNRESET;
         }
-        return;
+        if (cc == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+            channels[chfd].ready &= ~CHAN_RREADY;
+        return cc;
     }
 
     rcvbuf->pos += cc;
@@ -974,20 +1191,20 @@ doread(int chfd, struct Masks *chanmask)
                       sizeof(struct LSFHeader),
                       XDR_DECODE);
         if (!xdr_LSFHeader(&xdrs, &hdr)) {
-            FD_SET(chfd, &(chanmask->emask));
+            CHAN_SET(chfd, &chanmask->emask);
             channels[chfd].chanerr = CHANE_BADHDR;
             xdr_destroy(&xdrs);
-            return;
+            return -1;
         }
 
         if (hdr.length) {
             rcvbuf->len = hdr.length + LSF_HEADER_LEN;
             newdata = realloc(rcvbuf->data, rcvbuf->len);
             if (!newdata) {
-                FD_SET(chfd, &(chanmask->emask));
+                CHAN_SET(chfd, &chanmask->emask);
                 channels[chfd].chanerr = LSE_MALLOC;
                 xdr_destroy(&xdrs);
-                return;
+                return -1;
             }
             rcvbuf->data = newdata;
         }
@@ -995,30 +1212,39 @@ doread(int chfd, struct Masks *chanmask)
     }
 
     if (rcvbuf->pos == rcvbuf->len) {
-        FD_SET(chfd, &(chanmask->rmask));
+        CHAN_SET(chfd, &chanmask->rmask);
     }
 
-    return;
+    return cc;
 }
 
-static void
+/* dowrite()
+ *
+ * Write what the socket takes of the first queued
+ * message, return the number of bytes written.
+ */
+static int
 dowrite(int chfd, struct Masks *chanmask)
 {
     struct Buffer *sendbuf;
     int cc;
 
     if (channels[chfd].send->forw == channels[chfd].send)
-        return;
+        return 0;
     else
         sendbuf = channels[chfd].send->forw;
 
-    cc = write(channels[chfd].handle,
-               sendbuf->data + sendbuf->pos,
-               sendbuf->len - sendbuf->pos);
-    if (cc < 0 && BAD_IO_ERR(errno)){
-        FD_SET(chfd, &(chanmask->emask));
-        channels[chfd].chanerr = LSE_MSG_SYS;
-        return;
+    cc = writeNoWait(channels[chfd].handle,
+                     sendbuf->data + sendbuf->pos,
+                     sendbuf->len - sendbuf->pos);
+    if (cc < 0) {
+        if (BAD_IO_ERR(errno)) {
+            CHAN_SET(chfd, &chanmask->emask);
+            channels[chfd].chanerr = LSE_MSG_SYS;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            channels[chfd].ready &= ~CHAN_WREADY;
+        return cc;
     }
     sendbuf->pos += cc;
     if (sendbuf->pos == sendbuf->len) {
@@ -1026,7 +1252,7 @@ dowrite(int chfd, struct Masks *chanmask)
         free(sendbuf->data);
         free(sendbuf);
     }
-    return;
+    return cc;
 }
 
 static struct Buffer *
@@ -1125,6 +1351,396 @@ findAFreeChannel(void)
     channels[i].send  = NULL;
     channels[i].recv = NULL;
     channels[i].chanerr = CHANE_NOERR;
+    channels[i].events = 0;
+    /* The slot may still sit on the pending list.
+     */
+    channels[i].ready &= CHAN_PENDING;
 
     return i;
 }
+
+#ifdef CHAN_EPOLL
+
+/* epollOpen()
+ *
+ * The epoll instance is created at the first chanSelect_()
+ * so that library clients never pay for it. A forked child
+ * shares the instance of its parent and must not change it,
+ * it gets its own one the first time it selects.
+ */
+static int
+epollOpen(void)
+{
+    int i;
+
+    if (epfd >= 0)
+        close(epfd);
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        return -1;
+    epPid = getpid();
+
+    if (epEvents == NULL) {
+        epEvents = calloc(MAX_EPOLL_EVENTS, sizeof(struct epoll_event));
+        if (epEvents == NULL) {
+            close(epfd);
+            epfd = -1;
+            return -1;
+        }
+    }
+
+    numPend = 0;
+    for (i = 0; i < chanIndex; i++) {
+        channels[i].events = 0;
+        channels[i].ready = 0;
+        chanWatch(i);
+    }
+
+    return 0;
+}
+
+/* chanEvents()
+ *
+ * The events a channel is watched for, the same channels
+ * the select() version considers. Buffered channels are
+ * read and written by this library so they can be edge
+ * triggered as long as their socket does not block, the
+ * others are read by the caller and stay level triggered.
+ */
+static int
+chanEvents(int ch)
+{
+    int flags;
+
+    if (channels[ch].handle == INVALID_HANDLE
+        || channels[ch].state == CH_FREE
+        || channels[ch].state == CH_INACTIVE)
+        return 0;
+
+    if (channels[ch].type == CH_TYPE_UDP
+        && channels[ch].state != CH_WAIT)
+        return 0;
+
+    if (channels[ch].state != CH_PRECONN
+        && (!channels[ch].recv || !channels[ch].send)) {
+
+        if (channels[ch].type == CH_TYPE_TCP)
+            return 0;
+        if (channels[ch].type == CH_TYPE_UDP)
+            return EPOLLIN;
+        return EPOLLIN | EPOLLPRI;
+    }
+
+    flags = fcntl(channels[ch].handle, F_GETFL);
+    if (flags < 0 || !(flags & O_NONBLOCK)) {
+        if (channels[ch].state == CH_PRECONN
+            || channels[ch].send->forw != channels[ch].send)
+            return EPOLLIN | EPOLLOUT | EPOLLPRI;
+        return EPOLLIN | EPOLLPRI;
+    }
+
+    return EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+}
+
+/* chanWatch()
+ *
+ * Keep the epoll interest of the channel in step with
+ * its state.
+ */
+static void
+chanWatch(int ch)
+{
+    struct epoll_event ev;
+    int events;
+    int op;
+
+    if (epfd < 0 || epPid != getpid())
+        return;
+
+    events = chanEvents(ch);
+    if (events == channels[ch].events)
+        return;
+
+    if (events == 0) {
+        chanUnwatch(ch);
+        return;
+    }
+
+    op = EPOLL_CTL_MOD;
+    if (channels[ch].events == 0) {
+        op = EPOLL_CTL_ADD;
+        channels[ch].ready &= CHAN_PENDING;
+    }
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    ev.events = events;
+    ev.data.fd = ch;
+
+    if (epoll_ctl(epfd, op, channels[ch].handle, &ev) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: epoll_ctl() failed for channel %d socket %d %m", __func__,
+                  ch, channels[ch].handle);
+        return;
+    }
+
+    channels[ch].events = events;
+}
+
+/* chanUnwatch()
+ */
+static void
+chanUnwatch(int ch)
+{
+    struct epoll_event ev;
+
+    if (channels[ch].events == 0)
+        return;
+
+    channels[ch].events = 0;
+    channels[ch].ready &= CHAN_PENDING;
+
+    if (epfd < 0 || epPid != getpid())
+        return;
+
+    memset(&ev, 0, sizeof(struct epoll_event));
+    if (epoll_ctl(epfd, EPOLL_CTL_DEL, channels[ch].handle, &ev) < 0)
+        ls_syslog(LOG_ERR, "\
+%s: epoll_ctl() failed for channel %d socket %d %m", __func__,
+                  ch, channels[ch].handle);
+}
+
+/* addPending()
+ *
+ * An edge triggered channel whose readiness has not
+ * been consumed yet, epollSelect() looks at it again
+ * without waiting.
+ */
+static void
+addPending(int ch)
+{
+    if (epfd < 0
+        || channels[ch].events == 0
+        || (channels[ch].ready & CHAN_PENDING))
+        return;
+
+    channels[ch].ready |= CHAN_PENDING;
+    pendList[numPend] = ch;
+    ++numPend;
+}
+
+/* epollSelect()
+ *
+ * The epoll version of chanSelect_(), the cost of a
+ * call depends on the number of active channels only.
+ * Like select() it returns 0 only when the timeout
+ * expires, events that only moved partial messages
+ * are not reported.
+ */
+static int
+epollSelect(struct Masks *chanmask, struct timeval *timeout)
+{
+    struct timeval now;
+    struct timeval end;
+    int nReady;
+    int ms;
+
+    if (timeout) {
+        gettimeofday(&now, NULL);
+        timeradd(&now, timeout, &end);
+    }
+
+    for (;;) {
+
+        ms = -1;
+        if (timeout) {
+            gettimeofday(&now, NULL);
+            ms = 0;
+            if (timercmp(&now, &end, <)) {
+                timersub(&end, &now, &now);
+                ms = now.tv_sec * 1000 + (now.tv_usec + 999)/1000;
+            }
+        }
+
+        nReady = epollPoll(chanmask, ms);
+        if (nReady != 0 || ms == 0)
+            return nReady;
+    }
+}
+
+/* epollPoll()
+ */
+static int
+epollPoll(struct Masks *chanmask, int ms)
+{
+    struct epoll_event *ev;
+    int nEvents;
+    int nReady;
+    int ch;
+    int cc;
+    int i;
+    int n;
+
+    if (numPend > 0)
+        ms = 0;
+
+    nEvents = epoll_wait(epfd, epEvents, MAX_EPOLL_EVENTS, ms);
+    if (nEvents < 0)
+        return -1;
+
+    if (nEvents == 0 && numPend == 0)
+        return 0;
+
+    CHAN_ZERO(&chanmask->rmask);
+    CHAN_ZERO(&chanmask->wmask);
+    CHAN_ZERO(&chanmask->emask);
+
+    nReady = 0;
+    for (i = 0; i < nEvents; i++) {
+
+        ev = &epEvents[i];
+        ch = ev->data.fd;
+        if (channels[ch].events == 0)
+            continue;
+
+        if (ev->events & EPOLLPRI) {
+            ls_syslog(LOG_DEBUG, "\
+%s: setting error mask for channel %d", __func__, channels[ch].handle);
+            CHAN_SET(ch, &chanmask->emask);
+            ++nReady;
+            continue;
+        }
+
+        if (ev->events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            channels[ch].ready |= CHAN_RREADY;
+        if (ev->events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+            channels[ch].ready |= CHAN_WREADY;
+
+        addPending(ch);
+    }
+
+    /* Channels put back on the list while we
+     * go through it land behind the cursor.
+     */
+    n = numPend;
+    numPend = 0;
+    for (i = 0; i < n; i++) {
+
+        ch = pendList[i];
+        channels[ch].ready &= ~CHAN_PENDING;
+
+        if (channels[ch].events == 0
+            || CHAN_ISSET(ch, &chanmask->emask))
+            continue;
+
+        if (!(channels[ch].events & EPOLLET)
+            && channels[ch].state != CH_PRECONN
+            && (!channels[ch].send || !channels[ch].recv)) {
+
+            if (channels[ch].ready & CHAN_RREADY) {
+                CHAN_SET(ch, &chanmask->rmask);
+                ++nReady;
+            }
+            if (channels[ch].ready & CHAN_WREADY)
+                CHAN_SET(ch, &chanmask->wmask);
+            channels[ch].ready = 0;
+            continue;
+        }
+
+        if (channels[ch].state == CH_PRECONN) {
+
+            if (!(channels[ch].ready & CHAN_WREADY))
+                continue;
+
+            channels[ch].state = CH_CONN;
+            channels[ch].send  = newBuf();
+            channels[ch].recv  = newBuf();
+            CHAN_SET(ch, &chanmask->wmask);
+            ++nReady;
+            if (!channels[ch].send || !channels[ch].recv) {
+                CHAN_SET(ch, &chanmask->emask);
+                channels[ch].chanerr = LSE_MALLOC;
+                continue;
+            }
+        }
+
+        if (channels[ch].ready & CHAN_RREADY) {
+            do {
+                cc = doread(ch, chanmask);
+            } while (cc > 0
+                     && (channels[ch].events & EPOLLET)
+                     && (channels[ch].ready & CHAN_RREADY)
+                     && !CHAN_ISSET(ch, &chanmask->rmask)
+                     && !CHAN_ISSET(ch, &chanmask->emask));
+
+            if (CHAN_ISSET(ch, &chanmask->rmask)
+                || CHAN_ISSET(ch, &chanmask->emask))
+                ++nReady;
+        }
+
+        if (channels[ch].ready & CHAN_WREADY) {
+            do {
+                cc = dowrite(ch, chanmask);
+            } while (cc > 0
+                     && (channels[ch].events & EPOLLET)
+                     && channels[ch].send->forw != channels[ch].send);
+        }
+        CHAN_SET(ch, &chanmask->wmask);
+
+        if (!(channels[ch].events & EPOLLET)) {
+            channels[ch].ready = 0;
+            chanWatch(ch);
+            continue;
+        }
+
+        if (CHAN_ISSET(ch, &chanmask->emask))
+            continue;
+
+        /* A complete message goes back on the list
+         * when the caller dequeues it.
+         */
+        if ((channels[ch].ready & CHAN_RREADY)
+            && !CHAN_ISSET(ch, &chanmask->rmask))
+            addPending(ch);
+
+        if ((channels[ch].ready & CHAN_WREADY)
+            && channels[ch].send->forw != channels[ch].send)
+            addPending(ch);
+    }
+
+    return nReady;
+}
+
+/* readNoWait()
+ *
+ * Edge triggered channels drain the socket until
+ * EAGAIN, daemons may have put the socket back in
+ * blocking mode with io_block_() so never wait here.
+ */
+static ssize_t
+readNoWait(int s, void *buf, size_t len)
+{
+    ssize_t cc;
+
+    cc = recv(s, buf, len, MSG_DONTWAIT);
+    if (cc < 0 && errno == ENOTSOCK)
+        return read(s, buf, len);
+
+    return cc;
+}
+
+/* writeNoWait()
+ */
+static ssize_t
+writeNoWait(int s, const void *buf, size_t len)
+{
+    ssize_t cc;
+
+    cc = send(s, buf, len, MSG_DONTWAIT);
+    if (cc < 0 && errno == ENOTSOCK)
+        return write(s, buf, len);
+
+    return cc;
+}
+
+#endif /* CHAN_EPOLL */
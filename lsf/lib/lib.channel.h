@@ -62,12 +62,35 @@ struct Buffer {
     int stashed;
 };
 
+/* Channel masks are indexed by channel number,
+ * unlike fd_set they are not bound by FD_SETSIZE
+ * so a daemon can serve more than 1024 clients.
+ */
+#define CHAN_SETSIZE  65536
+#define CHAN_NBITS    (8 * sizeof(unsigned int))
+
+struct chanSet {
+    unsigned int bits[CHAN_SETSIZE/CHAN_NBITS];
+};
+
+#define CHAN_ZERO(s)     memset((s), 0, sizeof(struct chanSet))
+#define CHAN_SET(c, s)   ((s)->bits[(c)/CHAN_NBITS] |= 1U << ((c) % CHAN_NBITS))
+#define CHAN_CLR(c, s)   ((s)->bits[(c)/CHAN_NBITS] &= ~(1U << ((c) % CHAN_NBITS)))
+#define CHAN_ISSET(c, s) ((s)->bits[(c)/CHAN_NBITS] & (1U << ((c) % CHAN_NBITS)))
+
 struct Masks {
-    fd_set rmask;
-    fd_set wmask;
-    fd_set emask;
+    struct chanSet rmask;
+    struct chanSet wmask;
+    struct chanSet emask;
 };
 
+/* Readiness remembered between edges
+ * by the epoll backend.
+ */
+#define CHAN_RREADY   0x01
+#define CHAN_WREADY   0x02
+#define CHAN_PENDING  0x04
+
 
 struct chanData {
     int  handle;
@@ -77,7 +100,9 @@ struct chanData {
     int chanerr;
     struct Buffer *send;
     struct Buffer *recv;
-
+    struct Buffer *hold;
+    int events;
+    int ready;
 };
 
 #define  CHANE_NOERR      0
@@ -124,6 +149,8 @@ int chanFreeBuf_(struct Buffer *);
 int chanFreeStashedBuf_(struct Buffer *);
 int chanOpenSock_(int , int);
 int chanSetMode_(int, int);
+int chanHold_(int);
+int chanRelease_(int);
 
 extern int chanIndex;
 extern int cherrno;
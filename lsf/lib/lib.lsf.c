@@ -230,22 +230,78 @@ ls_time(time_t t)
  */
 
 /* ls_get_cpu_info()
+ *
+ * The CPUs of this host and the NUMA node
+ * each of them is on, node 0 if the kernel
+ * has no NUMA information.
  */
 struct infoCPUs *
 ls_get_cpu_info(int *n)
 {
     struct infoCPUs *array_cpus;
+    struct dirent *dp;
+    DIR *dir;
+    FILE *fp;
+    char file[PATH_MAX];
+    char buf[BUFSIZ];
+    char *p;
+    int node;
+    int c0;
+    int c1;
     int i;
 
     *n = ls_get_numcpus();
 
-    if (*n == 0)
+    if (*n <= 0)
         return NULL;
 
     array_cpus = calloc(*n, sizeof(struct infoCPUs));
+    if (array_cpus == NULL)
+        return NULL;
+
     for (i = 0; i < *n; i++)
         array_cpus[i].numCPU = i;
 
+    if ((dir = opendir("/sys/devices/system/node")) == NULL)
+        return array_cpus;
+
+    while ((dp = readdir(dir))) {
+
+        if (sscanf(dp->d_name, "node%d", &node) != 1)
+            continue;
+
+        sprintf(file, "/sys/devices/system/node/%.64s/cpulist", dp->d_name);
+        if ((fp = fopen(file, "r")) == NULL)
+            continue;
+        if (fgets(buf, sizeof(buf), fp) == NULL) {
+            fclose(fp);
+            continue;
+        }
+        fclose(fp);
+
+        /* The list is like 0-3,8-11
+         */
+        p = buf;
+        while (sscanf(p, "%d", &c0) == 1) {
+            c1 = c0;
+            while (*p >= '0' && *p <= '9')
+                ++p;
+            if (*p == '-') {
+                ++p;
+                if (sscanf(p, "%d", &c1) != 1)
+                    break;
+                while (*p >= '0' && *p <= '9')
+                    ++p;
+            }
+            for (i = c0; i <= c1 && i < *n; i++)
+                array_cpus[i].numNode = node;
+            if (*p != ',')
+                break;
+            ++p;
+        }
+    }
+    closedir(dir);
+
     return array_cpus;
 }
 
@@ -270,9 +326,6 @@ ls_get_numcpus(void)
             ++n;
     }
 
-    if (n == 0)
-        return false;
-
     fclose(fp);
     return n;
 }
@@ -459,3 +512,359 @@ lsb_rmcgroup_mem(const char *job_id,  pid_t pid)
 
     return 0;
 }
+
+/* Here come the cgroup v2 functions. Each job gets
+ * its own cgroup OL_CGROUP_ROOT/openlava/<job_id> in
+ * the unified hierarchy, its limits and its usage
+ * are in the files of that one directory.
+ */
+#define CGROUP2_CPU_PERIOD  100000
+
+static int cgroup2_write(const char *, const char *, const char *);
+static int cgroup2_read(const char *, const char *, char *, int);
+static long long cgroup2_key(const char *, const char *);
+static int cgroup2_pids(const char *, struct jRusage *, int *);
+
+/* ls_cgroup2()
+ *
+ * OL_CGROUP_ROOT is a cgroup v2 mount if it
+ * has the cgroup.controllers file.
+ */
+bool_t
+ls_cgroup2(void)
+{
+    char buf[PATH_MAX];
+    char *root;
+
+    root = genParams_[OL_CGROUP_ROOT].paramValue;
+    if (root == NULL)
+        return false;
+
+    sprintf(buf, "%s/cgroup.controllers", root);
+    if (access(buf, R_OK) < 0)
+        return false;
+
+    return true;
+}
+
+/* lsb_constrain_cgroup2()
+ *
+ * Create the cgroup of the job and move pid in it.
+ * The memory limit is in bytes, ncpus sets cpu.max
+ * to that many CPUs worth of time and cpus is a
+ * cpuset list like 0-3,8. Limits that are RLIM_INFINITY,
+ * 0 or NULL are not set.
+ */
+int
+lsb_constrain_cgroup2(const char *job_id,
+                      pid_t pid,
+                      unsigned long long mem_limit,
+                      int ncpus,
+                      const char *cpus)
+{
+    static char *ctrl[] = {"+cpu", "+cpuset", "+memory", "+io", NULL};
+    static int warned;
+    char buf[PATH_MAX];
+    char val[64];
+    char *root;
+    int cc;
+    int i;
+
+    root = genParams_[OL_CGROUP_ROOT].paramValue;
+    if (root == NULL)
+        return 0;
+
+    if (job_id == NULL)
+        return -1;
+
+    /* Enable the controllers one at the time
+     * so one the kernel does not have does not
+     * stop the others. A failure is logged once,
+     * the limits of that controller fail below.
+     */
+    sprintf(buf, "%s/openlava", root);
+    if (mkdir(buf, 0755) < 0 && errno != EEXIST)
+        return -1;
+
+    for (i = 0; ctrl[i] != NULL; i++) {
+        if ((cgroup2_write(root, "cgroup.subtree_control", ctrl[i]) < 0
+             || cgroup2_write(buf, "cgroup.subtree_control", ctrl[i]) < 0)
+            && !(warned & (1 << i))) {
+            ls_syslog(LOG_WARNING, "\
+%s: cannot enable controller %s under %s: %m", __func__,
+                      ctrl[i] + 1, buf);
+            warned |= 1 << i;
+        }
+    }
+
+    sprintf(buf, "%s/openlava/%s", root, job_id);
+    if (mkdir(buf, 0755) < 0 && errno != EEXIST)
+        return -1;
+
+    cc = 0;
+    if (mem_limit > 0 && mem_limit != RLIM_INFINITY) {
+        sprintf(val, "%llu", mem_limit);
+        if (cgroup2_write(buf, "memory.max", val) < 0)
+            cc = -1;
+    }
+
+    if (ncpus > 0) {
+        sprintf(val, "%d %d", ncpus * CGROUP2_CPU_PERIOD, CGROUP2_CPU_PERIOD);
+        if (cgroup2_write(buf, "cpu.max", val) < 0)
+            cc = -1;
+    }
+
+    if (cpus != NULL
+        && cgroup2_write(buf, "cpuset.cpus", cpus) < 0)
+        cc = -1;
+
+    sprintf(val, "%d", pid);
+    if (cgroup2_write(buf, "cgroup.procs", val) < 0)
+        return -1;
+
+    return cc;
+}
+
+/* lsb_cgroup2_rusage()
+ *
+ * Read the usage of the job from its cgroup. The
+ * CPU and memory come from cpu.stat and memory.current
+ * and count the processes that left the process group
+ * of the job, the pids are listed from cgroup.procs
+ * without reading /proc. Their parents and groups are
+ * not known, npgids is 0 and the caller fills them in.
+ * The returned structure is static, the memory is the
+ * working set, that is memory.current less the
+ * inactive file cache.
+ */
+struct jRusage *
+lsb_cgroup2_rusage(const char *job_id, struct cgroupUsage *cu)
+{
+    static struct jRusage jru;
+    static int maxPids;
+    char dir[PATH_MAX];
+    char file[PATH_MAX + 32];
+    char buf[256];
+    char *root;
+    long long mem;
+    long long x;
+
+    root = genParams_[OL_CGROUP_ROOT].paramValue;
+    if (root == NULL || job_id == NULL)
+        return NULL;
+
+    sprintf(dir, "%s/openlava/%s", root, job_id);
+
+    if (cgroup2_read(dir, "memory.current", buf, sizeof(buf)) < 0)
+        return NULL;
+    mem = atoll(buf);
+
+    jru.mem = jru.swap = jru.utime = jru.stime = 0;
+    cu->memCurrent = mem;
+
+    sprintf(file, "%s/memory.stat", dir);
+    if ((x = cgroup2_key(file, "inactive_file")) > 0 && x < mem)
+        mem -= x;
+    jru.mem = mem / 1024;
+
+    cu->memPeak = -1;
+    if (cgroup2_read(dir, "memory.peak", buf, sizeof(buf)) == 0)
+        cu->memPeak = atoll(buf);
+
+    if (cgroup2_read(dir, "memory.swap.current", buf, sizeof(buf)) == 0)
+        jru.swap = atoll(buf) / 1024;
+
+    sprintf(file, "%s/cpu.stat", dir);
+    cu->usageUsec = cgroup2_key(file, "usage_usec");
+    if ((x = cgroup2_key(file, "user_usec")) > 0)
+        jru.utime = x / 1000000;
+    if ((x = cgroup2_key(file, "system_usec")) > 0)
+        jru.stime = x / 1000000;
+
+    sprintf(file, "%s/io.stat", dir);
+    cu->rbytes = cgroup2_key(file, "rbytes");
+    cu->wbytes = cgroup2_key(file, "wbytes");
+
+    if (cgroup2_pids(dir, &jru, &maxPids) < 0)
+        return NULL;
+
+    return &jru;
+}
+
+/* lsb_rmcgroup2()
+ *
+ * Kill what is left in the job cgroup and remove it,
+ * the kernel takes a moment to empty it so try a few
+ * times before giving up.
+ */
+int
+lsb_rmcgroup2(const char *job_id)
+{
+    char buf[PATH_MAX];
+    char *root;
+    int i;
+
+    root = genParams_[OL_CGROUP_ROOT].paramValue;
+    if (root == NULL)
+        return 0;
+
+    sprintf(buf, "%s/openlava/%s", root, job_id);
+    if (access(buf, F_OK) < 0)
+        return 0;
+
+    for (i = 0; i < 10; i++) {
+
+        if (rmdir(buf) == 0 || errno == ENOENT)
+            return 0;
+
+        if (errno != EBUSY)
+            return -1;
+
+        if (i == 0
+            && cgroup2_write(buf, "cgroup.kill", "1") < 0) {
+            struct jRusage jru;
+            int maxPids;
+            int n;
+
+            /* Kernels before 5.14 have no cgroup.kill
+             */
+            memset(&jru, 0, sizeof(struct jRusage));
+            maxPids = 0;
+            if (cgroup2_pids(buf, &jru, &maxPids) == 0) {
+                for (n = 0; n < jru.npids; n++)
+                    kill(jru.pidInfo[n].pid, SIGKILL);
+                FREEUP(jru.pidInfo);
+            }
+        }
+        millisleep_(10);
+    }
+
+    return -1;
+}
+
+static int
+cgroup2_write(const char *dir, const char *file, const char *val)
+{
+    char buf[PATH_MAX];
+    int fd;
+    int cc;
+
+    sprintf(buf, "%s/%s", dir, file);
+    if ((fd = open(buf, O_WRONLY)) < 0)
+        return -1;
+
+    cc = write(fd, val, strlen(val));
+    close(fd);
+
+    return (cc < 0) ? -1 : 0;
+}
+
+static int
+cgroup2_read(const char *dir, const char *file, char *val, int len)
+{
+    char buf[PATH_MAX];
+    int fd;
+    int cc;
+
+    sprintf(buf, "%s/%s", dir, file);
+    if ((fd = open(buf, O_RDONLY)) < 0)
+        return -1;
+
+    cc = read(fd, val, len - 1);
+    close(fd);
+
+    if (cc <= 0)
+        return -1;
+    val[cc] = 0;
+
+    return 0;
+}
+
+/* cgroup2_key()
+ *
+ * Sum the values of key in a flat keyed file like
+ * cpu.stat or memory.stat, or in a nested keyed file
+ * like io.stat where there is a line per device with
+ * key=value fields. Return -1 if the key is not there.
+ */
+static long long
+cgroup2_key(const char *file, const char *key)
+{
+    FILE *fp;
+    char buf[512];
+    char *p;
+    char *q;
+    long long sum;
+    int l;
+
+    if ((fp = fopen(file, "r")) == NULL)
+        return -1;
+
+    l = strlen(key);
+    sum = -1;
+    while (fgets(buf, sizeof(buf), fp)) {
+
+        for (p = strtok(buf, " \n"); p; p = strtok(NULL, " \n")) {
+
+            if (strncmp(p, key, l) != 0)
+                continue;
+
+            q = p + l;
+            if (*q == '=') {
+                ++q;
+            } else if (*q == 0) {
+                if ((q = strtok(NULL, " \n")) == NULL)
+                    break;
+            } else {
+                continue;
+            }
+
+            if (sum < 0)
+                sum = 0;
+            sum += atoll(q);
+            break;
+        }
+    }
+
+    fclose(fp);
+    return sum;
+}
+
+/* cgroup2_pids()
+ *
+ * Fill the process list of jru from the cgroup.procs
+ * of the job, the list grows as needed and maxPids is
+ * its size. Only the pids are known, the rest of each
+ * entry is 0 and there are no process groups.
+ */
+static int
+cgroup2_pids(const char *dir, struct jRusage *jru, int *maxPids)
+{
+    struct pidInfo *pinfo;
+    char buf[PATH_MAX];
+    FILE *fp;
+    int pid;
+
+    sprintf(buf, "%s/cgroup.procs", dir);
+    if ((fp = fopen(buf, "r")) == NULL)
+        return -1;
+
+    jru->npids = jru->npgids = 0;
+    while (fscanf(fp, "%d", &pid) == 1) {
+
+        if (jru->npids == *maxPids) {
+            pinfo = realloc(jru->pidInfo,
+                            (*maxPids + 64) * sizeof(struct pidInfo));
+            if (pinfo == NULL)
+                break;
+            jru->pidInfo = pinfo;
+            *maxPids += 64;
+        }
+        pinfo = &jru->pidInfo[jru->npids++];
+        memset(pinfo, 0, sizeof(struct pidInfo));
+        pinfo->pid = pid;
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -23,6 +23,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <sys/mman.h>
 #include "../lsf.h"
 #include "lproto.h"
 
@@ -55,6 +56,11 @@ static int *pgidList = NULL;
 static int hitPGid = 0;
 static char *pimInfoBuf = NULL;
 static long pimInfoLen;
+static char pimTabFile[MAXFILENAMELEN];
+static struct pimTable *pimTab;
+static size_t pimTabSize;
+static dev_t pimTabDev;
+static ino_t pimTabIno;
 
 static int pimPort(struct sockaddr_in *, char *);
 static struct jRusage *readPIMInfo(int, int *);
@@ -64,6 +70,9 @@ static FILE *openPIMFile(char *pfile);
 static int readPIMFile(char *);
 static char *getNextString(char *,char *);
 static char *readPIMBuf(char *);
+static int mapPIMTable(void);
+static void unmapPIMTable(void);
+static int readPIMTable(void);
 
 static int argOptions;
 
@@ -128,6 +137,14 @@ struct jRusage *getJInfo_(int npgid, int *pgid, int options, int cpgid)
 	    }
 	}
 
+	if (snprintf(pimTabFile, sizeof(pimTabFile), "%s.tab", pfile)
+	    >= (int)sizeof(pimTabFile)) {
+	    if (logclass & LC_PIM)
+		ls_syslog(LOG_DEBUG, "%s: %s.tab is too long, not used",
+			  fname, pfile);
+	    pimTabFile[0] = '\0';
+	}
+
 	if (pimParams[LSF_PIM_SLEEPTIME].paramValue) {
 	    if ((pimSleepTime =
 		 atoi(pimParams[LSF_PIM_SLEEPTIME].paramValue)) < 0) {
@@ -177,6 +194,10 @@ struct jRusage *getJInfo_(int npgid, int *pgid, int options, int cpgid)
 		ls_syslog(LOG_DEBUG, "%s: b_connect() failed: %m", fname);
 	    lserrno = LSE_CONN_SYS;
 	    close(s);
+	    /* pim may have been restarted, take its
+	     * port from the table again next time.
+	     */
+	    unmapPIMTable();
 	    return NULL;
 	}
 
@@ -223,7 +244,8 @@ struct jRusage *getJInfo_(int npgid, int *pgid, int options, int cpgid)
 	}
         if (logclass & LC_PIM)
 	    ls_syslog(LOG_DEBUG,"%s updated now",fname);
-	if (!readPIMFile(pfile)) {
+	if (readPIMTable() < 0
+	    && !readPIMFile(pfile)) {
 		ls_syslog(LOG_ERR, I18N_FUNC_FAIL,  fname, "readPIMFile");
 		return NULL;
 	}
@@ -569,6 +591,11 @@ pimPort(struct sockaddr_in *pimAddr, char *pfile)
     FILE *fp;
     int port;
 
+    if (mapPIMTable() == 0) {
+	pimAddr->sin_port = htons(pimTab->port);
+	return 0;
+    }
+
     if ((fp = openPIMFile(pfile)) == NULL)
 	return -1;
 
@@ -600,3 +627,137 @@ openPIMFile(char *pfile)
     return (fp);
 }
 
+/* mapPIMTable()
+ *
+ * Map the process table of pim, again if pim
+ * replaced it or a new pim created another one.
+ * -1 if there is none, pim does not publish it
+ * on all platforms.
+ */
+static int
+mapPIMTable(void)
+{
+    struct pimTable *t;
+    struct stat st;
+    int fd;
+
+    if (pimTab
+	&& !pimTab->stale
+	&& stat(pimTabFile, &st) == 0
+	&& st.st_dev == pimTabDev
+	&& st.st_ino == pimTabIno)
+	return 0;
+
+    unmapPIMTable();
+
+    if (pimTabFile[0] == '\0'
+	|| (fd = open(pimTabFile, O_RDONLY)) < 0)
+	return -1;
+
+    if (fstat(fd, &st) < 0
+	|| st.st_size < (off_t)sizeof(struct pimTable)) {
+	close(fd);
+	return -1;
+    }
+
+    t = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (t == MAP_FAILED)
+	return -1;
+
+    if (t->magic != PIM_TABLE_MAGIC
+	|| t->version != PIM_TABLE_VERSION
+	|| sizeof(struct pimTable)
+	   + t->maxProcs * sizeof(struct pimProcEnt) > (size_t)st.st_size) {
+	if (logclass & LC_PIM)
+	    ls_syslog(LOG_DEBUG, "%s: %s is not a process table",
+		      __func__, pimTabFile);
+	munmap(t, st.st_size);
+	return -1;
+    }
+
+    pimTab = t;
+    pimTabSize = st.st_size;
+    pimTabDev = st.st_dev;
+    pimTabIno = st.st_ino;
+
+    return 0;
+}
+
+static void
+unmapPIMTable(void)
+{
+    if (pimTab == NULL)
+	return;
+
+    munmap(pimTab, pimTabSize);
+    pimTab = NULL;
+}
+
+/* readPIMTable()
+ *
+ * Copy the processes from the table, retry
+ * while pim is updating it.
+ */
+static int
+readPIMTable(void)
+{
+    struct lsPidInfo *tmp;
+    struct pimProcEnt *e;
+    unsigned int seq;
+    int numProcs;
+    int i;
+    int n;
+
+    for (n = 0; n < 1000; n++) {
+
+	if (mapPIMTable() < 0)
+	    return -1;
+
+	seq = pimTab->seq;
+	__sync_synchronize();
+	if (seq & 1) {
+	    millisleep_(1);
+	    continue;
+	}
+
+	numProcs = pimTab->numProcs;
+	if (numProcs < 0 || numProcs > pimTab->maxProcs)
+	    continue;
+
+	if (pinfoList == NULL || numProcs > npinfoList) {
+	    tmp = realloc(pinfoList, (numProcs + MAX_NUM_PID)
+			  * sizeof(struct lsPidInfo));
+	    if (tmp == NULL) {
+		ls_syslog(LOG_ERR, I18N_FUNC_D_FAIL_M, __func__, "realloc",
+			  (numProcs + MAX_NUM_PID) * sizeof(struct lsPidInfo));
+		return -1;
+	    }
+	    pinfoList = tmp;
+	}
+
+	for (i = 0; i < numProcs; i++) {
+	    e = &pimTab->procs[i];
+	    pinfoList[i].pid = e->pid;
+	    pinfoList[i].ppid = e->ppid;
+	    pinfoList[i].pgid = e->pgid;
+	    pinfoList[i].jobid = e->jobid;
+	    pinfoList[i].utime = e->utime;
+	    pinfoList[i].stime = e->stime;
+	    pinfoList[i].cutime = e->cutime;
+	    pinfoList[i].cstime = e->cstime;
+	    pinfoList[i].proc_size = e->proc_size;
+	    pinfoList[i].resident_size = e->resident_size;
+	    pinfoList[i].stack_size = e->stack_size;
+	    pinfoList[i].status = e->status;
+	}
+	__sync_synchronize();
+
+	if (seq == pimTab->seq && !pimTab->stale) {
+	    npinfoList = numProcs;
+	    return 0;
+	}
+    }
+
+    return -1;
+}
@@ -48,6 +48,42 @@ struct lsPidInfo {
     char command[PATH_MAX];
 };
 
+/* The process table pim publishes in the file
+ * <pim info file>.tab. pim bumps seq before and
+ * after an update, odd while updating. When the
+ * table grows pim renames a larger one in place
+ * and sets stale in the old one.
+ */
+#define PIM_TABLE_MAGIC   0x50494d54
+#define PIM_TABLE_VERSION 1
+
+struct pimProcEnt {
+    int pid;
+    int ppid;
+    int pgid;
+    int jobid;
+    int utime;
+    int stime;
+    int cutime;
+    int cstime;
+    int proc_size;
+    int resident_size;
+    int stack_size;
+    int status;
+};
+
+struct pimTable {
+    unsigned int magic;
+    unsigned int version;
+    volatile unsigned int seq;
+    volatile int stale;
+    int port;
+    int maxProcs;
+    int numProcs;
+    int updateTime;
+    struct pimProcEnt procs[];
+};
+
 #define PIM_API_TREAT_JID_AS_PGID 0x1
 #define PIM_API_UPDATE_NOW        0x2
 
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+#include "lim.h"
+
+/* Two level load collection.
+ *
+ * The hosts listed in LSF_LIM_AGGREGATORS collect the
+ * load updates of the other hosts and forward them to
+ * the master packed in one message per exchange
+ * interval. They also relay the master announcement
+ * to their hosts, so the master announces to the
+ * aggregators only. A host reports to the aggregator
+ * hostNo modulo the number of aggregators, if it stops
+ * hearing from it the host reports to the master
+ * directly and the master announces to it again.
+ */
+int aggrInactivityCount;
+
+static struct hostNode **aggrList;
+static int numAggr;
+
+/* Load updates waiting to be forwarded,
+ * aggrCountPos is where their number goes.
+ */
+static char aggrBuf[MSGSIZE];
+static XDR aggrXdrs;
+static u_int aggrCountPos;
+static int numAggrLoad;
+
+static int addAggrLoad(u_int, enum loadstruct, void *);
+static void startAggrLoad(void);
+
+/* initAggregators()
+ */
+void
+initAggregators(void)
+{
+    struct hostNode *hPtr;
+    char *sp;
+    char *word;
+    int n;
+
+    if (limParams[LSF_LIM_AGGREGATORS].paramValue == NULL)
+        return;
+
+    n = 0;
+    for (hPtr = myClusterPtr->hostList; hPtr; hPtr = hPtr->nextPtr)
+        ++n;
+
+    aggrList = calloc(n, sizeof(struct hostNode *));
+    if (aggrList == NULL) {
+        ls_syslog(LOG_ERR, "%s: calloc() failed %m", __func__);
+        return;
+    }
+
+    sp = limParams[LSF_LIM_AGGREGATORS].paramValue;
+    while ((word = getNextWord_(&sp)) != NULL) {
+
+        hPtr = findHostbyList(myClusterPtr->hostList, word);
+        if (hPtr == NULL) {
+            ls_syslog(LOG_ERR, "\
+%s: aggregator %s is not a host of the cluster, ignored",
+                      __func__, word);
+            continue;
+        }
+        if (hPtr->isAggr)
+            continue;
+
+        hPtr->isAggr = TRUE;
+        aggrList[numAggr] = hPtr;
+        ++numAggr;
+    }
+
+    if (numAggr == 0) {
+        FREEUP(aggrList);
+        return;
+    }
+
+    for (hPtr = myClusterPtr->hostList; hPtr; hPtr = hPtr->nextPtr) {
+        if (hPtr->isAggr)
+            continue;
+        hPtr->aggrPtr = aggrList[hPtr->hostNo % numAggr];
+    }
+
+    ls_syslog(LOG_INFO, "%s: %d load aggregators configured",
+              __func__, numAggr);
+}
+
+/* loadAggregator()
+ *
+ * The host this LIM sends its load to instead of
+ * the master, NULL if the load goes to the master.
+ * Probes of the master always go to the master.
+ */
+struct hostNode *
+loadAggregator(void)
+{
+    struct hostNode *aggrPtr;
+
+    aggrPtr = myHostPtr->aggrPtr;
+    if (aggrPtr == NULL
+        || aggrPtr == myClusterPtr->masterPtr)
+        return NULL;
+
+    if (aggrInactivityCount > retryLimit
+        || myClusterPtr->masterInactivityCount > hostInactivityLimit)
+        return NULL;
+
+    return aggrPtr;
+}
+
+/* aggrLoad()
+ *
+ * Decode a load update sent to this aggregator and
+ * queue it for the master.
+ */
+void
+aggrLoad(XDR *xdrs,
+         struct sockaddr_in *from,
+         struct LSFHeader *hdr,
+         enum loadstruct loadType)
+{
+    static struct loadVectorStruct *vec;
+    static struct loadDeltaStruct *delta;
+    struct hostNode *hPtr;
+    void *load;
+    u_int addr;
+
+    if (vec == NULL) {
+        vec = calloc(1, sizeof(struct loadVectorStruct));
+        vec->li = calloc(allInfo.numIndx, sizeof(float));
+        vec->status = calloc(1 + GET_INTNUM(allInfo.numIndx), sizeof(int));
+        delta = calloc(1, sizeof(struct loadDeltaStruct));
+        delta->status = calloc(1 + GET_INTNUM(allInfo.numIndx),
+                               sizeof(int));
+        delta->indx = calloc(allInfo.numIndx, sizeof(int));
+        delta->li = calloc(allInfo.numIndx, sizeof(float));
+    }
+
+    if (!myClusterPtr->masterKnown)
+        return;
+
+    hPtr = findHostbyAddr(from, (char *)__func__);
+    if (hPtr == NULL) {
+        ls_syslog(LOG_ERR, "\
+%s: Received load update from unknown host %s",
+                  __func__, sockAdd2Str_(from));
+        return;
+    }
+
+    if (loadType == e_vec) {
+        if (!xdr_loadvector(xdrs, vec, hdr)) {
+            ls_syslog(LOG_ERR, "\
+%s: Error in xdr_loadvector from %s", __func__, sockAdd2Str_(from));
+            return;
+        }
+        load = vec;
+    } else if (loadType == e_delta) {
+        if (!xdr_loaddelta(xdrs, delta, hdr)) {
+            ls_syslog(LOG_ERR, "\
+%s: Error in xdr_loaddelta from %s", __func__, sockAdd2Str_(from));
+            return;
+        }
+        load = delta;
+    } else {
+        ls_syslog(LOG_ERR, "\
+%s: Invalid load type %d from host %s",
+                  __func__, loadType, sockAdd2Str_(from));
+        return;
+    }
+
+    memcpy(&addr, &from->sin_addr.s_addr, sizeof(in_addr_t));
+
+    if (addAggrLoad(addr, loadType, load) < 0) {
+        flushAggrLoad();
+        if (addAggrLoad(addr, loadType, load) < 0)
+            ls_syslog(LOG_ERR, "\
+%s: load update from %s does not fit in a message",
+                      __func__, hPtr->hostName);
+    }
+}
+
+static void
+startAggrLoad(void)
+{
+    struct LSFHeader hdr;
+    enum loadstruct loadType;
+
+    xdrmem_create(&aggrXdrs, aggrBuf, MSGSIZE, XDR_ENCODE);
+    initLSFHeader_(&hdr);
+    hdr.opCode = LIM_LOAD_UPD;
+    hdr.refCode = 0;
+    loadType = e_mat;
+    numAggrLoad = 0;
+
+    xdr_LSFHeader(&aggrXdrs, &hdr);
+    xdr_enum(&aggrXdrs, (int *)&loadType);
+    aggrCountPos = XDR_GETPOS(&aggrXdrs);
+    xdr_int(&aggrXdrs, &numAggrLoad);
+}
+
+/* addAggrLoad()
+ *
+ * Each update goes as the address of the host
+ * it comes from, its type and the update itself.
+ */
+static int
+addAggrLoad(u_int addr, enum loadstruct loadType, void *load)
+{
+    struct LSFHeader hdr;
+    u_int pos;
+    bool_t cc;
+
+    if (numAggrLoad == 0)
+        startAggrLoad();
+
+    initLSFHeader_(&hdr);
+    pos = XDR_GETPOS(&aggrXdrs);
+
+    cc = xdr_u_int(&aggrXdrs, &addr)
+        && xdr_enum(&aggrXdrs, (int *)&loadType);
+    if (cc && loadType == e_vec)
+        cc = xdr_loadvector(&aggrXdrs, load, &hdr);
+    else if (cc)
+        cc = xdr_loaddelta(&aggrXdrs, load, &hdr);
+
+    if (!cc) {
+        XDR_SETPOS(&aggrXdrs, pos);
+        return -1;
+    }
+
+    ++numAggrLoad;
+
+    return 0;
+}
+
+/* flushAggrLoad()
+ *
+ * Send the queued load updates to the master.
+ */
+void
+flushAggrLoad(void)
+{
+    struct sockaddr_in toAddr;
+    u_int pos;
+
+    if (numAggrLoad == 0)
+        return;
+
+    pos = XDR_GETPOS(&aggrXdrs);
+    XDR_SETPOS(&aggrXdrs, aggrCountPos);
+    xdr_int(&aggrXdrs, &numAggrLoad);
+    XDR_SETPOS(&aggrXdrs, pos);
+
+    if (myClusterPtr->masterKnown
+        && !masterMe) {
+
+        memset(&toAddr, 0, sizeof(toAddr));
+        toAddr.sin_family = AF_INET;
+        toAddr.sin_port = htons(lim_port);
+        memcpy(&toAddr.sin_addr.s_addr,
+               &myClusterPtr->masterPtr->addr[0],
+               sizeof(in_addr_t));
+
+        if (logclass & LC_COMM)
+            ls_syslog(LOG_DEBUG, "\
+%s: sending %d load updates to %s (len=%d)", __func__,
+                      numAggrLoad, sockAdd2Str_(&toAddr), pos);
+
+        if (chanSendDgram_(limSock, aggrBuf, pos, &toAddr) < 0)
+            ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, __func__,
+                      "chanSendDgram_", sockAdd2Str_(&toAddr));
+    }
+
+    xdr_destroy(&aggrXdrs);
+    numAggrLoad = 0;
+}
+
+/* relayMasterAnn()
+ *
+ * Pass the announcement of the master on to the
+ * hosts of this aggregator, at most once per
+ * exchange interval.
+ */
+void
+relayMasterAnn(struct masterReg *masterReg)
+{
+    static time_t lastRelay;
+    struct masterReg relay;
+    struct sockaddr_in toAddr;
+    struct LSFHeader hdr;
+    struct hostNode *hPtr;
+    char buf[MSGSIZE/4];
+    time_t now;
+    XDR xdrs;
+
+    now = time(NULL);
+    if (now - lastRelay < exchIntvl)
+        return;
+    lastRelay = now;
+
+    memcpy(&relay, masterReg, sizeof(struct masterReg));
+    relay.flags = SEND_NO_INFO;
+
+    xdrmem_create(&xdrs, buf, MSGSIZE/4, XDR_ENCODE);
+    initLSFHeader_(&hdr);
+    hdr.opCode = LIM_MASTER_ANN;
+    hdr.refCode = 0;
+
+    if (!(xdr_LSFHeader(&xdrs, &hdr)
+          && xdr_masterReg(&xdrs, &relay, &hdr))) {
+        ls_syslog(LOG_ERR, "\
+%s: Error in xdr_LSFHeader/xdr_masterReg", __func__);
+        xdr_destroy(&xdrs);
+        return;
+    }
+
+    memset(&toAddr, 0, sizeof(toAddr));
+    toAddr.sin_family = AF_INET;
+
+    for (hPtr = myClusterPtr->hostList; hPtr; hPtr = hPtr->nextPtr) {
+
+        if (hPtr->aggrPtr != myHostPtr
+            || hPtr == myClusterPtr->masterPtr)
+            continue;
+
+        toAddr.sin_port = htons(getLIMPort(hPtr));
+        memcpy(&toAddr.sin_addr, &hPtr->addr[0], sizeof(in_addr_t));
+
+        if (chanSendDgram_(limSock,
+                           buf,
+                           XDR_GETPOS(&xdrs),
+                           &toAddr) < 0)
+            ls_syslog(LOG_ERR, "\
+%s: Failed to relay announce to LIM on %s: %m",
+                      __func__, hPtr->hostName);
+    }
+
+    xdr_destroy(&xdrs);
+}
+
+/* aggrRelays()
+ *
+ * Whether the master can leave the announcement to
+ * the host to its aggregator, the host must be
+ * reporting through the aggregator and the aggregator
+ * must be up.
+ */
+int
+aggrRelays(struct hostNode *hPtr)
+{
+    struct hostNode *aggrPtr;
+
+    aggrPtr = hPtr->aggrPtr;
+    if (!hPtr->viaAggr
+        || aggrPtr == NULL
+        || aggrPtr == myHostPtr)
+        return FALSE;
+
+    if (aggrPtr->infoValid != TRUE
+        || LS_ISUNAVAIL(aggrPtr->status))
+        return FALSE;
+
+    return TRUE;
+}
+
+/* announceAggregators()
+ *
+ * The master announces itself to the aggregators at
+ * every call of announceMaster() so that they can
+ * relay the announcement every exchange interval.
+ */
+void
+announceAggregators(char *buf, int len)
+{
+    struct sockaddr_in toAddr;
+    int i;
+
+    memset(&toAddr, 0, sizeof(toAddr));
+    toAddr.sin_family = AF_INET;
+
+    for (i = 0; i < numAggr; i++) {
+
+        if (aggrList[i] == myHostPtr
+            || aggrList[i]->infoValid != TRUE)
+            continue;
+
+        toAddr.sin_port = htons(getLIMPort(aggrList[i]));
+        memcpy(&toAddr.sin_addr, &aggrList[i]->addr[0], sizeof(in_addr_t));
+
+        if (chanSendDgram_(limSock, buf, len, &toAddr) < 0)
+            ls_syslog(LOG_ERR, "\
+%s: Failed to send announce to LIM on %s: %m",
+                      __func__, aggrList[i]->hostName);
+    }
+}
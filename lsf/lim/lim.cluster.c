@@ -46,7 +46,7 @@ clientIO(struct Masks *chanmasks)
         if (i == limSock || i == limTcpSock)
             continue;
 
-        if (FD_ISSET(i, &chanmasks->emask)) {
+        if (CHAN_ISSET(i, &chanmasks->emask)) {
 
             if (clientMap[i])
                 ls_syslog(LOG_ERR, "\
@@ -57,7 +57,7 @@ clientIO(struct Masks *chanmasks)
             continue;
         }
 
-        if (FD_ISSET(i, &chanmasks->rmask)) {
+        if (CHAN_ISSET(i, &chanmasks->rmask)) {
             processMsg(i);
         }
     }
@@ -129,6 +129,9 @@ struct hostNode {
     struct  hostNode *nextPtr;
     time_t  expireTime;
     uint8_t migrant;
+    char    isAggr;
+    char    viaAggr;
+    struct  hostNode *aggrPtr;
 };
 
 #define CLUST_ACTIVE		0x00010000
@@ -229,6 +232,27 @@ struct loadVectorStruct {
     struct resPair *resPairs;
 };
 
+enum loadstruct {e_vec, e_mat, e_delta};
+
+/* Load update carrying only the indices that changed
+ * more than their exchange threshold since the last
+ * update, indx[i] is the index whose value is li[i].
+ */
+struct loadDeltaStruct {
+    int     hostNo;
+    int     *status;
+    u_int   seqNo;
+    int     checkSum;
+    int     flags;
+    int     numIndx;
+    int     numUsrIndx;
+    int     numDelta;
+    int     *indx;
+    float   *li;
+    int     numResPairs;
+    struct resPair *resPairs;
+};
+
 #define MAX_SRES_INDEX	2
 
 struct masterReg {
@@ -334,7 +358,8 @@ typedef enum {
     LIM_COMPUTE_ONLY,
     LSB_SHAREDIR,
     LIM_NO_MIGRANT_HOSTS,
-    LIM_DONT_FORK
+    LIM_DONT_FORK,
+    LSF_LIM_AGGREGATORS
 } limParams_t;
 
 #define LOOP_ADDR       0x7F000001
@@ -376,6 +401,7 @@ extern int defaultRunElim;
 extern time_t lastSbdActiveTime;
 
 extern char mustSendLoad;
+extern char sendFullLoad;
 extern hTab hostModelTbl;
 
 extern char *env_dir;
@@ -479,6 +505,19 @@ extern void initConfInfo(void);
 extern void readLoad(int);
 extern char *getHostModel(void);
 
+/* Two level load collection through
+ * aggregator hosts.
+ */
+extern int aggrInactivityCount;
+extern void initAggregators(void);
+extern struct hostNode *loadAggregator(void);
+extern void aggrLoad(XDR *, struct sockaddr_in *, struct LSFHeader *,
+                     enum loadstruct);
+extern void flushAggrLoad(void);
+extern void relayMasterAnn(struct masterReg *);
+extern int aggrRelays(struct hostNode *);
+extern void announceAggregators(char *, int);
+
 extern void lim_Exit(const char *);
 extern int equivHostAddr(struct hostNode *, u_int);
 extern struct hostNode *findHost(char *);
@@ -496,7 +535,10 @@ extern void errorBack(struct sockaddr_in *, struct LSFHeader *,
                       enum limReplyCode, int);
 extern int initSock(int);
 extern void initLiStruct(void);
+extern struct tclLsInfo *getTclLsInfo(void);
 extern void placeReq(XDR *, struct sockaddr_in *, struct LSFHeader *, int);
+extern enum limReplyCode placeHosts(struct decisionReq *, struct resVal *,
+                                    struct placeReply *);
 extern void loadadjReq(XDR *, struct sockaddr_in *, struct LSFHeader *, int);
 extern void updExtraLoad(struct hostNode **, char *, int);
 extern void loadReq(XDR *, struct sockaddr_in *, struct LSFHeader *,
@@ -512,6 +554,8 @@ extern void reconfig(void);
 extern void shutdownLim(void);
 extern int xdr_loadvector(XDR *, struct loadVectorStruct *,
                           struct LSFHeader *);
+extern int xdr_loaddelta(XDR *, struct loadDeltaStruct *,
+                         struct LSFHeader *);
 extern int xdr_loadmatrix(XDR *, int, struct loadVectorStruct *,
                           struct LSFHeader *);
 extern int xdr_masterReg(XDR *, struct masterReg *, struct LSFHeader *);
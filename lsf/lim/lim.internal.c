@@ -69,6 +69,21 @@ Run lim -C on this host to find more information",
                   __func__, masterReg.hostName);
         return;
     }
+    /* Announce of the master relayed by our aggregator,
+     * it only tells that both are alive.
+     */
+    if (myHostPtr->aggrPtr
+        && !equivHostAddr(hPtr, *(u_int *)&from->sin_addr)
+        && equivHostAddr(myHostPtr->aggrPtr, *(u_int *)&from->sin_addr)) {
+
+        if (myClusterPtr->masterKnown
+            && hPtr == myClusterPtr->masterPtr) {
+            myClusterPtr->masterInactivityCount = 0;
+            aggrInactivityCount = 0;
+        }
+        return;
+    }
+
     /* Regular announce from the master.
      */
     if (myClusterPtr->masterKnown
@@ -92,16 +107,21 @@ Run lim -C on this host to find more information",
 
         hPtr->lastSeqNo = masterReg.seqNo;
         hPtr->statInfo.portno = masterReg.portno;
+        hPtr->protoVersion = reqHdr->version;
 
         if (masterReg.flags & SEND_CONF_INFO)
             sndConfInfo(from);
 
         if (masterReg.flags & SEND_LOAD_INFO) {
             mustSendLoad = TRUE;
+            sendFullLoad = TRUE;
             ls_syslog(LOG_DEBUG, "\
 %s: Master lim is probing me. Send my load in next interval", __func__);
         }
 
+        if (myHostPtr->isAggr)
+            relayMasterAnn(&masterReg);
+
         return;
 
     }
@@ -140,6 +160,7 @@ Run lim -C on this host to find more information",
         myClusterPtr->masterKnown = 1;
         myClusterPtr->masterInactivityCount = 0;
         mustSendLoad = 1;
+        sendFullLoad = TRUE;
 
         if (masterReg.flags | SEND_CONF_INFO)
             sndConfInfo(from);
@@ -376,6 +397,11 @@ announceMaster(struct clusterNode *clPtr, char broadcast, char all)
                 hPtr->callElim = FALSE;
 
             } else {
+                /* The aggregator relays it.
+                 */
+                if (aggrRelays(hPtr))
+                    continue;
+
                 if (chanSendDgram_(limSock,
                                    buf1,
                                    XDR_GETPOS(&xdrs1),
@@ -405,6 +431,9 @@ announceMaster: Failed to send request 1 to LIM on %s: %m", hPtr->hostName);
 
     }
 
+    if (!all)
+        announceAggregators(buf1, XDR_GETPOS(&xdrs1));
+
     xdr_destroy(&xdrs1);
     xdr_destroy(&xdrs2);
     xdr_destroy(&xdrs4);
@@ -529,6 +558,7 @@ initNewMaster(void)
             hPtr->hostInactivityCount = 0;
             hPtr->infoValid = FALSE;
             hPtr->lastSeqNo = 0;
+            hPtr->viaAggr = FALSE;
         }
     }
 
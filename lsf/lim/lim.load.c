@@ -23,7 +23,10 @@
 
 #define NL_SETN 24
 
-enum loadstruct {e_vec, e_mat};
+/* Number of load deltas a slave sends between two
+ * full load vectors.
+ */
+#define FULL_LOAD_PERIOD  10
 
 float  exchIntvl = EXCHINTVL;
 float  sampleIntvl = SAMPLINTVL;
@@ -36,29 +39,34 @@ short  keepTime = KEEPTIME;
 time_t lastSbdActiveTime = 0;
 
 char   mustSendLoad = TRUE;
+char   sendFullLoad = TRUE;
+
+static int numDeltaSent;
+static u_int resSumSent;
 
 extern int maxnLbHost;
 
-static void rcvLoadVector (XDR *, struct sockaddr_in *, struct LSFHeader *);
+static int rcvLoadVector(XDR *, struct sockaddr_in *, struct LSFHeader *, int);
+static int rcvLoadDelta(XDR *, struct sockaddr_in *, struct LSFHeader *, int);
+static void rcvLoadMatrix(XDR *, struct sockaddr_in *, struct LSFHeader *);
+static struct hostNode *loadHost(struct sockaddr_in *, int, int);
+static void copyStatus(struct hostNode *, int *);
 static void copyResValues (struct loadVectorStruct, struct hostNode *);
+static int sendLoadVector(int);
+static int sendLoadDelta(int);
+static int sendLoadBuf(XDR *, char *);
+static int resPairsSize(struct resPair *, int);
+static u_int resPairsSum(struct hostNode *);
 
 void
 sendLoad(void)
 {
     static int noSendCount = 0;
-    struct loadVectorStruct myLoadVector;
-    enum   loadstruct loadType;
     struct hostNode *hPtr;
-    struct sockaddr_in toAddr;
     int    i;
-    int    bufSize;
-    enum   limReqCode limReqCode;
-    XDR    xdrs;
-    char   *repBuf;
+    int    cc;
     int    sendInfo = SEND_NO_INFO;
-    struct LSFHeader reqHdr;
 
-    limReqCode = LIM_LOAD_UPD;
     resInactivityCount++;
 
     if (resInactivityCount > resInactivityLimit)
@@ -121,6 +129,7 @@ sendLoad(void)
     } else {
 
         myClusterPtr->masterInactivityCount++;
+        aggrInactivityCount++;
 
         ls_syslog (LOG_DEBUG, "\
 %s: masterInactivityCount=%d, hostInactivityLimit=%d, masterKnown=%d, retryLimit=%d",
@@ -182,6 +191,9 @@ sendLoad(void)
             }
         }
 
+        if (myHostPtr->isAggr)
+            flushAggrLoad();
+
         if (!myClusterPtr->masterKnown)
             return;
     }
@@ -201,93 +213,308 @@ sendLoad(void)
         return;
     }
 
+    if (masterMe) {
+        for (i = 0; i < allInfo.numIndx; i++)
+            li[i].valuesent = myHostPtr->loadIndex[i];
+    } else {
+        /* Send the indices that changed unless a full
+         * vector is due or the master does not know
+         * about deltas, a delta with no indices is the
+         * heartbeat.
+         */
+        if (sendFullLoad
+            || numDeltaSent >= FULL_LOAD_PERIOD
+            || myClusterPtr->masterPtr->protoVersion < 32)
+            cc = sendLoadVector(sendInfo);
+        else
+            cc = sendLoadDelta(sendInfo);
+        if (cc < 0)
+            return;
+    }
+
+    mustSendLoad = FALSE;
+    noSendCount = 0;
+}
+
+/* sendLoadVector()
+ *
+ * Send all the load indices and shared resource
+ * values to the master.
+ */
+static int
+sendLoadVector(int sendInfo)
+{
+    struct loadVectorStruct myLoadVector;
+    enum   loadstruct loadType;
+    struct LSFHeader reqHdr;
+    XDR    xdrs;
+    char   *repBuf;
+    int    bufSize;
+    int    cc;
+    int    i;
+
     for (i = 0; i < allInfo.numIndx; i++)
         li[i].valuesent = myHostPtr->loadIndex[i];
 
-    if (!masterMe) {
-
-        loadType = e_vec;
-        myLoadVector.hostNo = myHostPtr->hostNo;
-        myLoadVector.status = myHostPtr->status;
-        myLoadVector.seqNo  = loadVecSeqNo++;
-        myLoadVector.checkSum = myClusterPtr->checkSum;
-        myLoadVector.flags = sendInfo;
-        myLoadVector.numIndx   = allInfo.numIndx;
-        myLoadVector.numUsrIndx = allInfo.numUsrIndx;
-        myLoadVector.numResPairs = myHostPtr->numInstances;
-
-        if (myLoadVector.numResPairs > 0) {
-            if ((myLoadVector.resPairs  = getResPairs (myHostPtr)) == NULL) {
-                ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "getResPairs");
-                return;
-            }
-        } else
-            myLoadVector.resPairs = NULL;
-        myLoadVector.li = myHostPtr->loadIndex;
-        bufSize = sizeof (struct loadVectorStruct)
-                  + allInfo.numIndx *sizeof (float)
-                  + GET_INTNUM(allInfo.numIndx) * sizeof (int)
-                  + myLoadVector.numResPairs * sizeof (struct resPair)
-                  + 100;
-        for (i = 0; i < myLoadVector.numResPairs; i++ ){
-            bufSize += ALIGNWORD_(strlen(myLoadVector.resPairs[i].name) * sizeof(char) + 1) + 4;
-            bufSize += ALIGNWORD_(strlen(myLoadVector.resPairs[i].value) * sizeof(char) + 1) + 4;
+    loadType = e_vec;
+    myLoadVector.hostNo = myHostPtr->hostNo;
+    myLoadVector.status = myHostPtr->status;
+    myLoadVector.seqNo  = loadVecSeqNo++;
+    myLoadVector.checkSum = myClusterPtr->checkSum;
+    myLoadVector.flags = sendInfo;
+    myLoadVector.numIndx   = allInfo.numIndx;
+    myLoadVector.numUsrIndx = allInfo.numUsrIndx;
+    myLoadVector.numResPairs = myHostPtr->numInstances;
+
+    if (myLoadVector.numResPairs > 0) {
+        if ((myLoadVector.resPairs  = getResPairs (myHostPtr)) == NULL) {
+            ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "getResPairs");
+            return -1;
         }
-
-        if (bufSize > MSGSIZE) {
-            ls_syslog(LOG_ERR, "\
+    } else
+        myLoadVector.resPairs = NULL;
+    myLoadVector.li = myHostPtr->loadIndex;
+    bufSize = sizeof (struct loadVectorStruct)
+              + allInfo.numIndx *sizeof (float)
+              + GET_INTNUM(allInfo.numIndx) * sizeof (int)
+              + resPairsSize(myLoadVector.resPairs,
+                             myLoadVector.numResPairs)
+              + 100;
+
+    if (bufSize > MSGSIZE) {
+        ls_syslog(LOG_ERR, "\
 %s: message bigger then receive buf(%d)", __func__, bufSize);
-            return;
+        return -1;
+    }
+
+    if ((repBuf = malloc(bufSize)) == NULL) {
+        ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "malloc");
+        return -1;
+    }
+
+    xdrmem_create(&xdrs, repBuf, bufSize, XDR_ENCODE);
+    initLSFHeader_(&reqHdr);
+    reqHdr.opCode  = LIM_LOAD_UPD;
+    reqHdr.refCode =  0;
+
+    if (!(xdr_LSFHeader(&xdrs, &reqHdr)
+          && xdr_enum(&xdrs, (int *) &loadType)
+          && xdr_loadvector(&xdrs, &myLoadVector, &reqHdr))) {
+        ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "xdr_enum/xdr_loadvector");
+        xdr_destroy(&xdrs);
+        FREEUP (repBuf);
+        return -1;
+    }
+
+    cc = sendLoadBuf(&xdrs, repBuf);
+    xdr_destroy(&xdrs);
+    FREEUP (repBuf);
+
+    if (cc < 0)
+        return -1;
+
+    sendFullLoad = FALSE;
+    numDeltaSent = 0;
+    resSumSent = resPairsSum(myHostPtr);
+
+    return 0;
+}
+
+/* sendLoadDelta()
+ *
+ * Send the indices that changed more than their
+ * exchange threshold since they were last sent,
+ * the shared resource values are sent only if
+ * some of them changed.
+ */
+static int
+sendLoadDelta(int sendInfo)
+{
+    static int *indx;
+    static float *val;
+    struct loadDeltaStruct delta;
+    enum   loadstruct loadType;
+    struct LSFHeader reqHdr;
+    XDR    xdrs;
+    char   *repBuf;
+    u_int  resSum;
+    int    bufSize;
+    int    cc;
+    int    i;
+
+    if (indx == NULL) {
+        indx = calloc(allInfo.numIndx, sizeof(int));
+        val = calloc(allInfo.numIndx, sizeof(float));
+        if (indx == NULL || val == NULL) {
+            ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "calloc");
+            FREEUP(indx);
+            FREEUP(val);
+            return -1;
         }
+    }
 
-        if ((repBuf = malloc(bufSize)) == NULL) {
-            ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "malloc");
-            return;
+    loadType = e_delta;
+    delta.hostNo = myHostPtr->hostNo;
+    delta.status = myHostPtr->status;
+    delta.seqNo = loadVecSeqNo;
+    delta.checkSum = myClusterPtr->checkSum;
+    delta.flags = sendInfo;
+    delta.numIndx = allInfo.numIndx;
+    delta.numUsrIndx = allInfo.numUsrIndx;
+    delta.indx = indx;
+    delta.li = val;
+
+    delta.numDelta = 0;
+    for (i = 0; i < allInfo.numIndx; i++) {
+        if (fabs(myHostPtr->loadIndex[i] - li[i].valuesent)
+            > li[i].exchthreshold) {
+            indx[delta.numDelta] = i;
+            val[delta.numDelta] = myHostPtr->loadIndex[i];
+            delta.numDelta++;
         }
+    }
 
-        xdrmem_create(&xdrs, repBuf, bufSize, XDR_ENCODE);
-        initLSFHeader_(&reqHdr);
-        reqHdr.opCode  = (short) limReqCode;
-        reqHdr.refCode =  0;
-
-        if (!(xdr_LSFHeader(&xdrs, &reqHdr)
-              && xdr_enum(&xdrs, (int *) &loadType)
-              && xdr_loadvector(&xdrs, &myLoadVector, &reqHdr))) {
-            ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "xdr_enum/xdr_loadvector");
-            xdr_destroy(&xdrs);
-            FREEUP (repBuf);
-            return;
+    resSum = resPairsSum(myHostPtr);
+    delta.numResPairs = 0;
+    delta.resPairs = NULL;
+    if (resSum != resSumSent && myHostPtr->numInstances > 0) {
+        if ((delta.resPairs = getResPairs(myHostPtr)) == NULL) {
+            ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "getResPairs");
+            return -1;
         }
+        delta.numResPairs = myHostPtr->numInstances;
+    }
 
-        toAddr.sin_family = AF_INET;
-        /* Sending load to the master so use
-         * the port defined in lsf.conf
-         * even if virtual host.
-         */
-        toAddr.sin_port   = htons(lim_port);
-        memcpy(&toAddr.sin_addr.s_addr,
-               &myClusterPtr->masterPtr->addr[0],
-               sizeof(in_addr_t));
+    bufSize = sizeof(struct loadDeltaStruct)
+              + 2 * delta.numDelta * sizeof(int)
+              + GET_INTNUM(allInfo.numIndx) * sizeof(int)
+              + resPairsSize(delta.resPairs, delta.numResPairs)
+              + 100;
 
-        if (logclass & LC_COMM)
-            ls_syslog(LOG_DEBUG, "\
-sendLoad: sending to %s (len=%d,port=%d)",
-                      sockAdd2Str_(&toAddr), XDR_GETPOS(&xdrs),
-                      lim_port);
-
-        if (chanSendDgram_(limSock, repBuf, XDR_GETPOS(&xdrs), &toAddr) < 0) {
-            ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, __func__, "chanSendDgram_",
-                      sockAdd2Str_(&toAddr));
-            xdr_destroy(&xdrs);
-            FREEUP (repBuf);
-            return;
-        }
+    if (bufSize > MSGSIZE) {
+        ls_syslog(LOG_ERR, "\
+%s: message bigger then receive buf(%d)", __func__, bufSize);
+        return -1;
+    }
+
+    if ((repBuf = malloc(bufSize)) == NULL) {
+        ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "malloc");
+        return -1;
+    }
+
+    xdrmem_create(&xdrs, repBuf, bufSize, XDR_ENCODE);
+    initLSFHeader_(&reqHdr);
+    reqHdr.opCode  = LIM_LOAD_UPD;
+    reqHdr.refCode =  0;
+
+    if (!(xdr_LSFHeader(&xdrs, &reqHdr)
+          && xdr_enum(&xdrs, (int *) &loadType)
+          && xdr_loaddelta(&xdrs, &delta, &reqHdr))) {
+        ls_syslog(LOG_ERR, I18N_FUNC_FAIL, __func__, "xdr_enum/xdr_loaddelta");
         xdr_destroy(&xdrs);
         FREEUP (repBuf);
+        return -1;
     }
 
-    mustSendLoad = FALSE;
-    noSendCount = 0;
+    cc = sendLoadBuf(&xdrs, repBuf);
+    xdr_destroy(&xdrs);
+    FREEUP (repBuf);
+
+    if (cc < 0)
+        return -1;
+
+    /* Count the delta only once it is sent, the
+     * master drops a delta that does not follow the
+     * previous update.
+     */
+    loadVecSeqNo++;
+    numDeltaSent++;
+    for (i = 0; i < delta.numDelta; i++)
+        li[indx[i]].valuesent = val[i];
+    resSumSent = resSum;
+
+    return 0;
+}
+
+static int
+sendLoadBuf(XDR *xdrs, char *repBuf)
+{
+    struct sockaddr_in toAddr;
+    struct hostNode *hPtr;
+    uint16_t port;
+
+    /* Sending load to the master so use
+     * the port defined in lsf.conf
+     * even if virtual host.
+     */
+    port = lim_port;
+    hPtr = loadAggregator();
+    if (hPtr != NULL)
+        port = getLIMPort(hPtr);
+    else
+        hPtr = myClusterPtr->masterPtr;
+
+    memset(&toAddr, 0, sizeof(toAddr));
+    toAddr.sin_family = AF_INET;
+    toAddr.sin_port   = htons(port);
+    memcpy(&toAddr.sin_addr.s_addr,
+           &hPtr->addr[0],
+           sizeof(in_addr_t));
+
+    if (logclass & LC_COMM)
+        ls_syslog(LOG_DEBUG, "\
+%s: sending to %s (len=%d,port=%d)", __func__,
+                  sockAdd2Str_(&toAddr), XDR_GETPOS(xdrs),
+                  port);
+
+    if (chanSendDgram_(limSock, repBuf, XDR_GETPOS(xdrs), &toAddr) < 0) {
+        ls_syslog(LOG_ERR, I18N_FUNC_S_FAIL_M, __func__, "chanSendDgram_",
+                  sockAdd2Str_(&toAddr));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+resPairsSize(struct resPair *resPairs, int numResPairs)
+{
+    int size;
+    int i;
+
+    size = numResPairs * sizeof(struct resPair);
+    for (i = 0; i < numResPairs; i++) {
+        size += ALIGNWORD_(strlen(resPairs[i].name) * sizeof(char) + 1) + 4;
+        size += ALIGNWORD_(strlen(resPairs[i].value) * sizeof(char) + 1) + 4;
+    }
+
+    return size;
+}
+
+/* resPairsSum()
+ *
+ * Hash the shared resource values of the host
+ * to tell whether they changed since they were
+ * last sent.
+ */
+static u_int
+resPairsSum(struct hostNode *hPtr)
+{
+    u_int sum;
+    char *p;
+    int i;
+
+    sum = hPtr->numInstances;
+    for (i = 0; i < hPtr->numInstances; i++) {
+        for (p = hPtr->instances[i]->resName; *p; p++)
+            sum = sum * 31 + (u_char)*p;
+        sum = sum * 31;
+        for (p = hPtr->instances[i]->value; p && *p; p++)
+            sum = sum * 31 + (u_char)*p;
+        sum = sum * 31;
+    }
+
+    return sum;
 }
 
 struct resPair *
@@ -334,6 +561,24 @@ rcvLoad(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
         return;
     }
 
+    /* Hosts report to an aggregator that passes
+     * their load on to the master.
+     */
+    if (!masterMe && myHostPtr->isAggr) {
+        aggrLoad(xdrs, from, hdr, loadType);
+        return;
+    }
+
+    if (loadType == e_delta) {
+        rcvLoadDelta(xdrs, from, hdr, FALSE);
+        return;
+    }
+
+    if (loadType == e_mat) {
+        rcvLoadMatrix(xdrs, from, hdr);
+        return;
+    }
+
     if (loadType != e_vec) {
         ls_syslog(LOG_ERR, "\
 %s: Invalid load type %d from host %s",
@@ -341,18 +586,79 @@ rcvLoad(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
         return;
     }
 
-    rcvLoadVector(xdrs, from, hdr);
+    rcvLoadVector(xdrs, from, hdr, FALSE);
 }
 
-
+/* rcvLoadMatrix()
+ *
+ * Load updates of several hosts forwarded by
+ * an aggregator.
+ */
 static void
-rcvLoadVector(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
+rcvLoadMatrix(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
+{
+    struct hostNode *aggrPtr;
+    struct sockaddr_in hostAddr;
+    enum loadstruct loadType;
+    u_int addr;
+    int numLoad;
+    int cc;
+    int i;
+
+    if (!masterMe)
+        return;
+
+    aggrPtr = findHostbyAddr(from, (char *)__func__);
+    if (aggrPtr == NULL || !aggrPtr->isAggr) {
+        ls_syslog(LOG_ERR, "\
+%s: Received aggregated load from %s that is not an aggregator",
+                  __func__, sockAdd2Str_(from));
+        return;
+    }
+
+    if (!xdr_int(xdrs, &numLoad)) {
+        ls_syslog(LOG_ERR, "\
+%s: Error in xdr_int from %s", __func__, sockAdd2Str_(from));
+        return;
+    }
+
+    hostAddr = *from;
+    for (i = 0; i < numLoad; i++) {
+
+        if (!(xdr_u_int(xdrs, &addr)
+              && xdr_enum(xdrs, (int *)&loadType))) {
+            ls_syslog(LOG_ERR, "\
+%s: Error in load %d of %d from %s", __func__,
+                      i, numLoad, sockAdd2Str_(from));
+            return;
+        }
+        memcpy(&hostAddr.sin_addr.s_addr, &addr, sizeof(in_addr_t));
+
+        if (loadType == e_vec)
+            cc = rcvLoadVector(xdrs, &hostAddr, hdr, TRUE);
+        else if (loadType == e_delta)
+            cc = rcvLoadDelta(xdrs, &hostAddr, hdr, TRUE);
+        else
+            cc = -1;
+
+        if (cc < 0) {
+            ls_syslog(LOG_ERR, "\
+%s: Error in load %d of %d from %s", __func__,
+                      i, numLoad, sockAdd2Str_(from));
+            return;
+        }
+    }
+}
+
+
+static int
+rcvLoadVector(XDR *xdrs,
+              struct sockaddr_in *from,
+              struct LSFHeader *hdr,
+              int viaAggr)
 {
-    static int checkSumMismatch;
     static struct loadVectorStruct *loadVector;
     struct hostNode *hPtr;
-    int i;
-    int masterLock = FALSE;
 
     if (loadVector == NULL) {
         loadVector = calloc(1, sizeof(struct loadVectorStruct));
@@ -364,17 +670,131 @@ rcvLoadVector(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
     if (!xdr_loadvector(xdrs, loadVector, hdr)) {
         ls_syslog(LOG_ERR, "\
 %s: Error in xdr_loadvector from %s", __func__, sockAdd2Str_(from));
-        return;
+        return -1;
     }
 
+    hPtr = loadHost(from, loadVector->checkSum, viaAggr);
+    if (hPtr == NULL)
+        return 0;
+
+    copyStatus(hPtr, loadVector->status);
+
+    if (loadVector->seqNo - hPtr->lastSeqNo > 2
+        && loadVector->seqNo > hPtr->lastSeqNo
+        && hPtr->lastSeqNo != 0)
+
+        ls_syslog(LOG_ERR, "\
+%s: host %s lastSeqNo=%d seqNo=%d. Packets being dropped?",
+                  __func__, hPtr->hostName,
+                  hPtr->lastSeqNo, loadVector->seqNo);
+    hPtr->lastSeqNo = loadVector->seqNo;
+
+    copyResValues (*loadVector, hPtr);
+    copyIndices(loadVector->li,
+                loadVector->numIndx,
+                loadVector->numUsrIndx,
+                hPtr);
+
+    if (loadVector->flags & SEND_MASTER_ANN)  {
+        ls_syslog(LOG_INFO, "\
+%s: Sending master announce to %s", __func__, hPtr->hostName);
+        announceMasterToHost(hPtr, SEND_NO_INFO);
+    }
+
+    return 0;
+}
+
+/* rcvLoadDelta()
+ *
+ * Apply the indices in the delta to the raw load
+ * vector of the host, if updates were lost or the
+ * host never sent a full vector ask it for one.
+ */
+static int
+rcvLoadDelta(XDR *xdrs,
+             struct sockaddr_in *from,
+             struct LSFHeader *hdr,
+             int viaAggr)
+{
+    static struct loadDeltaStruct *delta;
+    static float *lindx;
+    struct loadVectorStruct resVector;
+    struct hostNode *hPtr;
+    int i;
+
+    if (delta == NULL) {
+        delta = calloc(1, sizeof(struct loadDeltaStruct));
+        delta->status = calloc((1 + GET_INTNUM(allInfo.numIndx)),
+                               sizeof(int));
+        delta->indx = calloc(allInfo.numIndx, sizeof(int));
+        delta->li = calloc(allInfo.numIndx, sizeof(float));
+        lindx = calloc(allInfo.numIndx, sizeof(float));
+    }
+
+    if (!xdr_loaddelta(xdrs, delta, hdr)) {
+        ls_syslog(LOG_ERR, "\
+%s: Error in xdr_loaddelta from %s", __func__, sockAdd2Str_(from));
+        return -1;
+    }
+
+    hPtr = loadHost(from, delta->checkSum, viaAggr);
+    if (hPtr == NULL)
+        return 0;
+
+    copyStatus(hPtr, delta->status);
+
+    if (hPtr->lastSeqNo == 0
+        || delta->seqNo != hPtr->lastSeqNo + 1) {
+        if (logclass & LC_COMM)
+            ls_syslog(LOG_DEBUG, "\
+%s: host %s lastSeqNo=%d seqNo=%d, asking for full load",
+                      __func__, hPtr->hostName,
+                      hPtr->lastSeqNo, delta->seqNo);
+        announceMasterToHost(hPtr, SEND_LOAD_INFO);
+        return 0;
+    }
+    hPtr->lastSeqNo = delta->seqNo;
+
+    if (delta->numDelta > 0) {
+        memcpy(lindx, hPtr->uloadIndex, allInfo.numIndx * sizeof(float));
+        for (i = 0; i < delta->numDelta; i++)
+            lindx[delta->indx[i]] = delta->li[i];
+        copyIndices(lindx, allInfo.numIndx, allInfo.numUsrIndx, hPtr);
+    }
+
+    resVector.numResPairs = delta->numResPairs;
+    resVector.resPairs = delta->resPairs;
+    copyResValues(resVector, hPtr);
+
+    if (delta->flags & SEND_MASTER_ANN)  {
+        ls_syslog(LOG_INFO, "\
+%s: Sending master announce to %s", __func__, hPtr->hostName);
+        announceMasterToHost(hPtr, SEND_NO_INFO);
+    }
+
+    return 0;
+}
+
+/* loadHost()
+ *
+ * The host a load update comes from, NULL if
+ * the update must be dropped. viaAggr tells if
+ * the update was forwarded by an aggregator.
+ */
+static struct hostNode *
+loadHost(struct sockaddr_in *from, int checkSum, int viaAggr)
+{
+    static int checkSumMismatch;
+    struct hostNode *hPtr;
+
     if (!masterMe) {
         ls_syslog(LOG_DEBUG, "\
 %s: %s thinks I am the master, but I'm not",
                   __func__, sockAdd2Str_(from));
-        return;
+        return NULL;
     }
 
-    if (myClusterPtr->checkSum != loadVector->checkSum
+    if (myClusterPtr->checkSum != checkSum
         && checkSumMismatch < 5
         && (limParams[LSF_LIM_IGNORE_CHECKSUM].paramValue == NULL)) {
         ls_syslog(LOG_DEBUG, "\
@@ -388,30 +808,40 @@ rcvLoadVector(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
         ls_syslog(LOG_ERR, "\
 %s: Received load update from unknown host %s",
                   __func__, sockAdd2Str_(from));
-        return ;
+        return NULL;
     }
 
     if (findHostbyList(myClusterPtr->hostList, hPtr->hostName) == NULL) {
         ls_syslog(LOG_ERR, "\
 %s: Got load from client-only host %s.  Kill LIM on %s",
                   __func__, sockAdd2Str_(from), sockAdd2Str_(from));
-        return;
+        return NULL;
     }
 
     if (hPtr->infoValid != TRUE) {
-        return;
+        return NULL;
     }
 
     ls_syslog(LOG_DEBUG,"\
 %s: Received load update from host %s", __func__, hPtr->hostName);
 
     hPtr->hostInactivityCount = 0;
+    hPtr->viaAggr = viaAggr;
+
+    return hPtr;
+}
+
+static void
+copyStatus(struct hostNode *hPtr, int *status)
+{
+    int masterLock = FALSE;
+    int i;
 
     if (hPtr->status[0] & LIM_LOCKEDM) {
         masterLock = TRUE;
     }
 
-    hPtr->status[0] = loadVector->status[0];
+    hPtr->status[0] = status[0];
     if (masterLock) {
         hPtr->status[0] |= LIM_LOCKEDM;
     } else {
@@ -419,31 +849,9 @@ rcvLoadVector(XDR *xdrs, struct sockaddr_in *from, struct LSFHeader *hdr)
     }
 
     for (i = 0; i < GET_INTNUM(allInfo.numIndx); i++)
-        hPtr->status[i + 1] = loadVector->status[i + 1];
+        hPtr->status[i + 1] = status[i + 1];
 
     hPtr->loadMask  = 0;
-
-    if (loadVector->seqNo - hPtr->lastSeqNo > 2
-        && loadVector->seqNo > hPtr->lastSeqNo
-        && hPtr->lastSeqNo != 0)
-
-        ls_syslog(LOG_ERR, "\
-%s: host %s lastSeqNo=%d seqNo=%d. Packets being dropped?",
-                  __func__, hPtr->hostName,
-                  hPtr->lastSeqNo, loadVector->seqNo);
-    hPtr->lastSeqNo = loadVector->seqNo;
-
-    copyResValues (*loadVector, hPtr);
-    copyIndices(loadVector->li,
-                loadVector->numIndx,
-                loadVector->numUsrIndx,
-                hPtr);
-
-    if (loadVector->flags & SEND_MASTER_ANN)  {
-        ls_syslog(LOG_INFO, "\
-%s: Sending master announce to %s", __func__, hPtr->hostName);
-        announceMasterToHost(hPtr, SEND_NO_INFO);
-    }
 }
 
 static void
@@ -80,6 +80,7 @@ struct config_param limParams[] =
     {"LSB_SHAREDIR", NULL},
     {"LIM_NO_MIGRANT_HOSTS", NULL},
     {"LIM_DONT_FORK", NULL},
+    {"LSF_LIM_AGGREGATORS", NULL},
     {NULL, NULL},
 };
 
@@ -89,10 +90,10 @@ static int initAndConfig(int, int *);
 static void term_handler(int);
 static void child_handler(int);
 static int  processUDPMsg(void);
+static int  doUDPMsg(char *, struct sockaddr_in *);
 static void doAcceptConn(void);
 static void initSignals(void);
 static void periodic(int);
-static struct tclLsInfo *getTclLsInfo(void);
 static void printTypeModel(void);
 static void initMiscLiStruct(void);
 static int getClusterConfig(void);
@@ -100,9 +101,12 @@ extern struct extResInfo *getExtResourcesDef(char *);
 extern char *getExtResourcesLoc(char *);
 extern char *getExtResourcesVal(char *);
 
-/* UDP message buffer.
+/* UDP message buffers, the master reads up to
+ * UDP_BATCH datagrams, mostly load updates from
+ * the slaves, on each wakeup.
  */
-static char reqBuf[MSGSIZE];
+#define UDP_BATCH 64
+static char reqBuf[UDP_BATCH][MSGSIZE];
 
 /* If this is a virtual host this is
  * its name
@@ -121,7 +125,6 @@ lim: [-C] [-V] [-h] [-t] [-debug_level] [-d env_dir] [-m machine@port]\n");
 int
 main(int argc, char **argv)
 {
-    fd_set allMask;
     struct Masks sockmask;
     struct Masks chanmask;
     struct timeval timer;
@@ -301,7 +304,6 @@ Reading configuration from %s/lsf.conf\n", env_dir);
     if (lim_debug < 2)
         chdir("/tmp");
 
-    FD_ZERO(&allMask);
     /* We use seconds based precision timer
      * which is good enough, just make sure
      * that every 5 seconds we read the load
@@ -316,7 +318,6 @@ Reading configuration from %s/lsf.conf\n", env_dir);
         sigset_t newMask;
         int nReady;
 
-        sockmask.rmask = allMask;
         if (pimPid == -1)
             startPIM(argc, argv);
 
@@ -368,11 +369,11 @@ Reading configuration from %s/lsf.conf\n", env_dir);
             continue;
         }
 
-        if (FD_ISSET(limSock, &chanmask.rmask)) {
+        if (CHAN_ISSET(limSock, &chanmask.rmask)) {
             processUDPMsg();
         }
 
-        if (FD_ISSET(limTcpSock, &chanmask.rmask)) {
+        if (CHAN_ISSET(limTcpSock, &chanmask.rmask)) {
             doAcceptConn();
         }
 
@@ -385,30 +386,69 @@ Reading configuration from %s/lsf.conf\n", env_dir);
 } /* main() */
 
 /* processUDPMsg()
+ *
+ * Drain up to UDP_BATCH datagrams from the socket
+ * with a single recvmmsg() and process them in
+ * arrival order.
  */
 static int
 processUDPMsg(void)
 {
-    struct hostNode *fromHost;
-    struct hostent *hp;
-    struct LSFHeader reqHdr;
-    struct sockaddr_in from;
-    enum limReqCode limReqCode;
+    static struct mmsghdr msgs[UDP_BATCH];
+    static struct iovec iov[UDP_BATCH];
+    static struct sockaddr_in from[UDP_BATCH];
+    int sock;
     int cc;
-    XDR xdrs;
+    int i;
 
-    memset(&from, 0, sizeof(from));
+    sock = chanSock_(limSock);
+
+    for (i = 0; i < UDP_BATCH; i++) {
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        memset(&from[i], 0, sizeof(struct sockaddr_in));
+        iov[i].iov_base = reqBuf[i];
+        iov[i].iov_len = MSGSIZE;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
 
-    cc = chanRcvDgram_(limSock, reqBuf, MSGSIZE, &from, -1);
+    cc = recvmmsg(sock, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
     if (cc < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
         ls_syslog(LOG_ERR, "\
-%s: chanRcvDgram() failed limSock %d: %m",
+%s: recvmmsg() failed limSock %d: %m",
                   __func__, limSock);
         return -1;
     }
 
-    xdrmem_create(&xdrs, reqBuf, MSGSIZE, XDR_DECODE);
-    cc = XDR_GETPOS(&xdrs);
+    if (logclass & LC_COMM)
+        ls_syslog(LOG_DEBUG, "\
+%s: received %d messages", __func__, cc);
+
+    for (i = 0; i < cc; i++)
+        doUDPMsg(reqBuf[i], &from[i]);
+
+    return cc;
+}
+
+/* doUDPMsg()
+ */
+static int
+doUDPMsg(char *buf, struct sockaddr_in *fromp)
+{
+    struct hostNode *fromHost;
+    struct hostent *hp;
+    struct LSFHeader reqHdr;
+    struct sockaddr_in from;
+    enum limReqCode limReqCode;
+    XDR xdrs;
+
+    from = *fromp;
+
+    xdrmem_create(&xdrs, buf, MSGSIZE, XDR_DECODE);
 
     if (!xdr_LSFHeader(&xdrs, &reqHdr)) {
         ls_syslog(LOG_ERR, "\
@@ -417,7 +457,6 @@ processUDPMsg(void)
         return -1;
     }
 
-    cc = XDR_GETPOS(&xdrs);
     limReqCode = reqHdr.opCode;
     limReqCode &= 0xFFFF;
 
@@ -680,6 +719,8 @@ initAndConfig(int checkMode, int *kernelPerm)
     if (reCheckClass() < 0)
         lim_Exit("readCluster");
 
+    initAggregators();
+
     if ((tclLsInfo = getTclLsInfo()) == NULL)
         lim_Exit("getTclLsInfo");
 
@@ -925,7 +966,7 @@ errorBack(struct sockaddr_in *from,
     xdr_destroy(&xdrs2);
 
 }
-static struct tclLsInfo *
+struct tclLsInfo *
 getTclLsInfo(void)
 {
     static struct tclLsInfo *tclLsInfo;
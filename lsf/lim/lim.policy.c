@@ -19,6 +19,7 @@
  *
  */
 #include "lim.h"
+#include "../intlib/heap.h"
 #include <math.h>
 
 #define NL_SETN 24
@@ -37,6 +38,21 @@ struct hostNode *fromHostPtr;
 #define SORT_SINDX  0x04
 #define SORT_INCR   0x08
 
+/* Sort key of a candidate host, the best host
+ * has the lowest rank and then the lowest load.
+ */
+struct candKey {
+    struct hostNode *hPtr;
+    int rank;
+    float load;
+    float value;
+    int pos;
+    char sel;
+};
+static struct candKey *candKeys;
+static int candKeysSize;
+static struct heap_ *candHeap;
+
 #define P_(s) s
 
 static int findBestHost P_((register struct resVal *, int, int, char **, int, char, int, int));
@@ -49,9 +65,11 @@ static int  getNumInstances P_((int));
 static int getOkSites(int, int, int);
 static int findNPref(int, int, char **);
 static int bsort(int, int, int, int, float, char, int, int);
-static void mkexld(struct hostNode *, struct hostNode *, int, float *, float *,
-                   float);
-static int orderByStatus(int, int);
+static float mkexld(struct hostNode *, int, float);
+static int statusRank(int *, int);
+static int cmpCand(const void *, const void *);
+static int cmpCandWorst(const void *, const void *);
+static int selectTop(int, int);
 static int grabHosts(struct hostNode *, struct resVal *, struct decisionReq *,  int, char *, int);
 
 static int addCandList(struct hostNode *, int );
@@ -73,17 +91,12 @@ placeReq(XDR *xdrs,
     struct decisionReq plReq;
     struct jobXfer jobXfer;
     struct LSFHeader replyHdr;
-    char fromEligible;
     XDR xdrs2;
     enum limReplyCode limReplyCode;
     struct resVal resVal;
-    int ncandidates;
-    int ncandidateInst;
-    int ignore_res;
     int propt;
     int returnCode;
     int i;
-    int j;
     int cc;
     char clName;
     char *replyStruct;
@@ -143,99 +156,7 @@ placeReq(XDR *xdrs,
         goto Reply;
     }
 
-    fromHostPtr = findHost(plReq.preferredHosts[0]);
-    if (!fromHostPtr) {
-        limReplyCode = LIME_NAUTH_HOST;
-        goto Reply;
-    }
-    if (strcmp(plReq.hostType, " ") == 0)
-        strcpy(plReq.hostType,
-               (fromHostPtr->hTypeNo >= 0) ?
-               shortInfo.hostTypes[fromHostPtr->hTypeNo] : "unknown");
-
-    fromEligible = FALSE;
-    ncandidates = getEligibleSites(&resVal, &plReq, 0, &fromEligible);
-    if (!fromEligible)
-        fromHostPtr = NULL;
-
-    if (ncandidates <= 0) {
-        limReplyCode = ncandidates ? LIME_NO_MEM : LIME_NO_OKHOST;
-        goto Reply;
-    }
-
-    ignore_res = (plReq.options & IGNORE_RES);
-
-
-    ncandidates = getOkSites(ncandidates, 0, ignore_res);
-
-
-    potentialOfCandidates(ncandidates, &resVal);
-    if (fromHostPtr)
-        potentialOfHost(fromHostPtr, &resVal);
-    ncandidateInst = getNumInstances(ncandidates);
-
-    if ( (ncandidates == 0)
-         || (ncandidateInst < plReq.numHosts
-             && (plReq.options & EXACT))) {
-        limReplyCode = LIME_NO_OKHOST;
-        goto Reply;
-    }
-
-    if (ncandidates > plReq.numHosts) {
-        ncandidates = findBestHost(&resVal,
-                                   plReq.numHosts,
-                                   plReq.numPrefs,
-                                   plReq.preferredHosts,
-                                   ncandidates,
-                                   TRUE,
-                                   ignore_res,
-                                   plReq.options);
-    } else {
-        ncandidates = findBestHost(&resVal,
-                                   ncandidates,
-                                   plReq.numPrefs,
-                                   plReq.preferredHosts,
-                                   ncandidates,
-                                   TRUE,
-                                   ignore_res,
-                                   plReq.options);
-    }
-
-    if ((getNumInstances(ncandidates) < plReq.numHosts)
-        && (plReq.options & EXACT)) {
-        limReplyCode = LIME_NO_OKHOST;
-        goto Reply;
-    }
-
-    selectBestInstances(ncandidates,
-                        plReq.numHosts,
-                        plReq.options & LOCALITY,
-                        ignore_res);
-    limReplyCode = LIME_NO_ERR;
-
-    placeReply.numHosts = 0;
-    for(i = 0; i < ncandidates ;i++) {
-        if (candidates[i]->use > 0) {
-            placeReply.numHosts++;
-        }
-    }
-
-    placeReply.placeInfo = calloc(placeReply.numHosts,
-                                  sizeof(struct placeInfo));
-    if (placeReply.placeInfo == NULL) {
-        limReplyCode = LIME_NO_MEM;
-        ls_syslog(LOG_ERR, "%s: %m", __func__);
-        goto Reply;
-    }
-
-    for (i = 0, j = 0; i < ncandidates; i++) {
-        if (candidates[i]->use > 0) {
-            strcpy(placeReply.placeInfo[j].hostName,
-                   candidates[i]->hostName);
-            placeReply.placeInfo[j].numtask = candidates[i]->use;
-            j++;
-        }
-    }
+    limReplyCode = placeHosts(&plReq, &resVal, &placeReply);
 
 Reply:
 
@@ -299,6 +220,116 @@ Reply1:
     return;
 }
 
+/* placeHosts()
+ *
+ * Choose the hosts for a placement request whose
+ * resource requirement has been parsed in resVal.
+ */
+enum limReplyCode
+placeHosts(struct decisionReq *plReq,
+           struct resVal *resVal,
+           struct placeReply *placeReply)
+{
+    char fromEligible;
+    int ncandidates;
+    int ncandidateInst;
+    int ignore_res;
+    int i;
+    int j;
+
+    placeReply->numHosts = 0;
+
+    fromHostPtr = findHost(plReq->preferredHosts[0]);
+    if (!fromHostPtr) {
+        return LIME_NAUTH_HOST;
+    }
+    if (strcmp(plReq->hostType, " ") == 0)
+        strcpy(plReq->hostType,
+               (fromHostPtr->hTypeNo >= 0) ?
+               shortInfo.hostTypes[fromHostPtr->hTypeNo] : "unknown");
+
+    fromEligible = FALSE;
+    ncandidates = getEligibleSites(resVal, plReq, 0, &fromEligible);
+    if (!fromEligible)
+        fromHostPtr = NULL;
+
+    if (ncandidates <= 0) {
+        return ncandidates ? LIME_NO_MEM : LIME_NO_OKHOST;
+    }
+
+    ignore_res = (plReq->options & IGNORE_RES);
+
+
+    ncandidates = getOkSites(ncandidates, 0, ignore_res);
+
+
+    potentialOfCandidates(ncandidates, resVal);
+    if (fromHostPtr)
+        potentialOfHost(fromHostPtr, resVal);
+    ncandidateInst = getNumInstances(ncandidates);
+
+    if ( (ncandidates == 0)
+         || (ncandidateInst < plReq->numHosts
+             && (plReq->options & EXACT))) {
+        return LIME_NO_OKHOST;
+    }
+
+    if (ncandidates > plReq->numHosts) {
+        ncandidates = findBestHost(resVal,
+                                   plReq->numHosts,
+                                   plReq->numPrefs,
+                                   plReq->preferredHosts,
+                                   ncandidates,
+                                   TRUE,
+                                   ignore_res,
+                                   plReq->options);
+    } else {
+        ncandidates = findBestHost(resVal,
+                                   ncandidates,
+                                   plReq->numPrefs,
+                                   plReq->preferredHosts,
+                                   ncandidates,
+                                   TRUE,
+                                   ignore_res,
+                                   plReq->options);
+    }
+
+    if ((getNumInstances(ncandidates) < plReq->numHosts)
+        && (plReq->options & EXACT)) {
+        return LIME_NO_OKHOST;
+    }
+
+    selectBestInstances(ncandidates,
+                        plReq->numHosts,
+                        plReq->options & LOCALITY,
+                        ignore_res);
+
+    placeReply->numHosts = 0;
+    for(i = 0; i < ncandidates ;i++) {
+        if (candidates[i]->use > 0) {
+            placeReply->numHosts++;
+        }
+    }
+
+    placeReply->placeInfo = calloc(placeReply->numHosts,
+                                  sizeof(struct placeInfo));
+    if (placeReply->placeInfo == NULL) {
+        ls_syslog(LOG_ERR, "%s: %m", __func__);
+        return LIME_NO_MEM;
+    }
+
+    for (i = 0, j = 0; i < ncandidates; i++) {
+        if (candidates[i]->use > 0) {
+            strcpy(placeReply->placeInfo[j].hostName,
+                   candidates[i]->hostName);
+            placeReply->placeInfo[j].numtask = candidates[i]->use;
+            j++;
+        }
+    }
+
+    return LIME_NO_ERR;
+}
+
 static int
 getOkSites(int num, int retain, int ignore_res)
 {
@@ -763,6 +794,16 @@ findNPref(int ncandidates, int numPrefs, char **preferredHosts)
 
 #define NOTORDERED(inc,a,b)   ((inc) ? ((a) > (b)) : ((a) < (b)))
 
+/* bsort()
+ *
+ * Order the candidates by the load index lidx. A cut
+ * phase keeps at least ncandidates - cutoffs of the
+ * best hosts plus the hosts whose load is within the
+ * threshold from the best, the final phase puts the
+ * best numHosts hosts at the head of the candidates.
+ * Only the hosts that are kept are ordered, they are
+ * selected with a bounded heap in O(n log k).
+ */
 static int
 bsort(int lidx,
       int ncandidates,
@@ -773,16 +814,16 @@ bsort(int lidx,
       int ignore_res,
       int rqlOptions)
 {
-    char swap;
-    register int i,j;
     char incr;
-    float exld1, exld2;
-    struct hostNode *tmp;
     float coef;
+    float bestload;
+    float load;
     int cutoffs;
     int residual;
     int shrink;
-    int order;
+    int top;
+    int i;
+    int j;
     char flip;
 
     if (lidx < 0)
@@ -824,163 +865,193 @@ bsort(int lidx,
             incr = !incr;
     }
 
-
     coef = 0.05 * nec/numHosts;
 
-    if (! (flags & SORT_FINAL)) {
-        float bestload = loadIndexValue(0, lidx, rqlOptions);
+    if (ncandidates > candKeysSize) {
+        struct candKey *keys;
 
-        for (i = 1; i < ncandidates; i++) {
-            if (NOTORDERED(incr, bestload, loadIndexValue(i, lidx, rqlOptions)))
-                bestload = loadIndexValue(i, lidx, rqlOptions);
+        keys = realloc(candKeys, ncandidates * sizeof(struct candKey));
+        if (keys == NULL) {
+            ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "realloc");
+            return (flags & SORT_FINAL) ? cutoffs : ncandidates;
         }
+        candKeys = keys;
+        candKeysSize = ncandidates;
+    }
 
+    for (i = 0; i < ncandidates; i++) {
+        struct candKey *k = &candKeys[i];
 
-        swap = TRUE;
-        i = 0;
-        while (swap && ( i< ncandidates-cutoffs)) {
-            swap = FALSE;
-            for (j = ncandidates - 2; j >= i; j--) {
-                order = orderByStatus(j + 1, ignore_res);
-                if (order == 0) {
-                    swap = TRUE;
-                    continue;
-                }
-                if (order == 1)
-                    continue;
-
-                if (!(flags & SORT_SINDX)) {
-                    mkexld(candidates[j], candidates[j+1], lidx,
-                           &exld1, &exld2, coef);
-                } else {
-                    exld1 = 0.0;
-                    exld2 = 0.0;
-                }
+        /* The local host is not busy because
+         * of its own interactive idle time.
+         */
+        if (candidates[i] == fromHostPtr)
+            candidates[i]->status[1] &= ~(1 << IT);
 
-                if (NOTORDERED(incr, loadIndexValue(j, lidx, rqlOptions)
-                               + exld1,
-                               loadIndexValue(j+1, lidx, rqlOptions)
-                               + exld2)) {
-                    swap = TRUE;
-                    tmp = candidates[j];
-                    candidates[j] = candidates[j+1];
-                    candidates[j+1] = tmp;
-                }
-            }
-            i++;
-        }
-        for (i = ncandidates-cutoffs; i < ncandidates; i++)
-            if (fabs(loadIndexValue(i, lidx, rqlOptions) - bestload) >= threshold)
-                return i;
+        k->value = loadIndexValue(i, lidx, rqlOptions);
+        load = k->value;
+        if (!(flags & SORT_SINDX))
+            load += mkexld(candidates[i], lidx, coef);
 
-        return ncandidates;
+        k->hPtr = candidates[i];
+        k->rank = statusRank(candidates[i]->status, ignore_res);
+        k->load = incr ? load : -load;
+        k->pos = i;
+        k->sel = FALSE;
     }
 
-    swap = TRUE;
-    i = 0;
-    while (swap && (i < cutoffs)) {
-        swap = FALSE;
-        for (j=ncandidates-2;j>=i;j--) {
-            order = orderByStatus(j+1, ignore_res);
-            if (order == 0) {
-                swap = TRUE;
-                continue;
-            }
-            if (order == 1)
-                continue;
+    if (! (flags & SORT_FINAL)) {
 
-            if (!(flags & SORT_SINDX)) {
-                mkexld(candidates[j], candidates[j+1], lidx, &exld1, &exld2, coef);
-            } else {
-                exld1 = 0.0;
-                exld2 = 0.0;
-            }
+        bestload = candKeys[0].value;
+        for (i = 1; i < ncandidates; i++) {
+            if (NOTORDERED(incr, bestload, candKeys[i].value))
+                bestload = candKeys[i].value;
+        }
 
-            if (NOTORDERED(incr,
-                           loadIndexValue(j, lidx, rqlOptions) + exld1,
-                           loadIndexValue(j+1, lidx, rqlOptions) + exld2)) {
-                swap = TRUE;
-                tmp = candidates[j];
-                candidates[j] = candidates[j+1];
-                candidates[j+1] = tmp;
-            }
+        top = selectTop(ncandidates, ncandidates - cutoffs);
+
+        /* Keep the other hosts close to the best,
+         * the hosts after them are cut.
+         */
+        j = top;
+        for (i = 0; i < ncandidates; i++) {
+            if (!candKeys[i].sel
+                && fabs(candKeys[i].value - bestload) < threshold)
+                candidates[j++] = candKeys[i].hPtr;
+        }
+        top = j;
+        for (i = 0; i < ncandidates; i++) {
+            if (!candKeys[i].sel
+                && fabs(candKeys[i].value - bestload) >= threshold)
+                candidates[j++] = candKeys[i].hPtr;
         }
-        i++;
+
+        return top;
     }
-    return (cutoffs);
 
+    return selectTop(ncandidates, cutoffs);
 }
 
+/* selectTop()
+ *
+ * Move the best top candidates, in order, to the
+ * head of the candidates, the others follow in
+ * their original order.
+ */
 static int
-orderByStatus(int j, int ignore_res)
+selectTop(int ncandidates, int top)
 {
-    struct hostNode *tmp;
-    int *status1, *status2;
+    struct candKey *k;
+    int i;
+    int j;
 
-    if (candidates[j-1] == fromHostPtr) {
-        status1 = candidates[j-1]->status;
-        status1[1] = candidates[j-1]->status[1] & ~(1 << IT);
-    } else {
-        status1 = candidates[j-1]->status;
+    if (top <= 0)
+        return 0;
+    if (top > ncandidates)
+        top = ncandidates;
+
+    if (candHeap == NULL) {
+        candHeap = heap_make(candKeysSize, cmpCandWorst, NULL);
+        if (candHeap == NULL) {
+            ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "heap_make");
+            return top;
+        }
     }
+    heap_clear(candHeap);
 
-    if (candidates[j] == fromHostPtr) {
-        status2 = candidates[j]->status;
-        status2[1] = candidates[j]->status[1]  & ~(1 << IT);
-    } else {
-        status2 = candidates[j]->status;
-    }
-
-    if ( (ignore_res && LS_ISOKNRES(status2) && ! LS_ISOKNRES(status1)) ||
-         (!ignore_res && LS_ISOK(status2) && ! LS_ISOK(status1))     ||
-         (!ignore_res && LS_ISOKNRES(status2) &&
-          (LS_ISBUSY(status1) || LS_ISLOCKED(status1)) ) ||
-         (! LS_ISUNAVAIL(status2) && LS_ISUNAVAIL(status1)) ||
-         (LS_ISBUSY(status2) && LS_ISLOCKED(status1))) {
-        tmp = candidates[j];
-        candidates[j] = candidates[j-1];
-        candidates[j-1] = tmp;
-        return 0;
+    /* The top of the heap is the worst of the
+     * best hosts found so far.
+     */
+    for (i = 0; i < ncandidates; i++) {
+        k = &candKeys[i];
+        if (HEAP_NUM_ENTRIES(candHeap) < top) {
+            if (heap_insert(candHeap, k) < 0) {
+                ls_syslog(LOG_ERR, I18N_FUNC_FAIL_M, __func__, "heap_insert");
+                return top;
+            }
+            continue;
+        }
+        if (cmpCand(k, HEAP_TOP(candHeap)) < 0) {
+            candHeap->v[0] = k;
+            heap_update(candHeap, 0);
+        }
     }
 
+    for (j = top - 1; j >= 0; j--) {
+        k = heap_pop(candHeap);
+        k->sel = TRUE;
+        candidates[j] = k->hPtr;
+    }
 
-    if (ignore_res && LS_ISOKNRES(status1) && ! LS_ISOKNRES(status2))
-        return 1;
-    if (!ignore_res && LS_ISOK(status1) && ! LS_ISOK(status2))
-        return 1;
-    if (!ignore_res && LS_ISOKNRES(status1) &&
-        (LS_ISBUSY(status2) || LS_ISLOCKED(status2)))
-        return 1;
-    if (! LS_ISUNAVAIL(status1) && LS_ISUNAVAIL(status2))
-        return 1;
-    if (LS_ISBUSY(status1) && LS_ISLOCKED(status2))
+    for (i = 0, j = top; i < ncandidates; i++) {
+        if (!candKeys[i].sel)
+            candidates[j++] = candKeys[i].hPtr;
+    }
+
+    return top;
+}
+
+static int
+cmpCand(const void *x, const void *y)
+{
+    const struct candKey *k1 = x;
+    const struct candKey *k2 = y;
+
+    if (k1->rank != k2->rank)
+        return k1->rank - k2->rank;
+    if (k1->load < k2->load)
+        return -1;
+    if (k1->load > k2->load)
         return 1;
-    if (LS_ISUNAVAIL(status1) && LS_ISUNAVAIL(status2))
 
+    return k1->pos - k2->pos;
+}
+
+static int
+cmpCandWorst(const void *x, const void *y)
+{
+    return cmpCand(y, x);
+}
+
+/* statusRank()
+ *
+ * Hosts that are ok go first, then the ones
+ * ok but for res or sbatchd, the busy, the
+ * locked and the unavailable ones.
+ */
+static int
+statusRank(int *status, int ignore_res)
+{
+    if (ignore_res ? LS_ISOKNRES(status) : LS_ISOK(status))
+        return 0;
+    if (LS_ISOKNRES(status))
         return 1;
+    if (LS_ISUNAVAIL(status))
+        return 4;
+    if (LS_ISLOCKED(status))
+        return 3;
 
     return 2;
-
 }
 
-static void
-mkexld(struct hostNode *hn1, struct hostNode *hn2, int lidx, float *exld1,
-       float *exld2, float coef)
+/* mkexld()
+ *
+ * Load added to the hosts that were not
+ * asked for by name.
+ */
+static float
+mkexld(struct hostNode *hPtr, int lidx, float coef)
 {
-    if(hn1->conStatus == FALSE) {
-        *exld1 = hn1->loadIndex[lidx] * coef;
-        if(!li[lidx].increasing)
-            *exld1 = - *exld1;
-    } else
-        *exld1 = 0;
-
-    if(hn2->conStatus == FALSE) {
-        *exld2 = hn2->loadIndex[lidx] * coef;
-        if(!li[lidx].increasing)
-            *exld2 = - *exld2;
-    } else
-        *exld2 = 0;
+    float exld;
+
+    if (hPtr->conStatus == TRUE)
+        return 0.0;
+
+    exld = hPtr->loadIndex[lidx] * coef;
+    if (!li[lidx].increasing)
+        exld = -exld;
 
+    return exld;
 }
 
 static void
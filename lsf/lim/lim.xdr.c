@@ -27,6 +27,7 @@ static u_short encfloat16_(float );
 static float   decfloat16_(u_short);
 static void freeResPairs (struct resPair *, int);
 static bool_t xdr_resPair (XDR *, struct resPair *, struct LSFHeader *);
+static bool_t xdr_resPairs(XDR *, int, struct resPair **, struct LSFHeader *);
 
 
 bool_t
@@ -35,8 +36,6 @@ xdr_loadvector(XDR *xdrs,
                struct LSFHeader *hdr)
 {
     int i;
-    static struct resPair *resPairs;
-    static int numResPairs;
 
     if (!(xdr_int(xdrs, &lvp->hostNo) &&
           xdr_u_int(xdrs, &lvp->seqNo) &&
@@ -76,23 +75,120 @@ xdr_loadvector(XDR *xdrs,
         return FALSE;
     }
 
+    if (!xdr_resPairs(xdrs, lvp->numResPairs, &lvp->resPairs, hdr))
+        return FALSE;
+
+    return TRUE;
+}
+
+/* xdr_loaddelta()
+ *
+ * A built-in index goes in one word with its number
+ * in the high 16 bits and its value as a float16 in
+ * the low ones like xdr_lvector() does, a user index
+ * number is followed by the float value.
+ */
+bool_t
+xdr_loaddelta(XDR *xdrs,
+              struct loadDeltaStruct *ldp,
+              struct LSFHeader *hdr)
+{
+    u_int a;
+    int i;
+
+    if (!(xdr_int(xdrs, &ldp->hostNo)
+          && xdr_u_int(xdrs, &ldp->seqNo)
+          && xdr_int(xdrs, &ldp->numResPairs)
+          && xdr_int(xdrs, &ldp->checkSum)
+          && xdr_int(xdrs, &ldp->flags)
+          && xdr_int(xdrs, &ldp->numIndx)
+          && xdr_int(xdrs, &ldp->numUsrIndx)
+          && xdr_int(xdrs, &ldp->numDelta))) {
+        return FALSE;
+    }
+
+    if (xdrs->x_op == XDR_DECODE) {
+
+        if (allInfo.numIndx != ldp->numIndx
+            || allInfo.numUsrIndx != ldp->numUsrIndx) {
+            ls_syslog(LOG_ERR, "\
+%s: Sender has a different number of load index vectors. It will be rejected from the cluster by the master host.", __func__);
+            return FALSE;
+        }
+
+        if (ldp->numDelta < 0 || ldp->numDelta > ldp->numIndx)
+            return FALSE;
+    }
+
+    for (i = 0; i < 1 + GET_INTNUM(ldp->numIndx); i++) {
+        if (!xdr_int(xdrs, &ldp->status[i]))
+            return FALSE;
+    }
+
+    for (i = 0; i < ldp->numDelta; i++) {
+
+        if (xdrs->x_op == XDR_ENCODE) {
+            a = ldp->indx[i] << 16;
+            if (ldp->indx[i] < NBUILTINDEX)
+                a += encfloat16_(ldp->li[i]);
+        }
+
+        if (!xdr_u_int(xdrs, &a))
+            return FALSE;
+
+        if (xdrs->x_op == XDR_DECODE) {
+            ldp->indx[i] = (a >> 16) & 0x0000ffff;
+            if (ldp->indx[i] >= ldp->numIndx)
+                return FALSE;
+            if (ldp->indx[i] < NBUILTINDEX)
+                ldp->li[i] = decfloat16_(a & 0x0000ffff);
+        }
+
+        if (ldp->indx[i] >= NBUILTINDEX
+            && !xdr_float(xdrs, &ldp->li[i]))
+            return FALSE;
+    }
+
+    if (!xdr_resPairs(xdrs, ldp->numResPairs, &ldp->resPairs, hdr))
+        return FALSE;
+
+    return TRUE;
+}
+
+/* xdr_resPairs()
+ *
+ * The decoded pairs are kept until the next
+ * message is decoded.
+ */
+static bool_t
+xdr_resPairs(XDR *xdrs,
+             int num,
+             struct resPair **resPairsp,
+             struct LSFHeader *hdr)
+{
+    static struct resPair *resPairs;
+    static int numResPairs;
+    int i;
+
     if (xdrs->x_op == XDR_DECODE) {
         freeResPairs (resPairs, numResPairs);
         resPairs = NULL;
         numResPairs = 0;
-        if (lvp->numResPairs > 0) {
-            resPairs = calloc(lvp->numResPairs,  sizeof(struct resPair));
-            lvp->resPairs = resPairs;
-        } else
-            lvp->resPairs = NULL;
+        if (num > 0) {
+            resPairs = calloc(num, sizeof(struct resPair));
+            if (resPairs == NULL)
+                return FALSE;
+        }
+        *resPairsp = resPairs;
     }
-    for (i = 0; i < lvp->numResPairs; i++) {
+    for (i = 0; i < num; i++) {
         if (!xdr_arrayElement(xdrs,
-                              (char *)&lvp->resPairs[i],
+                              (char *)&(*resPairsp)[i],
                               hdr,
                               xdr_resPair)) {
             if (xdrs->x_op == XDR_DECODE) {
-                freeResPairs (lvp->resPairs, i);
+                freeResPairs (*resPairsp, i);
+                *resPairsp = NULL;
                 resPairs = NULL;
                 numResPairs = 0;
             }
@@ -100,7 +196,7 @@ xdr_loadvector(XDR *xdrs,
         }
     }
     if (xdrs->x_op == XDR_DECODE)
-        numResPairs = lvp->numResPairs;
+        numResPairs = num;
 
     return TRUE;
 }
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2015 David Bigagli
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA
+ *
+ */
+
+/* limbench times the master LIM placement. The lim objects
+ * are linked as they are, their main() renamed, and a
+ * cluster of synthetic hosts with random loads is built in
+ * memory. Each request is parsed and placed the way
+ * placeReq() does it, without the network, and the number
+ * of requests per second is printed for every requested
+ * number of hosts.
+ *
+ * limbench writes its lsf.shared under $TMPDIR and
+ * removes it on exit.
+ */
+
+#include <sys/time.h>
+#include "lim.h"
+
+/* lim.main.c is compiled with its main() renamed.
+ */
+#undef main
+
+#define BENCH_DEF_HOSTS    10000
+#define BENCH_DEF_REQS     1000
+#define BENCH_DEF_RESREQ   "order[r15s:pg]"
+#define BENCH_CLUSTER      "benchcluster"
+#define BENCH_HOSTTYPE     "linux"
+#define BENCH_MAXCPUS      8
+
+static char *benchDir;
+static char *fromHost;
+
+static void usage(void);
+static int writeShared(void);
+static void rmShared(void);
+static int initBench(int, long);
+static double runBench(const char *, int, int);
+static double now(void);
+
+int
+main(int argc, char **argv)
+{
+    static int defSizes[] = {1, 4, 16, 64};
+    char *resReq;
+    int *sizes;
+    int numSizes;
+    int nHosts;
+    int nReqs;
+    long seed;
+    double t;
+    int cc;
+    int i;
+
+    resReq = BENCH_DEF_RESREQ;
+    nHosts = BENCH_DEF_HOSTS;
+    nReqs = BENCH_DEF_REQS;
+    seed = 1;
+    sizes = defSizes;
+    numSizes = sizeof(defSizes)/sizeof(defSizes[0]);
+
+    while ((cc = getopt(argc, argv, "hVm:n:R:N:s:")) != EOF) {
+        switch (cc) {
+            case 'm':
+                nHosts = atoi(optarg);
+                break;
+            case 'n':
+                nReqs = atoi(optarg);
+                break;
+            case 'R':
+                resReq = optarg;
+                break;
+            case 'N':
+                sizes = calloc(1, sizeof(int));
+                sizes[0] = atoi(optarg);
+                numSizes = 1;
+                break;
+            case 's':
+                seed = atol(optarg);
+                break;
+            case 'V':
+                fputs(_LS_VERSION_, stderr);
+                return 0;
+            case 'h':
+            default:
+                usage();
+                return -1;
+        }
+    }
+
+    if (nHosts <= 0 || nReqs <= 0 || sizes[0] <= 0) {
+        usage();
+        return -1;
+    }
+
+    if (initBench(nHosts, seed) < 0)
+        return -1;
+
+    printf("limbench: %d hosts, %d requests, resreq \"%s\"\n",
+           nHosts, nReqs, resReq);
+
+    for (i = 0; i < numSizes; i++) {
+        t = runBench(resReq, sizes[i], nReqs);
+        if (t < 0)
+            return -1;
+        printf("numHosts %4d %10.1f requests/sec %10.1f usec/request\n",
+               sizes[i], nReqs / t, t * 1e6 / nReqs);
+    }
+
+    return 0;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "\
+usage: limbench [-h] [-V] [-m hosts] [-n requests] [-N numhosts]\n\
+                [-R resreq] [-s seed]\n");
+}
+
+/* writeShared()
+ */
+static int
+writeShared(void)
+{
+    char buf[MAXFILENAMELEN];
+    char *tmp;
+    FILE *fp;
+
+    tmp = getenv("TMPDIR");
+    if (tmp == NULL)
+        tmp = "/tmp";
+    sprintf(buf, "%s/limbench.XXXXXX", tmp);
+    if (mkdtemp(buf) == NULL) {
+        fprintf(stderr, "limbench: mkdtemp() %s failed: %s\n",
+                buf, strerror(errno));
+        return -1;
+    }
+    benchDir = strdup(buf);
+    atexit(rmShared);
+
+    sprintf(buf, "%s/lsf.shared", benchDir);
+    if ((fp = fopen(buf, "w")) == NULL) {
+        fprintf(stderr, "limbench: fopen() %s failed: %s\n",
+                buf, strerror(errno));
+        return -1;
+    }
+    fprintf(fp, "\
+Begin Cluster\n\
+ClusterName\n\
+%s\n\
+End Cluster\n\
+\n\
+Begin HostType\n\
+TYPENAME\n\
+%s\n\
+End HostType\n\
+\n\
+Begin HostModel\n\
+MODELNAME  CPUFACTOR   ARCHITECTURE\n\
+bench      1.0         (x86_64)\n\
+End HostModel\n\
+\n\
+Begin Resource\n\
+RESOURCENAME  TYPE    INTERVAL INCREASING  DESCRIPTION\n\
+cs            Boolean ()       ()          (Compute server)\n\
+End Resource\n", BENCH_CLUSTER, BENCH_HOSTTYPE);
+    fclose(fp);
+
+    return 0;
+}
+
+/* rmShared()
+ */
+static void
+rmShared(void)
+{
+    char buf[MAXFILENAMELEN];
+
+    sprintf(buf, "%s/lsf.shared", benchDir);
+    if (unlink(buf) < 0 && errno != ENOENT)
+        fprintf(stderr, "limbench: unlink() %s failed: %s\n",
+                buf, strerror(errno));
+    if (rmdir(benchDir) < 0)
+        fprintf(stderr, "limbench: rmdir() %s failed: %s\n",
+                benchDir, strerror(errno));
+}
+
+/* initBench()
+ *
+ * Read the shared configuration and build the cluster
+ * with this LIM as its master. The built in load
+ * indices of the hosts are random within their usual
+ * range, there are no busy thresholds so every host
+ * is eligible and the order of the request decides.
+ */
+static int
+initBench(int nHosts, long seed)
+{
+    struct hostNode *hPtr;
+    struct hostNode *last;
+    struct tclLsInfo *tclLsInfo;
+    char name[MAXHOSTNAMELEN];
+    int i;
+    int j;
+
+    if (writeShared() < 0)
+        return -1;
+
+    limParams[LSF_CONFDIR].paramValue = benchDir;
+
+    initLiStruct();
+    if (readShared() < 0) {
+        fprintf(stderr, "limbench: readShared() failed\n");
+        return -1;
+    }
+    reCheckRes();
+
+    if ((tclLsInfo = getTclLsInfo()) == NULL
+        || initTcl(tclLsInfo) < 0) {
+        fprintf(stderr, "limbench: initTcl() failed\n");
+        return -1;
+    }
+    initParse(&allInfo);
+
+    myClusterPtr->status = CLUST_STAT_OK | CLUST_ACTIVE | CLUST_ALL_ELIGIBLE;
+
+    srand48(seed);
+
+    last = NULL;
+    for (i = 0; i < nHosts; i++) {
+
+        if ((hPtr = initHostNode()) == NULL)
+            return -1;
+
+        sprintf(name, "bench%05d", i);
+        hPtr->hostName = strdup(name);
+        hPtr->hostNo = i;
+        hPtr->hTypeNo = 0;
+        hPtr->hModelNo = 0;
+        hPtr->infoValid = TRUE;
+        hPtr->status[0] = 0;
+        hPtr->statInfo.maxCpus = BENCH_MAXCPUS;
+        hPtr->statInfo.maxMem = 64 * 1024;
+        hPtr->statInfo.maxSwap = 64 * 1024;
+        hPtr->statInfo.maxTmp = 1024 * 1024;
+
+        for (j = 0; j < NBUILTINDEX; j++) {
+            switch (j) {
+                case R15S:
+                case R1M:
+                case R15M:
+                    hPtr->uloadIndex[j] = drand48() * 2 * BENCH_MAXCPUS;
+                    hPtr->loadIndex[j] = hPtr->uloadIndex[j] / BENCH_MAXCPUS;
+                    break;
+                case UT:
+                    hPtr->loadIndex[j] = drand48();
+                    break;
+                case MEM:
+                case SWP:
+                    hPtr->loadIndex[j] = drand48() * 64 * 1024;
+                    break;
+                case TMP:
+                    hPtr->loadIndex[j] = drand48() * 1024 * 1024;
+                    break;
+                default:
+                    hPtr->loadIndex[j] = drand48() * 100;
+                    break;
+            }
+            if (j != R15S && j != R1M && j != R15M)
+                hPtr->uloadIndex[j] = hPtr->loadIndex[j];
+            hPtr->busyThreshold[j] = li[j].increasing ?
+                INFINIT_LOAD : -INFINIT_LOAD;
+        }
+
+        if (last)
+            last->nextPtr = hPtr;
+        else
+            myClusterPtr->hostList = hPtr;
+        last = hPtr;
+        myClusterPtr->numHosts++;
+    }
+
+    myHostPtr = myClusterPtr->hostList;
+    myClusterPtr->masterPtr = myHostPtr;
+    masterMe = TRUE;
+    fromHost = myHostPtr->hostName;
+
+    return 0;
+}
+
+/* runBench()
+ *
+ * Return the seconds it takes to place nReqs
+ * requests of numHosts hosts each.
+ */
+static double
+runBench(const char *resReq, int numHosts, int nReqs)
+{
+    struct decisionReq plReq;
+    struct placeReply placeReply;
+    struct resVal resVal;
+    enum limReplyCode cc;
+    double t;
+    int i;
+
+    memset(&plReq, 0, sizeof(struct decisionReq));
+    plReq.ofWhat = OF_ANY;
+    plReq.numHosts = numHosts;
+    strcpy(plReq.hostType, " ");
+    strcpy(plReq.resReq, resReq);
+    plReq.numPrefs = 1;
+    plReq.preferredHosts = &fromHost;
+
+    t = now();
+    for (i = 0; i < nReqs; i++) {
+
+        initResVal(&resVal);
+        if (parseResReq(plReq.resReq, &resVal, &allInfo, PR_ALL) != PARSE_OK) {
+            fprintf(stderr, "limbench: bad resreq %s\n", resReq);
+            return -1;
+        }
+
+        fromHostPtr = NULL;
+        cc = placeHosts(&plReq, &resVal, &placeReply);
+        if (cc != LIME_NO_ERR) {
+            fprintf(stderr, "limbench: placeHosts() failed %d\n", cc);
+            freeResVal(&resVal);
+            return -1;
+        }
+
+        free(placeReply.placeInfo);
+        freeResVal(&resVal);
+    }
+
+    return now() - t;
+}
+
+static double
+now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
@@ -87,7 +87,7 @@ extern char **environ;
  * comparibility where vN daemon talks
  * to vN-1 library
  */
-#define OPENLAVA_XDR_VERSION 31
+#define OPENLAVA_XDR_VERSION 32
 
 #define LSF_DEFAULT_SOCKS       15
 #define MAXLINELEN              PATH_MAX
@@ -596,6 +596,19 @@ struct hostEntryLog {
 struct infoCPUs {
     int numCPU;     /* CPU number */
     int numTasks;   /* number of tasks on this CPU */
+    int numNode;    /* NUMA node of this CPU */
+};
+
+/* Usage of a job read from its cgroup v2
+ * stat files, the parts that do not fit in
+ * struct jRusage.
+ */
+struct cgroupUsage {
+    long long usageUsec;   /* cpu.stat usage_usec */
+    long long memCurrent;  /* memory.current bytes */
+    long long memPeak;     /* memory.peak bytes, or -1 */
+    long long rbytes;      /* io.stat read bytes */
+    long long wbytes;      /* io.stat written bytes */
 };
 
 /* openlava error numbers
@@ -1003,6 +1016,11 @@ extern int ls_constrain_mem(int, pid_t);
 extern int ls_rmcgroup_mem(pid_t);
 extern int lsb_constrain_mem(const char *, int, pid_t);
 extern int lsb_rmcgroup_mem(const char *,  pid_t);
+extern bool_t ls_cgroup2(void);
+extern int lsb_constrain_cgroup2(const char *, pid_t,
+                                 unsigned long long, int, const char *);
+extern struct jRusage *lsb_cgroup2_rusage(const char *, struct cgroupUsage *);
+extern int lsb_rmcgroup2(const char *);
 
 #ifndef __CYGWIN__
 extern int optind;
@@ -23,3 +23,4 @@
 extern char infofile[];
 extern int pimPort;
 extern int scan_procs(void);
+extern void publishProcs(struct pimProcEnt *, int);
@@ -17,182 +17,299 @@
  *
  */
 
+#include <sys/resource.h>
 #include "pim.h"
 
-static struct lsPidInfo procs[MAX_PROC_ENT];
+/* The processes are kept from one scan to the next,
+ * hashed by pid, with /proc/<pid>/stat open. A scan
+ * rereads each stat file with pread() and parses it
+ * only if it changed. The stat file of a pid that
+ * was reused fails with ESRCH, it is then reopened.
+ */
+#define PROC_HASH_SIZE 4096
+#define STAT_SAVE_LEN  512
+
+struct procEnt {
+    struct procEnt *next;
+    int fd;
+    int gen;
+    int len;
+    char stat[STAT_SAVE_LEN];
+    struct pimProcEnt ent;
+};
+
+static struct procEnt *procHash[PROC_HASH_SIZE];
+static struct pimProcEnt *procs;
+static int maxprocs;
 static int numprocs;
-static int ls_pidinfo(int, struct lsPidInfo *);
-static int parse_stat(char *, struct lsPidInfo *);
-static void logProcessInfo(void);
+static int scanGen;
+static int numFds;
+static int maxFds;
+static long pageKB;
+
+static struct procEnt *getProc(int);
+static void sweepProcs(void);
+static int readStat(struct procEnt *);
+static int parse_stat(char *, struct pimProcEnt *);
 
 int
 scan_procs(void)
 {
-    DIR *dir;
+    static DIR *dir;
     struct dirent *process;
-    struct lsPidInfo rec;
+    struct procEnt *p;
+    int pid;
 
-    dir = opendir("/proc");
     if (dir == NULL) {
-        ls_syslog(LOG_ERR, "\
+        struct rlimit rl;
+
+        /* One descriptor per process.
+         */
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+            if (rl.rlim_cur < rl.rlim_max) {
+                rl.rlim_cur = rl.rlim_max;
+                setrlimit(RLIMIT_NOFILE, &rl);
+                getrlimit(RLIMIT_NOFILE, &rl);
+            }
+            maxFds = rl.rlim_cur > INT_MAX ? INT_MAX : rl.rlim_cur;
+            maxFds -= 64;
+        }
+        pageKB = sysconf(_SC_PAGESIZE)/1024;
+
+        dir = opendir("/proc");
+        if (dir == NULL) {
+            ls_syslog(LOG_ERR, "\
 %s: opendir(/proc) failed: %m.", __func__);
-        return -1;
+            return -1;
+        }
+    } else {
+        rewinddir(dir);
     }
 
+    ++scanGen;
     numprocs = 0;
     while ((process = readdir(dir))) {
 
         if (! isdigit(process->d_name[0]))
             continue;
 
-        if (ls_pidinfo(atoi(process->d_name), &rec) != 0)
-            continue;
+        pid = atoi(process->d_name);
+        if ((p = getProc(pid)) == NULL)
+            break;
+        p->gen = scanGen;
 
-        if (rec.pgid == 1)
+        if (readStat(p) != 0)
             continue;
 
-        procs[numprocs].pid = rec.pid;
-        procs[numprocs].ppid = rec.ppid;
-        procs[numprocs].pgid = rec.pgid;
-
-        procs[numprocs].utime = rec.utime/100;
-        procs[numprocs].stime = rec.stime/100;
-        procs[numprocs].cutime = rec.cutime/100;
-        procs[numprocs].cstime = rec.cstime/100;
+        if (p->ent.pgid == 1)
+            continue;
 
-        procs[numprocs].proc_size = rec.proc_size;
-        procs[numprocs].resident_size
-            = rec.resident_size * (sysconf(_SC_PAGESIZE)/1024);
-        procs[numprocs].stack_size = rec.stack_size;
-        if ( procs[numprocs].stack_size < 0 )
-            procs[numprocs].stack_size = 0;
-        procs[numprocs].status = rec.status;
+        if (numprocs == maxprocs) {
+            struct pimProcEnt *tmp;
+            int n;
+
+            n = maxprocs ? 2 * maxprocs : MAX_PROC_ENT;
+            tmp = realloc(procs, n * sizeof(struct pimProcEnt));
+            if (tmp == NULL) {
+                ls_syslog(LOG_ERR, "\
+%s: realloc() %d processes failed: %m.", __func__, n);
+                break;
+            }
+            procs = tmp;
+            maxprocs = n;
+        }
 
+        procs[numprocs] = p->ent;
         ++numprocs;
-        if (numprocs == MAX_PROC_ENT - 1) {
-            ls_syslog(LOG_INFO, "\
-%s: maximum number of processes %d reached.", __func__, numprocs);
-            break;
-        }
     }
 
-    closedir(dir);
+    sweepProcs();
 
-    logProcessInfo();
+    publishProcs(procs, numprocs);
 
     return 0;
 }
 
-/* logProcessInfo()
+/* getProc()
  */
-static void
-logProcessInfo(void)
+static struct procEnt *
+getProc(int pid)
 {
-    int i;
-    FILE *fp;
-    static char wfile[MAXFILENAMELEN];
+    struct procEnt *p;
+    int h;
 
-    sprintf(wfile, "%s.%d", infofile, getpid());
-
-    fp = fopen(wfile, "w");
-    if (fp == NULL) {
-        ls_syslog(LOG_ERR, "%s: fopen() %s failed %m.", wfile);
-        return;
+    h = pid % PROC_HASH_SIZE;
+    for (p = procHash[h]; p; p = p->next) {
+        if (p->ent.pid == pid)
+            return p;
     }
 
-    fprintf(fp, "%d\n", pimPort);
-    for (i = 0; i < numprocs; i++) {
-
-        fprintf(fp, "\
-%d %d %d %d %d %d %d %d %d %d %d %d\n",
-                procs[i].pid, procs[i].ppid, procs[i].pgid, procs[i].jobid,
-                procs[i].utime, procs[i].stime, procs[i].cutime,
-                procs[i].cstime, procs[i].proc_size,
-                procs[i].resident_size, procs[i].stack_size,
-                (int) procs[i].status);
+    p = calloc(1, sizeof(struct procEnt));
+    if (p == NULL) {
+        ls_syslog(LOG_ERR, "%s: calloc() failed: %m.", __func__);
+        return NULL;
     }
-    fclose(fp);
+    p->fd = -1;
+    p->ent.pid = pid;
+    p->next = procHash[h];
+    procHash[h] = p;
 
-    if (unlink(infofile) < 0 && errno != ENOENT) {
-        ls_syslog(LOG_DEBUG, "\
-%s: unlink(%s) failed: %m.", __func__, infofile);
-    }
+    return p;
+}
 
-    if (rename(wfile, infofile) < 0) {
-        ls_syslog(LOG_ERR, "\
-%s: rename() %s to %s failed: %m.", __func__, wfile, infofile);
+/* sweepProcs()
+ *
+ * Forget the processes not seen in this scan.
+ */
+static void
+sweepProcs(void)
+{
+    struct procEnt **pp;
+    struct procEnt *p;
+    int h;
+
+    for (h = 0; h < PROC_HASH_SIZE; h++) {
+        pp = &procHash[h];
+        while ((p = *pp)) {
+            if (p->gen == scanGen) {
+                pp = &p->next;
+                continue;
+            }
+            *pp = p->next;
+            if (p->fd >= 0) {
+                close(p->fd);
+                --numFds;
+            }
+            free(p);
+        }
     }
-    unlink(wfile);
-
-    ls_syslog(LOG_DEBUG, "\
-%s: process table updated.", __func__);
-
 }
 
-/* ls_pidinfo()
+/* readStat()
+ *
+ * Read the stat file of the process, 0 if the
+ * process is there, -1 if it is gone.
  */
 static int
-ls_pidinfo(int pid, struct lsPidInfo *rec)
+readStat(struct procEnt *p)
 {
+    char filename[64];
+    char buffer[BUFSIZ];
     int fd;
-    static char filename[PATH_MAX];
-    static char buffer[BUFSIZ];
+    int cc;
+
+    cc = -1;
+    if ((fd = p->fd) >= 0) {
+        cc = pread(fd, buffer, sizeof(buffer) - 1, 0);
+        if (cc <= 0) {
+            /* The process is gone and the
+             * pid is used by a new one.
+             */
+            close(fd);
+            --numFds;
+            p->fd = fd = -1;
+            p->len = 0;
+        }
+    }
 
-    sprintf(filename, "/proc/%d/stat", pid);
+    if (fd < 0) {
+        sprintf(filename, "/proc/%d/stat", p->ent.pid);
+        fd = open(filename, O_RDONLY, 0);
+        if (fd == -1) {
+            if (errno != ENOENT)
+                ls_syslog(LOG_ERR, "\
+%s: open() failed %s %m.", __func__, filename);
+            return -1;
+        }
 
-    fd = open(filename, O_RDONLY, 0);
-    if (fd == -1) {
-        ls_syslog(LOG_ERR, "\
-%s: open() failed %s %m.", __func__, filename );
-        return -1;
+        cc = pread(fd, buffer, sizeof(buffer) - 1, 0);
+        if (cc <= 0) {
+            close(fd);
+            return -1;
+        }
+
+        /* Keep it open unless we are
+         * short of descriptors.
+         */
+        if (numFds < maxFds) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            p->fd = fd;
+            ++numFds;
+        } else {
+            close(fd);
+        }
     }
+    buffer[cc] = 0;
 
-    if (read(fd, buffer, sizeof(buffer) - 1) <= 0) {
-        ls_syslog(LOG_ERR, "\
-%s: read() failed %s %m.", __func__, filename);
-        close(fd);
+    if (cc == p->len
+        && memcmp(buffer, p->stat, cc) == 0)
+        return 0;
+
+    if (parse_stat(buffer, &p->ent) < 0) {
+        p->len = 0;
         return -1;
     }
-    close(fd);
 
-    if (parse_stat(buffer, rec) < 0) {
-        ls_syslog(LOG_ERR, "\
-%s: parse_stat() failed process %d.", __func__, pid);
-        return -1;
+    if (cc < STAT_SAVE_LEN) {
+        memcpy(p->stat, buffer, cc);
+        p->len = cc;
+    } else {
+        p->len = 0;
     }
 
     return 0;
 }
 
 /* parse_stat()
+ *
+ * The command may have blanks and parentheses,
+ * the fields start after the last ')'.
  */
 static int
-parse_stat(char *buf, struct lsPidInfo *pinfo)
+parse_stat(char *buf, struct pimProcEnt *pinfo)
 {
-    unsigned int rss_rlim;
-    unsigned int start_code;
-    unsigned int end_code;
-    unsigned int start_stack;
-    unsigned int end_stack;
-    unsigned char status;
-    unsigned long vsize;
-
-    sscanf(buf, "\
-%d %s %c %d %d %*d %*d %*d %*u %*u %*u %*u %*u %d %d %d "
-           "%d %*d %*d %*u %*u %*d %lu %u %u %u %u %u %u",
-           &pinfo->pid, pinfo->command, &status, &pinfo->ppid, &pinfo->pgid,
-           &pinfo->utime, &pinfo->stime, &pinfo->cutime, &pinfo->cstime,
-           &vsize, &pinfo->resident_size, &rss_rlim, &start_code,
-           &end_code, &start_stack, &end_stack);
-
-    if (pinfo->pid == 0) {
+    unsigned long f[26];
+    char status;
+    char *sp;
+    char *ep;
+    int i;
+
+    sp = strrchr(buf, ')');
+    if (sp == NULL || sp[1] != ' ' || sp[2] == 0) {
         ls_syslog(LOG_ERR, "\
-%s: invalid process 0 found: %s", __func__, buf);
+%s: invalid stat of process %d: %s", __func__, pinfo->pid, buf);
         return -1;
     }
+    status = sp[2];
+    sp += 3;
+
+    /* f[i] is the field i + 4 of proc(5).
+     */
+    for (i = 0; i < 26; i++) {
+        f[i] = strtoul(sp, &ep, 10);
+        if (ep == sp)
+            break;
+        sp = ep;
+    }
+    if (i < 26) {
+        ls_syslog(LOG_ERR, "\
+%s: short stat of process %d: %s", __func__, pinfo->pid, buf);
+        return -1;
+    }
+
+    pinfo->ppid = f[0];
+    pinfo->pgid = f[1];
+
+    pinfo->utime = (int)f[10]/100;
+    pinfo->stime = (int)f[11]/100;
+    pinfo->cutime = (int)f[12]/100;
+    pinfo->cstime = (int)f[13]/100;
 
-    pinfo->stack_size = start_stack - end_stack;
-    pinfo->proc_size = vsize/1024;
+    pinfo->proc_size = f[19]/1024;
+    pinfo->resident_size = (int)f[20] * pageKB;
+    pinfo->stack_size = (unsigned int)f[24] - (unsigned int)f[25];
+    if (pinfo->stack_size < 0)
+        pinfo->stack_size = 0;
 
     switch (status) {
         case 'R' :
@@ -17,6 +17,7 @@
  *
  */
 
+#include <sys/mman.h>
 #include "pim.h"
 
 static int gothup;
@@ -54,6 +55,12 @@ enum {
  */
 char infofile[PATH_MAX];
 int pimPort;
+/* The binary process table next to
+ * the info file.
+ */
+static char tablefile[PATH_MAX];
+static struct pimTable *table;
+static size_t tableSize;
 static int pim_debug;
 static int sleepTime = PIM_SLEEP_TIME;
 static int updInterval = PIM_UPDATE_INTERVAL;
@@ -61,6 +68,7 @@ static int updInterval = PIM_UPDATE_INTERVAL;
 static int doServ(void);
 static void hup(int);
 static void updateProcs(void);
+static int newTable(int);
 
 static void
 usage (const char *cmd)
@@ -174,6 +182,12 @@ pim: Howdy this is Process Information Manager daemon on host %s.", myHost);
         sprintf(infofile, "\
 %s/pim.info.%s", pimParams[LSF_PIM_INFODIR].paramValue, myHost);
     }
+    if (snprintf(tablefile, sizeof(tablefile), "%s.tab", infofile)
+        >= (int)sizeof(tablefile)) {
+        ls_syslog(LOG_ERR, "\
+%s: process table name %s.tab is too long", __func__, infofile);
+        return -1;
+    }
 
     /* Like a good old Unix deamon do something
      * upon receiving SIGHUP.
@@ -317,3 +331,105 @@ hup(int sig)
 {
     gothup = 1;
 }
+
+/* publishProcs()
+ *
+ * Copy the processes in the table, consumers
+ * retry while seq is odd or has changed.
+ */
+void
+publishProcs(struct pimProcEnt *procs, int numProcs)
+{
+    if (table == NULL
+        || numProcs > table->maxProcs) {
+        if (newTable(numProcs) < 0)
+            return;
+    }
+
+    table->seq++;
+    __sync_synchronize();
+
+    memcpy(table->procs, procs, numProcs * sizeof(struct pimProcEnt));
+    table->numProcs = numProcs;
+    table->updateTime = time(NULL);
+
+    __sync_synchronize();
+    table->seq++;
+
+    ls_syslog(LOG_DEBUG, "\
+%s: process table updated %d processes.", __func__, numProcs);
+}
+
+/* newTable()
+ *
+ * Create a table with room for twice numProcs, the
+ * old one is marked stale so that the consumers
+ * map the new one.
+ */
+static int
+newTable(int numProcs)
+{
+    struct pimTable *t;
+    char wfile[PATH_MAX];
+    size_t size;
+    int maxProcs;
+    int fd;
+
+    maxProcs = 2 * numProcs;
+    if (maxProcs < MAX_PROC_ENT)
+        maxProcs = MAX_PROC_ENT;
+    size = sizeof(struct pimTable) + maxProcs * sizeof(struct pimProcEnt);
+
+    if (snprintf(wfile, sizeof(wfile), "%s.%d", tablefile, (int)getpid())
+        >= (int)sizeof(wfile)) {
+        ls_syslog(LOG_ERR, "\
+%s: process table name %s.%d is too long.", __func__, tablefile, (int)getpid());
+        return -1;
+    }
+    fd = open(wfile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ls_syslog(LOG_ERR, "%s: open() %s failed: %m.", __func__, wfile);
+        return -1;
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        ls_syslog(LOG_ERR, "%s: ftruncate() %s failed: %m.", __func__, wfile);
+        close(fd);
+        unlink(wfile);
+        return -1;
+    }
+
+    t = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (t == MAP_FAILED) {
+        ls_syslog(LOG_ERR, "%s: mmap() %s failed: %m.", __func__, wfile);
+        unlink(wfile);
+        return -1;
+    }
+
+    t->magic = PIM_TABLE_MAGIC;
+    t->version = PIM_TABLE_VERSION;
+    t->port = pimPort;
+    t->maxProcs = maxProcs;
+
+    if (rename(wfile, tablefile) < 0) {
+        ls_syslog(LOG_ERR, "\
+%s: rename() %s to %s failed: %m.", __func__, wfile, tablefile);
+        munmap(t, size);
+        unlink(wfile);
+        return -1;
+    }
+
+    if (table) {
+        table->stale = 1;
+        munmap(table, tableSize);
+    }
+    table = t;
+    tableSize = size;
+
+    ls_syslog(LOG_INFO, "\
+%s: process table %s room for %d processes.", __func__,
+              tablefile, maxProcs);
+
+    return 0;
+}